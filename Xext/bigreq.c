@@ -33,6 +33,7 @@ from The Open Group.
 #include <X11/extensions/bigreqsproto.h>
 
 #include "dix/dix_priv.h"
+#include "os/readthread.h"
 
 #include "misc.h"
 #include "os.h"
@@ -54,6 +55,7 @@ ProcBigReqDispatch(ClientPtr client)
         return BadRequest;
     REQUEST_SIZE_MATCH(xBigReqEnableReq);
     client->big_requests = TRUE;
+    ReadThreadBigRequests(client);
     rep = (xBigReqEnableReply) {
         .type = X_Reply,
         .sequenceNumber = client->sequence,
@@ -43,6 +43,7 @@ in this Software without prior written authorization from The Open Group.
 #include <X11/Xfuncproto.h>
 
 #include "dix/dix_priv.h"
+#include "dix/property_priv.h"
 #include "os/auth.h"
 #include "os/busfault.h"
 #include "os/osdep.h"
@@ -53,6 +54,7 @@ in this Software without prior written authorization from The Open Group.
 #include "resource.h"
 #include "scrnintstr.h"
 #include "windowstr.h"
+#include "propertyst.h"
 #include "pixmapstr.h"
 #include "gcstruct.h"
 #include "extnsionst.h"
@@ -94,6 +96,22 @@ in this Software without prior written authorization from The Open Group.
 #include "panoramiXsrv.h"
 #endif
 
+/*
+ * ShmPutProperty and ShmGetProperty move property contents through a
+ * shared memory segment instead of the request and reply, for clients
+ * transferring very large properties (clipboard managers and the like).
+ *
+ * Their opcodes, wire structures and the MIT-SHM version that brings them
+ * are the protocol's to define, so they are only built against a
+ * shmproto.h that has them; until then MIT-SHM stays at the version it
+ * was and clients get BadRequest for them.
+ */
+#ifdef X_ShmPutProperty
+#define SHM_PROPERTIES 1
+#else
+#define SHM_PROPERTIES 0
+#endif
+
 typedef struct _ShmScrPrivateRec {
     CloseScreenProcPtr CloseScreen;
     ShmFuncsPtr shmFuncs;
@@ -611,6 +629,138 @@ ProcShmPutImage(ClientPtr client)
     return Success;
 }
 
+/* Whether the rectangle of a ShmGetImage is all in the drawable. */
+static int
+ShmGetImageCheck(DrawablePtr pDraw, int x, int y, int width, int height)
+{
+    if (pDraw->type == DRAWABLE_WINDOW) {
+        if (   /* check for being viewable */
+               !((WindowPtr) pDraw)->realized ||
+               /* check for being on screen */
+               pDraw->x + x < 0 ||
+               pDraw->x + x + width > pDraw->pScreen->width
+               || pDraw->y + y < 0 ||
+               pDraw->y + y + height > pDraw->pScreen->height ||
+               /* check for being inside of border */
+               x < -wBorderWidth((WindowPtr) pDraw) ||
+               x + width > wBorderWidth((WindowPtr) pDraw) + (int) pDraw->width ||
+               y < -wBorderWidth((WindowPtr) pDraw) ||
+               y + height > wBorderWidth((WindowPtr) pDraw) + (int) pDraw->height)
+            return BadMatch;
+    }
+    else {
+        if (x < 0 || x + width > pDraw->width ||
+            y < 0 || y + height > pDraw->height)
+            return BadMatch;
+    }
+    return Success;
+}
+
+static void
+ShmGetImageLines(ClientPtr client, DrawablePtr pDraw, int format,
+                 int x, int y, int width, int nlines, Mask planemask,
+                 char *addr)
+{
+    (*pDraw->pScreen->GetImage) (pDraw, x, y, width, nlines,
+                                 format, planemask, addr);
+    if (pDraw->type == DRAWABLE_WINDOW)
+        XaceCensorImage(client, &((WindowPtr) pDraw)->borderClip,
+                        format == ZPixmap ?
+                        PixmapBytePad(width, pDraw->depth) :
+                        BitmapBytePad(width),
+                        pDraw, x, y, width, nlines, format, addr);
+}
+
+static void
+ShmSendGetImageReply(ClientPtr client, xShmGetImageReply *xgi)
+{
+    if (client->swapped) {
+        swaps(&xgi->sequenceNumber);
+        swapl(&xgi->length);
+        swapl(&xgi->visual);
+        swapl(&xgi->size);
+    }
+    WriteToClient(client, sizeof(xShmGetImageReply), xgi);
+}
+
+/*
+ * Like core GetImage, images of more than SHM_IMAGE_STEPS_MIN bytes are
+ * got in steps of about SHM_IMAGE_STEP bytes, between other clients' turns.
+ * The segment is held on to until then.  The reply goes out after the last
+ * step, or an error if the drawable went away or shrank in between.
+ */
+#define SHM_IMAGE_STEPS_MIN (16 * IMAGE_BUFSIZE)
+#define SHM_IMAGE_STEP (4 * IMAGE_BUFSIZE)
+
+typedef struct _ShmGetImageSteps {
+    xShmGetImageReply xgi;
+    ShmDescPtr shmdesc;
+    Drawable drawable;
+    int format;
+    int x, y, width, height;
+    Mask planemask;
+    Mask plane;                 /* for XYPixmap, the plane being got */
+    long widthBytesLine;
+    int linesPerStep;
+    int linesDone;
+    char *addr;                 /* where the next lines go */
+} ShmGetImageStepsRec, *ShmGetImageStepsPtr;
+
+static Bool
+ShmGetImageStep(ClientPtr client, void *closure)
+{
+    ShmGetImageStepsPtr steps = closure;
+    DrawablePtr pDraw;
+    int y = steps->y + steps->linesDone;
+    int nlines = min(steps->linesPerStep, steps->height - steps->linesDone);
+    int rc;
+
+    rc = dixLookupDrawable(&pDraw, steps->drawable, client, 0, DixReadAccess);
+    if (rc == Success)
+        rc = ShmGetImageCheck(pDraw, steps->x, steps->y,
+                              steps->width, steps->height);
+    if (rc == Success && pDraw->depth != steps->xgi.depth)
+        rc = BadMatch;
+    if (rc != Success) {
+        SendErrorToClient(client, ShmReqCode, X_ShmGetImage,
+                          steps->drawable, rc);
+        return TRUE;
+    }
+
+    if (pDraw->type == DRAWABLE_WINDOW)
+        pDraw->pScreen->SourceValidate(pDraw, steps->x, y,
+                                       steps->width, nlines,
+                                       IncludeInferiors);
+    ShmGetImageLines(client, pDraw, steps->format, steps->x, y,
+                     steps->width, nlines,
+                     steps->format == ZPixmap ? steps->planemask : steps->plane,
+                     steps->addr);
+    steps->addr += nlines * steps->widthBytesLine;
+    steps->linesDone += nlines;
+    if (steps->linesDone < steps->height)
+        return FALSE;
+
+    if (steps->format == XYPixmap) {
+        steps->linesDone = 0;
+        do
+            steps->plane >>= 1;
+        while (steps->plane && !(steps->planemask & steps->plane));
+        if (steps->plane)
+            return FALSE;
+    }
+    ShmSendGetImageReply(client, &steps->xgi);
+    return TRUE;
+}
+
+static void
+ShmGetImageStepsDone(void *closure)
+{
+    ShmGetImageStepsPtr steps = closure;
+
+    ShmDetachSegment(steps->shmdesc, 0);
+    free(steps);
+}
+
 static int
 ProcShmGetImage(ClientPtr client)
 {
@@ -619,8 +769,8 @@ ProcShmGetImage(ClientPtr client)
     Mask plane = 0;
     xShmGetImageReply xgi;
     ShmDescPtr shmdesc;
+    ShmGetImageStepsPtr steps;
     VisualID visual = None;
-    RegionPtr pVisibleRegion = NULL;
     int rc;
 
     REQUEST(xShmGetImageReq);
@@ -634,37 +784,12 @@ ProcShmGetImage(ClientPtr client)
     if (rc != Success)
         return rc;
     VERIFY_SHMPTR(stuff->shmseg, stuff->offset, TRUE, shmdesc, client);
-    if (pDraw->type == DRAWABLE_WINDOW) {
-        if (   /* check for being viewable */
-               !((WindowPtr) pDraw)->realized ||
-               /* check for being on screen */
-               pDraw->x + stuff->x < 0 ||
-               pDraw->x + stuff->x + (int) stuff->width > pDraw->pScreen->width
-               || pDraw->y + stuff->y < 0 ||
-               pDraw->y + stuff->y + (int) stuff->height >
-               pDraw->pScreen->height ||
-               /* check for being inside of border */
-               stuff->x < -wBorderWidth((WindowPtr) pDraw) ||
-               stuff->x + (int) stuff->width >
-               wBorderWidth((WindowPtr) pDraw) + (int) pDraw->width ||
-               stuff->y < -wBorderWidth((WindowPtr) pDraw) ||
-               stuff->y + (int) stuff->height >
-               wBorderWidth((WindowPtr) pDraw) + (int) pDraw->height)
-            return BadMatch;
+    rc = ShmGetImageCheck(pDraw, stuff->x, stuff->y,
+                          stuff->width, stuff->height);
+    if (rc != Success)
+        return rc;
+    if (pDraw->type == DRAWABLE_WINDOW)
         visual = wVisual(((WindowPtr) pDraw));
-        if (pDraw->type == DRAWABLE_WINDOW)
-            pVisibleRegion = &((WindowPtr) pDraw)->borderClip;
-        pDraw->pScreen->SourceValidate(pDraw, stuff->x, stuff->y,
-                                       stuff->width, stuff->height,
-                                       IncludeInferiors);
-    }
-    else {
-        if (stuff->x < 0 ||
-            stuff->x + (int) stuff->width > pDraw->width ||
-            stuff->y < 0 || stuff->y + (int) stuff->height > pDraw->height)
-            return BadMatch;
-        visual = None;
-    }
     xgi = (xShmGetImageReply) {
         .type = X_Reply,
         .sequenceNumber = client->sequence,
@@ -685,51 +810,251 @@ ProcShmGetImage(ClientPtr client)
     VERIFY_SHMSIZE(shmdesc, stuff->offset, length, client);
     xgi.size = length;
 
+    if (length > SHM_IMAGE_STEPS_MIN &&
+        (steps = malloc(sizeof(ShmGetImageStepsRec)))) {
+        *steps = (ShmGetImageStepsRec) {
+            .xgi = xgi,
+            .shmdesc = shmdesc,
+            .drawable = stuff->drawable,
+            .format = stuff->format,
+            .x = stuff->x,
+            .y = stuff->y,
+            .width = stuff->width,
+            .height = stuff->height,
+            .planemask = stuff->planeMask,
+            .plane = plane,
+            .widthBytesLine = stuff->format == ZPixmap ?
+                PixmapBytePad(stuff->width, pDraw->depth) :
+                PixmapBytePad(stuff->width, 1),
+            .addr = shmdesc->addr + stuff->offset,
+        };
+        steps->linesPerStep = max(SHM_IMAGE_STEP / steps->widthBytesLine, 1);
+        while (stuff->format == XYPixmap && !(steps->planemask & steps->plane))
+            steps->plane >>= 1;
+        shmdesc->refcnt++;
+        if (RunRequestInSteps(client, ShmGetImageStep, ShmGetImageStepsDone,
+                              steps))
+            return Success;
+        shmdesc->refcnt--;
+        free(steps);
+    }
+
+    if (pDraw->type == DRAWABLE_WINDOW)
+        pDraw->pScreen->SourceValidate(pDraw, stuff->x, stuff->y,
+                                       stuff->width, stuff->height,
+                                       IncludeInferiors);
+
     if (length == 0) {
         /* nothing to do */
     }
     else if (stuff->format == ZPixmap) {
-        (*pDraw->pScreen->GetImage) (pDraw, stuff->x, stuff->y,
-                                     stuff->width, stuff->height,
-                                     stuff->format, stuff->planeMask,
-                                     shmdesc->addr + stuff->offset);
-        if (pVisibleRegion)
-            XaceCensorImage(client, pVisibleRegion,
-                    PixmapBytePad(stuff->width, pDraw->depth), pDraw,
-                    stuff->x, stuff->y, stuff->width, stuff->height,
-                    stuff->format, shmdesc->addr + stuff->offset);
+        ShmGetImageLines(client, pDraw, stuff->format, stuff->x, stuff->y,
+                         stuff->width, stuff->height, stuff->planeMask,
+                         shmdesc->addr + stuff->offset);
     }
     else {
 
         length = stuff->offset;
         for (; plane; plane >>= 1) {
             if (stuff->planeMask & plane) {
-                (*pDraw->pScreen->GetImage) (pDraw,
-                                             stuff->x, stuff->y,
-                                             stuff->width, stuff->height,
-                                             stuff->format, plane,
-                                             shmdesc->addr + length);
-                if (pVisibleRegion)
-                    XaceCensorImage(client, pVisibleRegion,
-                            BitmapBytePad(stuff->width), pDraw,
-                            stuff->x, stuff->y, stuff->width, stuff->height,
-                            stuff->format, shmdesc->addr + length);
+                ShmGetImageLines(client, pDraw, stuff->format,
+                                 stuff->x, stuff->y,
+                                 stuff->width, stuff->height, plane,
+                                 shmdesc->addr + length);
                 length += lenPer;
             }
         }
     }
 
-    if (client->swapped) {
-        swaps(&xgi.sequenceNumber);
-        swapl(&xgi.length);
-        swapl(&xgi.visual);
-        swapl(&xgi.size);
+    ShmSendGetImageReply(client, &xgi);
+
+    return Success;
+}
+
+#if SHM_PROPERTIES
+
+/* Byte-swap 16 or 32 bit property data while copying it */
+static void
+ShmCopySwapProperty(char *dst, const char *src, unsigned long len, int format)
+{
+    unsigned long i;
+
+    if (format == 32) {
+        for (i = 0; i + 4 <= len; i += 4) {
+            char b0 = src[i], b1 = src[i + 1];
+
+            dst[i] = src[i + 3];
+            dst[i + 1] = src[i + 2];
+            dst[i + 2] = b1;
+            dst[i + 3] = b0;
+        }
     }
-    WriteToClient(client, sizeof(xShmGetImageReply), &xgi);
+    else if (format == 16) {
+        for (i = 0; i + 2 <= len; i += 2) {
+            char b0 = src[i];
+
+            dst[i] = src[i + 1];
+            dst[i + 1] = b0;
+        }
+    }
+    else
+        memmove(dst, src, len);
+}
+
+static int
+ProcShmPutProperty(ClientPtr client)
+{
+    WindowPtr pWin;
+    ShmDescPtr shmdesc;
+    uint64_t totalSize;
+    char *data;
+    int rc;
+
+    REQUEST(xShmPutPropertyReq);
+
+    REQUEST_SIZE_MATCH(xShmPutPropertyReq);
+    UpdateCurrentTime();
+    if ((stuff->mode != PropModeReplace) && (stuff->mode != PropModeAppend) &&
+        (stuff->mode != PropModePrepend)) {
+        client->errorValue = stuff->mode;
+        return BadValue;
+    }
+    if ((stuff->format != 8) && (stuff->format != 16) &&
+        (stuff->format != 32)) {
+        client->errorValue = stuff->format;
+        return BadValue;
+    }
+    totalSize = (uint64_t) stuff->nUnits * (stuff->format >> 3);
+    if (totalSize > INT_MAX)
+        return BadLength;
+
+    rc = dixLookupWindow(&pWin, stuff->window, client, DixSetPropAccess);
+    if (rc != Success)
+        return rc;
+    if (!ValidAtom(stuff->property)) {
+        client->errorValue = stuff->property;
+        return BadAtom;
+    }
+    if (!ValidAtom(stuff->type)) {
+        client->errorValue = stuff->type;
+        return BadAtom;
+    }
+    VERIFY_SHMPTR(stuff->shmseg, stuff->offset, FALSE, shmdesc, client);
+    VERIFY_SHMSIZE(shmdesc, (uint64_t) stuff->offset, totalSize, client);
+
+    data = shmdesc->addr + stuff->offset;
+    if (client->swapped && stuff->format != 8 && totalSize) {
+        char *swapped = malloc(totalSize);
+
+        if (!swapped)
+            return BadAlloc;
+        ShmCopySwapProperty(swapped, data, totalSize, stuff->format);
+        rc = dixChangeWindowProperty(client, pWin, stuff->property,
+                                     stuff->type, stuff->format, stuff->mode,
+                                     stuff->nUnits, swapped, TRUE);
+        free(swapped);
+        return rc;
+    }
+
+    return dixChangeWindowProperty(client, pWin, stuff->property, stuff->type,
+                                   stuff->format, stuff->mode, stuff->nUnits,
+                                   data, TRUE);
+}
+
+static int
+ProcShmGetProperty(ClientPtr client)
+{
+    PropertyPtr pProp;
+    WindowPtr pWin;
+    ShmDescPtr shmdesc;
+    unsigned long n, len, ind;
+    xShmGetPropertyReply rep = {
+        .type = X_Reply,
+        .sequenceNumber = client->sequence,
+        .length = 0,
+    };
+    Mask win_mode = DixGetPropAccess, prop_mode = DixReadAccess;
+    int rc;
 
+    REQUEST(xShmGetPropertyReq);
+
+    REQUEST_SIZE_MATCH(xShmGetPropertyReq);
+    if (stuff->delete) {
+        UpdateCurrentTime();
+        win_mode |= DixSetPropAccess;
+        prop_mode |= DixDestroyAccess;
+    }
+    rc = dixLookupWindow(&pWin, stuff->window, client, win_mode);
+    if (rc != Success)
+        return rc;
+    if (!ValidAtom(stuff->property)) {
+        client->errorValue = stuff->property;
+        return BadAtom;
+    }
+    if ((stuff->delete != xTrue) && (stuff->delete != xFalse)) {
+        client->errorValue = stuff->delete;
+        return BadValue;
+    }
+    if ((stuff->type != AnyPropertyType) && !ValidAtom(stuff->type)) {
+        client->errorValue = stuff->type;
+        return BadAtom;
+    }
+    VERIFY_SHMPTR(stuff->shmseg, stuff->offset, TRUE, shmdesc, client);
+
+    rc = dixLookupProperty(&pProp, pWin, stuff->property, client, prop_mode);
+    if (rc == BadMatch)
+        goto reply;
+    else if (rc != Success)
+        return rc;
+
+    rep.format = pProp->format;
+    rep.propertyType = pProp->type;
+
+    /* Type mismatch, report the property but don't transfer it */
+    if ((stuff->type != pProp->type) && (stuff->type != AnyPropertyType)) {
+        rep.bytesAfter = pProp->size;
+        goto reply;
+    }
+
+    n = (pProp->format / 8) * pProp->size;
+    ind = stuff->longOffset << 2;
+    if (n < ind) {
+        client->errorValue = stuff->longOffset;
+        return BadValue;
+    }
+    len = min(n - ind, 4 * (uint64_t) stuff->longLength);
+    VERIFY_SHMSIZE(shmdesc, (uint64_t) stuff->offset, len, client);
+
+    rep.bytesAfter = n - (ind + len);
+    rep.nItems = len / (pProp->format / 8);
+
+    if (client->swapped)
+        ShmCopySwapProperty(shmdesc->addr + stuff->offset,
+                            (char *) pProp->data + ind, len, pProp->format);
+    else
+        memcpy(shmdesc->addr + stuff->offset, (char *) pProp->data + ind, len);
+
+    /* The PropertyNotify goes out ahead of the reply, as for GetProperty */
+    if (stuff->delete && (rep.bytesAfter == 0)) {
+        rc = DeleteProperty(client, pWin, stuff->property);
+        if (rc != Success)
+            return rc;
+    }
+
+ reply:
+    if (client->swapped) {
+        swaps(&rep.sequenceNumber);
+        swapl(&rep.length);
+        swapl(&rep.propertyType);
+        swapl(&rep.bytesAfter);
+        swapl(&rep.nItems);
+    }
+    WriteToClient(client, sizeof(xShmGetPropertyReply), &rep);
     return Success;
 }
 
+#endif /* SHM_PROPERTIES */
+
 #ifdef PANORAMIX
 static int
 ProcPanoramiXShmPutImage(ClientPtr client)
@@ -1363,6 +1688,12 @@ ProcShmDispatch(ClientPtr client)
             return ProcPanoramiXShmCreatePixmap(client);
 #endif
         return ProcShmCreatePixmap(client);
+#if SHM_PROPERTIES
+    case X_ShmPutProperty:
+        return ProcShmPutProperty(client);
+    case X_ShmGetProperty:
+        return ProcShmGetProperty(client);
+#endif
 #ifdef SHM_FD_PASSING
     case X_ShmAttachFd:
         return ProcShmAttachFd(client);
@@ -1469,6 +1800,39 @@ SProcShmCreatePixmap(ClientPtr client)
     return ProcShmCreatePixmap(client);
 }
 
+#if SHM_PROPERTIES
+static int _X_COLD
+SProcShmPutProperty(ClientPtr client)
+{
+    REQUEST(xShmPutPropertyReq);
+    swaps(&stuff->length);
+    REQUEST_SIZE_MATCH(xShmPutPropertyReq);
+    swapl(&stuff->window);
+    swapl(&stuff->property);
+    swapl(&stuff->type);
+    swapl(&stuff->nUnits);
+    swapl(&stuff->shmseg);
+    swapl(&stuff->offset);
+    return ProcShmPutProperty(client);
+}
+
+static int _X_COLD
+SProcShmGetProperty(ClientPtr client)
+{
+    REQUEST(xShmGetPropertyReq);
+    swaps(&stuff->length);
+    REQUEST_SIZE_MATCH(xShmGetPropertyReq);
+    swapl(&stuff->window);
+    swapl(&stuff->property);
+    swapl(&stuff->type);
+    swapl(&stuff->longOffset);
+    swapl(&stuff->longLength);
+    swapl(&stuff->shmseg);
+    swapl(&stuff->offset);
+    return ProcShmGetProperty(client);
+}
+#endif /* SHM_PROPERTIES */
+
 #ifdef SHM_FD_PASSING
 static int _X_COLD
 SProcShmAttachFd(ClientPtr client)
@@ -1515,6 +1879,12 @@ SProcShmDispatch(ClientPtr client)
         return SProcShmGetImage(client);
     case X_ShmCreatePixmap:
         return SProcShmCreatePixmap(client);
+#if SHM_PROPERTIES
+    case X_ShmPutProperty:
+        return SProcShmPutProperty(client);
+    case X_ShmGetProperty:
+        return SProcShmGetProperty(client);
+#endif
 #ifdef SHM_FD_PASSING
     case X_ShmAttachFd:
         return SProcShmAttachFd(client);
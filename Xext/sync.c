@@ -111,8 +111,14 @@ static const char *WARN_INVALID_COUNTER_ALARM =
 
 static void SyncComputeBracketValues(SyncCounter *);
 
+static Bool SyncIndexInsert(SyncCounter *, SyncTrigger *);
+
+static void SyncIndexRemove(SyncCounter *, SyncTrigger *);
+
 static void SyncInitServerTime(void);
 
+static void SyncInitWakeups(void);
+
 static void SyncInitIdleTime(void);
 
 static inline void*
@@ -175,6 +181,8 @@ SyncDeleteTriggerFromSyncObject(SyncTrigger * pTrigger)
     if (SYNC_COUNTER == pTrigger->pSync->type) {
         pCounter = (SyncCounter *) pTrigger->pSync;
 
+        if (pCur)
+            SyncIndexRemove(pCounter, pTrigger);
         if (IsSystemCounter(pCounter))
             SyncComputeBracketValues(pCounter);
     }
@@ -203,6 +211,12 @@ SyncAddTriggerToSyncObject(SyncTrigger * pTrigger)
     if (!(pCur = malloc(sizeof(SyncTriggerList))))
         return BadAlloc;
 
+    if (SYNC_COUNTER == pTrigger->pSync->type &&
+        !SyncIndexInsert((SyncCounter *) pTrigger->pSync, pTrigger)) {
+        free(pCur);
+        return BadAlloc;
+    }
+
     pCur->pTrigger = pTrigger;
     pCur->next = pTrigger->pSync->pTriglist;
     pTrigger->pSync->pTriglist = pCur;
@@ -311,6 +325,192 @@ SyncCheckTriggerFence(SyncTrigger * pTrigger, int64_t unused)
     return (pFence == NULL || pFence->funcs.CheckTriggered(pFence));
 }
 
+/*  Counters also keep their triggers in arrays sorted by test value, one
+ *  for each of the check functions above, so that a change of the counter
+ *  only has to look at the triggers it may have set off: the comparisons
+ *  on the far side of the new value, and the transitions between the old
+ *  and the new one.  Triggers with a check of their own go on a list that
+ *  is looked at every time.  Should the index run out of memory, the
+ *  counter goes back to looking at all its triggers.
+ */
+enum {
+    SYNC_INDEX_POSITIVE_COMPARISON,
+    SYNC_INDEX_NEGATIVE_COMPARISON,
+    SYNC_INDEX_POSITIVE_TRANSITION,
+    SYNC_INDEX_NEGATIVE_TRANSITION,
+    SYNC_INDEX_OTHER,
+    SYNC_INDEX_LISTS
+};
+
+#define SYNC_INDEX_NONE -1
+
+typedef struct _SyncIndexEntry {
+    int64_t value;
+    SyncTrigger *pTrigger;
+} SyncIndexEntry;
+
+typedef struct _SyncIndexList {
+    SyncIndexEntry *entries;
+    int num;
+    int size;
+} SyncIndexList;
+
+typedef struct _SyncCounterIndex {
+    SyncIndexList lists[SYNC_INDEX_LISTS];
+    SyncTrigger **pending;      /* triggers SyncChangeCounter is firing */
+    Bool broken;                /* out of memory, look at all triggers */
+} SyncCounterIndex;
+
+static int
+SyncIndexListFor(SyncTrigger * pTrigger)
+{
+    if (pTrigger->CheckTrigger == SyncCheckTriggerPositiveComparison)
+        return SYNC_INDEX_POSITIVE_COMPARISON;
+    if (pTrigger->CheckTrigger == SyncCheckTriggerNegativeComparison)
+        return SYNC_INDEX_NEGATIVE_COMPARISON;
+    if (pTrigger->CheckTrigger == SyncCheckTriggerPositiveTransition)
+        return SYNC_INDEX_POSITIVE_TRANSITION;
+    if (pTrigger->CheckTrigger == SyncCheckTriggerNegativeTransition)
+        return SYNC_INDEX_NEGATIVE_TRANSITION;
+    return SYNC_INDEX_OTHER;
+}
+
+/* first entry with a test value of at least value */
+static int
+SyncIndexLowerBound(SyncIndexList * pList, int64_t value)
+{
+    int lo = 0, hi = pList->num;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+
+        if (pList->entries[mid].value < value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* first entry with a test value above value */
+static int
+SyncIndexUpperBound(SyncIndexList * pList, int64_t value)
+{
+    int lo = 0, hi = pList->num;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+
+        if (pList->entries[mid].value <= value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static Bool
+SyncIndexInsert(SyncCounter * pCounter, SyncTrigger * pTrigger)
+{
+    SyncCounterIndex *pIndex = pCounter->pIndex;
+    SyncIndexList *pList;
+    int list = SyncIndexListFor(pTrigger);
+    int i;
+
+    if (!pIndex) {
+        pIndex = calloc(1, sizeof(SyncCounterIndex));
+        if (!pIndex)
+            return FALSE;
+        pCounter->pIndex = pIndex;
+    }
+
+    pList = &pIndex->lists[list];
+    if (pList->num == pList->size) {
+        int size = pList->size ? pList->size * 2 : 8;
+        SyncIndexEntry *entries = reallocarray(pList->entries, size,
+                                               sizeof(SyncIndexEntry));
+
+        if (!entries)
+            return FALSE;
+        pList->entries = entries;
+        pList->size = size;
+    }
+
+    i = SyncIndexUpperBound(pList, pTrigger->test_value);
+    memmove(&pList->entries[i + 1], &pList->entries[i],
+            (pList->num - i) * sizeof(SyncIndexEntry));
+    pList->entries[i].value = pTrigger->test_value;
+    pList->entries[i].pTrigger = pTrigger;
+    pList->num++;
+
+    pTrigger->index_list = list;
+    pTrigger->index_value = pTrigger->test_value;
+    pTrigger->index_pending = -1;
+    return TRUE;
+}
+
+static void
+SyncIndexRemove(SyncCounter * pCounter, SyncTrigger * pTrigger)
+{
+    SyncCounterIndex *pIndex = pCounter->pIndex;
+    SyncIndexList *pList;
+    int i;
+
+    if (!pIndex || pTrigger->index_list == SYNC_INDEX_NONE)
+        return;
+
+    pList = &pIndex->lists[pTrigger->index_list];
+    for (i = SyncIndexLowerBound(pList, pTrigger->index_value);
+         i < pList->num && pList->entries[i].value == pTrigger->index_value;
+         i++) {
+        if (pList->entries[i].pTrigger == pTrigger) {
+            memmove(&pList->entries[i], &pList->entries[i + 1],
+                    (pList->num - i - 1) * sizeof(SyncIndexEntry));
+            pList->num--;
+            break;
+        }
+    }
+
+    /* don't fire it if it's gone */
+    if (pIndex->pending && pTrigger->index_pending >= 0)
+        pIndex->pending[pTrigger->index_pending] = NULL;
+
+    pTrigger->index_list = SYNC_INDEX_NONE;
+    pTrigger->index_pending = -1;
+}
+
+/*  Move a trigger in its counter's index after its check function or test
+ *  value changed.  Triggers that aren't on the counter are left alone.
+ */
+static void
+SyncIndexUpdate(SyncCounter * pCounter, SyncTrigger * pTrigger)
+{
+    if (pTrigger->index_list == SYNC_INDEX_NONE)
+        return;
+    if (pTrigger->index_list == SyncIndexListFor(pTrigger) &&
+        pTrigger->index_value == pTrigger->test_value)
+        return;
+
+    SyncIndexRemove(pCounter, pTrigger);
+    if (!SyncIndexInsert(pCounter, pTrigger))
+        pCounter->pIndex->broken = TRUE;
+}
+
+static void
+SyncIndexDestroy(SyncCounter * pCounter)
+{
+    SyncCounterIndex *pIndex = pCounter->pIndex;
+    int list;
+
+    if (!pIndex)
+        return;
+
+    for (list = 0; list < SYNC_INDEX_LISTS; list++)
+        free(pIndex->lists[list].entries);
+    free(pIndex);
+    pCounter->pIndex = NULL;
+}
+
 static int
 SyncInitTrigger(ClientPtr client, SyncTrigger * pTrigger, XID syncObject,
                 RESTYPE resType, Mask changes)
@@ -333,6 +533,8 @@ SyncInitTrigger(ClientPtr client, SyncTrigger * pTrigger, XID syncObject,
         if (pSync != pTrigger->pSync) { /* new counter for trigger */
             SyncDeleteTriggerFromSyncObject(pTrigger);
             pTrigger->pSync = pSync;
+            pTrigger->index_list = SYNC_INDEX_NONE;
+            pTrigger->index_pending = -1;
             newSyncObject = TRUE;
         }
     }
@@ -397,6 +599,8 @@ SyncInitTrigger(ClientPtr client, SyncTrigger * pTrigger, XID syncObject,
                                          pCounter->value, pTrigger->wait_value);
             if (overflow) {
                 client->errorValue = pTrigger->wait_value >> 32;
+                if (!newSyncObject)
+                    SyncIndexUpdate(pCounter, pTrigger);
                 return BadValue;
             }
         }
@@ -409,8 +613,10 @@ SyncInitTrigger(ClientPtr client, SyncTrigger * pTrigger, XID syncObject,
         if ((rc = SyncAddTriggerToSyncObject(pTrigger)) != Success)
             return rc;
     }
-    else if (pCounter && IsSystemCounter(pCounter)) {
-        SyncComputeBracketValues(pCounter);
+    else if (pCounter) {
+        SyncIndexUpdate(pCounter, pTrigger);
+        if (IsSystemCounter(pCounter))
+            SyncComputeBracketValues(pCounter);
     }
 
     return Success;
@@ -600,6 +806,8 @@ SyncAlarmTriggerFired(SyncTrigger * pTrigger)
      */
     SyncSendAlarmNotifyEvents(pAlarm);
     pTrigger->test_value = new_test_value;
+    if (pCounter)
+        SyncIndexUpdate(pCounter, pTrigger);
 }
 
 /*  This function is called when an Await unblocks, either as a result
@@ -711,18 +919,97 @@ SyncUpdateCounter(SyncCounter *pCounter, int64_t newval)
 void
 SyncChangeCounter(SyncCounter * pCounter, int64_t newval)
 {
+    SyncCounterIndex *pIndex = pCounter->pIndex;
+    SyncTrigger *local[32];
+    SyncTrigger **pending = NULL, **prev;
     SyncTriggerList *ptl, *pnext;
+    int first[SYNC_INDEX_LISTS], last[SYNC_INDEX_LISTS];
     int64_t oldval;
+    int list, i, num = 0;
 
     oldval = SyncUpdateCounter(pCounter, newval);
 
-    /* run through triggers to see if any become true */
-    for (ptl = pCounter->sync.pTriglist; ptl; ptl = pnext) {
-        pnext = ptl->next;
-        if ((*ptl->pTrigger->CheckTrigger) (ptl->pTrigger, oldval))
-            (*ptl->pTrigger->TriggerFired) (ptl->pTrigger);
+    if (pIndex && !pIndex->broken) {
+        SyncIndexList *lists = pIndex->lists;
+
+        /* find the triggers whose test values the counter went past */
+        first[SYNC_INDEX_POSITIVE_COMPARISON] = 0;
+        last[SYNC_INDEX_POSITIVE_COMPARISON] =
+            SyncIndexUpperBound(&lists[SYNC_INDEX_POSITIVE_COMPARISON], newval);
+        first[SYNC_INDEX_NEGATIVE_COMPARISON] =
+            SyncIndexLowerBound(&lists[SYNC_INDEX_NEGATIVE_COMPARISON], newval);
+        last[SYNC_INDEX_NEGATIVE_COMPARISON] =
+            lists[SYNC_INDEX_NEGATIVE_COMPARISON].num;
+        first[SYNC_INDEX_POSITIVE_TRANSITION] =
+            last[SYNC_INDEX_POSITIVE_TRANSITION] = 0;
+        if (newval > oldval) {
+            first[SYNC_INDEX_POSITIVE_TRANSITION] =
+                SyncIndexUpperBound(&lists[SYNC_INDEX_POSITIVE_TRANSITION],
+                                    oldval);
+            last[SYNC_INDEX_POSITIVE_TRANSITION] =
+                SyncIndexUpperBound(&lists[SYNC_INDEX_POSITIVE_TRANSITION],
+                                    newval);
+        }
+        first[SYNC_INDEX_NEGATIVE_TRANSITION] =
+            last[SYNC_INDEX_NEGATIVE_TRANSITION] = 0;
+        if (newval < oldval) {
+            first[SYNC_INDEX_NEGATIVE_TRANSITION] =
+                SyncIndexLowerBound(&lists[SYNC_INDEX_NEGATIVE_TRANSITION],
+                                    newval);
+            last[SYNC_INDEX_NEGATIVE_TRANSITION] =
+                SyncIndexLowerBound(&lists[SYNC_INDEX_NEGATIVE_TRANSITION],
+                                    oldval);
+        }
+        first[SYNC_INDEX_OTHER] = 0;
+        last[SYNC_INDEX_OTHER] = lists[SYNC_INDEX_OTHER].num;
+
+        for (list = 0; list < SYNC_INDEX_LISTS; list++)
+            num += last[list] - first[list];
+
+        pending = local;
+        if (num > ARRAY_SIZE(local))
+            pending = xallocarray(num, sizeof(SyncTrigger *));
+    }
+
+    if (!pending) {
+        /* run through triggers to see if any become true */
+        for (ptl = pCounter->sync.pTriglist; ptl; ptl = pnext) {
+            pnext = ptl->next;
+            if ((*ptl->pTrigger->CheckTrigger) (ptl->pTrigger, oldval))
+                (*ptl->pTrigger->TriggerFired) (ptl->pTrigger);
+        }
+    }
+    else if (num) {
+        /*  firing a trigger can take others off the counter, so they are
+         *  collected first and taken out of here when they go
+         */
+        num = 0;
+        for (list = 0; list < SYNC_INDEX_LISTS; list++) {
+            for (i = first[list]; i < last[list]; i++) {
+                SyncTrigger *pTrigger = pIndex->lists[list].entries[i].pTrigger;
+
+                pTrigger->index_pending = num;
+                pending[num++] = pTrigger;
+            }
+        }
+
+        prev = pIndex->pending;
+        pIndex->pending = pending;
+        for (i = 0; i < num; i++) {
+            SyncTrigger *pTrigger = pending[i];
+
+            if (!pTrigger)
+                continue;
+            pTrigger->index_pending = -1;
+            if ((*pTrigger->CheckTrigger) (pTrigger, oldval))
+                (*pTrigger->TriggerFired) (pTrigger);
+        }
+        pIndex->pending = prev;
     }
 
+    if (pending != local)
+        free(pending);
+
     if (IsSystemCounter(pCounter)) {
         SyncComputeBracketValues(pCounter);
     }
@@ -962,6 +1249,7 @@ SyncCreateCounter(ClientPtr client, XSyncCounter id, int64_t initialvalue)
 
     pCounter->value = initialvalue;
     pCounter->pSysCounterInfo = NULL;
+    pCounter->pIndex = NULL;
 
     pCounter->sync.initialized = TRUE;
 
@@ -1016,15 +1304,91 @@ SyncDestroySystemCounter(void *pSysCounter)
     FreeResource(pCounter->sync.id, X11_RESTYPE_NONE);
 }
 
+/*  See whether the test value of pTrigger makes a closer bracket for its
+ *  counter, a system counter.
+ */
+static void
+SyncBracketTrigger(SyncCounter * pCounter, SyncTrigger * pTrigger,
+                   int64_t **ppnewltval, int64_t **ppnewgtval)
+{
+    SysCounterInfo *psci = pCounter->pSysCounterInfo;
+    SyncCounterType ct = psci->counterType;
+
+    if (pTrigger->test_type == XSyncPositiveComparison &&
+        ct != XSyncCounterNeverIncreases) {
+        if (pCounter->value < pTrigger->test_value &&
+            pTrigger->test_value < psci->bracket_greater) {
+            psci->bracket_greater = pTrigger->test_value;
+            *ppnewgtval = &psci->bracket_greater;
+        }
+        else if (pCounter->value > pTrigger->test_value &&
+                 pTrigger->test_value > psci->bracket_less) {
+                psci->bracket_less = pTrigger->test_value;
+                *ppnewltval = &psci->bracket_less;
+        }
+    }
+    else if (pTrigger->test_type == XSyncNegativeComparison &&
+             ct != XSyncCounterNeverDecreases) {
+        if (pCounter->value > pTrigger->test_value &&
+            pTrigger->test_value > psci->bracket_less) {
+            psci->bracket_less = pTrigger->test_value;
+            *ppnewltval = &psci->bracket_less;
+        }
+        else if (pCounter->value < pTrigger->test_value &&
+                 pTrigger->test_value < psci->bracket_greater) {
+                psci->bracket_greater = pTrigger->test_value;
+                *ppnewgtval = &psci->bracket_greater;
+        }
+    }
+    else if (pTrigger->test_type == XSyncNegativeTransition &&
+             ct != XSyncCounterNeverIncreases) {
+        if (pCounter->value >= pTrigger->test_value &&
+            pTrigger->test_value > psci->bracket_less) {
+                /*
+                 * If the value is exactly equal to our threshold, we want one
+                 * more event in the negative direction to ensure we pick up
+                 * when the value is less than this threshold.
+                 */
+                psci->bracket_less = pTrigger->test_value;
+                *ppnewltval = &psci->bracket_less;
+        }
+        else if (pCounter->value < pTrigger->test_value &&
+                 pTrigger->test_value < psci->bracket_greater) {
+                psci->bracket_greater = pTrigger->test_value;
+                *ppnewgtval = &psci->bracket_greater;
+        }
+    }
+    else if (pTrigger->test_type == XSyncPositiveTransition &&
+             ct != XSyncCounterNeverDecreases) {
+        if (pCounter->value <= pTrigger->test_value &&
+            pTrigger->test_value < psci->bracket_greater) {
+                /*
+                 * If the value is exactly equal to our threshold, we
+                 * want one more event in the positive direction to
+                 * ensure we pick up when the value *exceeds* this
+                 * threshold.
+                 */
+                psci->bracket_greater = pTrigger->test_value;
+                *ppnewgtval = &psci->bracket_greater;
+        }
+        else if (pCounter->value > pTrigger->test_value &&
+                 pTrigger->test_value > psci->bracket_less) {
+                psci->bracket_less = pTrigger->test_value;
+                *ppnewltval = &psci->bracket_less;
+        }
+    }
+}
+
 static void
 SyncComputeBracketValues(SyncCounter * pCounter)
 {
+    SyncCounterIndex *pIndex;
     SyncTriggerList *pCur;
-    SyncTrigger *pTrigger;
     SysCounterInfo *psci;
     int64_t *pnewgtval = NULL;
     int64_t *pnewltval = NULL;
     SyncCounterType ct;
+    int list, i;
 
     if (!pCounter)
         return;
@@ -1037,73 +1401,32 @@ SyncComputeBracketValues(SyncCounter * pCounter)
     psci->bracket_greater = LLONG_MAX;
     psci->bracket_less = LLONG_MIN;
 
-    for (pCur = pCounter->sync.pTriglist; pCur; pCur = pCur->next) {
-        pTrigger = pCur->pTrigger;
-
-        if (pTrigger->test_type == XSyncPositiveComparison &&
-            ct != XSyncCounterNeverIncreases) {
-            if (pCounter->value < pTrigger->test_value &&
-                pTrigger->test_value < psci->bracket_greater) {
-                psci->bracket_greater = pTrigger->test_value;
-                pnewgtval = &psci->bracket_greater;
-            }
-            else if (pCounter->value > pTrigger->test_value &&
-                     pTrigger->test_value > psci->bracket_less) {
-                    psci->bracket_less = pTrigger->test_value;
-                    pnewltval = &psci->bracket_less;
-            }
-        }
-        else if (pTrigger->test_type == XSyncNegativeComparison &&
-                 ct != XSyncCounterNeverDecreases) {
-            if (pCounter->value > pTrigger->test_value &&
-                pTrigger->test_value > psci->bracket_less) {
-                psci->bracket_less = pTrigger->test_value;
-                pnewltval = &psci->bracket_less;
-            }
-            else if (pCounter->value < pTrigger->test_value &&
-                     pTrigger->test_value < psci->bracket_greater) {
-                    psci->bracket_greater = pTrigger->test_value;
-                    pnewgtval = &psci->bracket_greater;
-            }
-        }
-        else if (pTrigger->test_type == XSyncNegativeTransition &&
-                 ct != XSyncCounterNeverIncreases) {
-            if (pCounter->value >= pTrigger->test_value &&
-                pTrigger->test_value > psci->bracket_less) {
-                    /*
-                     * If the value is exactly equal to our threshold, we want one
-                     * more event in the negative direction to ensure we pick up
-                     * when the value is less than this threshold.
-                     */
-                    psci->bracket_less = pTrigger->test_value;
-                    pnewltval = &psci->bracket_less;
-            }
-            else if (pCounter->value < pTrigger->test_value &&
-                     pTrigger->test_value < psci->bracket_greater) {
-                    psci->bracket_greater = pTrigger->test_value;
-                    pnewgtval = &psci->bracket_greater;
-            }
-        }
-        else if (pTrigger->test_type == XSyncPositiveTransition &&
-                 ct != XSyncCounterNeverDecreases) {
-            if (pCounter->value <= pTrigger->test_value &&
-                pTrigger->test_value < psci->bracket_greater) {
-                    /*
-                     * If the value is exactly equal to our threshold, we
-                     * want one more event in the positive direction to
-                     * ensure we pick up when the value *exceeds* this
-                     * threshold.
-                     */
-                    psci->bracket_greater = pTrigger->test_value;
-                    pnewgtval = &psci->bracket_greater;
-            }
-            else if (pCounter->value > pTrigger->test_value &&
-                     pTrigger->test_value > psci->bracket_less) {
-                    psci->bracket_less = pTrigger->test_value;
-                    pnewltval = &psci->bracket_less;
+    pIndex = pCounter->pIndex;
+    if (!pIndex || pIndex->broken) {
+        for (pCur = pCounter->sync.pTriglist; pCur; pCur = pCur->next)
+            SyncBracketTrigger(pCounter, pCur->pTrigger,
+                               &pnewltval, &pnewgtval);
+    }
+    else {
+        for (list = 0; list < SYNC_INDEX_OTHER; list++) {
+            SyncIndexList *pList = &pIndex->lists[list];
+            int lower = SyncIndexLowerBound(pList, pCounter->value);
+            int upper = SyncIndexUpperBound(pList, pCounter->value);
+            int near[] = { lower - 1, lower, upper - 1, upper };
+
+            /* only the ones next to the value can be the brackets */
+            for (i = 0; i < ARRAY_SIZE(near); i++) {
+                if (near[i] >= 0 && near[i] < pList->num)
+                    SyncBracketTrigger(pCounter,
+                                       pList->entries[near[i]].pTrigger,
+                                       &pnewltval, &pnewgtval);
             }
         }
-    }                           /* end for each trigger */
+        for (i = 0; i < pIndex->lists[SYNC_INDEX_OTHER].num; i++)
+            SyncBracketTrigger(pCounter,
+                               pIndex->lists[SYNC_INDEX_OTHER].entries[i].pTrigger,
+                               &pnewltval, &pnewgtval);
+    }
 
     (*psci->BracketValues) ((void *) pCounter, pnewltval, pnewgtval);
 
@@ -1155,6 +1478,11 @@ FreeCounter(void *env, XID id)
             free(ptl); /* destroy the trigger list as we go */
         }
         if (IsSystemCounter(pCounter)) {
+            /* drop whatever timers or handlers watch the counter */
+            if (pCounter->pSysCounterInfo->counterType !=
+                XSyncCounterNeverChanges)
+                (*pCounter->pSysCounterInfo->BracketValues) (pCounter,
+                                                             NULL, NULL);
             xorg_list_del(&pCounter->pSysCounterInfo->entry);
             free(pCounter->pSysCounterInfo->name);
             free(pCounter->pSysCounterInfo->private);
@@ -1162,6 +1490,8 @@ FreeCounter(void *env, XID id)
         }
     }
 
+    SyncIndexDestroy(pCounter);
+
     free(pCounter);
     return Success;
 }
@@ -2529,6 +2859,7 @@ SyncExtensionInit(void)
      * because there is always a servertime counter.
      */
     SyncInitServerTime();
+    SyncInitWakeups();
     SyncInitIdleTime();
 
 #ifdef DEBUG
@@ -2544,6 +2875,10 @@ SyncExtensionInit(void)
 static void *ServertimeCounter;
 static int64_t Now;
 static int64_t *pnext_time;
+static OsTimerPtr ServertimeTimer;
+
+/* OsTimers compare expiry times as signed 32 bit numbers */
+#define SYNC_TIMER_MAX (1 << 30)
 
 static void GetTime(void)
 {
@@ -2557,40 +2892,32 @@ static void GetTime(void)
 }
 
 /*
-*** Server Block Handler
-*** code inspired by multibuffer extension (now deprecated)
+ * Milliseconds until a clock now at now reaches value, for an OsTimer.  At
+ * least one, so that the timer never goes off right inside TimerSet().
  */
-/*ARGSUSED*/ static void
-ServertimeBlockHandler(void *env, void *wt)
+static CARD32
+SyncTimerDelay(int64_t value, int64_t now)
 {
-    unsigned long timeout;
-
-    if (pnext_time) {
-        GetTime();
-
-        if (Now >= *pnext_time) {
-            timeout = 0;
-        }
-        else {
-            timeout = *pnext_time - Now;
-        }
-        AdjustWaitForDelay(wt, timeout);        /* os/utils.c */
-    }
+    if (value - now < 1)
+        return 1;
+    if (value - now > SYNC_TIMER_MAX)
+        return SYNC_TIMER_MAX;
+    return value - now;
 }
 
-/*
-*** Wakeup Handler
- */
-/*ARGSUSED*/ static void
-ServertimeWakeupHandler(void *env, int rc)
+static CARD32
+ServertimeTimerExpired(OsTimerPtr timer, CARD32 time, void *arg)
 {
-    if (pnext_time) {
-        GetTime();
+    if (!pnext_time)
+        return 0;
 
-        if (Now >= *pnext_time) {
-            SyncChangeCounter(ServertimeCounter, Now);
-        }
-    }
+    GetTime();
+    if (Now < *pnext_time)
+        return SyncTimerDelay(*pnext_time, Now);
+
+    /* sets the timer again, or frees it, through the brackets */
+    SyncChangeCounter(ServertimeCounter, Now);
+    return 0;
 }
 
 static void
@@ -2600,19 +2927,26 @@ ServertimeQueryValue(void *pCounter, int64_t *pValue_return)
     *pValue_return = Now;
 }
 
+/*
+ * The time only needs looking at when it reaches the greater bracket, so
+ * rather than checking it on every trip through WaitForSomething(), a timer
+ * is set for exactly then.
+ */
 static void
 ServertimeBracketValues(void *pCounter, int64_t *pbracket_less,
                         int64_t *pbracket_greater)
 {
-    if (!pnext_time && pbracket_greater) {
-        RegisterBlockAndWakeupHandlers(ServertimeBlockHandler,
-                                       ServertimeWakeupHandler, NULL);
+    pnext_time = pbracket_greater;
+    if (pnext_time) {
+        GetTime();
+        ServertimeTimer = TimerSet(ServertimeTimer, 0,
+                                   SyncTimerDelay(*pnext_time, Now),
+                                   ServertimeTimerExpired, NULL);
     }
-    else if (pnext_time && !pbracket_greater) {
-        RemoveBlockAndWakeupHandlers(ServertimeBlockHandler,
-                                     ServertimeWakeupHandler, NULL);
+    else {
+        TimerFree(ServertimeTimer);
+        ServertimeTimer = NULL;
     }
-    pnext_time = pbracket_greater;
 }
 
 static void
@@ -2626,18 +2960,81 @@ SyncInitServerTime(void)
                                                 ServertimeQueryValue,
                                                 ServertimeBracketValues);
     pnext_time = NULL;
+    ServertimeTimer = NULL;
+}
+
+/*
+ * SERVERWAKEUPS implementation: how often the server came out of poll(),
+ * so that one can tell whether it really sleeps while nothing happens.
+ */
+
+static void *WakeupsCounter;
+static int64_t *pnext_wakeups;
+
+static void
+WakeupsWakeupHandler(void *env, int rc)
+{
+    int64_t wakeups = WaitForSomethingWakeups();
+
+    if (pnext_wakeups && wakeups >= *pnext_wakeups)
+        SyncChangeCounter(WakeupsCounter, wakeups);
+}
+
+static void
+WakeupsQueryValue(void *pCounter, int64_t *pValue_return)
+{
+    *pValue_return = WaitForSomethingWakeups();
+}
+
+static void
+WakeupsBracketValues(void *pCounter, int64_t *pbracket_less,
+                     int64_t *pbracket_greater)
+{
+    /* a wakeup handler is run on every wakeup, and doesn't add any */
+    if (!pnext_wakeups && pbracket_greater) {
+        RegisterBlockAndWakeupHandlers((ServerBlockHandlerProcPtr) NoopDDA,
+                                       WakeupsWakeupHandler, NULL);
+    }
+    else if (pnext_wakeups && !pbracket_greater) {
+        RemoveBlockAndWakeupHandlers((ServerBlockHandlerProcPtr) NoopDDA,
+                                     WakeupsWakeupHandler, NULL);
+    }
+    pnext_wakeups = pbracket_greater;
+}
+
+static void
+SyncInitWakeups(void)
+{
+    WakeupsCounter = SyncCreateSystemCounter("SERVERWAKEUPS",
+                                             WaitForSomethingWakeups(), 1,
+                                             XSyncCounterNeverDecreases,
+                                             WakeupsQueryValue,
+                                             WakeupsBracketValues);
+    pnext_wakeups = NULL;
 }
 
 /*
  * IDLETIME implementation
+ *
+ * The idle time goes up by itself, so reaching the greater bracket is a
+ * matter of time and has a timer.  It only goes down when there is input,
+ * which NoticeTime() tells us about; the lesser bracket is then looked at
+ * before the server goes back to sleep.
  */
 
 typedef struct {
     int64_t *value_less;
     int64_t *value_greater;
     int deviceid;
+    OsTimerPtr timer;           /* for value_greater */
+    Bool reset;                 /* input since value_less was looked at */
 } IdleCounterPriv;
 
+static Bool idle_reset_queued;
+
+static void IdleTimeBracketValues(void *pCounter, int64_t *pbracket_less,
+                                  int64_t *pbracket_greater);
+
 static void
 IdleTimeQueryValue(void *pCounter, int64_t *pValue_return)
 {
@@ -2655,84 +3052,6 @@ IdleTimeQueryValue(void *pCounter, int64_t *pValue_return)
     *pValue_return = idle;
 }
 
-static void
-IdleTimeBlockHandler(void *pCounter, void *wt)
-{
-    SyncCounter *counter = pCounter;
-    IdleCounterPriv *priv = SysCounterGetPrivate(counter);
-    int64_t *less = priv->value_less;
-    int64_t *greater = priv->value_greater;
-    int64_t idle, old_idle;
-    SyncTriggerList *list = counter->sync.pTriglist;
-    SyncTrigger *trig;
-
-    if (!less && !greater)
-        return;
-
-    old_idle = counter->value;
-    IdleTimeQueryValue(counter, &idle);
-    counter->value = idle;      /* push, so CheckTrigger works */
-
-    /**
-     * There's an indefinite amount of time between ProcessInputEvents()
-     * where the idle time is reset and the time we actually get here. idle
-     * may be past the lower bracket if we dawdled with the events, so
-     * check for whether we did reset and bomb out of select immediately.
-     */
-    if (less && idle > *less &&
-        LastEventTimeWasReset(priv->deviceid)) {
-        AdjustWaitForDelay(wt, 0);
-    } else if (less && idle <= *less) {
-        /*
-         * We've been idle for less than the threshold value, and someone
-         * wants to know about that, but now we need to know whether they
-         * want level or edge trigger.  Check the trigger list against the
-         * current idle time, and if any succeed, bomb out of select()
-         * immediately so we can reschedule.
-         */
-
-        for (list = counter->sync.pTriglist; list; list = list->next) {
-            trig = list->pTrigger;
-            if (trig->CheckTrigger(trig, old_idle)) {
-                AdjustWaitForDelay(wt, 0);
-                break;
-            }
-        }
-        /*
-         * We've been called exactly on the idle time, but we have a
-         * NegativeTransition trigger which requires a transition from an
-         * idle time greater than this.  Schedule a wakeup for the next
-         * millisecond so we won't miss a transition.
-         */
-        if (idle == *less)
-            AdjustWaitForDelay(wt, 1);
-    }
-    else if (greater) {
-        /*
-         * There's a threshold in the positive direction.  If we've been
-         * idle less than it, schedule a wakeup for sometime in the future.
-         * If we've been idle more than it, and someone wants to know about
-         * that level-triggered, schedule an immediate wakeup.
-         */
-
-        if (idle < *greater) {
-            AdjustWaitForDelay(wt, *greater - idle);
-        }
-        else {
-            for (list = counter->sync.pTriglist; list;
-                 list = list->next) {
-                trig = list->pTrigger;
-                if (trig->CheckTrigger(trig, old_idle)) {
-                    AdjustWaitForDelay(wt, 0);
-                    break;
-                }
-            }
-        }
-    }
-
-    counter->value = old_idle;  /* pop */
-}
-
 static void
 IdleTimeCheckBrackets(SyncCounter *counter, int64_t idle,
                       int64_t *less, int64_t *greater)
@@ -2745,10 +3064,30 @@ IdleTimeCheckBrackets(SyncCounter *counter, int64_t idle,
         SyncUpdateCounter(counter, idle);
 }
 
+static CARD32
+IdleTimeTimerExpired(OsTimerPtr timer, CARD32 time, void *pCounter);
+
 static void
-IdleTimeWakeupHandler(void *pCounter, int rc)
+IdleTimeSetTimer(SyncCounter *counter)
+{
+    IdleCounterPriv *priv = SysCounterGetPrivate(counter);
+    int64_t idle;
+
+    if (!priv->value_greater) {
+        TimerFree(priv->timer);
+        priv->timer = NULL;
+        return;
+    }
+
+    IdleTimeQueryValue(counter, &idle);
+    priv->timer = TimerSet(priv->timer, 0,
+                           SyncTimerDelay(*priv->value_greater, idle),
+                           IdleTimeTimerExpired, counter);
+}
+
+static void
+IdleTimeCheck(SyncCounter *counter)
 {
-    SyncCounter *counter = pCounter;
     IdleCounterPriv *priv = SysCounterGetPrivate(counter);
     int64_t *less = priv->value_less;
     int64_t *greater = priv->value_greater;
@@ -2757,12 +3096,11 @@ IdleTimeWakeupHandler(void *pCounter, int rc)
     if (!less && !greater)
         return;
 
-    IdleTimeQueryValue(pCounter, &idle);
+    IdleTimeQueryValue(counter, &idle);
 
     /*
-      There is no guarantee for the WakeupHandler to be called within a specific
-      timeframe. Idletime may go to 0, but by the time we get here, it may be
-      non-zero and alarms for a pos. transition on 0 won't get triggered.
+      Idletime may have gone to 0 and be non-zero again by the time we get
+      here, and alarms for a pos. transition on 0 won't get triggered.
       https://bugs.freedesktop.org/show_bug.cgi?id=70476
       */
     if (LastEventTimeWasReset(priv->deviceid)) {
@@ -2775,6 +3113,55 @@ IdleTimeWakeupHandler(void *pCounter, int rc)
     }
 
     IdleTimeCheckBrackets(counter, idle, less, greater);
+
+    /* the idle time may have started over since the timer was set */
+    IdleTimeSetTimer(counter);
+}
+
+static CARD32
+IdleTimeTimerExpired(OsTimerPtr timer, CARD32 time, void *pCounter)
+{
+    /* sets the timer again, or frees it */
+    IdleTimeCheck(pCounter);
+    return 0;
+}
+
+static Bool
+IdleTimeResetWork(ClientPtr client, void *closure)
+{
+    SysCounterInfo *psci;
+
+    idle_reset_queued = FALSE;
+ again:
+    xorg_list_for_each_entry(psci, &SysCounterList, entry) {
+        IdleCounterPriv *priv = psci->private;
+
+        if (psci->BracketValues != IdleTimeBracketValues || !priv->reset)
+            continue;
+        priv->reset = FALSE;
+        IdleTimeCheck(psci->pCounter);
+        /* alarms going off may have changed any counter's brackets */
+        goto again;
+    }
+    return TRUE;
+}
+
+/*
+ * Called by NoticeTime() on input.  The counter is looked at once the
+ * events have been dealt with, as the server was woken up for them anyway.
+ */
+static void
+IdleTimeNoticeReset(CallbackListPtr *pcbl, void *pCounter, void *calldata)
+{
+    IdleCounterPriv *priv = SysCounterGetPrivate(pCounter);
+    DeviceIntPtr dev = calldata;
+
+    if (priv->deviceid != XIAllDevices && priv->deviceid != dev->id)
+        return;
+
+    priv->reset = TRUE;
+    if (!idle_reset_queued)
+        idle_reset_queued = QueueWorkProc(IdleTimeResetWork, NULL, NULL);
 }
 
 static void
@@ -2785,22 +3172,21 @@ IdleTimeBracketValues(void *pCounter, int64_t *pbracket_less,
     IdleCounterPriv *priv = SysCounterGetPrivate(counter);
     int64_t *less = priv->value_less;
     int64_t *greater = priv->value_greater;
-    Bool registered = (less || greater);
 
-    if (registered && !pbracket_less && !pbracket_greater) {
-        RemoveBlockAndWakeupHandlers(IdleTimeBlockHandler,
-                                     IdleTimeWakeupHandler, pCounter);
-    }
-    else if (!registered && (pbracket_less || pbracket_greater)) {
-        /* Reset flag must be zero so we don't force a idle timer reset on
-           the first wakeup */
+    /* Reset flag must be zero so we don't force a idle timer reset on
+       the first check */
+    if (!less && !greater && (pbracket_less || pbracket_greater))
         LastEventTimeToggleResetAll(FALSE);
-        RegisterBlockAndWakeupHandlers(IdleTimeBlockHandler,
-                                       IdleTimeWakeupHandler, pCounter);
-    }
+
+    if (!less && pbracket_less)
+        AddCallback(&LastEventTimeCallback, IdleTimeNoticeReset, pCounter);
+    else if (less && !pbracket_less)
+        DeleteCallback(&LastEventTimeCallback, IdleTimeNoticeReset, pCounter);
 
     priv->value_greater = pbracket_greater;
     priv->value_less = pbracket_less;
+
+    IdleTimeSetTimer(counter);
 }
 
 static SyncCounter*
@@ -2822,6 +3208,8 @@ init_system_idle_counter(const char *name, int deviceid)
 
         priv->value_less = priv->value_greater = NULL;
         priv->deviceid = deviceid;
+        priv->timer = NULL;
+        priv->reset = FALSE;
 
         idle_time_counter->pSysCounterInfo->private = priv;
     }
@@ -55,87 +55,211 @@ SOFTWARE.
 #include "dix.h"
 
 #define InitialTableSize 256
+#define InitialHashSize 512     /* must be a power of two */
+#define StringBlockSize 16384
 
+/*
+ * Atoms are kept in two tables: nodeTable is indexed by the atom value and
+ * holds the name, while hashTable is an open-addressing (linear probing)
+ * table mapping name hashes back to atoms.  hashTable is kept at most half
+ * full so probe sequences stay short regardless of the insertion order.
+ */
 typedef struct _Node {
-    struct _Node *left, *right;
-    Atom a;
-    unsigned int fingerPrint;
     const char *string;
+    unsigned int len;
+    unsigned int hash;
 } NodeRec, *NodePtr;
 
+typedef struct _HashSlot {
+    unsigned int hash;
+    Atom a;                     /* None if the slot is empty */
+} HashSlotRec, *HashSlotPtr;
+
+/*
+ * Atom names are never freed individually, so they're packed into large
+ * blocks instead of being strdup'ed one by one.
+ */
+typedef struct _StringBlock {
+    struct _StringBlock *next;
+    size_t used;
+    size_t size;
+    char data[];
+} StringBlockRec, *StringBlockPtr;
+
 static Atom lastAtom = None;
-static NodePtr atomRoot = NULL;
 static unsigned long tableLength;
-static NodePtr *nodeTable;
+static NodePtr nodeTable;
+static unsigned long hashMask;
+static HashSlotPtr hashTable;
+static StringBlockPtr stringBlocks;
 
-Atom
-MakeAtom(const char *string, unsigned len, Bool makeit)
+/* 32-bit MurmurHash3 */
+static unsigned int
+HashAtomName(const char *string, unsigned len)
 {
-    NodePtr *np;
+    const unsigned int c1 = 0xcc9e2d51, c2 = 0x1b873593;
+    const unsigned char *data = (const unsigned char *) string;
+    unsigned int h = 0, k;
     unsigned i;
-    int comp;
-    unsigned int fp = 0;
 
-    np = &atomRoot;
-    for (i = 0; i < (len + 1) / 2; i++) {
-        fp = fp * 27 + string[i];
-        fp = fp * 27 + string[len - 1 - i];
+    for (i = 0; i + 4 <= len; i += 4) {
+        memcpy(&k, data + i, sizeof(k));
+        k *= c1;
+        k = (k << 15) | (k >> 17);
+        k *= c2;
+        h ^= k;
+        h = (h << 13) | (h >> 19);
+        h = h * 5 + 0xe6546b64;
     }
-    while (*np != NULL) {
-        if (fp < (*np)->fingerPrint)
-            np = &((*np)->left);
-        else if (fp > (*np)->fingerPrint)
-            np = &((*np)->right);
-        else {                  /* now start testing the strings */
-            comp = strncmp(string, (*np)->string, (int) len);
-            if ((comp < 0) || ((comp == 0) && (len < strlen((*np)->string))))
-                np = &((*np)->left);
-            else if (comp > 0)
-                np = &((*np)->right);
-            else
-                return (*np)->a;
-        }
+
+    k = 0;
+    switch (len & 3) {
+    case 3:
+        k ^= data[i + 2] << 16;
+        /* fallthrough */
+    case 2:
+        k ^= data[i + 1] << 8;
+        /* fallthrough */
+    case 1:
+        k ^= data[i];
+        k *= c1;
+        k = (k << 15) | (k >> 17);
+        k *= c2;
+        h ^= k;
     }
-    if (makeit) {
+
+    h ^= len;
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+static HashSlotPtr
+FindSlot(const char *string, unsigned len, unsigned int hash)
+{
+    unsigned long i;
+
+    for (i = hash & hashMask;; i = (i + 1) & hashMask) {
+        HashSlotPtr slot = &hashTable[i];
         NodePtr nd;
 
-        nd = malloc(sizeof(NodeRec));
-        if (!nd)
-            return BAD_RESOURCE;
-        if (lastAtom < XA_LAST_PREDEFINED) {
-            nd->string = string;
+        if (slot->a == None)
+            return slot;
+        if (slot->hash != hash)
+            continue;
+        nd = &nodeTable[slot->a];
+        if (nd->len == len && memcmp(nd->string, string, len) == 0)
+            return slot;
+    }
+}
+
+static Bool
+GrowHashTable(void)
+{
+    unsigned long newMask = (hashMask << 1) | 1;
+    HashSlotPtr newTable;
+    Atom a;
+
+    newTable = calloc(newMask + 1, sizeof(HashSlotRec));
+    if (!newTable)
+        return FALSE;
+    for (a = 1; a <= lastAtom; a++) {
+        unsigned int hash = nodeTable[a].hash;
+        unsigned long i = hash & newMask;
+
+        while (newTable[i].a != None)
+            i = (i + 1) & newMask;
+        newTable[i].hash = hash;
+        newTable[i].a = a;
+    }
+    free(hashTable);
+    hashTable = newTable;
+    hashMask = newMask;
+    return TRUE;
+}
+
+static char *
+AllocAtomName(const char *string, unsigned len)
+{
+    StringBlockPtr block = stringBlocks;
+    char *name;
+
+    if (!block || block->size - block->used < len + 1) {
+        size_t size = max(StringBlockSize, len + 1);
+
+        block = malloc(sizeof(StringBlockRec) + size);
+        if (!block)
+            return NULL;
+        block->used = 0;
+        block->size = size;
+        /* keep the partially filled block at the head for short names */
+        if (stringBlocks && len + 1 > StringBlockSize) {
+            block->next = stringBlocks->next;
+            stringBlocks->next = block;
         }
         else {
-            nd->string = strndup(string, len);
-            if (!nd->string) {
-                free(nd);
-                return BAD_RESOURCE;
-            }
+            block->next = stringBlocks;
+            stringBlocks = block;
         }
-        if ((lastAtom + 1) >= tableLength) {
-            NodePtr *table;
-
-            table = reallocarray(nodeTable, tableLength, 2 * sizeof(NodePtr));
-            if (!table) {
-                if (nd->string != string) {
-                    /* nd->string has been strdup'ed */
-                    free((char *) nd->string);
-                }
-                free(nd);
-                return BAD_RESOURCE;
-            }
-            tableLength <<= 1;
-            nodeTable = table;
-        }
-        *np = nd;
-        nd->left = nd->right = NULL;
-        nd->fingerPrint = fp;
-        nd->a = ++lastAtom;
-        nodeTable[lastAtom] = nd;
-        return nd->a;
     }
-    else
+    name = block->data + block->used;
+    memcpy(name, string, len);
+    name[len] = '\0';
+    block->used += len + 1;
+    return name;
+}
+
+Atom
+MakeAtom(const char *string, unsigned len, Bool makeit)
+{
+    HashSlotPtr slot;
+    NodePtr nd;
+    unsigned int hash;
+
+    if (!hashTable)
+        return makeit ? BAD_RESOURCE : None;
+
+    /* names are compared as C strings, as they always have been */
+    len = strnlen(string, len);
+    hash = HashAtomName(string, len);
+    slot = FindSlot(string, len, hash);
+    if (slot->a != None)
+        return slot->a;
+    if (!makeit)
         return None;
+
+    if ((lastAtom + 1) >= tableLength) {
+        NodePtr table;
+
+        table = reallocarray(nodeTable, tableLength, 2 * sizeof(NodeRec));
+        if (!table)
+            return BAD_RESOURCE;
+        tableLength <<= 1;
+        nodeTable = table;
+    }
+    if (2 * (lastAtom + 1) > hashMask) {
+        if (!GrowHashTable())
+            return BAD_RESOURCE;
+        slot = FindSlot(string, len, hash);
+    }
+
+    nd = &nodeTable[lastAtom + 1];
+    if (lastAtom < XA_LAST_PREDEFINED) {
+        nd->string = string;
+    }
+    else {
+        nd->string = AllocAtomName(string, len);
+        if (!nd->string)
+            return BAD_RESOURCE;
+    }
+    nd->len = len;
+    nd->hash = hash;
+    slot->hash = hash;
+    slot->a = ++lastAtom;
+    return slot->a;
 }
 
 Bool
@@ -147,13 +271,9 @@ ValidAtom(Atom atom)
 const char *
 NameForAtom(Atom atom)
 {
-    NodePtr node;
-
     if (atom > lastAtom)
         return 0;
-    if ((node = nodeTable[atom]) == NULL)
-        return 0;
-    return node->string;
+    return nodeTable[atom].string;
 }
 
 void
@@ -162,30 +282,18 @@ AtomError(void)
     FatalError("initializing atoms");
 }
 
-static void
-FreeAtom(NodePtr patom)
-{
-    if (patom->left)
-        FreeAtom(patom->left);
-    if (patom->right)
-        FreeAtom(patom->right);
-    if (patom->a > XA_LAST_PREDEFINED) {
-        /*
-         * All strings above XA_LAST_PREDEFINED are strdup'ed, so it's safe to
-         * cast here
-         */
-        free((char *) patom->string);
-    }
-    free(patom);
-}
-
 void
 FreeAllAtoms(void)
 {
-    if (atomRoot == NULL)
-        return;
-    FreeAtom(atomRoot);
-    atomRoot = NULL;
+    while (stringBlocks) {
+        StringBlockPtr next = stringBlocks->next;
+
+        free(stringBlocks);
+        stringBlocks = next;
+    }
+    free(hashTable);
+    hashTable = NULL;
+    hashMask = 0;
     free(nodeTable);
     nodeTable = NULL;
     lastAtom = None;
@@ -196,10 +304,14 @@ InitAtoms(void)
 {
     FreeAllAtoms();
     tableLength = InitialTableSize;
-    nodeTable = xallocarray(InitialTableSize, sizeof(NodePtr));
-    if (!nodeTable)
+    nodeTable = xallocarray(InitialTableSize, sizeof(NodeRec));
+    hashTable = calloc(InitialHashSize, sizeof(HashSlotRec));
+    if (!nodeTable || !hashTable)
         AtomError();
-    nodeTable[None] = NULL;
+    hashMask = InitialHashSize - 1;
+    nodeTable[None].string = NULL;
+    nodeTable[None].len = 0;
+    nodeTable[None].hash = 0;
     MakePredeclaredAtoms();
     if (lastAtom != XA_LAST_PREDEFINED)
         AtomError();
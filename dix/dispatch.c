@@ -108,8 +108,10 @@ Equipment Corporation.
 #include "dix/dix_priv.h"
 #include "dix/input_priv.h"
 #include "dix/gc_priv.h"
+#include "dix/profile_priv.h"
 #include "dix/registry_priv.h"
 #include "dix/screenint_priv.h"
+#include "dix/slab_priv.h"
 #include "include/resource.h"
 #include "os/auth.h"
 #include "os/client_priv.h"
@@ -211,36 +213,37 @@ SetInputCheck(HWEventQueuePtr c0, HWEventQueuePtr c1)
     checkForInput[1] = c1;
 }
 
+/* The cached clock can lag behind the timestamps of the input events
+ * processed since it was read; those must not look like a wraparound. */
+static void
+AdvanceCurrentTime(CARD32 milliseconds)
+{
+    if ((INT32) (milliseconds - currentTime.milliseconds) <= 0)
+        return;
+    if (milliseconds < currentTime.milliseconds)
+        currentTime.months++;
+    currentTime.milliseconds = milliseconds;
+}
+
 void
 UpdateCurrentTime(void)
 {
-    TimeStamp systime;
+    CARD32 milliseconds;
 
-    /* To avoid time running backwards, we must call GetTimeInMillis before
+    /* To avoid time running backwards, we must read the clock before
      * calling ProcessInputEvents.
      */
-    systime.months = currentTime.months;
-    systime.milliseconds = GetTimeInMillis();
-    if (systime.milliseconds < currentTime.milliseconds)
-        systime.months++;
+    milliseconds = GetCachedTimeInMillis();
     if (InputCheckPending())
         ProcessInputEvents();
-    if (CompareTimeStamps(systime, currentTime) == LATER)
-        currentTime = systime;
+    AdvanceCurrentTime(milliseconds);
 }
 
 /* Like UpdateCurrentTime, but can't call ProcessInputEvents */
 void
 UpdateCurrentTimeIf(void)
 {
-    TimeStamp systime;
-
-    systime.months = currentTime.months;
-    systime.milliseconds = GetTimeInMillis();
-    if (systime.milliseconds < currentTime.milliseconds)
-        systime.months++;
-    if (CompareTimeStamps(systime, currentTime) == LATER)
-        currentTime = systime;
+    AdvanceCurrentTime(GetCachedTimeInMillis());
 }
 
 #undef SMART_DEBUG
@@ -271,7 +274,7 @@ static struct xorg_list ready_clients;
 static struct xorg_list saved_ready_clients;
 struct xorg_list output_pending_clients;
 
-static void
+void
 init_client_ready(void)
 {
     xorg_list_init(&ready_clients);
@@ -334,18 +337,144 @@ mark_client_ungrab(void)
     }
 }
 
-static ClientPtr
+/*
+ * Scheduling policies.  Whichever one is in use, the client picked gets a
+ * time slice the way the smart scheduler has always handed them out; the
+ * policies differ only in how they rank the ready clients.  Ties go round
+ * robin.
+ */
+typedef struct _SchedulePolicy {
+    const char *name;
+    void (*Start) (void);       /* before ranking, if not NULL */
+    int64_t (*Rank) (ClientPtr client); /* higher goes first */
+} SchedulePolicyRec;
+
+#define SCHEDULE_FOCUS_BOOST 10
+#define SCHEDULE_FOCUS_MAX 8
+#define SCHEDULE_WEIGHT_SHIFT_MAX 4
+
+int SchedulePolicy = SCHEDULE_POLICY_SMART;
+ScheduleClientRec ScheduleClients[MAXCLIENTS];
+static CARD64 ScheduleVirtualTime;
+static ClientPtr ScheduleFocusClients[SCHEDULE_FOCUS_MAX];
+static int ScheduleNumFocusClients;
+
+/* X priority first, then how little of its slices the client used up */
+static int64_t
+SmartScheduleRank(ClientPtr client)
+{
+    return (int64_t) client->priority * 256 + client->smart_priority;
+}
+
+/*
+ * Weighted fair queuing: the client that has had the least CPU time, as
+ * weighed by ScheduleCharge(), goes first.  A client coming back from idle
+ * starts level with the others, rather than with a credit that would let
+ * it hog the server.
+ */
+static int64_t
+FairScheduleRank(ClientPtr client)
+{
+    ScheduleClientRec *sched = &ScheduleClients[client->index];
+
+    if (sched->vtime < ScheduleVirtualTime)
+        sched->vtime = ScheduleVirtualTime;
+    return -(int64_t) sched->vtime;
+}
+
+/* the clients whose windows the master keyboards are focused on */
+static void
+FocusScheduleStart(void)
+{
+    DeviceIntPtr dev;
+
+    ScheduleNumFocusClients = 0;
+    for (dev = inputInfo.devices; dev; dev = dev->next) {
+        WindowPtr win;
+
+        if (!IsMaster(dev) || !dev->focus ||
+            ScheduleNumFocusClients == SCHEDULE_FOCUS_MAX)
+            continue;
+        win = dev->focus->win;
+        if (win == NoneWin || win == PointerRootWin || win == FollowKeyboardWin)
+            continue;
+        ScheduleFocusClients[ScheduleNumFocusClients++] = wClient(win);
+    }
+}
+
+/*
+ * The smart ranking, with a head start for the clients the user is typing
+ * at.  One that floods the server still loses it after a few full slices.
+ */
+static int64_t
+FocusScheduleRank(ClientPtr client)
+{
+    int64_t rank = SmartScheduleRank(client);
+    int i;
+
+    for (i = 0; i < ScheduleNumFocusClients; i++)
+        if (ScheduleFocusClients[i] == client)
+            return rank + SCHEDULE_FOCUS_BOOST;
+    return rank;
+}
+
+static const SchedulePolicyRec SchedulePolicies[] = {
+    [SCHEDULE_POLICY_SMART] = { "smart", NULL, SmartScheduleRank },
+    [SCHEDULE_POLICY_FAIR] = { "fair", NULL, FairScheduleRank },
+    [SCHEDULE_POLICY_FOCUS] = { "focus", FocusScheduleStart, FocusScheduleRank },
+};
+
+Bool
+ScheduleSetPolicy(const char *name)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(SchedulePolicies); i++) {
+        if (strcmp(name, SchedulePolicies[i].name) == 0) {
+            SchedulePolicy = i;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+ * Charge the client for a time slice.  For the fair policy, each step of
+ * X priority above zero halves the charge and each step below doubles it.
+ */
+void
+ScheduleCharge(ClientPtr client, CARD64 ns)
+{
+    ScheduleClientRec *sched = &ScheduleClients[client->index];
+    int shift = client->priority;
+
+    if (shift > SCHEDULE_WEIGHT_SHIFT_MAX)
+        shift = SCHEDULE_WEIGHT_SHIFT_MAX;
+    else if (shift < -SCHEDULE_WEIGHT_SHIFT_MAX)
+        shift = -SCHEDULE_WEIGHT_SHIFT_MAX;
+
+    sched->cpu_ns += ns;
+    sched->vtime += shift >= 0 ? ns >> shift : ns << -shift;
+}
+
+ClientPtr
 SmartScheduleClient(void)
 {
+    const SchedulePolicyRec *policy = &SchedulePolicies[SchedulePolicy];
     ClientPtr pClient, best = NULL;
     int bestRobin, robin;
+    int64_t bestRank, rank;
     long now = SmartScheduleTime;
     long idle;
     int nready = 0;
 
     bestRobin = 0;
+    bestRank = 0;
     idle = 2 * SmartScheduleSlice;
 
+    if (policy->Start)
+        (*policy->Start) ();
+
     xorg_list_for_each_entry(pClient, &ready_clients, ready) {
         nready++;
 
@@ -362,13 +491,11 @@ SmartScheduleClient(void)
                             SMART_MIN_PRIORITY]) & 0xff;
 
         /* pick the best client */
-        if (!best ||
-            pClient->priority > best->priority ||
-            (pClient->priority == best->priority &&
-             (pClient->smart_priority > best->smart_priority ||
-              (pClient->smart_priority == best->smart_priority && robin > bestRobin))))
+        rank = (*policy->Rank) (pClient);
+        if (!best || rank > bestRank || (rank == bestRank && robin > bestRobin))
         {
             best = pClient;
+            bestRank = rank;
             bestRobin = robin;
         }
 #ifdef SMART_DEBUG
@@ -383,6 +510,8 @@ SmartScheduleClient(void)
     }
 #endif
     SmartLastIndex[best->smart_priority - SMART_MIN_PRIORITY] = best->index;
+    if (ScheduleClients[best->index].vtime > ScheduleVirtualTime)
+        ScheduleVirtualTime = ScheduleClients[best->index].vtime;
     /*
      * Set current client pointer
      */
@@ -485,6 +614,9 @@ Dispatch(void)
     int result;
     ClientPtr client;
     long start_tick;
+    CARD64 start_ns;
+    uint64_t profile_start = 0;
+    Bool ready;
 
     nextFreeClientID = 1;
     nClients = 0;
@@ -498,7 +630,15 @@ Dispatch(void)
             FlushIfCriticalOutputPending();
         }
 
-        if (!WaitForSomething(clients_are_ready()))
+        if (DispatchProfileSignalled)
+            DispatchProfileToggle();
+
+        if (DispatchProfileEnabled)
+            profile_start = DispatchProfileNow();
+        ready = WaitForSomething(clients_are_ready());
+        if (DispatchProfileEnabled && profile_start)
+            DispatchProfileWait(DispatchProfileNow() - profile_start);
+        if (!ready)
             continue;
 
         /*****************
@@ -508,10 +648,13 @@ Dispatch(void)
 
         if (!dispatchException && clients_are_ready()) {
             client = SmartScheduleClient();
+            if (DispatchProfileEnabled)
+                DispatchProfileSlice(client, FALSE);
 
             isItTimeToYield = FALSE;
 
             start_tick = SmartScheduleTime;
+            start_ns = GetTimeInNanos();
             while (!isItTimeToYield) {
                 if (InputCheckPending())
                     ProcessInputEvents();
@@ -522,6 +665,8 @@ Dispatch(void)
                     /* Penalize clients which consume ticks */
                     if (client->smart_priority > SMART_MIN_PRIORITY)
                         client->smart_priority--;
+                    if (DispatchProfileEnabled)
+                        DispatchProfileSlice(client, TRUE);
                     break;
                 }
 
@@ -550,19 +695,25 @@ Dispatch(void)
                                           client->index,
                                           client->requestBuffer);
 #endif
+                profile_start = DispatchProfileEnabled ? DispatchProfileNow() : 0;
                 if (result > (maxBigRequestSize << 2))
                     result = BadLength;
                 else {
                     result = XaceHookDispatch(client, client->majorOp);
                     if (result == Success) {
                         currentClient = client;
-                        result =
-                            (*client->requestVector[client->majorOp]) (client);
+                        /* a reader thread may have done the swapping */
+                        if (client->req_preswapped)
+                            result = (*ProcVector[client->majorOp]) (client);
+                        else
+                            result =
+                                (*client->requestVector[client->majorOp]) (client);
                         currentClient = NULL;
                     }
                 }
+                InvalidateCachedTime();
                 if (!SmartScheduleSignalEnable)
-                    SmartScheduleTime = GetTimeInMillis();
+                    SmartScheduleTime = GetCachedTimeInMillis();
 
 #ifdef XSERVER_DTRACE
                 if (XSERVER_REQUEST_DONE_ENABLED())
@@ -570,6 +721,9 @@ Dispatch(void)
                                          client->majorOp, client->sequence,
                                          client->index, result);
 #endif
+                if (DispatchProfileEnabled && profile_start)
+                    DispatchProfileRequest(client,
+                                           DispatchProfileNow() - profile_start);
 
                 if (client->noClientException != Success) {
                     CloseDownClient(client);
@@ -583,8 +737,10 @@ Dispatch(void)
                 }
             }
             FlushAllOutput();
-            if (client == SmartLastClient)
+            if (client == SmartLastClient) {
+                ScheduleCharge(client, GetTimeInNanos() - start_ns);
                 client->smart_stop_tick = SmartScheduleTime;
+            }
         }
         dispatchException &= ~DE_PRIORITYCHANGE;
     }
@@ -594,9 +750,185 @@ Dispatch(void)
     KillAllClients();
     dispatchException &= ~DE_RESET;
     SmartScheduleLatencyLimited = 0;
+    if (DispatchProfileEnabled)
+        DispatchProfileDump();
+    LogOsBufferStats();
+    dixSlabLogStats();
     ResetOsBuffers();
 }
 
+/*
+ * A request too big to do in one go, like a GetImage of a whole large
+ * screen, may do the rest of its work in steps.  Its client is ignored
+ * until then, and the steps run from the work queue between the turns of
+ * other clients, for at most a scheduling interval each time and only
+ * while the client's connection takes what they write.  The time goes on
+ * the client's bill like that of any other turn.  Events for the client
+ * are held back until the request is done, so they can't end up in the
+ * middle of its reply; if there's no memory to hold one, the request is
+ * finished on the spot, and the held events sent, before it.
+ */
+
+typedef struct _RequestSteps {
+    struct xorg_list entry;
+    ClientPtr client;
+    RequestStepProcPtr step;
+    RequestReleaseProcPtr release;
+    void *closure;
+    char *events;               /* held back until the request is done */
+    int eventBytes;
+    int eventSize;
+    Bool running;               /* what a step sends goes out as it is */
+    Bool done;                  /* only waiting to be released */
+} RequestStepsRec, *RequestStepsPtr;
+
+static struct xorg_list requestSteps = { &requestSteps, &requestSteps };
+static unsigned long requestStepsGeneration;
+
+static RequestStepsPtr
+FindRequestSteps(ClientPtr client)
+{
+    RequestStepsPtr steps;
+
+    xorg_list_for_each_entry(steps, &requestSteps, entry)
+        if (steps->client == client)
+            return steps;
+    return NULL;
+}
+
+/* Steps wait for the client's connection, and for another client's
+ * server grab to end, as any request of theirs would. */
+static Bool
+RequestStepsMayRun(ClientPtr client)
+{
+    return !ClientOutputBlocked(client) &&
+        (grabState == GrabNone || grabClient == client);
+}
+
+static void
+RequestStepsBlockHandler(void *data, void *timeout)
+{
+    RequestStepsPtr steps;
+
+    /* don't sleep while there's a step that could go on */
+    xorg_list_for_each_entry(steps, &requestSteps, entry)
+        if (steps->done || RequestStepsMayRun(steps->client)) {
+            AdjustWaitForDelay(timeout, 0);
+            break;
+        }
+}
+
+/* The request is done: let the client go on, and send what was held. */
+static void
+RequestStepsDone(RequestStepsPtr steps)
+{
+    ClientPtr client = steps->client;
+
+    steps->done = TRUE;
+    /* Dispatch() closes the client down if writing to it failed */
+    AttendClient(client);
+    if (steps->eventBytes && client->noClientException == Success)
+        WriteToClient(client, steps->eventBytes, steps->events);
+    free(steps->events);
+    steps->events = NULL;
+    steps->eventBytes = steps->eventSize = 0;
+}
+
+static Bool
+RequestStepsWork(ClientPtr client, void *closure)
+{
+    RequestStepsPtr steps = closure;
+    CARD64 start, now;
+    Bool done;
+
+    if (!client->clientGone && !steps->done) {
+        if (!RequestStepsMayRun(client))
+            return FALSE;
+
+        start = GetTimeInNanos();
+        steps->running = TRUE;
+        do {
+            done = (*steps->step) (client, steps->closure);
+            now = GetTimeInNanos();
+        } while (!done && client->noClientException == Success &&
+                 !ClientOutputBlocked(client) &&
+                 now - start < (CARD64) SmartScheduleInterval * 1000000);
+        steps->running = FALSE;
+        ScheduleCharge(client, now - start);
+
+        if (!done && client->noClientException == Success)
+            return FALSE;
+
+        RequestStepsDone(steps);
+    }
+
+    xorg_list_del(&steps->entry);
+    (*steps->release) (steps->closure);
+    free(steps->events);
+    free(steps);
+    return TRUE;
+}
+
+Bool
+RunRequestInSteps(ClientPtr client, RequestStepProcPtr step,
+                  RequestReleaseProcPtr release, void *closure)
+{
+    RequestStepsPtr steps;
+
+    if (requestStepsGeneration != serverGeneration) {
+        if (!RegisterBlockAndWakeupHandlers(RequestStepsBlockHandler,
+                                            (ServerWakeupHandlerProcPtr) NoopDDA,
+                                            NULL))
+            return FALSE;
+        requestStepsGeneration = serverGeneration;
+    }
+
+    steps = calloc(1, sizeof(RequestStepsRec));
+    if (!steps)
+        return FALSE;
+    if (!QueueWorkProc(RequestStepsWork, client, steps)) {
+        free(steps);
+        return FALSE;
+    }
+    steps->client = client;
+    steps->step = step;
+    steps->release = release;
+    steps->closure = closure;
+    xorg_list_append(&steps->entry, &requestSteps);
+    IgnoreClient(client);
+    return TRUE;
+}
+
+Bool
+DeferClientEvents(ClientPtr client, int count, const void *events)
+{
+    RequestStepsPtr steps;
+
+    if (xorg_list_is_empty(&requestSteps) ||
+        !(steps = FindRequestSteps(client)) || steps->running || steps->done)
+        return FALSE;
+
+    if (steps->eventBytes + count > steps->eventSize) {
+        int size = max(2 * steps->eventSize, steps->eventBytes + count);
+        char *held = realloc(steps->events, size);
+
+        if (!held) {
+            /* send the rest of the reply now; these events go after it */
+            steps->done = TRUE;
+            while (client->noClientException == Success &&
+                   !(*steps->step) (client, steps->closure))
+                ;
+            RequestStepsDone(steps);
+            return FALSE;
+        }
+        steps->events = held;
+        steps->eventSize = size;
+    }
+    memcpy(steps->events + steps->eventBytes, events, count);
+    steps->eventBytes += count;
+    return TRUE;
+}
+
 static int VendorRelease = VENDOR_RELEASE;
 
 void
@@ -2143,33 +2475,43 @@ ProcPutImage(ClientPtr client)
     return Success;
 }
 
+/*
+ * Hand a chunk of image data to the client without copying it, taking a
+ * fresh buffer for the next chunk.  Chunks small enough that they'd be
+ * copied anyway, or a fresh buffer that can't be had, keep the buffer.
+ */
+static char *
+WriteImageToClient(ClientPtr client, int count, char *pBuf, long size)
+{
+    char *pNext;
+
+    if (count < OUTPUT_REF_MIN || !(pNext = malloc(size))) {
+        WriteToClient(client, count, pBuf);
+        return pBuf;
+    }
+    WriteToClientNoCopy(client, count, pBuf, free);
+    return pNext;
+}
+
+/*
+ * Look the drawable of a GetImage up and check that the rectangle is
+ * wholly in it.  Steps of a GetImage check again, as the drawable may
+ * have changed or gone by then.
+ */
 static int
-DoGetImage(ClientPtr client, int format, Drawable drawable,
-           int x, int y, int width, int height,
-           Mask planemask)
+GetImageDrawable(ClientPtr client, Drawable drawable,
+                 int x, int y, int width, int height, DrawablePtr *ppDraw)
 {
     DrawablePtr pDraw, pBoundingDraw;
-    int nlines, linesPerBuf, rc;
-    int linesDone;
 
     /* coordinates relative to the bounding drawable */
     int relx, rely;
-    long widthBytesLine, length;
-    Mask plane = 0;
-    char *pBuf;
-    xGetImageReply xgi;
-    RegionPtr pVisibleRegion = NULL;
+    int rc;
 
-    if ((format != XYPixmap) && (format != ZPixmap)) {
-        client->errorValue = format;
-        return BadValue;
-    }
     rc = dixLookupDrawable(&pDraw, drawable, client, 0, DixReadAccess);
     if (rc != Success)
         return rc;
 
-    memset(&xgi, 0, sizeof(xGetImageReply));
-
     relx = x;
     rely = y;
 
@@ -2204,12 +2546,9 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
         else {
             pBoundingDraw = (DrawablePtr) pDraw->pScreen->root;
         }
-
-        xgi.visual = wVisual(pWin);
     }
     else {
         pBoundingDraw = pDraw;
-        xgi.visual = None;
     }
 
     /* "If the drawable is a pixmap, the given rectangle must be wholly
@@ -2227,6 +2566,143 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
         rely < 0 || rely + height > (int) pBoundingDraw->height)
         return BadMatch;
 
+    *ppDraw = pDraw;
+    return Success;
+}
+
+/*
+ * Get nlines lines of the image into pBuf, as the client wants to see
+ * them.  For XYPixmap, planemask is the one plane to get.
+ */
+static void
+GetImageLines(ClientPtr client, DrawablePtr pDraw, int format,
+              int x, int y, int width, int nlines, Mask planemask,
+              long widthBytesLine, char *pBuf)
+{
+    int bpp = format == ZPixmap ? BitsPerPixel(pDraw->depth) : 1;
+    long lineBytes = ((long) width * bpp) / 8;
+    int i;
+
+    /* GetImage leaves the scanline pad alone, don't send what was there */
+    if (lineBytes < widthBytesLine)
+        for (i = 0; i < nlines; i++)
+            memset(pBuf + i * widthBytesLine + lineBytes, 0,
+                   widthBytesLine - lineBytes);
+
+    (*pDraw->pScreen->GetImage) (pDraw, x, y, width, nlines,
+                                 format, planemask, (void *) pBuf);
+    if (pDraw->type == DRAWABLE_WINDOW)
+        XaceCensorImage(client, &((WindowPtr) pDraw)->borderClip,
+                        widthBytesLine, pDraw, x, y, width, nlines,
+                        format, pBuf);
+
+    /* Note that this is NOT a call to WriteSwappedDataToClient,
+       as we do NOT byte swap */
+    ReformatImage(pBuf, (int) (nlines * widthBytesLine), bpp,
+                  ClientOrder(client));
+}
+
+/*
+ * Images of more than IMAGE_STEPS_MIN bytes are sent a buffer at a time
+ * in steps, see RunRequestInSteps(), so that getting all of a large screen
+ * doesn't hold up everyone else.  Other clients may draw in between, so
+ * the image is only as consistent as what several smaller GetImages would
+ * give.  If the drawable goes away or no longer holds the rectangle, the
+ * rest of the image is zeros.
+ */
+#define IMAGE_STEPS_MIN (16 * IMAGE_BUFSIZE)
+
+typedef struct _GetImageSteps {
+    Drawable drawable;
+    int format;
+    int depth;
+    int x, y, width, height;
+    Mask planemask;
+    Mask plane;                 /* for XYPixmap, the plane being sent */
+    int linesDone;
+    int linesPerBuf;
+    long widthBytesLine;
+    long length;                /* size of pBuf */
+    char *pBuf;
+} GetImageStepsRec, *GetImageStepsPtr;
+
+static Bool
+GetImageStep(ClientPtr client, void *closure)
+{
+    GetImageStepsPtr steps = closure;
+    DrawablePtr pDraw;
+    int y = steps->y + steps->linesDone;
+    int nlines = min(steps->linesPerBuf, steps->height - steps->linesDone);
+
+    if (GetImageDrawable(client, steps->drawable, steps->x, steps->y,
+                         steps->width, steps->height, &pDraw) == Success &&
+        pDraw->depth == steps->depth) {
+        if (pDraw->type == DRAWABLE_WINDOW)
+            pDraw->pScreen->SourceValidate(pDraw, steps->x, y,
+                                           steps->width, nlines,
+                                           IncludeInferiors);
+        GetImageLines(client, pDraw, steps->format, steps->x, y,
+                      steps->width, nlines,
+                      steps->format == ZPixmap ? steps->planemask : steps->plane,
+                      steps->widthBytesLine, steps->pBuf);
+    }
+    else
+        memset(steps->pBuf, 0, nlines * steps->widthBytesLine);
+
+    steps->pBuf = WriteImageToClient(client,
+                                     (int) (nlines * steps->widthBytesLine),
+                                     steps->pBuf, steps->length);
+    steps->linesDone += nlines;
+    if (steps->linesDone < steps->height)
+        return FALSE;
+    if (steps->format == ZPixmap)
+        return TRUE;
+
+    steps->linesDone = 0;
+    do
+        steps->plane >>= 1;
+    while (steps->plane && !(steps->planemask & steps->plane));
+    return !steps->plane;
+}
+
+static void
+GetImageStepsDone(void *closure)
+{
+    GetImageStepsPtr steps = closure;
+
+    free(steps->pBuf);
+    free(steps);
+}
+
+static int
+DoGetImage(ClientPtr client, int format, Drawable drawable,
+           int x, int y, int width, int height,
+           Mask planemask)
+{
+    DrawablePtr pDraw;
+    int nlines, linesPerBuf, rc;
+    int linesDone;
+    long widthBytesLine, length;
+    Mask plane = 0;
+    char *pBuf;
+    xGetImageReply xgi;
+    GetImageStepsPtr steps;
+
+    if ((format != XYPixmap) && (format != ZPixmap)) {
+        client->errorValue = format;
+        return BadValue;
+    }
+    rc = GetImageDrawable(client, drawable, x, y, width, height, &pDraw);
+    if (rc != Success)
+        return rc;
+
+    memset(&xgi, 0, sizeof(xGetImageReply));
+
+    if (pDraw->type == DRAWABLE_WINDOW)
+        xgi.visual = wVisual((WindowPtr) pDraw);
+    else
+        xgi.visual = None;
+
     xgi.type = X_Reply;
     xgi.sequenceNumber = client->sequence;
     xgi.depth = pDraw->depth;
@@ -2269,15 +2745,41 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
             length += widthBytesLine;
         }
     }
-    if (!(pBuf = calloc(1, length)))
+    if (!(pBuf = malloc(length)))
         return BadAlloc;
+
+    if (linesPerBuf > 0 && (CARD64) xgi.length * 4 > IMAGE_STEPS_MIN &&
+        (steps = malloc(sizeof(GetImageStepsRec)))) {
+        *steps = (GetImageStepsRec) {
+            .drawable = drawable,
+            .format = format,
+            .depth = pDraw->depth,
+            .x = x,
+            .y = y,
+            .width = width,
+            .height = height,
+            .planemask = planemask,
+            .plane = plane,
+            .linesPerBuf = linesPerBuf,
+            .widthBytesLine = widthBytesLine,
+            .length = length,
+            .pBuf = pBuf,
+        };
+        while (format == XYPixmap && !(planemask & steps->plane))
+            steps->plane >>= 1;
+        if (RunRequestInSteps(client, GetImageStep, GetImageStepsDone,
+                              steps)) {
+            WriteReplyToClient(client, sizeof(xGetImageReply), &xgi);
+            return Success;
+        }
+        free(steps);
+    }
+
     WriteReplyToClient(client, sizeof(xGetImageReply), &xgi);
 
-    if (pDraw->type == DRAWABLE_WINDOW) {
-        pVisibleRegion = &((WindowPtr) pDraw)->borderClip;
+    if (pDraw->type == DRAWABLE_WINDOW)
         pDraw->pScreen->SourceValidate(pDraw, x, y, width, height,
                                        IncludeInferiors);
-    }
 
     if (linesPerBuf == 0) {
         /* nothing to do */
@@ -2286,23 +2788,10 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
         linesDone = 0;
         while (height - linesDone > 0) {
             nlines = min(linesPerBuf, height - linesDone);
-            (*pDraw->pScreen->GetImage) (pDraw,
-                                         x,
-                                         y + linesDone,
-                                         width,
-                                         nlines,
-                                         format, planemask, (void *) pBuf);
-            if (pVisibleRegion)
-                XaceCensorImage(client, pVisibleRegion, widthBytesLine,
-                                pDraw, x, y + linesDone, width,
-                                nlines, format, pBuf);
-
-            /* Note that this is NOT a call to WriteSwappedDataToClient,
-               as we do NOT byte swap */
-            ReformatImage(pBuf, (int) (nlines * widthBytesLine),
-                          BitsPerPixel(pDraw->depth), ClientOrder(client));
-
-            WriteToClient(client, (int) (nlines * widthBytesLine), pBuf);
+            GetImageLines(client, pDraw, format, x, y + linesDone, width,
+                          nlines, planemask, widthBytesLine, pBuf);
+            pBuf = WriteImageToClient(client, (int) (nlines * widthBytesLine),
+                                      pBuf, length);
             linesDone += nlines;
         }
     }
@@ -2313,24 +2802,11 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
                 linesDone = 0;
                 while (height - linesDone > 0) {
                     nlines = min(linesPerBuf, height - linesDone);
-                    (*pDraw->pScreen->GetImage) (pDraw,
-                                                 x,
-                                                 y + linesDone,
-                                                 width,
-                                                 nlines,
-                                                 format, plane, (void *) pBuf);
-                    if (pVisibleRegion)
-                        XaceCensorImage(client, pVisibleRegion,
-                                        widthBytesLine,
-                                        pDraw, x, y + linesDone, width,
-                                        nlines, format, pBuf);
-
-                    /* Note: NOT a call to WriteSwappedDataToClient,
-                       as we do NOT byte swap */
-                    ReformatImage(pBuf, (int) (nlines * widthBytesLine),
-                                  1, ClientOrder(client));
-
-                    WriteToClient(client, (int)(nlines * widthBytesLine), pBuf);
+                    GetImageLines(client, pDraw, format, x, y + linesDone,
+                                  width, nlines, plane, widthBytesLine, pBuf);
+                    pBuf = WriteImageToClient(client,
+                                              (int) (nlines * widthBytesLine),
+                                              pBuf, length);
                     linesDone += nlines;
                 }
             }
@@ -3565,6 +4041,8 @@ CloseDownClient(ClientPtr client)
 #ifdef XSERVER_DTRACE
         XSERVER_CLIENT_DISCONNECT(client->index);
 #endif
+        if (DispatchProfileEnabled)
+            DispatchProfileClientGone(client);
         if (client->index < nextFreeClientID)
             nextFreeClientID = client->index;
         clients[client->index] = NullClient;
@@ -3605,6 +4083,8 @@ InitClient(ClientPtr client, int i, void *ospriv)
     QueryMinMaxKeyCodes(&client->minKC, &client->maxKC);
     client->smart_start_tick = SmartScheduleTime;
     client->smart_stop_tick = SmartScheduleTime;
+    ScheduleClients[i].cpu_ns = 0;
+    ScheduleClients[i].vtime = ScheduleVirtualTime;
     client->clientIds = NULL;
 }
 
@@ -33,12 +33,20 @@ extern long maxBigRequestSize;
 extern char dispatchExceptionAtReset;
 extern int terminateDelay;
 extern Bool touchEmulatePointer;
+extern Bool coalesceMotionEvents;
+
+/* -coalescemotion: let a motion event take the place of the one the client
+ * still has waiting; see events.c. */
+Bool CoalesceMotionEvent(ClientPtr pClient, xEvent *ev, int length);
 
 extern HWEventQueuePtr checkForInput[2];
 
  /* -retro mode */
 extern Bool party_like_its_1989;
 
+/* -fbthreads: threads fb draws large operations with, next to the main one */
+extern int fbThreadCount;
+
 static inline _X_NOTSAN Bool
 InputCheckPending(void)
 {
@@ -49,6 +57,18 @@ void ClearWorkQueue(void);
 void ProcessWorkQueue(void);
 void ProcessWorkQueueZombies(void);
 
+/* The rest of a long request, done in steps between other clients' turns
+ * until step returns TRUE; release is called once it is done or the client
+ * is gone.  See dispatch.c. */
+typedef Bool (*RequestStepProcPtr) (ClientPtr client, void *closure);
+typedef void (*RequestReleaseProcPtr) (void *closure);
+
+Bool RunRequestInSteps(ClientPtr client, RequestStepProcPtr step,
+                       RequestReleaseProcPtr release, void *closure);
+
+/* Hold back events for a client whose request runs in steps. */
+Bool DeferClientEvents(ClientPtr client, int count, const void *events);
+
 void CloseDownClient(ClientPtr client);
 ClientPtr GetCurrentClient(void);
 void InitClient(ClientPtr client, int i, void *ospriv);
@@ -101,6 +121,9 @@ void EnqueueEvent(InternalEvent *ev, DeviceIntPtr device);
 
 void PlayReleasedEvents(void);
 
+/* called with the device from NoticeTime(), as its idle time starts over */
+extern CallbackListPtr LastEventTimeCallback;
+
 void ActivatePointerGrab(DeviceIntPtr mouse,
                          GrabPtr grab,
                          TimeStamp time,
@@ -38,6 +38,34 @@ extern Bool SmartScheduleSignalEnable;
 void SmartScheduleStartTimer(void);
 void SmartScheduleStopTimer(void);
 
+/* how the next client to run is picked from the ready ones */
+enum {
+    SCHEDULE_POLICY_SMART,      /* clients using up their slices go last */
+    SCHEDULE_POLICY_FAIR,       /* least CPU time, weighed by priority, first */
+    SCHEDULE_POLICY_FOCUS,      /* smart, but clients with the focus go first */
+};
+extern int SchedulePolicy;
+
+/* Select the policy for -schedPolicy; FALSE if there is none by that name. */
+Bool ScheduleSetPolicy(const char *name);
+
+/* Pick the ready client to run next, and size its time slice. */
+ClientPtr SmartScheduleClient(void);
+
+/* Charge the client for ns of CPU time taken by its time slice. */
+void ScheduleCharge(ClientPtr client, CARD64 ns);
+
+/* What the scheduler keeps for each client, by client index. */
+typedef struct _ScheduleClient {
+    CARD64 cpu_ns;              /* time its time slices took */
+    CARD64 vtime;               /* place in line for -schedPolicy fair */
+} ScheduleClientRec;
+
+extern ScheduleClientRec ScheduleClients[MAXCLIENTS];
+
+/* Set up the lists of ready clients, empty. */
+void init_client_ready(void);
+
 /* Client has requests queued or data on the network */
 void mark_client_ready(ClientPtr client);
 
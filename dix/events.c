@@ -124,6 +124,7 @@ Equipment Corporation.
 #include "dix/input_priv.h"
 #include "dix/eventconvert.h"
 #include "dix/exevents_priv.h"
+#include "os/osdep.h"
 #include "xkb/xkbsrv_priv.h"
 
 #include "misc.h"
@@ -209,6 +210,10 @@ xi2_get_type(const xEvent *event)
 
 CallbackListPtr EventCallback;
 CallbackListPtr DeviceEventCallback;
+CallbackListPtr LastEventTimeCallback;
+
+/* -coalescemotion: drop motion events a client hasn't received yet */
+Bool coalesceMotionEvents = FALSE;
 
 #define DNPMCOUNT 8
 
@@ -1078,6 +1083,8 @@ NoticeTime(const DeviceIntPtr dev, TimeStamp time)
 
     LastEventTimeToggleResetFlag(dev->id, TRUE);
     LastEventTimeToggleResetFlag(XIAllDevices, TRUE);
+
+    CallCallbacks(&LastEventTimeCallback, dev);
 }
 
 static void
@@ -5986,6 +5993,82 @@ ProcRecolorCursor(ClientPtr client)
     return Success;
 }
 
+/* A CARD16 of an event as the client will read it, swapped if need be. */
+static inline uint16_t
+ClientEventCard16(ClientPtr pClient, uint16_t value)
+{
+    return pClient->swapped ? bswap_16(value) : value;
+}
+
+/**
+ * Replace a pointer motion event still waiting in the client's output
+ * buffer with ev, if it is the last thing there and differs only in time
+ * and position.  That is a core MotionNotify, or an XI2 XI_Motion, whose
+ * valuator values may differ too: they are absolute, so the latest ones
+ * stand for all the steps before.  XI_RawMotion is left alone, as its
+ * values may be relative and there is no telling from the event.
+ * Whoever asked for the pointer's path rather than its position loses the
+ * steps in between, so this is only done with -coalescemotion.  Nor is it
+ * done while anyone, such as RECORD, watches delivered events through
+ * EventCallback, as they have already seen the event being replaced.
+ *
+ * @param pClient Client to send the event to.
+ * @param ev The event as it would be written, swapped if need be.
+ * @param length The length of ev in bytes.
+ * @return TRUE if ev took the place of the earlier event.
+ */
+Bool
+CoalesceMotionEvent(ClientPtr pClient, xEvent *ev, int length)
+{
+    if (!coalesceMotionEvents || EventCallback)
+        return FALSE;
+
+    if (ev->u.u.type == MotionNotify && length == sizeof(xEvent)) {
+        xEvent *last = ClientOutputTail(pClient, sizeof(xEvent));
+
+        if (!last || last->u.u.type != MotionNotify ||
+            last->u.u.detail != ev->u.u.detail ||
+            last->u.u.sequenceNumber != ev->u.u.sequenceNumber ||
+            last->u.keyButtonPointer.root != ev->u.keyButtonPointer.root ||
+            last->u.keyButtonPointer.event != ev->u.keyButtonPointer.event ||
+            last->u.keyButtonPointer.child != ev->u.keyButtonPointer.child ||
+            last->u.keyButtonPointer.state != ev->u.keyButtonPointer.state ||
+            last->u.keyButtonPointer.sameScreen !=
+            ev->u.keyButtonPointer.sameScreen)
+            return FALSE;
+
+        memcpy(last, ev, sizeof(xEvent));
+        return TRUE;
+    }
+
+    if (ev->u.u.type == GenericEvent &&
+        ((xGenericEvent *) ev)->extension == IReqCode &&
+        ClientEventCard16(pClient, ((xGenericEvent *) ev)->evtype) ==
+        XI_Motion && length >= sizeof(xXIDeviceEvent)) {
+        xXIDeviceEvent *dev = (xXIDeviceEvent *) ev;
+        xXIDeviceEvent *last = ClientOutputTail(pClient, length);
+        /* the valuator values follow the button and valuator masks */
+        int values = sizeof(xXIDeviceEvent) +
+            4 * (ClientEventCard16(pClient, dev->buttons_len) +
+                 ClientEventCard16(pClient, dev->valuators_len));
+
+        /* the header holds the length, so the masks are as long */
+        if (!last || values > length ||
+            memcmp(last, dev, offsetof(xXIDeviceEvent, time)) != 0 ||
+            memcmp(&last->detail, &dev->detail,
+                   offsetof(xXIDeviceEvent, root_x) -
+                   offsetof(xXIDeviceEvent, detail)) != 0 ||
+            memcmp(&last->buttons_len, &dev->buttons_len,
+                   values - offsetof(xXIDeviceEvent, buttons_len)) != 0)
+            return FALSE;
+
+        memcpy(last, dev, length);
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
 /**
  * Write the given events to a client, swapping the byte order if necessary.
  * To swap the byte ordering, a callback is called that has to be set up for
@@ -5996,6 +6079,9 @@ ProcRecolorCursor(ClientPtr client)
  *
  * Do not modify the event structure passed in. See comment below.
  *
+ * While a request of the client runs in steps, the events wait until it is
+ * done; see RunRequestInSteps().
+ *
  * @param pClient Client to send events to.
  * @param count Number of events.
  * @param events The event list.
@@ -6099,6 +6185,11 @@ WriteEventsToClient(ClientPtr pClient, int count, xEvent *events)
             (*EventSwapVector[eventFrom->u.u.type & 0177])
                 (eventFrom, eventTo);
 
+            if (DeferClientEvents(pClient, eventlength, eventTo))
+                continue;
+            if (count == 1 &&
+                CoalesceMotionEvent(pClient, eventTo, eventlength))
+                continue;
             WriteToClient(pClient, eventlength, eventTo);
         }
     }
@@ -6106,6 +6197,10 @@ WriteEventsToClient(ClientPtr pClient, int count, xEvent *events)
         /* only one GenericEvent, remember? that means either count is 1 and
          * eventlength is arbitrary or eventlength is 32 and count doesn't
          * matter. And we're all set. Woohoo. */
+        if (DeferClientEvents(pClient, count * eventlength, events))
+            return;
+        if (count == 1 && CoalesceMotionEvent(pClient, events, eventlength))
+            return;
         WriteToClient(pClient, count * eventlength, events);
     }
 }
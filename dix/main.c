@@ -89,6 +89,7 @@ Equipment Corporation.
 #include "dix/dix_priv.h"
 #include "dix/input_priv.h"
 #include "dix/gc_priv.h"
+#include "dix/profile_priv.h"
 #include "dix/registry_priv.h"
 #include "os/audit.h"
 #include "os/auth.h"
@@ -96,6 +97,7 @@ Equipment Corporation.
 #include "os/cmdline.h"
 #include "os/ddx_priv.h"
 #include "os/osdep.h"
+#include "os/readthread.h"
 #include "os/screensaver.h"
 
 #include "scrnintstr.h"
@@ -278,6 +280,8 @@ dix_main(int argc, char *argv[], char *envp[])
         NotifyParentProcess();
 
         InputThreadInit();
+        ReadThreadInit();
+        DispatchProfileInit();
 
         Dispatch();
 
@@ -305,6 +309,7 @@ dix_main(int argc, char *argv[], char *envp[])
         CloseInput();
 
         InputThreadFini();
+        ReadThreadFini();
 
         for (i = 0; i < screenInfo.numScreens; i++)
             screenInfo.screens[i]->root = NullWindow;
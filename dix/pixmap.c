@@ -28,6 +28,10 @@ from The Open Group.
 
 #include <dix-config.h>
 
+#include <string.h>
+
+#include "dix/slab_priv.h"
+
 #include <X11/X.h>
 #include "scrnintstr.h"
 #include "mi.h"
@@ -100,7 +104,8 @@ AllocatePixmap(ScreenPtr pScreen, int pixDataSize)
     if (pScreen->totalPixmapSize > ((size_t) - 1) - pixDataSize)
         return NullPixmap;
 
-    pPixmap = calloc(1, pScreen->totalPixmapSize + pixDataSize);
+    pPixmap = dixSlabCalloc(SLAB_PIXMAP,
+                            pScreen->totalPixmapSize + pixDataSize);
     if (!pPixmap)
         return NullPixmap;
 
@@ -113,7 +118,7 @@ void
 FreePixmap(PixmapPtr pPixmap)
 {
     dixFiniPrivates(pPixmap, PRIVATE_PIXMAP);
-    free(pPixmap);
+    dixSlabFree(pPixmap);
 }
 
 void PixmapUnshareSecondaryPixmap(PixmapPtr secondary_pixmap)
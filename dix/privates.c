@@ -51,6 +51,9 @@ from The Open Group.
 #include <dix-config.h>
 
 #include <stddef.h>
+
+#include "dix/slab_priv.h"
+
 #include "windowstr.h"
 #include "resource.h"
 #include "privates.h"
@@ -64,6 +67,9 @@ from The Open Group.
 
 static DevPrivateSetRec global_keys[PRIVATE_LAST];
 
+/* End of the hot privates of each type, kept out of the installed structs */
+static unsigned hot_end[PRIVATE_LAST];
+
 static const Bool xselinux_private[PRIVATE_LAST] = {
     [PRIVATE_SCREEN] = TRUE,
     [PRIVATE_CLIENT] = TRUE,
@@ -80,6 +86,32 @@ static const Bool xselinux_private[PRIVATE_LAST] = {
     [PRIVATE_GLYPHSET] = TRUE,
 };
 
+/* Objects that come from slabs rather than from malloc */
+static int
+private_slab(DevPrivateType type)
+{
+    switch (type) {
+    case PRIVATE_WINDOW:
+        return SLAB_WINDOW;
+    case PRIVATE_GC:
+        return SLAB_GC;
+    case PRIVATE_PIXMAP:
+        return SLAB_PIXMAP;
+    default:
+        return -1;
+    }
+}
+
+static void *
+private_alloc(DevPrivateType type, size_t size)
+{
+    int slab = private_slab(type);
+
+    if (slab < 0)
+        return malloc(size);
+    return dixSlabAlloc(slab, size);
+}
+
 static const char *key_names[PRIVATE_LAST] = {
     /* XSELinux uses the same private keys for numerous objects */
     [PRIVATE_XSELINUX] = "XSELINUX",
@@ -325,9 +357,21 @@ grow_screen_specific_set(DevPrivateType type, unsigned bytes)
  * non-zero, then the specified amount of space will be allocated in
  * the private storage. Otherwise, space for a single pointer will
  * be allocated which can be set with dixSetPrivate
+ *
+ * The privates of each type are laid out as the XSELINUX keys, then
+ * the hot keys, then the cold ones, and after those, for each screen,
+ * its screen-specific keys.  A hot key goes at the end of the hot ones,
+ * moving the cold ones up.
  */
 Bool
 dixRegisterPrivateKey(DevPrivateKey key, DevPrivateType type, unsigned size)
+{
+    return dixRegisterPrivateKeyHotness(key, type, size, PRIVATE_KEY_COLD);
+}
+
+Bool
+dixRegisterPrivateKeyHotness(DevPrivateKey key, DevPrivateType type,
+                             unsigned size, DevPrivateHotness hotness)
 {
     DevPrivateType t;
     int offset;
@@ -365,6 +409,7 @@ dixRegisterPrivateKey(DevPrivateKey key, DevPrivateType type, unsigned size)
         for (t = PRIVATE_XSELINUX; t < PRIVATE_LAST; t++) {
             if (xselinux_private[t]) {
                 grow_private_set(&global_keys[t], bytes);
+                hot_end[t] += bytes;
                 grow_screen_specific_set(t, bytes);
                 if (allocated_early[t])
                     allocated_early[t] (dixMovePrivates, bytes);
@@ -374,6 +419,19 @@ dixRegisterPrivateKey(DevPrivateKey key, DevPrivateType type, unsigned size)
 
         offset = 0;
     }
+    else if (hotness == PRIVATE_KEY_HOT && !allocated_early[type]) {
+        DevPrivateKey k;
+
+        /* Move the cold keys up to make room at the end of the hot ones */
+        assert(!global_keys[type].created);
+        offset = hot_end[type];
+        for (k = global_keys[type].key; k; k = k->next)
+            if (k->offset >= offset)
+                k->offset += bytes;
+        global_keys[type].offset += bytes;
+        hot_end[type] += bytes;
+        grow_screen_specific_set(type, bytes);
+    }
     else {
         /* Resize if we can, or make sure nothing's allocated if we can't */
         if (!allocated_early[type])
@@ -480,7 +538,7 @@ _dixAllocateObjectWithPrivates(unsigned baseSize, unsigned clear,
     /* round up so that void * is aligned */
     baseSize = (baseSize + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
     totalSize = baseSize + global_keys[type].offset;
-    object = malloc(totalSize);
+    object = private_alloc(type, totalSize);
     if (!object)
         return NULL;
 
@@ -533,7 +591,10 @@ _dixFreeObjectWithPrivates(void *object, PrivatePtr privates,
                            DevPrivateType type)
 {
     _dixFiniPrivates(privates, type);
-    free(object);
+    if (private_slab(type) < 0)
+        free(object);
+    else
+        dixSlabFree(object);
 }
 
 /*
@@ -708,7 +769,7 @@ _dixAllocateScreenObjectWithPrivates(ScreenPtr pScreen,
     /* round up so that pointer is aligned */
     baseSize = (baseSize + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
     totalSize = baseSize + privates_size;
-    object = malloc(totalSize);
+    object = private_alloc(type, totalSize);
     if (!object)
         return NULL;
 
@@ -733,6 +794,17 @@ dixScreenSpecificPrivatesSize(ScreenPtr pScreen, DevPrivateType type)
         return global_keys[type].offset;
 }
 
+static void
+dixPrivateKeyUsage(DevPrivateKey key)
+{
+    /* screen-specific keys all come after the hot ones */
+    for (; key; key = key->next)
+        ErrorF("    %s key %p: %d bytes at %d\n",
+               key->offset < hot_end[key->type] ? "hot " : "cold",
+               (void *) key, key->size ? key->size : (int) sizeof(void *),
+               key->offset);
+}
+
 void
 dixPrivateUsage(void)
 {
@@ -740,17 +812,32 @@ dixPrivateUsage(void)
     int bytes = 0;
     int alloc = 0;
     DevPrivateType t;
+    int s;
 
     for (t = PRIVATE_XSELINUX + 1; t < PRIVATE_LAST; t++) {
         if (global_keys[t].offset) {
             ErrorF
-                ("%s: %d objects of %d bytes = %d total bytes %d private allocs\n",
+                ("%s: %d objects of %d bytes (%d hot) = %d total bytes %d private allocs\n",
                  key_names[t], global_keys[t].created, global_keys[t].offset,
+                 hot_end[t],
                  global_keys[t].created * global_keys[t].offset, global_keys[t].allocated);
+            dixPrivateKeyUsage(global_keys[t].key);
             bytes += global_keys[t].created * global_keys[t].offset;
             objects += global_keys[t].created;
             alloc += global_keys[t].allocated;
         }
+        if (!screen_specific_private[t])
+            continue;
+        for (s = 0; s < screenInfo.numScreens; s++) {
+            DevPrivateSetPtr set = &screenInfo.screens[s]->screenSpecificPrivates[t];
+
+            if (!set->key)
+                continue;
+            ErrorF("%s on screen %d: %d objects of %d bytes = %d total bytes\n",
+                   key_names[t], s, set->created, set->offset,
+                   set->created * set->offset);
+            dixPrivateKeyUsage(set->key);
+        }
     }
     ErrorF("TOTAL: %d objects, %d bytes, %d allocs\n", objects, bytes, alloc);
 }
@@ -760,6 +847,8 @@ dixResetPrivates(void)
 {
     DevPrivateType t;
 
+    dixSlabReset();
+
     for (t = PRIVATE_XSELINUX; t < PRIVATE_LAST; t++) {
         DevPrivateKey key, next;
 
@@ -779,6 +868,7 @@ dixResetPrivates(void)
         }
         global_keys[t].key = NULL;
         global_keys[t].offset = 0;
+        hot_end[t] = 0;
         global_keys[t].created = 0;
         global_keys[t].allocated = 0;
     }
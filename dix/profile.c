@@ -0,0 +1,372 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Dispatch profiling.  Dispatch() reports what it does here while
+ * DispatchProfileEnabled is set, next to its dtrace probes; when it isn't,
+ * all it costs is a test of that flag per request.
+ *
+ * Request latencies go into power of two histogram buckets, so the log can
+ * show percentiles without keeping samples around.
+ */
+
+#include <dix-config.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dix/dix_priv.h"
+#include "dix/profile_priv.h"
+#include "dix/registry_priv.h"
+#include "dix/resource_priv.h"
+#include "os/client_priv.h"
+#include "os/osdep.h"
+
+#include "misc.h"
+#include "os.h"
+#include "dixstruct.h"
+#include "opaque.h"
+
+#define PROFILE_BUCKETS 24      /* 1us to 8s, and longer */
+#define PROFILE_TOP_REQUESTS 25
+#define PROFILE_TOP_CLIENTS 10
+
+typedef struct _ProfileOp {
+    uint64_t count;
+    uint64_t ns;
+    uint64_t maxNs;
+    uint32_t buckets[PROFILE_BUCKETS];
+} ProfileOpRec, *ProfileOpPtr;
+
+typedef struct _ProfileClient {
+    uint64_t ns;
+    uint64_t requests;
+    uint32_t slices;
+    uint32_t preempted;
+} ProfileClientRec, *ProfileClientPtr;
+
+typedef struct _ProfileEntry {
+    int major;
+    int minor;
+    uint64_t ns;
+} ProfileEntryRec;
+
+Bool DispatchProfileEnabled = FALSE;
+volatile sig_atomic_t DispatchProfileSignalled = FALSE;
+
+/* SIGUSR2 is ours to toggle profiling with */
+static Bool profileSignal;
+
+/* by major opcode; core requests have one entry, extensions one per minor */
+static ProfileOpPtr profileOps[256];
+static ProfileClientRec profileClients[MAXCLIENTS];
+static ProfileClientRec profileGone;    /* clients that went away */
+static uint64_t profileStart;
+static uint64_t profileWaitNs;
+static uint64_t profileWaits;
+
+uint64_t
+DispatchProfileNow(void)
+{
+    return GetTimeInNanos();
+}
+
+static int
+ProfileBucket(uint64_t ns)
+{
+    uint64_t us = ns >> 10;
+    int bucket = 0;
+
+    while (us && bucket < PROFILE_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void
+DispatchProfileRequest(ClientPtr client, uint64_t ns)
+{
+    ProfileOpPtr op = profileOps[client->majorOp];
+    ProfileClientPtr pc = &profileClients[client->index];
+
+    if (!op) {
+        int n = client->majorOp < EXTENSION_BASE ? 1 : 256;
+
+        op = profileOps[client->majorOp] = calloc(n, sizeof(ProfileOpRec));
+        if (!op)
+            return;
+    }
+    if (client->majorOp >= EXTENSION_BASE)
+        op += client->minorOp;
+
+    op->count++;
+    op->ns += ns;
+    if (ns > op->maxNs)
+        op->maxNs = ns;
+    op->buckets[ProfileBucket(ns)]++;
+
+    pc->ns += ns;
+    pc->requests++;
+}
+
+void
+DispatchProfileSlice(ClientPtr client, Bool preempted)
+{
+    ProfileClientPtr pc = &profileClients[client->index];
+
+    if (preempted)
+        pc->preempted++;
+    else
+        pc->slices++;
+}
+
+void
+DispatchProfileWait(uint64_t ns)
+{
+    profileWaitNs += ns;
+    profileWaits++;
+}
+
+void
+DispatchProfileClientGone(ClientPtr client)
+{
+    ProfileClientPtr pc = &profileClients[client->index];
+
+    profileGone.ns += pc->ns;
+    profileGone.requests += pc->requests;
+    profileGone.slices += pc->slices;
+    profileGone.preempted += pc->preempted;
+    memset(pc, 0, sizeof(*pc));
+}
+
+/* upper bound of the bucket the given fraction of requests falls into */
+static uint64_t
+ProfilePercentileUs(ProfileOpPtr op, int permille)
+{
+    uint64_t want = (op->count * permille + 999) / 1000, seen = 0;
+    int i;
+
+    for (i = 0; i < PROFILE_BUCKETS - 1; i++) {
+        seen += op->buckets[i];
+        if (seen >= want)
+            break;
+    }
+    return (uint64_t) 1 << i;
+}
+
+static int
+ProfileEntryCompare(const void *a, const void *b)
+{
+    const ProfileEntryRec *ea = a, *eb = b;
+
+    if (ea->ns != eb->ns)
+        return ea->ns < eb->ns ? 1 : -1;
+    return 0;
+}
+
+static void
+ProfileDumpRequests(uint64_t busy)
+{
+    ProfileEntryRec *entries;
+    int major, minor, n = 0, i;
+
+    entries = calloc(256 * 256, sizeof(ProfileEntryRec));
+    if (!entries)
+        return;
+
+    for (major = 0; major < 256; major++) {
+        int minors = major < EXTENSION_BASE ? 1 : 256;
+
+        if (!profileOps[major])
+            continue;
+        for (minor = 0; minor < minors; minor++) {
+            if (!profileOps[major][minor].count)
+                continue;
+            entries[n].major = major;
+            entries[n].minor = minor;
+            entries[n].ns = profileOps[major][minor].ns;
+            n++;
+        }
+    }
+    qsort(entries, n, sizeof(ProfileEntryRec), ProfileEntryCompare);
+
+    LogMessage(X_INFO, "Dispatch profile: %-28s %10s %10s %6s %9s %9s %9s\n",
+               "request", "count", "total ms", "%busy",
+               "p50 us", "p99 us", "max us");
+    for (i = 0; i < n && i < PROFILE_TOP_REQUESTS; i++) {
+        ProfileOpPtr op = &profileOps[entries[i].major][entries[i].minor];
+
+        LogMessage(X_INFO, "Dispatch profile: %-28.28s %10llu %10.1f %6.1f "
+                   "%9llu %9llu %9llu\n",
+                   LookupRequestName(entries[i].major, entries[i].minor),
+                   (unsigned long long) op->count, op->ns / 1e6,
+                   busy ? 100.0 * op->ns / busy : 0.0,
+                   (unsigned long long) ProfilePercentileUs(op, 500),
+                   (unsigned long long) ProfilePercentileUs(op, 990),
+                   (unsigned long long) (op->maxNs / 1000));
+    }
+
+    free(entries);
+}
+
+static int
+ProfileClientCompare(const void *a, const void *b)
+{
+    uint64_t na = profileClients[*(const int *) a].ns;
+    uint64_t nb = profileClients[*(const int *) b].ns;
+
+    if (na != nb)
+        return na < nb ? 1 : -1;
+    return 0;
+}
+
+static void
+ProfileDumpClients(uint64_t busy)
+{
+    int order[MAXCLIENTS];
+    int n = 0, i;
+
+    for (i = 0; i < MAXCLIENTS; i++)
+        if (profileClients[i].requests || profileClients[i].slices)
+            order[n++] = i;
+    qsort(order, n, sizeof(int), ProfileClientCompare);
+    n = min(n, PROFILE_TOP_CLIENTS);
+
+    LogMessage(X_INFO, "Dispatch profile: %-28s %10s %10s %6s %9s %9s\n",
+               "client", "requests", "total ms", "%busy",
+               "slices", "preempted");
+    for (i = 0; i < n; i++) {
+        ProfileClientPtr pc = &profileClients[order[i]];
+        ClientPtr client = clients[order[i]];
+        const char *name = client ? GetClientCmdName(client) : NULL;
+        char label[64];
+
+        snprintf(label, sizeof(label), "%d %s", order[i],
+                 name ? name : "");
+        LogMessage(X_INFO, "Dispatch profile: %-28.28s %10llu %10.1f %6.1f "
+                   "%9u %9u\n", label,
+                   (unsigned long long) pc->requests, pc->ns / 1e6,
+                   busy ? 100.0 * pc->ns / busy : 0.0,
+                   pc->slices, pc->preempted);
+    }
+    if (profileGone.requests)
+        LogMessage(X_INFO, "Dispatch profile: %-28s %10llu %10.1f %6.1f "
+                   "%9u %9u\n", "(disconnected)",
+                   (unsigned long long) profileGone.requests,
+                   profileGone.ns / 1e6,
+                   busy ? 100.0 * profileGone.ns / busy : 0.0,
+                   profileGone.slices, profileGone.preempted);
+}
+
+static void
+ProfileClear(void)
+{
+    int i;
+
+    for (i = 0; i < 256; i++) {
+        free(profileOps[i]);
+        profileOps[i] = NULL;
+    }
+    memset(profileClients, 0, sizeof(profileClients));
+    memset(&profileGone, 0, sizeof(profileGone));
+    profileWaitNs = 0;
+    profileWaits = 0;
+    profileStart = DispatchProfileNow();
+}
+
+void
+DispatchProfileDump(void)
+{
+    uint64_t elapsed = DispatchProfileNow() - profileStart;
+    uint64_t busy = 0;
+    int i;
+
+    for (i = 0; i < MAXCLIENTS; i++)
+        busy += profileClients[i].ns;
+    busy += profileGone.ns;
+
+    LogMessage(X_INFO, "Dispatch profile: %.1f ms profiled, %.1f ms in "
+               "requests, %.1f ms waiting in %llu waits\n",
+               elapsed / 1e6, busy / 1e6, profileWaitNs / 1e6,
+               (unsigned long long) profileWaits);
+    ProfileDumpRequests(busy);
+    ProfileDumpClients(busy);
+    LogResourceLookupStats();
+
+    ProfileClear();
+}
+
+void
+DispatchProfileToggle(void)
+{
+    DispatchProfileSignalled = FALSE;
+
+    if (DispatchProfileEnabled) {
+        DispatchProfileDump();
+        DispatchProfileEnabled = FALSE;
+        LogMessage(X_INFO, "Dispatch profiling stopped\n");
+    }
+    else {
+        ProfileClear();
+        DispatchProfileEnabled = TRUE;
+        LogMessage(X_INFO, "Dispatch profiling started\n");
+    }
+}
+
+static void
+DispatchProfileSignal(int sig)
+{
+    int olderrno = errno;
+
+    DispatchProfileSignalled = TRUE;
+    isItTimeToYield = TRUE;
+    errno = olderrno;
+}
+
+void
+DispatchProfileInit(void)
+{
+#if !defined(WIN32)
+    struct sigaction act;
+
+    /* -profile sets DispatchProfileEnabled before the first generation;
+     * without it the signal is left alone. */
+    if (serverGeneration == 1)
+        profileSignal = DispatchProfileEnabled;
+
+    /* Some DDXs switch VTs on SIGUSR2; don't take it away from them. */
+    if (profileSignal && sigaction(SIGUSR2, NULL, &act) == 0 &&
+        act.sa_handler != SIG_DFL && act.sa_handler != SIG_IGN &&
+        act.sa_handler != DispatchProfileSignal) {
+        LogMessage(X_WARNING, "SIGUSR2 is in use, dispatch profiling "
+                   "can't be toggled at runtime\n");
+        profileSignal = FALSE;
+    }
+    if (profileSignal)
+        OsSignal(SIGUSR2, DispatchProfileSignal);
+#endif
+    if (DispatchProfileEnabled && !profileStart)
+        ProfileClear();
+}
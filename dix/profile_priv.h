@@ -0,0 +1,49 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Copyright © 2026 X.Org Foundation
+ */
+#ifndef _XSERVER_DIX_PROFILE_PRIV_H
+#define _XSERVER_DIX_PROFILE_PRIV_H
+
+#include <signal.h>
+#include <stdint.h>
+
+#include "dixstruct.h"
+
+/*
+ * Dispatch profiling: per-opcode request counts and latencies, per-client
+ * time shares, time slice preemptions, time spent waiting for work, and
+ * how well the resource lookup cache does.
+ * Enabled with -profile, then toggled at runtime with SIGUSR2; turning it off
+ * (or a server reset) writes the figures to the log.
+ */
+
+extern Bool DispatchProfileEnabled;
+extern volatile sig_atomic_t DispatchProfileSignalled;
+
+/* Install the SIGUSR2 handler, if -profile was given and the DDX
+ * doesn't use the signal. */
+void DispatchProfileInit(void);
+
+/* Act on SIGUSR2: start profiling, or log the results and stop. */
+void DispatchProfileToggle(void);
+
+/* Write the results to the log, and start over. */
+void DispatchProfileDump(void);
+
+/* Monotonic clock the profile is kept in, in nanoseconds. */
+uint64_t DispatchProfileNow(void);
+
+/* The client's current request took ns. */
+void DispatchProfileRequest(ClientPtr client, uint64_t ns);
+
+/* The client got a time slice; preempted if it used it all up. */
+void DispatchProfileSlice(ClientPtr client, Bool preempted);
+
+/* WaitForSomething() took ns. */
+void DispatchProfileWait(uint64_t ns);
+
+/* The client's slot is about to be reused. */
+void DispatchProfileClientGone(ClientPtr client);
+
+#endif /* _XSERVER_DIX_PROFILE_PRIV_H */
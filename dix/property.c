@@ -53,6 +53,7 @@ SOFTWARE.
 #include "dix/property_priv.h"
 
 #include "windowstr.h"
+#include "privates.h"
 #include "propertyst.h"
 #include "dixstruct.h"
 #include "dispatch.h"
@@ -88,18 +89,248 @@ PrintPropertys(WindowPtr pWin)
 }
 #endif
 
+/*
+ * Windows carrying many properties (the root window in particular) get a
+ * hash index from property name to PropertyRec on top of the list, so
+ * lookups don't need to walk it.  The list stays authoritative: it keeps
+ * the ordering ListProperties reports and may hold several instances of
+ * the same name (XACE polyinstantiation), in which case the index points
+ * at the first one in list order, exactly as a list walk would find.
+ */
+
+#define PROPERTY_INDEX_THRESHOLD 32     /* build the index at this many */
+#define PROPERTY_INDEX_MIN_BITS 6
+
+typedef struct _PropertySlot {
+    Atom name;                  /* None if the slot is empty */
+    PropertyPtr prop;
+} PropertySlotRec, *PropertySlotPtr;
+
+typedef struct _PropertyIndex {
+    unsigned int count;         /* properties in the window's list */
+    unsigned int used;          /* slots in use */
+    unsigned int bits;
+    PropertySlotPtr slots;
+} PropertyIndexRec, *PropertyIndexPtr;
+
+/* The index of a window, kept in a private rather than in WindowOptRec */
+DevPrivateKeyRec PropertyIndexKeyRec;
+
+Bool
+PropertyIndexInit(void)
+{
+    return dixRegisterPrivateKey(&PropertyIndexKeyRec, PRIVATE_WINDOW, 0);
+}
+
+static inline PropertyIndexPtr
+PropertyIndexGet(WindowPtr pWin)
+{
+    return dixLookupPrivate(&pWin->devPrivates, &PropertyIndexKeyRec);
+}
+
+static inline unsigned int
+PropertyHash(PropertyIndexPtr pIndex, Atom name)
+{
+    return (name * 0x9e3779b1U) >> (32 - pIndex->bits);
+}
+
+static PropertySlotPtr
+PropertyIndexFind(PropertyIndexPtr pIndex, Atom name)
+{
+    unsigned int mask = (1U << pIndex->bits) - 1;
+    unsigned int i;
+
+    for (i = PropertyHash(pIndex, name);; i = (i + 1) & mask) {
+        PropertySlotPtr slot = &pIndex->slots[i];
+
+        if (slot->name == name || slot->name == None)
+            return slot;
+    }
+}
+
+static Bool
+PropertyIndexResize(PropertyIndexPtr pIndex, unsigned int bits)
+{
+    PropertySlotPtr old = pIndex->slots;
+    unsigned int i, oldSize = old ? 1U << pIndex->bits : 0;
+
+    pIndex->slots = calloc(1U << bits, sizeof(PropertySlotRec));
+    if (!pIndex->slots) {
+        pIndex->slots = old;
+        return FALSE;
+    }
+    pIndex->bits = bits;
+    for (i = 0; i < oldSize; i++)
+        if (old[i].name != None)
+            *PropertyIndexFind(pIndex, old[i].name) = old[i];
+    free(old);
+    return TRUE;
+}
+
+/* Make pProp, which has just been put at the head of the list, findable */
+static Bool
+PropertyIndexAdd(PropertyIndexPtr pIndex, PropertyPtr pProp)
+{
+    PropertySlotPtr slot;
+
+    if (2 * (pIndex->used + 1) > (1U << pIndex->bits) &&
+        !PropertyIndexResize(pIndex, pIndex->bits + 1))
+        return FALSE;
+    slot = PropertyIndexFind(pIndex, pProp->propertyName);
+    if (slot->name == None) {
+        slot->name = pProp->propertyName;
+        pIndex->used++;
+    }
+    slot->prop = pProp;
+    pIndex->count++;
+    return TRUE;
+}
+
+static void
+PropertyIndexRemove(PropertyIndexPtr pIndex, PropertyPtr pProp)
+{
+    unsigned int mask = (1U << pIndex->bits) - 1;
+    PropertySlotPtr slot;
+    PropertyPtr other;
+    unsigned int i, j;
+
+    pIndex->count--;
+    slot = PropertyIndexFind(pIndex, pProp->propertyName);
+    if (slot->prop != pProp)
+        return;
+
+    /* another instance further down the list takes over */
+    for (other = pProp->next; other; other = other->next) {
+        if (other->propertyName == pProp->propertyName) {
+            slot->prop = other;
+            return;
+        }
+    }
+
+    /* backward-shift deletion keeps the probe sequences intact */
+    i = slot - pIndex->slots;
+    for (j = (i + 1) & mask; pIndex->slots[j].name != None; j = (j + 1) & mask) {
+        unsigned int home = PropertyHash(pIndex, pIndex->slots[j].name);
+
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            pIndex->slots[i] = pIndex->slots[j];
+            i = j;
+        }
+    }
+    pIndex->slots[i].name = None;
+    pIndex->slots[i].prop = NULL;
+    pIndex->used--;
+}
+
+static void
+PropertyIndexDestroy(WindowPtr pWin)
+{
+    PropertyIndexPtr pIndex = PropertyIndexGet(pWin);
+
+    if (pIndex) {
+        free(pIndex->slots);
+        free(pIndex);
+        dixSetPrivate(&pWin->devPrivates, &PropertyIndexKeyRec, NULL);
+    }
+}
+
+/* Called after a property was added; builds the index once it pays off */
+static void
+PropertyIndexCheck(WindowPtr pWin)
+{
+    PropertyIndexPtr pIndex;
+    PropertyPtr pProp;
+    unsigned int count = 0, bits = PROPERTY_INDEX_MIN_BITS;
+
+    for (pProp = pWin->optional->userProps; pProp; pProp = pProp->next)
+        if (++count == PROPERTY_INDEX_THRESHOLD)
+            break;
+    if (count < PROPERTY_INDEX_THRESHOLD)
+        return;
+
+    /* the list may be longer than the threshold if allocation failed before */
+    for (; pProp->next; pProp = pProp->next)
+        count++;
+    while ((1U << bits) < 2 * count)
+        bits++;
+
+    pIndex = calloc(1, sizeof(PropertyIndexRec));
+    if (!pIndex)
+        return;
+    if (!PropertyIndexResize(pIndex, bits)) {
+        free(pIndex);
+        return;
+    }
+    for (pProp = pWin->optional->userProps; pProp; pProp = pProp->next) {
+        PropertySlotPtr slot = PropertyIndexFind(pIndex, pProp->propertyName);
+
+        if (slot->name == None) {
+            slot->name = pProp->propertyName;
+            slot->prop = pProp;
+            pIndex->used++;
+        }
+    }
+    pIndex->count = count;
+    dixSetPrivate(&pWin->devPrivates, &PropertyIndexKeyRec, pIndex);
+}
+
+static void
+InsertProperty(WindowPtr pWin, PropertyPtr pProp)
+{
+    PropertyIndexPtr pIndex = PropertyIndexGet(pWin);
+
+    pProp->next = pWin->optional->userProps;
+    pWin->optional->userProps = pProp;
+
+    /* without an index we're merely slower, so don't fail the request */
+    if (!pIndex)
+        PropertyIndexCheck(pWin);
+    else if (!PropertyIndexAdd(pIndex, pProp))
+        PropertyIndexDestroy(pWin);
+}
+
+static void
+RemoveProperty(WindowPtr pWin, PropertyPtr pProp)
+{
+    PropertyIndexPtr pIndex = PropertyIndexGet(pWin);
+    PropertyPtr prevProp;
+
+    if (pIndex) {
+        PropertyIndexRemove(pIndex, pProp);
+        if (pIndex->count < PROPERTY_INDEX_THRESHOLD / 2)
+            PropertyIndexDestroy(pWin);
+    }
+
+    if (pWin->optional->userProps == pProp) {
+        /* Takes care of head */
+        if (!(pWin->optional->userProps = pProp->next))
+            CheckWindowOptionalNeed(pWin);
+    }
+    else {
+        /* Need to traverse to find the previous element */
+        prevProp = pWin->optional->userProps;
+        while (prevProp->next != pProp)
+            prevProp = prevProp->next;
+        prevProp->next = pProp->next;
+    }
+}
+
 int
 dixLookupProperty(PropertyPtr *result, WindowPtr pWin, Atom propertyName,
                   ClientPtr client, Mask access_mode)
 {
+    PropertyIndexPtr pIndex = PropertyIndexGet(pWin);
     PropertyPtr pProp;
     int rc = BadMatch;
 
     client->errorValue = propertyName;
 
-    for (pProp = wUserProps(pWin); pProp; pProp = pProp->next)
-        if (pProp->propertyName == propertyName)
-            break;
+    if (pIndex)
+        pProp = PropertyIndexFind(pIndex, propertyName)->prop;
+    else
+        for (pProp = wUserProps(pWin); pProp; pProp = pProp->next)
+            if (pProp->propertyName == propertyName)
+                break;
 
     if (pProp)
         rc = XaceHookPropertyAccess(client, pWin, &pProp, access_mode);
@@ -298,8 +529,7 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
             pClient->errorValue = property;
             return rc;
         }
-        pProp->next = pWin->optional->userProps;
-        pWin->optional->userProps = pProp;
+        InsertProperty(pWin, pProp);
     }
     else if (rc == Success) {
         /* To append or prepend to a property the request format and type
@@ -375,7 +605,7 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
 int
 DeleteProperty(ClientPtr client, WindowPtr pWin, Atom propName)
 {
-    PropertyPtr pProp, prevProp;
+    PropertyPtr pProp;
     int rc;
 
     rc = dixLookupProperty(&pProp, pWin, propName, client, DixDestroyAccess);
@@ -383,19 +613,7 @@ DeleteProperty(ClientPtr client, WindowPtr pWin, Atom propName)
         return Success;         /* Succeed if property does not exist */
 
     if (rc == Success) {
-        if (pWin->optional->userProps == pProp) {
-            /* Takes care of head */
-            if (!(pWin->optional->userProps = pProp->next))
-                CheckWindowOptionalNeed(pWin);
-        }
-        else {
-            /* Need to traverse to find the previous element */
-            prevProp = pWin->optional->userProps;
-            while (prevProp->next != pProp)
-                prevProp = prevProp->next;
-            prevProp->next = pProp->next;
-        }
-
+        RemoveProperty(pWin, pProp);
         deliverPropertyNotifyEvent(pWin, PropertyDelete, pProp);
         free(pProp->data);
         dixFreeObjectWithPrivates(pProp, PRIVATE_PROPERTY);
@@ -417,6 +635,7 @@ DeleteAllWindowProperties(WindowPtr pWin)
         pProp = pNextProp;
     }
 
+    PropertyIndexDestroy(pWin);
     if (pWin->optional)
         pWin->optional->userProps = NULL;
 }
@@ -450,7 +669,7 @@ NullPropertyReply(ClientPtr client, ATOM propertyType, int format)
 int
 ProcGetProperty(ClientPtr client)
 {
-    PropertyPtr pProp, prevProp;
+    PropertyPtr pProp;
     unsigned long n, len, ind;
     int rc;
     WindowPtr pWin;
@@ -553,19 +772,7 @@ ProcGetProperty(ClientPtr client)
 
     if (stuff->delete && (reply.bytesAfter == 0)) {
         /* Delete the Property */
-        if (pWin->optional->userProps == pProp) {
-            /* Takes care of head */
-            if (!(pWin->optional->userProps = pProp->next))
-                CheckWindowOptionalNeed(pWin);
-        }
-        else {
-            /* Need to traverse to find the previous element */
-            prevProp = pWin->optional->userProps;
-            while (prevProp->next != pProp)
-                prevProp = prevProp->next;
-            prevProp->next = pProp->next;
-        }
-
+        RemoveProperty(pWin, pProp);
         free(pProp->data);
         dixFreeObjectWithPrivates(pProp, PRIVATE_PROPERTY);
     }
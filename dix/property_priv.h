@@ -55,6 +55,7 @@ SOFTWARE.
 
 #include "dix.h"
 #include "window.h"
+#include "privates.h"
 #include "property.h"
 
 typedef struct _PropertyStateRec {
@@ -70,4 +71,10 @@ int dixLookupProperty(PropertyPtr *result, WindowPtr pWin, Atom proprty,
 
 void DeleteAllWindowProperties(WindowPtr pWin);
 
+/* Window private holding the name index of windows with many properties */
+extern DevPrivateKeyRec PropertyIndexKeyRec;
+
+/* Register PropertyIndexKeyRec; before any window is created. */
+Bool PropertyIndexInit(void);
+
 #endif /* _XSERVER_PROPERTY_PRIV_H */
@@ -77,6 +77,8 @@ Equipment Corporation.
 
 #include <dix-config.h>
 
+#include "dix/slab_priv.h"
+
 #include "regionstr.h"
 #include <X11/Xprotostr.h>
 #include <X11/Xfuncproto.h>
@@ -236,7 +238,7 @@ RegionCreate(BoxPtr rect, int size)
 {
     RegionPtr pReg;
 
-    pReg = (RegionPtr) malloc(sizeof(RegionRec));
+    pReg = dixSlabAlloc(SLAB_REGION, sizeof(RegionRec));
     if (!pReg)
         return &RegionBrokenRegion;
 
@@ -250,7 +252,7 @@ RegionDestroy(RegionPtr pReg)
 {
     pixman_region_fini(pReg);
     if (pReg != &RegionBrokenRegion)
-        free(pReg);
+        dixSlabFree(pReg);
 }
 
 RegionPtr
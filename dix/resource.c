@@ -125,6 +125,7 @@ Equipment Corporation.
 #include "dix/dixgrabs_priv.h"
 #include "dix/gc_priv.h"
 #include "dix/registry_priv.h"
+#include "dix/resource_priv.h"
 #include "os/osdep.h"
 
 #include "misc.h"
@@ -151,31 +152,74 @@ Equipment Corporation.
 #define TypeNameString(t) LookupResourceName(t)
 #endif
 
-static void RebuildTable(int    /*client */
-    );
-
 #define SERVER_MINID 32
 
 #define INITBUCKETS 64
 #define INITHASHSIZE 6
-#define MAXHASHSIZE 16
 
+/* old slots moved over per AddResource() while the table grows */
+#define REHASHSTEP 8
+
+/* lookups remembered per client, a power of two */
+#define LOOKUPCACHESIZE 16
+
+/*
+ * Each client's resources live in an open addressing hash table with
+ * linear probing, the entries stored in the slots themselves.  A slot
+ * whose type is X11_RESTYPE_NONE is free: empty if its value is NULL, or
+ * deleted, so lookups have to probe past it.
+ *
+ * Several resources can share an id.  Those are kept along the probe
+ * sequence in the order they were added, and every lookup goes for the
+ * last matching one, as the old hash chains handed out the newest first.
+ *
+ * Growing the table doesn't rehash all of it at once: the old table stays
+ * around until AddResource() has moved all its resources over, a few at
+ * a time.  All resources with the same id are in the same table, so the
+ * order among them is kept.
+ */
 typedef struct _Resource {
-    struct _Resource *next;
     XID id;
     RESTYPE type;
     void *value;
 } ResourceRec, *ResourcePtr;
 
-typedef struct _ClientResource {
-    ResourcePtr *resources;
-    int elements;
+typedef struct _ResourceTable {
+    ResourcePtr slots;
     int buckets;
     int hashsize;               /* log(2)(buckets) */
+} ResourceTableRec, *ResourceTablePtr;
+
+/*
+ * Requests tend to look up the same few resources as the ones before,
+ * the drawable and GC they keep drawing with.  What those lookups found
+ * is kept here, by id, until a resource with that id gets added, freed
+ * or changed.  Only the table lookup is skipped, access is still checked.
+ */
+typedef struct _LookupCache {
+    XID id;
+    RESTYPE key;                /* type, or class, looked up */
+    Bool byClass;
+    RESTYPE type;               /* X11_RESTYPE_NONE if unused */
+    void *value;
+} LookupCacheRec, *LookupCachePtr;
+
+typedef struct _ClientResource {
+    ResourceTableRec table;
+    ResourceTableRec old;       /* being moved into table */
+    int rehash;                 /* next slot of old to move */
+    int used;                   /* slots of table not empty */
+    int elements;
+    int iterating;              /* table is being walked, don't move things */
     XID fakeID;
     XID endFakeID;
+    LookupCacheRec cache[LOOKUPCACHESIZE];
 } ClientResourceRec;
 
+static char deletedSlot;
+
+#define SLOT_DELETED ((void *) &deletedSlot)
+
 RESTYPE lastResourceType;
 static RESTYPE lastResourceClass;
 RESTYPE TypeMask;
@@ -185,6 +229,8 @@ struct ResourceType {
     SizeType sizeFunc;
     FindTypeSubResources findSubResFunc;
     int errorValue;
+    uint64_t lookups;           /* successful ones, for the profile */
+    uint64_t cacheHits;
 };
 
 /**
@@ -522,6 +568,8 @@ CreateNewResourceType(DeleteType deleteFunc, const char *name)
     resourceTypes[next].sizeFunc = GetDefaultBytes;
     resourceTypes[next].findSubResFunc = DefaultFindSubRes;
     resourceTypes[next].errorValue = BadValue;
+    resourceTypes[next].lookups = 0;
+    resourceTypes[next].cacheHits = 0;
 
 #if X_REGISTRY_RESOURCE
     /* Called even if name is NULL, to remove any previous entry */
@@ -642,7 +690,7 @@ ResourceClientBits(void)
 Bool
 InitClientResources(ClientPtr client)
 {
-    int i, j;
+    int i;
 
     if (client == serverClient) {
         lastResourceType = X11_RESTYPE_LASTPREDEF;
@@ -654,13 +702,13 @@ InitClientResources(ClientPtr client)
             return FALSE;
         memcpy(resourceTypes, predefTypes, sizeof(predefTypes));
     }
-    clientTable[i = client->index].resources =
-        malloc(INITBUCKETS * sizeof(ResourcePtr));
-    if (!clientTable[i].resources)
+    i = client->index;
+    memset(&clientTable[i], 0, sizeof(ClientResourceRec));
+    clientTable[i].table.slots = calloc(INITBUCKETS, sizeof(ResourceRec));
+    if (!clientTable[i].table.slots)
         return FALSE;
-    clientTable[i].buckets = INITBUCKETS;
-    clientTable[i].elements = 0;
-    clientTable[i].hashsize = INITHASHSIZE;
+    clientTable[i].table.buckets = INITBUCKETS;
+    clientTable[i].table.hashsize = INITHASHSIZE;
     /* Many IDs allocated from the server client are visible to clients,
      * so we don't use the SERVER_BIT for them, but we have to start
      * past the magic value constants used in the protocol.  For normal
@@ -669,9 +717,6 @@ InitClientResources(ClientPtr client)
     clientTable[i].fakeID = client->clientAsMask |
         (client->index ? SERVER_BIT : SERVER_MINID);
     clientTable[i].endFakeID = (clientTable[i].fakeID | RESOURCE_ID_MASK) + 1;
-    for (j = 0; j < INITBUCKETS; j++) {
-        clientTable[i].resources[j] = NULL;
-    }
     return TRUE;
 }
 
@@ -688,18 +733,282 @@ HashResourceID(XID id, unsigned int numBits)
     return (id ^ (id >> numBits)) & ~((~0U) << numBits);
 }
 
-static XID
-AvailableID(int client, XID id, XID maxid, XID goodid)
+/*
+ * Fibonacci hashing.  Clients hand out their XIDs in sequence, which the
+ * low bits HashResourceID() picks would put in one long run of slots.
+ */
+static inline unsigned int
+ResourceHash(XID id, int hashsize)
+{
+    return ((CARD32) id * 0x9e3779b1U) >> (32 - hashsize);
+}
+
+/*
+ * Find the last resource with the given id, and either the given type, or
+ * one of the given class bits if type is X11_RESTYPE_NONE.
+ */
+static ResourcePtr
+TableFind(ResourceTablePtr table, XID id, RESTYPE type, RESTYPE rclass)
+{
+    unsigned int mask = table->buckets - 1;
+    unsigned int i = ResourceHash(id, table->hashsize);
+    ResourcePtr res, found = NULL;
+
+    for (;; i = (i + 1) & mask) {
+        res = &table->slots[i];
+        if (res->type == X11_RESTYPE_NONE) {
+            if (!res->value)
+                return found;
+            continue;
+        }
+        if (res->id == id &&
+            (type ? res->type == type : (res->type & rclass) != 0))
+            found = res;
+    }
+}
+
+/*
+ * Add a resource after the others with the same id, counting the slot in
+ * used if it was empty rather than deleted.
+ */
+static ResourcePtr
+TableInsert(ResourceTablePtr table, int *used,
+            XID id, RESTYPE type, void *value)
+{
+    unsigned int mask = table->buckets - 1;
+    unsigned int i = ResourceHash(id, table->hashsize);
+    ResourcePtr res, slot = NULL;
+
+    for (;; i = (i + 1) & mask) {
+        res = &table->slots[i];
+        if (res->type != X11_RESTYPE_NONE) {
+            if (res->id == id)
+                slot = NULL;
+            continue;
+        }
+        if (!slot)
+            slot = res;
+        if (!res->value)
+            break;
+    }
+    if (slot == res)
+        (*used)++;
+    slot->id = id;
+    slot->type = type;
+    slot->value = value;
+    return slot;
+}
+
+static ResourcePtr
+FindResource(ClientResourceRec *rrec, XID id, RESTYPE type, RESTYPE rclass)
+{
+    ResourcePtr res = TableFind(&rrec->table, id, type, rclass);
+
+    if (!res && rrec->old.slots)
+        res = TableFind(&rrec->old, id, type, rclass);
+    return res;
+}
+
+/* Move all resources with the given id into the table, in order. */
+static void
+MoveResources(ClientResourceRec *rrec, ResourceTablePtr from, XID id)
+{
+    unsigned int mask = from->buckets - 1;
+    unsigned int i = ResourceHash(id, from->hashsize);
+    ResourcePtr res;
+
+    for (;; i = (i + 1) & mask) {
+        res = &from->slots[i];
+        if (res->type == X11_RESTYPE_NONE) {
+            if (!res->value)
+                return;
+            continue;
+        }
+        if (res->id != id)
+            continue;
+        TableInsert(&rrec->table, &rrec->used, res->id, res->type, res->value);
+        res->type = X11_RESTYPE_NONE;
+        res->value = SLOT_DELETED;
+    }
+}
+
+static void
+RehashResources(ClientResourceRec *rrec, int count)
 {
     ResourcePtr res;
 
+    while (rrec->old.slots && count-- > 0) {
+        res = &rrec->old.slots[rrec->rehash];
+        if (res->type != X11_RESTYPE_NONE)
+            MoveResources(rrec, &rrec->old, res->id);
+        if (++rrec->rehash == rrec->old.buckets) {
+            free(rrec->old.slots);
+            memset(&rrec->old, 0, sizeof(rrec->old));
+            rrec->rehash = 0;
+        }
+    }
+}
+
+/*
+ * Start over with a new table, twice the size unless deleted slots are
+ * what filled this one, and have AddResource() move the resources over.
+ */
+static Bool
+GrowResources(ClientResourceRec *rrec)
+{
+    ResourceTableRec table = rrec->table, old = rrec->old;
+    int hashsize = table.hashsize;
+    ResourcePtr slots;
+    int i;
+
+    while ((rrec->elements + 1) * 3 > (1 << hashsize))
+        hashsize++;
+    slots = calloc((size_t) 1 << hashsize, sizeof(ResourceRec));
+    if (!slots)
+        return FALSE;
+
+    rrec->table.slots = slots;
+    rrec->table.buckets = 1 << hashsize;
+    rrec->table.hashsize = hashsize;
+    rrec->used = 0;
+    rrec->rehash = 0;
+    if (!old.slots) {
+        rrec->old = table;
+        return TRUE;
+    }
+
+    /* The last move isn't done yet, which only happens when resources
+     * get added while the table is walked: move everything right away. */
+    memset(&rrec->old, 0, sizeof(rrec->old));
+    for (i = 0; i < old.buckets; i++)
+        if (old.slots[i].type != X11_RESTYPE_NONE)
+            MoveResources(rrec, &old, old.slots[i].id);
+    for (i = 0; i < table.buckets; i++)
+        if (table.slots[i].type != X11_RESTYPE_NONE)
+            MoveResources(rrec, &table, table.slots[i].id);
+    free(old.slots);
+    free(table.slots);
+    return TRUE;
+}
+
+/* A resource with the given id came or went, or changed. */
+static inline void
+ForgetLookup(ClientResourceRec *rrec, XID id)
+{
+    LookupCachePtr entry = &rrec->cache[id & (LOOKUPCACHESIZE - 1)];
+
+    if (entry->id == id)
+        entry->type = X11_RESTYPE_NONE;
+}
+
+/*
+ * Find the resource a lookup by type, or by class, would, going through
+ * the lookup cache.  The type found goes to *type, X11_RESTYPE_NONE if
+ * there's none.
+ */
+static void *
+LookupResource(XID id, RESTYPE key, Bool byClass, RESTYPE *type)
+{
+    int cid = CLIENT_ID(id);
+    ClientResourceRec *rrec;
+    LookupCachePtr entry;
+    ResourcePtr res;
+
+    *type = X11_RESTYPE_NONE;
+    if (cid >= LimitClients || !clientTable[cid].table.buckets)
+        return NULL;
+
+    rrec = &clientTable[cid];
+    entry = &rrec->cache[id & (LOOKUPCACHESIZE - 1)];
+    if (entry->type != X11_RESTYPE_NONE && entry->id == id &&
+        entry->key == key && entry->byClass == byClass) {
+        resourceTypes[entry->type & TypeMask].lookups++;
+        resourceTypes[entry->type & TypeMask].cacheHits++;
+        *type = entry->type;
+        return entry->value;
+    }
+
+    if (byClass)
+        res = FindResource(rrec, id, X11_RESTYPE_NONE, key);
+    else
+        res = FindResource(rrec, id, key, RC_ANY);
+    if (!res)
+        return NULL;
+
+    resourceTypes[res->type & TypeMask].lookups++;
+    entry->id = id;
+    entry->key = key;
+    entry->byClass = byClass;
+    entry->type = res->type;
+    entry->value = res->value;
+    *type = res->type;
+    return res->value;
+}
+
+static void
+doFreeResource(ResourcePtr res, Bool skip)
+{
+    CallResourceStateCallback(ResourceStateFreeing, res);
+
+    if (!skip)
+        resourceTypes[res->type & TypeMask].deleteFunc(res->value, res->id);
+}
+
+/* Take a resource out of the table, and free it. */
+static void
+RemoveResource(ClientResourceRec *rrec, ResourcePtr res, Bool skip)
+{
+    ResourceRec gone = *res;
+    ResourceTablePtr table = &rrec->table;
+    ResourcePtr next;
+    unsigned int mask, i;
+
+#ifdef XSERVER_DTRACE
+    XSERVER_RESOURCE_FREE(res->id, res->type,
+                          res->value, TypeNameString(res->type));
+#endif
+    if (res < table->slots || res >= table->slots + table->buckets)
+        table = &rrec->old;
+    mask = table->buckets - 1;
+    i = res - table->slots;
+
+    /* no probe needs to go past the slot if the next one is empty */
+    res->type = X11_RESTYPE_NONE;
+    res->value = SLOT_DELETED;
+    next = &table->slots[(i + 1) & mask];
+    if (next->type == X11_RESTYPE_NONE && !next->value) {
+        while (table->slots[i].value == SLOT_DELETED) {
+            table->slots[i].value = NULL;
+            if (table == &rrec->table)
+                rrec->used--;
+            i = (i - 1) & mask;
+        }
+    }
+    rrec->elements--;
+    ForgetLookup(rrec, gone.id);
+
+    doFreeResource(&gone, skip);
+}
+
+/* Slots of both tables, the old one first. */
+static ResourcePtr
+ResourceSlot(ClientResourceRec *rrec, int i)
+{
+    if (i < rrec->old.buckets)
+        return &rrec->old.slots[i];
+    i -= rrec->old.buckets;
+    if (i < rrec->table.buckets)
+        return &rrec->table.slots[i];
+    return NULL;
+}
+
+static XID
+AvailableID(int client, XID id, XID maxid, XID goodid)
+{
     if ((goodid >= id) && (goodid <= maxid))
         return goodid;
     for (; id <= maxid; id++) {
-        res = clientTable[client].resources[HashResourceID(id, clientTable[client].hashsize)];
-        while (res && (res->id != id))
-            res = res->next;
-        if (!res)
+        if (!FindResource(&clientTable[client], id, X11_RESTYPE_NONE, RC_ANY))
             return id;
     }
     return 0;
@@ -709,7 +1018,6 @@ void
 GetXIDRange(int client, Bool server, XID *minp, XID *maxp)
 {
     XID id, maxid;
-    ResourcePtr *resp;
     ResourcePtr res;
     int i;
     XID goodid;
@@ -719,18 +1027,17 @@ GetXIDRange(int client, Bool server, XID *minp, XID *maxp)
         id |= client ? SERVER_BIT : SERVER_MINID;
     maxid = id | RESOURCE_ID_MASK;
     goodid = 0;
-    for (resp = clientTable[client].resources, i = clientTable[client].buckets;
-         --i >= 0;) {
-        for (res = *resp++; res; res = res->next) {
-            if ((res->id < id) || (res->id > maxid))
-                continue;
-            if (((res->id - id) >= (maxid - res->id)) ?
-                (goodid = AvailableID(client, id, res->id - 1, goodid)) :
-                !(goodid = AvailableID(client, res->id + 1, maxid, goodid)))
-                maxid = res->id - 1;
-            else
-                id = res->id + 1;
-        }
+    for (i = 0; (res = ResourceSlot(&clientTable[client], i)); i++) {
+        if (res->type == X11_RESTYPE_NONE)
+            continue;
+        if ((res->id < id) || (res->id > maxid))
+            continue;
+        if (((res->id - id) >= (maxid - res->id)) ?
+            (goodid = AvailableID(client, id, res->id - 1, goodid)) :
+            !(goodid = AvailableID(client, res->id + 1, maxid, goodid)))
+            maxid = res->id - 1;
+        else
+            id = res->id + 1;
     }
     if (id > maxid)
         id = maxid = 0;
@@ -808,123 +1115,52 @@ AddResource(XID id, RESTYPE type, void *value)
 {
     int client;
     ClientResourceRec *rrec;
-    ResourcePtr res, *head;
+    ResourcePtr res;
 
 #ifdef XSERVER_DTRACE
     XSERVER_RESOURCE_ALLOC(id, type, value, TypeNameString(type));
 #endif
     client = CLIENT_ID(id);
     rrec = &clientTable[client];
-    if (!rrec->buckets) {
+    if (!rrec->table.buckets) {
         ErrorF("[dix] AddResource(%lx, %x, %lx), client=%d \n",
                (unsigned long) id, type, (unsigned long) value, client);
         FatalError("client not in use\n");
     }
-    if ((rrec->elements >= 4 * rrec->buckets) && (rrec->hashsize < MAXHASHSIZE))
-        RebuildTable(client);
-    head = &rrec->resources[HashResourceID(id, clientTable[client].hashsize)];
-    res = malloc(sizeof(ResourceRec));
-    if (!res) {
+    /* Keep at least half the slots empty.  While the table is walked,
+     * don't move resources around unless it is about to fill up. */
+    if ((rrec->used + 1) * 2 > rrec->table.buckets &&
+        (!rrec->iterating || rrec->used + 2 >= rrec->table.buckets) &&
+        !GrowResources(rrec) && rrec->used + 2 >= rrec->table.buckets) {
         (*resourceTypes[type & TypeMask].deleteFunc) (value, id);
         return FALSE;
     }
-    res->next = *head;
-    res->id = id;
-    res->type = type;
-    res->value = value;
-    *head = res;
+    if (rrec->old.slots) {
+        if (!rrec->iterating)
+            RehashResources(rrec, REHASHSTEP);
+        if (rrec->old.slots)
+            MoveResources(rrec, &rrec->old, id);
+    }
+    res = TableInsert(&rrec->table, &rrec->used, id, type, value);
     rrec->elements++;
+    ForgetLookup(rrec, id);
     CallResourceStateCallback(ResourceStateAdding, res);
     return TRUE;
 }
 
-static void
-RebuildTable(int client)
-{
-    int j;
-    ResourcePtr res, next;
-    ResourcePtr **tails, *resources;
-    ResourcePtr **tptr, *rptr;
-
-    /*
-     * For now, preserve insertion order, since some ddx layers depend
-     * on resources being free in the opposite order they are added.
-     */
-
-    j = 2 * clientTable[client].buckets;
-    tails =  xallocarray(j, sizeof(ResourcePtr *));
-    if (!tails)
-        return;
-    resources =  xallocarray(j, sizeof(ResourcePtr));
-    if (!resources) {
-        free(tails);
-        return;
-    }
-    for (rptr = resources, tptr = tails; --j >= 0; rptr++, tptr++) {
-        *rptr = NULL;
-        *tptr = rptr;
-    }
-    clientTable[client].hashsize++;
-    for (j = clientTable[client].buckets,
-         rptr = clientTable[client].resources; --j >= 0; rptr++) {
-        for (res = *rptr; res; res = next) {
-            next = res->next;
-            res->next = NULL;
-            tptr = &tails[HashResourceID(res->id, clientTable[client].hashsize)];
-            **tptr = res;
-            *tptr = &res->next;
-        }
-    }
-    free(tails);
-    clientTable[client].buckets *= 2;
-    free(clientTable[client].resources);
-    clientTable[client].resources = resources;
-}
-
-static void
-doFreeResource(ResourcePtr res, Bool skip)
-{
-    CallResourceStateCallback(ResourceStateFreeing, res);
-
-    if (!skip)
-        resourceTypes[res->type & TypeMask].deleteFunc(res->value, res->id);
-
-    free(res);
-}
-
 void
 FreeResource(XID id, RESTYPE skipDeleteFuncType)
 {
     int cid;
     ResourcePtr res;
-    ResourcePtr *prev, *head;
-    int *eltptr;
-    int elements;
-
-    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].buckets) {
-        head = &clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-        eltptr = &clientTable[cid].elements;
-
-        prev = head;
-        while ((res = *prev)) {
-            if (res->id == id) {
-                RESTYPE rtype = res->type;
-
-#ifdef XSERVER_DTRACE
-                XSERVER_RESOURCE_FREE(res->id, res->type,
-                                      res->value, TypeNameString(res->type));
-#endif
-                *prev = res->next;
-                elements = --*eltptr;
 
-                doFreeResource(res, rtype == skipDeleteFuncType);
-
-                if (*eltptr != elements)
-                    prev = head;        /* prev may no longer be valid */
-            }
-            else
-                prev = &res->next;
-        }
+    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].table.buckets) {
+        /* the delete functions may change the table, so start over each
+         * time */
+        while ((res = FindResource(&clientTable[cid], id,
+                                   X11_RESTYPE_NONE, RC_ANY)))
+            RemoveResource(&clientTable[cid], res,
+                           res->type == skipDeleteFuncType);
     }
 }
 
@@ -933,28 +1169,11 @@ FreeResourceByType(XID id, RESTYPE type, Bool skipFree)
 {
     int cid;
     ResourcePtr res;
-    ResourcePtr *prev, *head;
-
-    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].buckets) {
-        head = &clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-
-        prev = head;
-        while ((res = *prev)) {
-            if (res->id == id && res->type == type) {
-#ifdef XSERVER_DTRACE
-                XSERVER_RESOURCE_FREE(res->id, res->type,
-                                      res->value, TypeNameString(res->type));
-#endif
-                *prev = res->next;
-                clientTable[cid].elements--;
 
-                doFreeResource(res, skipFree);
-
-                break;
-            }
-            else
-                prev = &res->next;
-        }
+    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].table.buckets) {
+        res = FindResource(&clientTable[cid], id, type, RC_ANY);
+        if (res)
+            RemoveResource(&clientTable[cid], res, skipFree);
     }
 }
 
@@ -970,14 +1189,13 @@ ChangeResourceValue(XID id, RESTYPE rtype, void *value)
     int cid;
     ResourcePtr res;
 
-    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].buckets) {
-        res = clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-
-        for (; res; res = res->next)
-            if ((res->id == id) && (res->type == rtype)) {
-                res->value = value;
-                return TRUE;
-            }
+    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].table.buckets) {
+        res = FindResource(&clientTable[cid], id, rtype, RC_ANY);
+        if (res) {
+            res->value = value;
+            ForgetLookup(&clientTable[cid], id);
+            return TRUE;
+        }
     }
     return FALSE;
 }
@@ -992,27 +1210,22 @@ void
 FindClientResourcesByType(ClientPtr client,
                           RESTYPE type, FindResType func, void *cdata)
 {
-    ResourcePtr *resources;
-    ResourcePtr this, next;
-    int i, elements;
-    int *eltptr;
+    ClientResourceRec *rrec;
+    ResourcePtr res;
+    int i;
 
     if (!client)
         client = serverClient;
 
-    resources = clientTable[client->index].resources;
-    eltptr = &clientTable[client->index].elements;
-    for (i = 0; i < clientTable[client->index].buckets; i++) {
-        for (this = resources[i]; this; this = next) {
-            next = this->next;
-            if (!type || this->type == type) {
-                elements = *eltptr;
-                (*func) (this->value, this->id, cdata);
-                if (*eltptr != elements)
-                    next = resources[i];        /* start over */
-            }
-        }
+    rrec = &clientTable[client->index];
+    rrec->iterating++;
+    for (i = 0; (res = ResourceSlot(rrec, i)); i++) {
+        if (res->type == X11_RESTYPE_NONE)
+            continue;
+        if (!type || res->type == type)
+            (*func) (res->value, res->id, cdata);
     }
+    rrec->iterating--;
 }
 
 void FindSubResources(void *resource,
@@ -1027,25 +1240,20 @@ void FindSubResources(void *resource,
 void
 FindAllClientResources(ClientPtr client, FindAllRes func, void *cdata)
 {
-    ResourcePtr *resources;
-    ResourcePtr this, next;
-    int i, elements;
-    int *eltptr;
+    ClientResourceRec *rrec;
+    ResourcePtr res;
+    int i;
 
     if (!client)
         client = serverClient;
 
-    resources = clientTable[client->index].resources;
-    eltptr = &clientTable[client->index].elements;
-    for (i = 0; i < clientTable[client->index].buckets; i++) {
-        for (this = resources[i]; this; this = next) {
-            next = this->next;
-            elements = *eltptr;
-            (*func) (this->value, this->id, this->type, cdata);
-            if (*eltptr != elements)
-                next = resources[i];    /* start over */
-        }
+    rrec = &clientTable[client->index];
+    rrec->iterating++;
+    for (i = 0; (res = ResourceSlot(rrec, i)); i++) {
+        if (res->type != X11_RESTYPE_NONE)
+            (*func) (res->value, res->id, res->type, cdata);
     }
+    rrec->iterating--;
 }
 
 void *
@@ -1053,74 +1261,61 @@ LookupClientResourceComplex(ClientPtr client,
                             RESTYPE type,
                             FindComplexResType func, void *cdata)
 {
-    ResourcePtr *resources;
-    ResourcePtr this, next;
-    void *value;
+    ClientResourceRec *rrec;
+    ResourcePtr res;
+    void *value = NULL;
     int i;
 
     if (!client)
         client = serverClient;
 
-    resources = clientTable[client->index].resources;
-    for (i = 0; i < clientTable[client->index].buckets; i++) {
-        for (this = resources[i]; this; this = next) {
-            next = this->next;
-            if (!type || this->type == type) {
-                /* workaround func freeing the type as DRI1 does */
-                value = this->value;
-                if ((*func) (value, this->id, cdata))
-                    return value;
-            }
+    rrec = &clientTable[client->index];
+    rrec->iterating++;
+    for (i = 0; (res = ResourceSlot(rrec, i)); i++) {
+        if (res->type == X11_RESTYPE_NONE)
+            continue;
+        if (!type || res->type == type) {
+            /* workaround func freeing the type as DRI1 does */
+            value = res->value;
+            if ((*func) (value, res->id, cdata))
+                break;
+            value = NULL;
         }
     }
-    return NULL;
+    rrec->iterating--;
+    return value;
 }
 
 void
 FreeClientNeverRetainResources(ClientPtr client)
 {
-    ResourcePtr *resources;
-    ResourcePtr this;
-    ResourcePtr *prev;
-    int j, elements;
-    int *eltptr;
+    ClientResourceRec *rrec;
+    ResourcePtr res;
+    int i;
 
     if (!client)
         return;
 
-    resources = clientTable[client->index].resources;
-    eltptr = &clientTable[client->index].elements;
-    for (j = 0; j < clientTable[client->index].buckets; j++) {
-        prev = &resources[j];
-        while ((this = *prev)) {
-            RESTYPE rtype = this->type;
-
-            if (rtype & RC_NEVERRETAIN) {
-#ifdef XSERVER_DTRACE
-                XSERVER_RESOURCE_FREE(this->id, this->type,
-                                      this->value, TypeNameString(this->type));
-#endif
-                *prev = this->next;
-                clientTable[client->index].elements--;
-                elements = *eltptr;
-
-                doFreeResource(this, FALSE);
-
-                if (*eltptr != elements)
-                    prev = &resources[j];       /* prev may no longer be valid */
-            }
-            else
-                prev = &this->next;
-        }
+    rrec = &clientTable[client->index];
+    rrec->iterating++;
+    /* newest first among those sharing an id */
+    for (i = 0; (res = ResourceSlot(rrec, i));) {
+        if (res->type & RC_NEVERRETAIN)
+            RemoveResource(rrec,
+                           FindResource(rrec, res->id, X11_RESTYPE_NONE,
+                                        RC_NEVERRETAIN), FALSE);
+        else
+            i++;
     }
+    rrec->iterating--;
 }
 
 void
 FreeClientResources(ClientPtr client)
 {
-    ResourcePtr *resources;
-    ResourcePtr this;
-    int j;
+    ClientResourceRec *rrec;
+    ResourcePtr res;
+    int i;
 
     /* This routine shouldn't be called with a null client, but just in
        case ... */
@@ -1130,35 +1325,32 @@ FreeClientResources(ClientPtr client)
 
     HandleSaveSet(client);
 
-    resources = clientTable[client->index].resources;
-    for (j = 0; j < clientTable[client->index].buckets; j++) {
-        /* It may seem silly to update the head of this resource list as
-           we delete the members, since the entire list will be deleted any way,
-           but there are some resource deletion functions "FreeClientPixels" for
-           one which do a LookupID on another resource id (a Colormap id in this
-           case), so the resource list must be kept valid up to the point that
-           it is deleted, so every time we delete a resource, we must update the
-           head, just like in FreeResource. I hope that this doesn't slow down
-           mass deletion appreciably. PRH */
-
-        ResourcePtr *head;
-
-        head = &resources[j];
-
-        for (this = *head; this; this = *head) {
-#ifdef XSERVER_DTRACE
-            XSERVER_RESOURCE_FREE(this->id, this->type,
-                                  this->value, TypeNameString(this->type));
-#endif
-            *head = this->next;
-            clientTable[client->index].elements--;
-
-            doFreeResource(this, FALSE);
+    /* Some resource deletion functions, "FreeClientPixels" for one, do a
+     * LookupID on another resource id (a Colormap id in this case), so the
+     * table must be kept valid up to the point that it is deleted.  Free
+     * the resources sharing an id newest first, like FreeResource() does;
+     * some ddx layers depend on resources being freed in the opposite
+     * order they were added. */
+    rrec = &clientTable[client->index];
+    rrec->iterating++;
+    while (rrec->elements > 0) {
+        for (i = 0; (res = ResourceSlot(rrec, i));) {
+            if (res->type != X11_RESTYPE_NONE)
+                RemoveResource(rrec,
+                               FindResource(rrec, res->id, X11_RESTYPE_NONE,
+                                            RC_ANY), FALSE);
+            else
+                i++;
         }
     }
-    free(clientTable[client->index].resources);
-    clientTable[client->index].resources = NULL;
-    clientTable[client->index].buckets = 0;
+    rrec->iterating--;
+    free(rrec->table.slots);
+    free(rrec->old.slots);
+    memset(rrec->cache, 0, sizeof(rrec->cache));
+    memset(&rrec->table, 0, sizeof(rrec->table));
+    memset(&rrec->old, 0, sizeof(rrec->old));
+    rrec->rehash = 0;
+    rrec->used = 0;
 }
 
 void
@@ -1167,7 +1359,7 @@ FreeAllResources(void)
     int i;
 
     for (i = currentMaxClients; --i >= 0;) {
-        if (clientTable[i].buckets)
+        if (clientTable[i].table.buckets)
             FreeClientResources(clients[i]);
     }
 }
@@ -1201,36 +1393,31 @@ int
 dixLookupResourceByType(void **result, XID id, RESTYPE rtype,
                         ClientPtr client, Mask mode)
 {
-    int cid = CLIENT_ID(id);
-    ResourcePtr res = NULL;
+    RESTYPE type;
+    void *value;
+    int rc;
 
     *result = NULL;
     if ((rtype & TypeMask) > lastResourceType)
         return BadImplementation;
 
-    if ((cid < LimitClients) && clientTable[cid].buckets) {
-        res = clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-
-        for (; res; res = res->next)
-            if (res->id == id && res->type == rtype)
-                break;
-    }
+    value = LookupResource(id, rtype, FALSE, &type);
     if (client) {
         client->errorValue = id;
     }
-    if (!res)
+    if (type == X11_RESTYPE_NONE)
         return resourceTypes[rtype & TypeMask].errorValue;
 
     if (client) {
-        cid = XaceHookResourceAccess(client, id, res->type,
-                       res->value, X11_RESTYPE_NONE, NULL, mode);
-        if (cid == BadValue)
+        rc = XaceHookResourceAccess(client, id, type,
+                       value, X11_RESTYPE_NONE, NULL, mode);
+        if (rc == BadValue)
             return resourceTypes[rtype & TypeMask].errorValue;
-        if (cid != Success)
-            return cid;
+        if (rc != Success)
+            return rc;
     }
 
-    *result = res->value;
+    *result = value;
     return Success;
 }
 
@@ -1238,31 +1425,68 @@ int
 dixLookupResourceByClass(void **result, XID id, RESTYPE rclass,
                          ClientPtr client, Mask mode)
 {
-    int cid = CLIENT_ID(id);
-    ResourcePtr res = NULL;
+    RESTYPE type;
+    void *value;
+    int rc;
 
     *result = NULL;
 
-    if ((cid < LimitClients) && clientTable[cid].buckets) {
-        res = clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-
-        for (; res; res = res->next)
-            if (res->id == id && (res->type & rclass))
-                break;
-    }
+    value = LookupResource(id, rclass, TRUE, &type);
     if (client) {
         client->errorValue = id;
     }
-    if (!res)
+    if (type == X11_RESTYPE_NONE)
         return BadValue;
 
     if (client) {
-        cid = XaceHookResourceAccess(client, id, res->type,
-                       res->value, X11_RESTYPE_NONE, NULL, mode);
-        if (cid != Success)
-            return cid;
+        rc = XaceHookResourceAccess(client, id, type,
+                       value, X11_RESTYPE_NONE, NULL, mode);
+        if (rc != Success)
+            return rc;
     }
 
-    *result = res->value;
+    *result = value;
     return Success;
 }
+
+static int
+LookupStatsCompare(const void *a, const void *b)
+{
+    uint64_t la = resourceTypes[*(const RESTYPE *) a].lookups;
+    uint64_t lb = resourceTypes[*(const RESTYPE *) b].lookups;
+
+    if (la != lb)
+        return la < lb ? 1 : -1;
+    return 0;
+}
+
+void
+LogResourceLookupStats(void)
+{
+    RESTYPE *order;
+    RESTYPE t;
+    int n = 0, i;
+
+    order = calloc(lastResourceType + 1, sizeof(RESTYPE));
+    if (!order)
+        return;
+    for (t = 1; t <= lastResourceType; t++)
+        if (resourceTypes[t].lookups)
+            order[n++] = t;
+    qsort(order, n, sizeof(RESTYPE), LookupStatsCompare);
+
+    LogMessage(X_INFO, "Dispatch profile: %-28s %10s %9s\n",
+               "resource type", "lookups", "% cached");
+    for (i = 0; i < n; i++) {
+        struct ResourceType *rt = &resourceTypes[order[i]];
+
+        LogMessage(X_INFO, "Dispatch profile: %-28.28s %10llu %9.1f\n",
+                   LookupResourceName(order[i]),
+                   (unsigned long long) rt->lookups,
+                   100.0 * rt->cacheHits / rt->lookups);
+    }
+    free(order);
+
+    for (t = 0; t <= lastResourceType; t++)
+        resourceTypes[t].lookups = resourceTypes[t].cacheHits = 0;
+}
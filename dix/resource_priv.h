@@ -0,0 +1,12 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Copyright © 2026 X.Org Foundation
+ */
+#ifndef _XSERVER_DIX_RESOURCE_PRIV_H
+#define _XSERVER_DIX_RESOURCE_PRIV_H
+
+/* Write how often lookups of each resource type were answered from the
+ * lookup cache to the log, and start counting over. */
+void LogResourceLookupStats(void);
+
+#endif /* _XSERVER_DIX_RESOURCE_PRIV_H */
@@ -0,0 +1,377 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Each object is preceded by a header naming the slab it lives in, so that
+ * freeing needs nothing but the pointer; objects that did not fit a slab
+ * have no slab there and go straight back to free().  Sizes are rounded up
+ * to SLAB_ALIGN and every type has a cache per rounded size, which in
+ * practice means one or two per type: the object plus the privates of the
+ * screens it can be on.  A cache keeps its slabs with free objects on a
+ * list, the full ones on none, and at most one empty one on the side.
+ *
+ * Pixmaps and regions can be made from the input thread while it moves a
+ * software cursor, so the input thread has caches of its own, and neither
+ * thread takes a lock for its own objects.  An object freed by the thread
+ * that doesn't own its cache goes on the cache's remote list, which the
+ * owner takes back on its next allocation.  No other thread may allocate
+ * from the slabs.
+ */
+
+#include <dix-config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dix/slab_priv.h"
+
+#include "list.h"
+#include "input.h"
+
+#define SLAB_ALIGN 32
+#define SLAB_MAX_OBJECT 2048
+#define SLAB_CLASSES (SLAB_MAX_OBJECT / SLAB_ALIGN)
+#define SLAB_BYTES 16384
+#define SLAB_MIN_OBJECTS 8
+
+/* Objects are aligned as malloc() would align them */
+#if defined(__STDC__) && (__STDC_VERSION__ - 0 >= 201112L)
+#define SLAB_OBJECT_ALIGN _Alignof(max_align_t)
+#else
+#define SLAB_OBJECT_ALIGN (2 * sizeof(void *))
+#endif
+#define SLAB_ROUND(n) (((n) + SLAB_OBJECT_ALIGN - 1) & ~(SLAB_OBJECT_ALIGN - 1))
+
+/* caches of the main thread, and of the input thread */
+#define SLAB_MAIN 0
+#define SLAB_INPUT 1
+#define SLAB_OWNERS 2
+
+typedef struct _DixSlabCache *DixSlabCachePtr;
+typedef struct _DixSlab *DixSlabPtr;
+
+typedef struct _DixSlabHeader {
+    DixSlabPtr slab;            /* NULL if from malloc */
+    DixSlabType type;
+} DixSlabHeaderRec, *DixSlabHeaderPtr;
+
+typedef struct _DixSlab {
+    struct xorg_list entry;     /* in cache->partial, if on it */
+    DixSlabCachePtr cache;
+    DixSlabHeaderPtr free;      /* linked through the object's first word */
+    unsigned inuse;
+} DixSlabRec;
+
+typedef struct _DixSlabCache {
+    DixSlabType type;
+    int owner;
+    unsigned stride;            /* header and object */
+    unsigned count;             /* objects per slab */
+    unsigned slabs;
+    struct xorg_list partial;
+    DixSlabPtr empty;
+    DixSlabHeaderPtr remote;    /* freed by the other thread */
+} DixSlabCacheRec;
+
+static DixSlabCachePtr caches[SLAB_OWNERS][SLAB_LAST][SLAB_CLASSES];
+static DixSlabStatsRec stats[SLAB_OWNERS][SLAB_LAST];
+
+static const char *slab_names[SLAB_LAST] = {
+    [SLAB_WINDOW] = "WINDOW",
+    [SLAB_GC] = "GC",
+    [SLAB_PIXMAP] = "PIXMAP",
+    [SLAB_REGION] = "REGION",
+};
+
+#define SLAB_HEADER_SIZE SLAB_ROUND(sizeof(DixSlabHeaderRec))
+#define SLAB_FIRST SLAB_ROUND(sizeof(DixSlabRec))
+#define SLAB_OBJECT(h) ((void *) ((char *) (h) + SLAB_HEADER_SIZE))
+#define SLAB_HEADER(o) ((DixSlabHeaderPtr) ((char *) (o) - SLAB_HEADER_SIZE))
+#define SLAB_NEXT(h) (*(DixSlabHeaderPtr *) SLAB_OBJECT(h))
+
+static int
+slab_owner(void)
+{
+    return in_input_thread() ? SLAB_INPUT : SLAB_MAIN;
+}
+
+static size_t
+slab_size(DixSlabCachePtr cache)
+{
+    return SLAB_FIRST + (size_t) cache->stride * cache->count;
+}
+
+static DixSlabCachePtr
+slab_cache(int owner, DixSlabType type, size_t size)
+{
+    int class = (size + SLAB_ALIGN - 1) / SLAB_ALIGN - 1;
+    DixSlabCachePtr cache = caches[owner][type][class];
+
+    if (cache)
+        return cache;
+
+    cache = calloc(1, sizeof(DixSlabCacheRec));
+    if (!cache)
+        return NULL;
+    cache->type = type;
+    cache->owner = owner;
+    cache->stride = SLAB_ROUND(SLAB_HEADER_SIZE + (class + 1) * SLAB_ALIGN);
+    cache->count = (SLAB_BYTES - SLAB_FIRST) / cache->stride;
+    if (cache->count < SLAB_MIN_OBJECTS)
+        cache->count = SLAB_MIN_OBJECTS;
+    xorg_list_init(&cache->partial);
+    caches[owner][type][class] = cache;
+    return cache;
+}
+
+static DixSlabPtr
+slab_create(DixSlabCachePtr cache)
+{
+    DixSlabPtr slab = malloc(slab_size(cache));
+    char *object;
+    unsigned i;
+
+    if (!slab)
+        return NULL;
+
+    slab->cache = cache;
+    slab->inuse = 0;
+    slab->free = NULL;
+    object = (char *) slab + slab_size(cache);
+    for (i = 0; i < cache->count; i++) {
+        DixSlabHeaderPtr header;
+
+        object -= cache->stride;
+        header = (DixSlabHeaderPtr) object;
+        header->slab = slab;
+        header->type = cache->type;
+        SLAB_NEXT(header) = slab->free;
+        slab->free = header;
+    }
+    xorg_list_init(&slab->entry);
+
+    cache->slabs++;
+    stats[cache->owner][cache->type].cached += cache->count;
+    stats[cache->owner][cache->type].bytes += slab_size(cache);
+    return slab;
+}
+
+static void
+slab_destroy(DixSlabPtr slab)
+{
+    DixSlabCachePtr cache = slab->cache;
+
+    xorg_list_del(&slab->entry);
+    cache->slabs--;
+    stats[cache->owner][cache->type].cached -= cache->count;
+    stats[cache->owner][cache->type].bytes -= slab_size(cache);
+    free(slab);
+}
+
+/* Put an object back in its slab; on the thread owning the cache. */
+static void
+slab_put(DixSlabCachePtr cache, DixSlabHeaderPtr header)
+{
+    DixSlabPtr slab = header->slab;
+
+    stats[cache->owner][cache->type].cached++;
+    if (!slab->free)
+        xorg_list_add(&slab->entry, &cache->partial);
+    SLAB_NEXT(header) = slab->free;
+    slab->free = header;
+
+    if (--slab->inuse == 0) {
+        if (cache->empty)
+            slab_destroy(slab);
+        else {
+            xorg_list_del(&slab->entry);
+            cache->empty = slab;
+        }
+    }
+}
+
+/* Take back what the other thread freed. */
+static void
+slab_put_remote(DixSlabCachePtr cache)
+{
+    DixSlabHeaderPtr header, next;
+
+    header = __atomic_exchange_n(&cache->remote, NULL, __ATOMIC_ACQUIRE);
+    for (; header; header = next) {
+        next = SLAB_NEXT(header);
+        slab_put(cache, header);
+    }
+}
+
+static void *
+slab_alloc(DixSlabType type, size_t size, Bool clear)
+{
+    int owner = slab_owner();
+    DixSlabHeaderPtr header;
+    DixSlabCachePtr cache;
+    DixSlabPtr slab;
+
+    /* calloc() gets big ones fresh pages that need no clearing */
+    if (size > SLAB_MAX_OBJECT ||
+        !(cache = slab_cache(owner, type, size ? size : 1))) {
+        header = clear ? calloc(1, SLAB_HEADER_SIZE + size) :
+            malloc(SLAB_HEADER_SIZE + size);
+        if (!header)
+            return NULL;
+        header->slab = NULL;
+        header->type = type;
+        stats[owner][type].live++;
+        return SLAB_OBJECT(header);
+    }
+
+    if (__atomic_load_n(&cache->remote, __ATOMIC_RELAXED))
+        slab_put_remote(cache);
+
+    if (!xorg_list_is_empty(&cache->partial))
+        slab = xorg_list_first_entry(&cache->partial, DixSlabRec, entry);
+    else {
+        slab = cache->empty;
+        if (slab)
+            cache->empty = NULL;
+        else if (!(slab = slab_create(cache)))
+            return NULL;
+        xorg_list_add(&slab->entry, &cache->partial);
+    }
+
+    header = slab->free;
+    slab->free = SLAB_NEXT(header);
+    if (!slab->free)
+        xorg_list_del(&slab->entry);
+    slab->inuse++;
+    stats[owner][type].live++;
+    stats[owner][type].cached--;
+
+    if (clear)
+        memset(SLAB_OBJECT(header), 0, size);
+    return SLAB_OBJECT(header);
+}
+
+void *
+dixSlabAlloc(DixSlabType type, size_t size)
+{
+    return slab_alloc(type, size, FALSE);
+}
+
+void *
+dixSlabCalloc(DixSlabType type, size_t size)
+{
+    return slab_alloc(type, size, TRUE);
+}
+
+void
+dixSlabFree(void *object)
+{
+    int owner = slab_owner();
+    DixSlabHeaderPtr header, head;
+    DixSlabCachePtr cache;
+
+    if (!object)
+        return;
+
+    header = SLAB_HEADER(object);
+    stats[owner][header->type].live--;
+    if (!header->slab) {
+        free(header);
+        return;
+    }
+
+    cache = header->slab->cache;
+    if (cache->owner == owner) {
+        slab_put(cache, header);
+        return;
+    }
+
+    /* the owner may be allocating from the cache right now */
+    head = __atomic_load_n(&cache->remote, __ATOMIC_RELAXED);
+    do {
+        SLAB_NEXT(header) = head;
+    } while (!__atomic_compare_exchange_n(&cache->remote, &head, header, TRUE,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+void
+dixSlabStats(DixSlabType type, DixSlabStatsPtr out)
+{
+    int owner;
+
+    /* objects on a remote list count as neither live nor cached */
+    memset(out, 0, sizeof(*out));
+    input_lock();
+    for (owner = 0; owner < SLAB_OWNERS; owner++) {
+        out->live += stats[owner][type].live;
+        out->cached += stats[owner][type].cached;
+        out->bytes += stats[owner][type].bytes;
+    }
+    input_unlock();
+}
+
+void
+dixSlabLogStats(void)
+{
+    DixSlabType type;
+
+    for (type = 0; type < SLAB_LAST; type++) {
+        DixSlabStatsRec stats;
+
+        dixSlabStats(type, &stats);
+        LogMessageVerb(X_INFO, 3, "Slab %s: %lu live, %lu cached, "
+                       "%lu bytes\n", slab_names[type], stats.live,
+                       stats.cached, stats.bytes);
+    }
+}
+
+void
+dixSlabReset(void)
+{
+    DixSlabType type;
+    int owner, class;
+
+    /* the input thread only allocates under the input lock */
+    input_lock();
+    for (owner = 0; owner < SLAB_OWNERS; owner++) {
+        for (type = 0; type < SLAB_LAST; type++) {
+            for (class = 0; class < SLAB_CLASSES; class++) {
+                DixSlabCachePtr cache = caches[owner][type][class];
+
+                if (!cache)
+                    continue;
+                slab_put_remote(cache);
+                if (cache->empty) {
+                    slab_destroy(cache->empty);
+                    cache->empty = NULL;
+                }
+                /* privates may be laid out differently next time around */
+                if (!cache->slabs) {
+                    free(cache);
+                    caches[owner][type][class] = NULL;
+                }
+            }
+        }
+    }
+    input_unlock();
+}
@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Copyright © 2026 X.Org Foundation
+ */
+#ifndef _XSERVER_DIX_SLAB_PRIV_H
+#define _XSERVER_DIX_SLAB_PRIV_H
+
+#include <stddef.h>
+
+#include "misc.h"
+
+/*
+ * Slabs for the small objects that come and go all the time: windows, GCs,
+ * pixmap headers and regions, each with their privates.  Objects of one
+ * type and size are carved out of bigger blocks and go back onto a free
+ * list of their block when freed, so that popup and pixmap churn neither
+ * hits malloc nor spreads over the heap.  A block that has nothing handed
+ * out any more is kept while it is the only one, and freed otherwise.
+ *
+ * Objects too big for a slab come from malloc, or calloc if they are to be
+ * cleared, but are still counted; the numbers are logged at server reset.
+ */
+
+typedef enum {
+    SLAB_WINDOW,
+    SLAB_GC,
+    SLAB_PIXMAP,
+    SLAB_REGION,
+    SLAB_LAST,
+} DixSlabType;
+
+typedef struct _DixSlabStats {
+    unsigned long live;         /* objects handed out */
+    unsigned long cached;       /* free objects sitting in slabs */
+    unsigned long bytes;        /* memory in slabs, in use or not */
+} DixSlabStatsRec, *DixSlabStatsPtr;
+
+/* Allocate size bytes, not cleared, for an object of type; NULL if OOM. */
+void *dixSlabAlloc(DixSlabType type, size_t size);
+
+/* Like dixSlabAlloc(), but cleared. */
+void *dixSlabCalloc(DixSlabType type, size_t size);
+
+/* Free an object from dixSlabAlloc(); NULL is ignored. */
+void dixSlabFree(void *object);
+
+/* Fill in the numbers for type. */
+void dixSlabStats(DixSlabType type, DixSlabStatsPtr stats);
+
+/* Log the numbers of each type. */
+void dixSlabLogStats(void);
+
+/* Free the slabs with nothing handed out, at server reset. */
+void dixSlabReset(void);
+
+#endif /* _XSERVER_DIX_SLAB_PRIV_H */
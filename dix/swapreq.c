@@ -112,26 +112,55 @@ SwapShorts(short *list, unsigned long count)
     }
 }
 
+/*
+ * Request swappers byte-swap a request in place without needing its
+ * client, so that reader threads can do it ahead of dispatch.  They
+ * return FALSE and leave the request alone if it's too short for its
+ * type.  The sizes they go by come from req_len, never from a field they
+ * swap, so swapping a request twice gives it back unchanged.
+ */
+
 /* The following is used for all requests that have
    no fields to be swapped (except "length") */
+Bool
+SwapSimpleReq(xReq *req, CARD32 req_len)
+{
+    xReq *stuff = req;
+
+    swaps(&stuff->length);
+    return TRUE;
+}
+
 int _X_COLD
 SProcSimpleReq(ClientPtr client)
 {
     REQUEST(xReq);
-    swaps(&stuff->length);
+    if (!SwapSimpleReq(stuff, client->req_len))
+        return BadLength;
     return (*ProcVector[stuff->reqType]) (client);
 }
 
 /* The following is used for all requests that have
    only a single 32-bit field to be swapped, coming
    right after the "length" field */
-int _X_COLD
-SProcResourceReq(ClientPtr client)
+Bool
+SwapResourceReq(xReq *req, CARD32 req_len)
 {
-    REQUEST(xResourceReq);
+    xResourceReq *stuff = (xResourceReq *) req;
+
+    if ((sizeof(xResourceReq) >> 2) > req_len)
+        return FALSE;
     swaps(&stuff->length);
-    REQUEST_AT_LEAST_SIZE(xResourceReq);        /* not EXACT */
     swapl(&stuff->id);
+    return TRUE;
+}
+
+int _X_COLD
+SProcResourceReq(ClientPtr client)
+{
+    REQUEST(xReq);
+    if (!SwapResourceReq(stuff, client->req_len))
+        return BadLength;
     return (*ProcVector[stuff->reqType]) (client);
 }
 
@@ -155,15 +184,25 @@ SProcCreateWindow(ClientPtr client)
     return ((*ProcVector[X_CreateWindow]) (client));
 }
 
-int _X_COLD
-SProcChangeWindowAttributes(ClientPtr client)
+Bool
+SwapChangeWindowAttributesReq(xReq *req, CARD32 req_len)
 {
-    REQUEST(xChangeWindowAttributesReq);
+    xChangeWindowAttributesReq *stuff = (xChangeWindowAttributesReq *) req;
+
+    if ((sizeof(xChangeWindowAttributesReq) >> 2) > req_len)
+        return FALSE;
     swaps(&stuff->length);
-    REQUEST_AT_LEAST_SIZE(xChangeWindowAttributesReq);
     swapl(&stuff->window);
     swapl(&stuff->valueMask);
-    SwapRestL(stuff);
+    SwapReqRestL(stuff, req_len);
+    return TRUE;
+}
+
+int _X_COLD
+SProcChangeWindowAttributes(ClientPtr client)
+{
+    if (!SwapChangeWindowAttributesReq(client->requestBuffer, client->req_len))
+        return BadLength;
     return ((*ProcVector[X_ChangeWindowAttributes]) (client));
 }
 
@@ -180,17 +219,26 @@ SProcReparentWindow(ClientPtr client)
     return ((*ProcVector[X_ReparentWindow]) (client));
 }
 
-int _X_COLD
-SProcConfigureWindow(ClientPtr client)
+Bool
+SwapConfigureWindowReq(xReq *req, CARD32 req_len)
 {
-    REQUEST(xConfigureWindowReq);
+    xConfigureWindowReq *stuff = (xConfigureWindowReq *) req;
+
+    if ((sizeof(xConfigureWindowReq) >> 2) > req_len)
+        return FALSE;
     swaps(&stuff->length);
-    REQUEST_AT_LEAST_SIZE(xConfigureWindowReq);
     swapl(&stuff->window);
     swaps(&stuff->mask);
-    SwapRestL(stuff);
-    return ((*ProcVector[X_ConfigureWindow]) (client));
+    SwapReqRestL(stuff, req_len);
+    return TRUE;
+}
 
+int _X_COLD
+SProcConfigureWindow(ClientPtr client)
+{
+    if (!SwapConfigureWindowReq(client->requestBuffer, client->req_len))
+        return BadLength;
+    return ((*ProcVector[X_ConfigureWindow]) (client));
 }
 
 int _X_COLD
@@ -203,12 +251,14 @@ SProcInternAtom(ClientPtr client)
     return ((*ProcVector[X_InternAtom]) (client));
 }
 
-int _X_COLD
-SProcChangeProperty(ClientPtr client)
+Bool
+SwapChangePropertyReq(xReq *req, CARD32 req_len)
 {
-    REQUEST(xChangePropertyReq);
+    xChangePropertyReq *stuff = (xChangePropertyReq *) req;
+
+    if ((sizeof(xChangePropertyReq) >> 2) > req_len)
+        return FALSE;
     swaps(&stuff->length);
-    REQUEST_AT_LEAST_SIZE(xChangePropertyReq);
     swapl(&stuff->window);
     swapl(&stuff->property);
     swapl(&stuff->type);
@@ -217,12 +267,20 @@ SProcChangeProperty(ClientPtr client)
     case 8:
         break;
     case 16:
-        SwapRestS(stuff);
+        SwapReqRestS(stuff, req_len);
         break;
     case 32:
-        SwapRestL(stuff);
+        SwapReqRestL(stuff, req_len);
         break;
     }
+    return TRUE;
+}
+
+int _X_COLD
+SProcChangeProperty(ClientPtr client)
+{
+    if (!SwapChangePropertyReq(client->requestBuffer, client->req_len))
+        return BadLength;
     return ((*ProcVector[X_ChangeProperty]) (client));
 }
 
@@ -501,28 +559,48 @@ SProcCreatePixmap(ClientPtr client)
     return ((*ProcVector[X_CreatePixmap]) (client));
 }
 
-int _X_COLD
-SProcCreateGC(ClientPtr client)
+Bool
+SwapCreateGCReq(xReq *req, CARD32 req_len)
 {
-    REQUEST(xCreateGCReq);
+    xCreateGCReq *stuff = (xCreateGCReq *) req;
+
+    if ((sizeof(xCreateGCReq) >> 2) > req_len)
+        return FALSE;
     swaps(&stuff->length);
-    REQUEST_AT_LEAST_SIZE(xCreateGCReq);
     swapl(&stuff->gc);
     swapl(&stuff->drawable);
     swapl(&stuff->mask);
-    SwapRestL(stuff);
-    return ((*ProcVector[X_CreateGC]) (client));
+    SwapReqRestL(stuff, req_len);
+    return TRUE;
 }
 
 int _X_COLD
-SProcChangeGC(ClientPtr client)
+SProcCreateGC(ClientPtr client)
+{
+    if (!SwapCreateGCReq(client->requestBuffer, client->req_len))
+        return BadLength;
+    return ((*ProcVector[X_CreateGC]) (client));
+}
+
+Bool
+SwapChangeGCReq(xReq *req, CARD32 req_len)
 {
-    REQUEST(xChangeGCReq);
+    xChangeGCReq *stuff = (xChangeGCReq *) req;
+
+    if ((sizeof(xChangeGCReq) >> 2) > req_len)
+        return FALSE;
     swaps(&stuff->length);
-    REQUEST_AT_LEAST_SIZE(xChangeGCReq);
     swapl(&stuff->gc);
     swapl(&stuff->mask);
-    SwapRestL(stuff);
+    SwapReqRestL(stuff, req_len);
+    return TRUE;
+}
+
+int _X_COLD
+SProcChangeGC(ClientPtr client)
+{
+    if (!SwapChangeGCReq(client->requestBuffer, client->req_len))
+        return BadLength;
     return ((*ProcVector[X_ChangeGC]) (client));
 }
 
@@ -551,39 +629,61 @@ SProcSetDashes(ClientPtr client)
 
 }
 
-int _X_COLD
-SProcSetClipRectangles(ClientPtr client)
+Bool
+SwapSetClipRectanglesReq(xReq *req, CARD32 req_len)
 {
-    REQUEST(xSetClipRectanglesReq);
+    xSetClipRectanglesReq *stuff = (xSetClipRectanglesReq *) req;
+
+    if ((sizeof(xSetClipRectanglesReq) >> 2) > req_len)
+        return FALSE;
     swaps(&stuff->length);
-    REQUEST_AT_LEAST_SIZE(xSetClipRectanglesReq);
     swapl(&stuff->gc);
     swaps(&stuff->xOrigin);
     swaps(&stuff->yOrigin);
-    SwapRestS(stuff);
-    return ((*ProcVector[X_SetClipRectangles]) (client));
+    SwapReqRestS(stuff, req_len);
+    return TRUE;
 }
 
 int _X_COLD
-SProcClearToBackground(ClientPtr client)
+SProcSetClipRectangles(ClientPtr client)
+{
+    if (!SwapSetClipRectanglesReq(client->requestBuffer, client->req_len))
+        return BadLength;
+    return ((*ProcVector[X_SetClipRectangles]) (client));
+}
+
+Bool
+SwapClearAreaReq(xReq *req, CARD32 req_len)
 {
-    REQUEST(xClearAreaReq);
+    xClearAreaReq *stuff = (xClearAreaReq *) req;
+
+    if ((sizeof(xClearAreaReq) >> 2) != req_len)
+        return FALSE;
     swaps(&stuff->length);
-    REQUEST_SIZE_MATCH(xClearAreaReq);
     swapl(&stuff->window);
     swaps(&stuff->x);
     swaps(&stuff->y);
     swaps(&stuff->width);
     swaps(&stuff->height);
-    return ((*ProcVector[X_ClearArea]) (client));
+    return TRUE;
 }
 
 int _X_COLD
-SProcCopyArea(ClientPtr client)
+SProcClearToBackground(ClientPtr client)
+{
+    if (!SwapClearAreaReq(client->requestBuffer, client->req_len))
+        return BadLength;
+    return ((*ProcVector[X_ClearArea]) (client));
+}
+
+Bool
+SwapCopyAreaReq(xReq *req, CARD32 req_len)
 {
-    REQUEST(xCopyAreaReq);
+    xCopyAreaReq *stuff = (xCopyAreaReq *) req;
+
+    if ((sizeof(xCopyAreaReq) >> 2) != req_len)
+        return FALSE;
     swaps(&stuff->length);
-    REQUEST_SIZE_MATCH(xCopyAreaReq);
     swapl(&stuff->srcDrawable);
     swapl(&stuff->dstDrawable);
     swapl(&stuff->gc);
@@ -593,6 +693,14 @@ SProcCopyArea(ClientPtr client)
     swaps(&stuff->dstY);
     swaps(&stuff->width);
     swaps(&stuff->height);
+    return TRUE;
+}
+
+int _X_COLD
+SProcCopyArea(ClientPtr client)
+{
+    if (!SwapCopyAreaReq(client->requestBuffer, client->req_len))
+        return BadLength;
     return ((*ProcVector[X_CopyArea]) (client));
 }
 
@@ -617,39 +725,62 @@ SProcCopyPlane(ClientPtr client)
 
 /* The following routine is used for all Poly drawing requests
    (except FillPoly, which uses a different request format) */
-int _X_COLD
-SProcPoly(ClientPtr client)
+Bool
+SwapPolyReq(xReq *req, CARD32 req_len)
 {
-    REQUEST(xPolyPointReq);
+    xPolyPointReq *stuff = (xPolyPointReq *) req;
+
+    if ((sizeof(xPolyPointReq) >> 2) > req_len)
+        return FALSE;
     swaps(&stuff->length);
-    REQUEST_AT_LEAST_SIZE(xPolyPointReq);
     swapl(&stuff->drawable);
     swapl(&stuff->gc);
-    SwapRestS(stuff);
+    SwapReqRestS(stuff, req_len);
+    return TRUE;
+}
+
+int _X_COLD
+SProcPoly(ClientPtr client)
+{
+    REQUEST(xReq);
+    if (!SwapPolyReq(stuff, client->req_len))
+        return BadLength;
     return ((*ProcVector[stuff->reqType]) (client));
 }
 
 /* cannot use SProcPoly for this one, because xFillPolyReq
    is longer than xPolyPointReq, and we don't want to swap
    the difference as shorts! */
-int _X_COLD
-SProcFillPoly(ClientPtr client)
+Bool
+SwapFillPolyReq(xReq *req, CARD32 req_len)
 {
-    REQUEST(xFillPolyReq);
+    xFillPolyReq *stuff = (xFillPolyReq *) req;
+
+    if ((sizeof(xFillPolyReq) >> 2) > req_len)
+        return FALSE;
     swaps(&stuff->length);
-    REQUEST_AT_LEAST_SIZE(xFillPolyReq);
     swapl(&stuff->drawable);
     swapl(&stuff->gc);
-    SwapRestS(stuff);
-    return ((*ProcVector[X_FillPoly]) (client));
+    SwapReqRestS(stuff, req_len);
+    return TRUE;
 }
 
 int _X_COLD
-SProcPutImage(ClientPtr client)
+SProcFillPoly(ClientPtr client)
+{
+    if (!SwapFillPolyReq(client->requestBuffer, client->req_len))
+        return BadLength;
+    return ((*ProcVector[X_FillPoly]) (client));
+}
+
+Bool
+SwapPutImageReq(xReq *req, CARD32 req_len)
 {
-    REQUEST(xPutImageReq);
+    xPutImageReq *stuff = (xPutImageReq *) req;
+
+    if ((sizeof(xPutImageReq) >> 2) > req_len)
+        return FALSE;
     swaps(&stuff->length);
-    REQUEST_AT_LEAST_SIZE(xPutImageReq);
     swapl(&stuff->drawable);
     swapl(&stuff->gc);
     swaps(&stuff->width);
@@ -657,8 +788,15 @@ SProcPutImage(ClientPtr client)
     swaps(&stuff->dstX);
     swaps(&stuff->dstY);
     /* Image should already be swapped */
-    return ((*ProcVector[X_PutImage]) (client));
+    return TRUE;
+}
 
+int _X_COLD
+SProcPutImage(ClientPtr client)
+{
+    if (!SwapPutImageReq(client->requestBuffer, client->req_len))
+        return BadLength;
+    return ((*ProcVector[X_PutImage]) (client));
 }
 
 int _X_COLD
@@ -678,31 +816,53 @@ SProcGetImage(ClientPtr client)
 
 /* ProcPolyText used for both PolyText8 and PolyText16 */
 
-int _X_COLD
-SProcPolyText(ClientPtr client)
+Bool
+SwapPolyTextReq(xReq *req, CARD32 req_len)
 {
-    REQUEST(xPolyTextReq);
+    xPolyTextReq *stuff = (xPolyTextReq *) req;
+
+    if ((sizeof(xPolyTextReq) >> 2) > req_len)
+        return FALSE;
     swaps(&stuff->length);
-    REQUEST_AT_LEAST_SIZE(xPolyTextReq);
     swapl(&stuff->drawable);
     swapl(&stuff->gc);
     swaps(&stuff->x);
     swaps(&stuff->y);
+    return TRUE;
+}
+
+int _X_COLD
+SProcPolyText(ClientPtr client)
+{
+    REQUEST(xReq);
+    if (!SwapPolyTextReq(stuff, client->req_len))
+        return BadLength;
     return ((*ProcVector[stuff->reqType]) (client));
 }
 
 /* ProcImageText used for both ImageText8 and ImageText16 */
 
-int _X_COLD
-SProcImageText(ClientPtr client)
+Bool
+SwapImageTextReq(xReq *req, CARD32 req_len)
 {
-    REQUEST(xImageTextReq);
+    xImageTextReq *stuff = (xImageTextReq *) req;
+
+    if ((sizeof(xImageTextReq) >> 2) > req_len)
+        return FALSE;
     swaps(&stuff->length);
-    REQUEST_AT_LEAST_SIZE(xImageTextReq);
     swapl(&stuff->drawable);
     swapl(&stuff->gc);
     swaps(&stuff->x);
     swaps(&stuff->y);
+    return TRUE;
+}
+
+int _X_COLD
+SProcImageText(ClientPtr client)
+{
+    REQUEST(xReq);
+    if (!SwapImageTextReq(stuff, client->req_len))
+        return BadLength;
     return ((*ProcVector[stuff->reqType]) (client));
 }
 
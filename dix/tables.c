@@ -580,6 +580,78 @@ int (*SwappedProcVector[256]) (ClientPtr /* client */) = {
     ProcBadRequest
 };
 
+SwapReqProcPtr SwapReqVector[EXTENSION_BASE] = {
+    [X_ChangeWindowAttributes] = SwapChangeWindowAttributesReq,
+    [X_GetWindowAttributes] = SwapResourceReq,
+    [X_DestroyWindow] = SwapResourceReq,
+    [X_DestroySubwindows] = SwapResourceReq,
+    [X_ChangeSaveSet] = SwapResourceReq,
+    [X_MapWindow] = SwapResourceReq,
+    [X_MapSubwindows] = SwapResourceReq,
+    [X_UnmapWindow] = SwapResourceReq,
+    [X_UnmapSubwindows] = SwapResourceReq,
+    [X_ConfigureWindow] = SwapConfigureWindowReq,
+    [X_CirculateWindow] = SwapResourceReq,
+    [X_GetGeometry] = SwapResourceReq,
+    [X_QueryTree] = SwapResourceReq,
+    [X_GetAtomName] = SwapResourceReq,
+    [X_ChangeProperty] = SwapChangePropertyReq,
+    [X_ListProperties] = SwapResourceReq,
+    [X_GetSelectionOwner] = SwapResourceReq,
+    [X_UngrabPointer] = SwapResourceReq,
+    [X_UngrabKeyboard] = SwapResourceReq,
+    [X_AllowEvents] = SwapResourceReq,
+    [X_GrabServer] = SwapSimpleReq,
+    [X_UngrabServer] = SwapSimpleReq,
+    [X_QueryPointer] = SwapResourceReq,
+    [X_GetInputFocus] = SwapSimpleReq,
+    [X_QueryKeymap] = SwapSimpleReq,
+    [X_CloseFont] = SwapResourceReq,
+    [X_QueryFont] = SwapResourceReq,
+    [X_QueryTextExtents] = SwapResourceReq,
+    [X_GetFontPath] = SwapSimpleReq,
+    [X_FreePixmap] = SwapResourceReq,
+    [X_CreateGC] = SwapCreateGCReq,
+    [X_ChangeGC] = SwapChangeGCReq,
+    [X_SetClipRectangles] = SwapSetClipRectanglesReq,
+    [X_FreeGC] = SwapResourceReq,
+    [X_ClearArea] = SwapClearAreaReq,
+    [X_CopyArea] = SwapCopyAreaReq,
+    [X_PolyPoint] = SwapPolyReq,
+    [X_PolyLine] = SwapPolyReq,
+    [X_PolySegment] = SwapPolyReq,
+    [X_PolyRectangle] = SwapPolyReq,
+    [X_PolyArc] = SwapPolyReq,
+    [X_FillPoly] = SwapFillPolyReq,
+    [X_PolyFillRectangle] = SwapPolyReq,
+    [X_PolyFillArc] = SwapPolyReq,
+    [X_PutImage] = SwapPutImageReq,
+    [X_PolyText8] = SwapPolyTextReq,
+    [X_PolyText16] = SwapPolyTextReq,
+    [X_ImageText8] = SwapImageTextReq,
+    [X_ImageText16] = SwapImageTextReq,
+    [X_FreeColormap] = SwapResourceReq,
+    [X_InstallColormap] = SwapResourceReq,
+    [X_UninstallColormap] = SwapResourceReq,
+    [X_ListInstalledColormaps] = SwapResourceReq,
+    [X_FreeCursor] = SwapResourceReq,
+    [X_ListExtensions] = SwapSimpleReq,
+    [X_GetKeyboardMapping] = SwapSimpleReq,
+    [X_GetKeyboardControl] = SwapSimpleReq,
+    [X_Bell] = SwapSimpleReq,
+    [X_GetPointerControl] = SwapSimpleReq,
+    [X_GetScreenSaver] = SwapSimpleReq,
+    [X_ListHosts] = SwapSimpleReq,
+    [X_SetAccessControl] = SwapSimpleReq,
+    [X_SetCloseDownMode] = SwapSimpleReq,
+    [X_KillClient] = SwapResourceReq,
+    [X_ForceScreenSaver] = SwapSimpleReq,
+    [X_SetPointerMapping] = SwapSimpleReq,
+    [X_GetPointerMapping] = SwapSimpleReq,
+    [X_SetModifierMapping] = SwapSimpleReq,
+    [X_GetModifierMapping] = SwapSimpleReq,
+};
+
 EventSwapPtr EventSwapVector[MAXEVENTS] = {
     (EventSwapPtr) SErrorEvent,
     NotImplemented,
@@ -104,6 +104,7 @@ Equipment Corporation.
 #include "dix/exevents_priv.h"
 #include "dix/input_priv.h"
 #include "dix/property_priv.h"
+#include "dix/windowindex_priv.h"
 #include "os/auth.h"
 #include "os/client_priv.h"
 #include "os/screensaver.h"
@@ -568,6 +569,10 @@ CreateRootWindow(ScreenPtr pScreen)
     BoxRec box;
     PixmapFormatRec *format;
 
+    /* the first root window comes before any other */
+    if (!PropertyIndexInit() || !WindowIndexInit())
+        return FALSE;
+
     pWin = dixAllocateScreenObjectWithPrivates(pScreen, WindowRec, PRIVATE_WINDOW);
     if (!pWin)
         return FALSE;
@@ -917,6 +922,7 @@ CreateWindow(Window wid, WindowPtr pParent, int x, int y, unsigned w,
             pParent->lastChild = pWin;
         pParent->firstChild = pWin;
     }
+    WindowIndexInvalidate(pParent);
 
     SetWinSize(pWin);
     SetBorderSize(pWin);
@@ -991,6 +997,7 @@ DisposeWindowOptional(WindowPtr pWin)
         pWin->optional->deviceCursors = NULL;
     }
 
+    WindowIndexDestroy(pWin);
     free(pWin->optional);
     pWin->optional = NULL;
 }
@@ -1098,6 +1105,7 @@ DeleteWindow(void *value, XID wid)
             pWin->nextSib->prevSib = pWin->prevSib;
         if (pWin->prevSib)
             pWin->prevSib->nextSib = pWin->nextSib;
+        WindowIndexInvalidate(pParent);
     }
     else
         pWin->drawable.pScreen->root = NULL;
@@ -1696,6 +1704,7 @@ MoveWindowInStack(WindowPtr pWin, WindowPtr pNextSib)
                     pFirstChange = pFirstChange->nextSib;
             }
         }
+        WindowIndexInvalidate(pParent);
         if (pWin->drawable.pScreen->RestackWindow)
             (*pWin->drawable.pScreen->RestackWindow) (pWin, pOldNextSib);
     }
@@ -1788,6 +1797,9 @@ SetBorderSize(WindowPtr pWin)
     else {
         RegionCopy(&pWin->borderSize, &pWin->winSize);
     }
+
+    /* every change of position or size ends up here */
+    WindowIndexUpdate(pWin);
 }
 
 /**
@@ -2551,6 +2563,7 @@ ReparentWindow(WindowPtr pWin, WindowPtr pParent,
         pWin->nextSib->prevSib = pWin->prevSib;
     if (pWin->prevSib)
         pWin->prevSib->nextSib = pWin->nextSib;
+    WindowIndexInvalidate(pPrev);
 
     /* insert at beginning of pParent */
     pWin->parent = pParent;
@@ -2573,6 +2586,7 @@ ReparentWindow(WindowPtr pWin, WindowPtr pParent,
             pParent->lastChild = pWin;
         pParent->firstChild = pWin;
     }
+    WindowIndexInvalidate(pParent);
 
     pWin->origin.x = x + bw;
     pWin->origin.y = y + bw;
@@ -2680,6 +2694,7 @@ MapWindow(WindowPtr pWin, ClientPtr client)
                 return Success;
 
         pWin->mapped = TRUE;
+        WindowIndexUpdate(pWin);
         if (SubStrSend(pWin, pParent))
             DeliverMapNotify(pWin);
 
@@ -2748,6 +2763,7 @@ MapSubwindows(WindowPtr pParent, ClientPtr client)
                     continue;
 
             pWin->mapped = TRUE;
+            WindowIndexUpdate(pWin);
             if (parentNotify || StrSend(pWin))
                 DeliverMapNotify(pWin);
 
@@ -2864,6 +2880,7 @@ UnmapWindow(WindowPtr pWin, Bool fromConfigure)
         (*pScreen->MarkWindow) (pLayerWin->parent);
     }
     pWin->mapped = FALSE;
+    WindowIndexUpdate(pWin);
     if (wasRealized)
         UnrealizeTree(pWin, fromConfigure);
     if (wasViewable && !fromConfigure) {
@@ -2913,6 +2930,7 @@ UnmapSubwindows(WindowPtr pWin)
                 anyMarked = TRUE;
             }
             pChild->mapped = FALSE;
+            WindowIndexUpdate(pChild);
             if (pChild->realized)
                 UnrealizeTree(pChild, FALSE);
         }
@@ -2972,8 +2990,10 @@ HandleSaveSet(ClientPtr client)
                                pParent->drawable.x,
                                pWin->drawable.y - wBorderWidth(pWin) -
                                pParent->drawable.y, client);
-                if (!pWin->realized && pWin->mapped)
+                if (!pWin->realized && pWin->mapped) {
                     pWin->mapped = FALSE;
+                    WindowIndexUpdate(pWin);
+                }
             }
             if (SaveSetShouldMap(client->saveSet[j]))
                 MapWindow(pWin, client);
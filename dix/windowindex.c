@@ -0,0 +1,381 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The grid covers the parent's inside, split into at most
+ * WINDOW_INDEX_GRID cells each way, in coordinates relative to the parent
+ * so that moving the parent leaves it alone.  Each child gets a slot
+ * number from its place in the stacking order, topmost first, and each
+ * cell keeps the sorted slots of the mapped children whose border box
+ * touches it.  Whatever sticks out of the grid goes into the edge cells,
+ * and points outside it are looked up there, so the grid never has to
+ * follow the parent's size; it only gets coarser than it needs to be.
+ */
+
+#include <dix-config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dix/windowindex_priv.h"
+
+#include "misc.h"
+#include "privates.h"
+#include "window.h"
+#include "windowstr.h"
+
+#define WINDOW_INDEX_GRID 32
+#define WINDOW_INDEX_MIN_CELL 64
+
+typedef struct _WindowIndexItem {
+    WindowPtr pWin;
+    short x1, y1, x2, y2;       /* cells it is in, x1 > x2 if none */
+} WindowIndexItemRec, *WindowIndexItemPtr;
+
+typedef struct _WindowIndexCell {
+    int num;
+    int size;
+    int *slots;
+} WindowIndexCellRec, *WindowIndexCellPtr;
+
+typedef struct _WindowIndex {
+    Bool dirty;
+    int numItems;
+    int sizeItems;
+    WindowIndexItemPtr items;
+    int cellWidth, cellHeight;
+    int cols, rows;
+    WindowIndexCellPtr cells;
+} WindowIndexRec, *WindowIndexPtr;
+
+/* What a window keeps in its private, rather than in WindowRec */
+typedef struct _WindowIndexPriv {
+    WindowIndexPtr children;    /* index of its children, or NULL */
+    int slot;                   /* its place in its parent's index */
+} WindowIndexPrivRec, *WindowIndexPrivPtr;
+
+DevPrivateKeyRec WindowIndexKeyRec;
+
+Bool
+WindowIndexInit(void)
+{
+    return dixRegisterPrivateKey(&WindowIndexKeyRec, PRIVATE_WINDOW,
+                                 sizeof(WindowIndexPrivRec));
+}
+
+static inline WindowIndexPrivPtr
+WindowIndexPriv(WindowPtr pWin)
+{
+    return dixLookupPrivate(&pWin->devPrivates, &WindowIndexKeyRec);
+}
+
+static inline WindowIndexPtr
+WindowIndexGet(WindowPtr pParent)
+{
+    return pParent ? WindowIndexPriv(pParent)->children : NULL;
+}
+
+static inline int
+WindowIndexCol(WindowIndexPtr pIndex, int x)
+{
+    if (x < 0)
+        return 0;
+    return min(x / pIndex->cellWidth, pIndex->cols - 1);
+}
+
+static inline int
+WindowIndexRow(WindowIndexPtr pIndex, int y)
+{
+    if (y < 0)
+        return 0;
+    return min(y / pIndex->cellHeight, pIndex->rows - 1);
+}
+
+/* Work out which cells pWin belongs in, from its current geometry */
+static void
+WindowIndexCells(WindowIndexPtr pIndex, WindowPtr pWin,
+                 WindowIndexItemPtr item)
+{
+    WindowPtr pParent = pWin->parent;
+    int bw = wBorderWidth(pWin);
+    int x, y;
+
+    if (!pWin->mapped) {
+        item->x1 = item->y1 = 1;
+        item->x2 = item->y2 = 0;
+        return;
+    }
+    x = pWin->drawable.x - pParent->drawable.x;
+    y = pWin->drawable.y - pParent->drawable.y;
+    item->x1 = WindowIndexCol(pIndex, x - bw);
+    item->y1 = WindowIndexRow(pIndex, y - bw);
+    item->x2 = WindowIndexCol(pIndex, x + (int) pWin->drawable.width + bw - 1);
+    item->y2 = WindowIndexRow(pIndex, y + (int) pWin->drawable.height + bw - 1);
+}
+
+static Bool
+WindowIndexCellInsert(WindowIndexCellPtr cell, int slot)
+{
+    int lo = 0, hi = cell->num;
+
+    if (cell->num == cell->size) {
+        int size = cell->size ? cell->size * 2 : 8;
+        int *slots = reallocarray(cell->slots, size, sizeof(int));
+
+        if (!slots)
+            return FALSE;
+        cell->slots = slots;
+        cell->size = size;
+    }
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+
+        if (cell->slots[mid] < slot)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    memmove(&cell->slots[lo + 1], &cell->slots[lo],
+            (cell->num - lo) * sizeof(int));
+    cell->slots[lo] = slot;
+    cell->num++;
+    return TRUE;
+}
+
+static void
+WindowIndexCellRemove(WindowIndexCellPtr cell, int slot)
+{
+    int lo = 0, hi = cell->num;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+
+        if (cell->slots[mid] < slot)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == cell->num || cell->slots[lo] != slot)
+        return;
+    cell->num--;
+    memmove(&cell->slots[lo], &cell->slots[lo + 1],
+            (cell->num - lo) * sizeof(int));
+}
+
+static Bool
+WindowIndexAddItem(WindowIndexPtr pIndex, int slot)
+{
+    WindowIndexItemPtr item = &pIndex->items[slot];
+    int x, y;
+
+    for (y = item->y1; y <= item->y2; y++)
+        for (x = item->x1; x <= item->x2; x++)
+            if (!WindowIndexCellInsert(&pIndex->cells[y * pIndex->cols + x],
+                                       slot))
+                return FALSE;
+    return TRUE;
+}
+
+static void
+WindowIndexRemoveItem(WindowIndexPtr pIndex, int slot)
+{
+    WindowIndexItemPtr item = &pIndex->items[slot];
+    int x, y;
+
+    for (y = item->y1; y <= item->y2; y++)
+        for (x = item->x1; x <= item->x2; x++)
+            WindowIndexCellRemove(&pIndex->cells[y * pIndex->cols + x], slot);
+}
+
+static void
+WindowIndexFree(WindowIndexPtr pIndex)
+{
+    int i;
+
+    if (pIndex->cells)
+        for (i = 0; i < pIndex->cols * pIndex->rows; i++)
+            free(pIndex->cells[i].slots);
+    free(pIndex->cells);
+    free(pIndex->items);
+    free(pIndex);
+}
+
+/* Start over from pParent's list of children; FALSE if not worth it */
+static Bool
+WindowIndexBuild(WindowPtr pParent, WindowIndexPtr pIndex)
+{
+    int width = max((int) pParent->drawable.width, 1);
+    int height = max((int) pParent->drawable.height, 1);
+    int cols, rows, count = 0, i;
+    WindowPtr pWin;
+
+    for (pWin = pParent->firstChild; pWin; pWin = pWin->nextSib)
+        count++;
+    if (count < WINDOW_INDEX_MIN_CHILDREN / 2)
+        return FALSE;
+
+    if (count > pIndex->sizeItems) {
+        WindowIndexItemPtr items;
+
+        items = reallocarray(pIndex->items, count, sizeof(WindowIndexItemRec));
+        if (!items)
+            return FALSE;
+        pIndex->items = items;
+        pIndex->sizeItems = count;
+    }
+
+    cols = min(WINDOW_INDEX_GRID,
+               (width + WINDOW_INDEX_MIN_CELL - 1) / WINDOW_INDEX_MIN_CELL);
+    rows = min(WINDOW_INDEX_GRID,
+               (height + WINDOW_INDEX_MIN_CELL - 1) / WINDOW_INDEX_MIN_CELL);
+    if (cols != pIndex->cols || rows != pIndex->rows) {
+        WindowIndexCellPtr cells = calloc(cols * rows,
+                                          sizeof(WindowIndexCellRec));
+
+        if (!cells)
+            return FALSE;
+        if (pIndex->cells)
+            for (i = 0; i < pIndex->cols * pIndex->rows; i++)
+                free(pIndex->cells[i].slots);
+        free(pIndex->cells);
+        pIndex->cells = cells;
+        pIndex->cols = cols;
+        pIndex->rows = rows;
+    }
+    else {
+        for (i = 0; i < cols * rows; i++)
+            pIndex->cells[i].num = 0;
+    }
+    pIndex->cellWidth = (width + cols - 1) / cols;
+    pIndex->cellHeight = (height + rows - 1) / rows;
+
+    /* slots go up from the top, so appending keeps the cells sorted */
+    pIndex->numItems = count;
+    for (pWin = pParent->firstChild, i = 0; pWin; pWin = pWin->nextSib, i++) {
+        WindowIndexPriv(pWin)->slot = i;
+        pIndex->items[i].pWin = pWin;
+        WindowIndexCells(pIndex, pWin, &pIndex->items[i]);
+        if (!WindowIndexAddItem(pIndex, i))
+            return FALSE;
+    }
+    pIndex->dirty = FALSE;
+    return TRUE;
+}
+
+Bool
+WindowIndexCreate(WindowPtr pParent)
+{
+    WindowIndexPtr pIndex;
+
+    if (WindowIndexGet(pParent))
+        return TRUE;
+    pIndex = calloc(1, sizeof(WindowIndexRec));
+    if (!pIndex)
+        return FALSE;
+    pIndex->dirty = TRUE;
+    WindowIndexPriv(pParent)->children = pIndex;
+    return TRUE;
+}
+
+void
+WindowIndexDestroy(WindowPtr pParent)
+{
+    WindowIndexPtr pIndex = WindowIndexGet(pParent);
+
+    if (pIndex) {
+        WindowIndexFree(pIndex);
+        WindowIndexPriv(pParent)->children = NULL;
+    }
+}
+
+void
+WindowIndexInvalidate(WindowPtr pParent)
+{
+    WindowIndexPtr pIndex = WindowIndexGet(pParent);
+
+    if (pIndex)
+        pIndex->dirty = TRUE;
+}
+
+void
+WindowIndexUpdate(WindowPtr pWin)
+{
+    WindowIndexPtr pIndex = WindowIndexGet(pWin->parent);
+    WindowIndexItemRec cells;
+    WindowIndexItemPtr item;
+    int slot;
+
+    if (!pIndex || pIndex->dirty)
+        return;
+
+    slot = WindowIndexPriv(pWin)->slot;
+    if (slot < 0 || slot >= pIndex->numItems ||
+        pIndex->items[slot].pWin != pWin) {
+        pIndex->dirty = TRUE;
+        return;
+    }
+
+    item = &pIndex->items[slot];
+    WindowIndexCells(pIndex, pWin, &cells);
+    if (cells.x1 == item->x1 && cells.y1 == item->y1 &&
+        cells.x2 == item->x2 && cells.y2 == item->y2)
+        return;
+
+    WindowIndexRemoveItem(pIndex, slot);
+    item->x1 = cells.x1;
+    item->y1 = cells.y1;
+    item->x2 = cells.x2;
+    item->y2 = cells.y2;
+    if (!WindowIndexAddItem(pIndex, slot))
+        pIndex->dirty = TRUE;
+}
+
+Bool
+WindowIndexPick(WindowPtr pParent, int x, int y,
+                WindowIndexHitProcPtr hit, WindowPtr *ppWin)
+{
+    WindowIndexPtr pIndex = WindowIndexGet(pParent);
+    WindowIndexCellPtr cell;
+    int i;
+
+    if (!pIndex)
+        return FALSE;
+    if (pIndex->dirty && !WindowIndexBuild(pParent, pIndex)) {
+        WindowIndexDestroy(pParent);
+        return FALSE;
+    }
+
+    cell = &pIndex->cells[WindowIndexRow(pIndex, y - pParent->drawable.y) *
+                          pIndex->cols +
+                          WindowIndexCol(pIndex, x - pParent->drawable.x)];
+    for (i = 0; i < cell->num; i++) {
+        WindowPtr pWin = pIndex->items[cell->slots[i]].pWin;
+
+        if (hit(pWin, x, y)) {
+            *ppWin = pWin;
+            return TRUE;
+        }
+    }
+    *ppWin = NullWindow;
+    return TRUE;
+}
@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Copyright © 2026 X.Org Foundation
+ */
+#ifndef _XSERVER_DIX_WINDOWINDEX_PRIV_H
+#define _XSERVER_DIX_WINDOWINDEX_PRIV_H
+
+#include "privates.h"
+#include "windowstr.h"
+
+/*
+ * Grid of a window's mapped children, for finding the ones under the
+ * pointer without walking all of them.  Only worth having on windows with
+ * lots of children, so it is created by whoever does the walking once they
+ * see that many, and dropped again when the window loses most of them.
+ *
+ * Mapping, unmapping, moving and resizing a child update the grid in
+ * place; creating, destroying, reparenting and restacking children make it
+ * get rebuilt on the next WindowIndexPick().
+ */
+
+/* Children seen on a walk before it is worth creating an index. */
+#define WINDOW_INDEX_MIN_CHILDREN 64
+
+typedef Bool (*WindowIndexHitProcPtr) (WindowPtr pWin, int x, int y);
+
+/* Windows keep their index and their place in their parent's here. */
+extern DevPrivateKeyRec WindowIndexKeyRec;
+
+/* Register the window private; before any window is created. */
+Bool WindowIndexInit(void);
+
+/* Give pParent an index of its children; FALSE if out of memory. */
+Bool WindowIndexCreate(WindowPtr pParent);
+
+/* Free pParent's index, if it has one. */
+void WindowIndexDestroy(WindowPtr pParent);
+
+/* pParent's children were added, removed or restacked. */
+void WindowIndexInvalidate(WindowPtr pParent);
+
+/* pWin was mapped, unmapped, moved or resized. */
+void WindowIndexUpdate(WindowPtr pWin);
+
+/*
+ * Find the topmost child of pParent whose border box contains x,y (in
+ * screen coordinates) and that hit() accepts, or NULL.  FALSE if pParent
+ * has no index, so its children need to be walked instead.
+ */
+Bool WindowIndexPick(WindowPtr pParent, int x, int y,
+                     WindowIndexHitProcPtr hit, WindowPtr *ppWin);
+
+#endif /* _XSERVER_DIX_WINDOWINDEX_PRIV_H */
@@ -392,9 +392,15 @@ typedef void (*FinishWrapProcPtr) (DrawablePtr pDraw);
 #define fbFinishAccess(pDraw) \
 	fbGetScreenPrivate((pDraw)->pScreen)->finishWrap(pDraw)
 
+#define fbBatchAccess(pDraw)
+
 #else
 
-#define fbPrepareAccess(pPix)
+/* Draw what fbbatch.c recorded if it involves the pixels of pDraw */
+extern _X_EXPORT void
+ fbBatchAccess(DrawablePtr pDraw);
+
+#define fbPrepareAccess(pDraw) fbBatchAccess(pDraw)
 #define fbFinishAccess(pDraw)
 
 #endif
@@ -519,6 +525,16 @@ fbAllocatePrivates(ScreenPtr pScreen);
 extern _X_EXPORT void
 fbPolyArc(DrawablePtr pDrawable, GCPtr pGC, int narcs, xArc * parcs);
 
+/*
+ * fbbatch.c
+ */
+
+extern _X_EXPORT Bool
+ fbBatchInit(ScreenPtr pScreen);
+
+extern _X_EXPORT void
+ fbBatchFlush(void);
+
 /*
  * fbbits.c
  */
@@ -713,6 +729,19 @@ fbBltPlane(FbBits * src,
            FbStip fgand,
            FbStip fgxor, FbStip bgand, FbStip bgxor, Pixel planeMask);
 
+extern _X_EXPORT void
+
+fbBltXYPlanes(FbStip * src,
+              FbStride srcStride,
+              FbStride planeStride,
+              int srcX,
+              int depth,
+              FbBits * dst,
+              FbStride dstStride,
+              int dstX,
+              int dstBpp,
+              int width, int height, int alu, Pixel planeMask);
+
 /*
  * fbcmap_mi.c
  */
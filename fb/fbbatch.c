@@ -0,0 +1,614 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Small solid fills, copies between pixmaps and Render composites are
+ * recorded instead of drawn, as long as each one is like the last: same
+ * destination, same fill or source, same rop.  A run of them is then
+ * drawn in one go, setting up the bits or the pixman images once instead
+ * of for every operation.
+ *
+ * The recorded operations are drawn before anything else gets at the
+ * pixels they read or write: every fb access to a drawable goes through
+ * fbPrepareAccess(), which checks the pixmap against the ones recorded.
+ * A pixmap going away or getting new bits, a Render picture of the run
+ * changing or going away, a different operation, output to a client and
+ * going to sleep do the same, so neither fb nor clients can tell the
+ * drawing came late.
+ *
+ * Only screens whose DDX asks for it with fbBatchInit() record: it is for
+ * pixmaps that live in plain memory and are only ever touched by fb.
+ * Drivers that map pixmaps around fb calls, or read the frame buffer
+ * behind fb's back, would see the drawing too late.
+ */
+
+#include <dix-config.h>
+
+#include "fb.h"
+#include "fbpriv.h"
+
+#define FB_BATCH_OPS 256                /* draw them once this many wait */
+#define FB_BATCH_MAX_PIXELS 4096        /* bigger ones are drawn right away */
+
+typedef enum {
+    FB_BATCH_NONE,
+    FB_BATCH_FILL,
+    FB_BATCH_COPY,
+    FB_BATCH_COMPOSITE,
+} FbBatchKind;
+
+/* An operation, in pixmap coordinates; composites in pixman image ones */
+typedef struct _FbBatchOp {
+    int x, y, width, height;
+    int sx, sy;                 /* source of copies and composites */
+    int mx, my;                 /* mask of composites */
+} FbBatchOpRec, *FbBatchOpPtr;
+
+typedef struct _FbBatchScreen {
+    Bool enabled;
+    CloseScreenProcPtr CloseScreen;
+    ValidatePictureProcPtr ValidatePicture;
+    DestroyPictureProcPtr DestroyPicture;
+    ChangePictureFilterProcPtr ChangePictureFilter;
+    ModifyPixmapHeaderProcPtr ModifyPixmapHeader;
+} FbBatchScreenRec, *FbBatchScreenPtr;
+
+#ifndef FB_ACCESS_WRAPPER
+
+/* Operations recorded and yet to be drawn */
+static Bool fbBatchPending;
+
+static struct {
+    FbBatchKind kind;
+    PixmapPtr pixmaps[3];       /* drawn to first, then read from */
+    int npixmaps;
+
+    /* the bits of the pixmaps as they were recorded */
+    FbBits *bits[3];
+    FbStride strides[3];
+    int bpps[3];
+    int heights[3];
+
+    FbBits and, xor;            /* fills */
+
+    int alu;                    /* copies */
+    FbBits pm;
+
+    CARD8 op;                   /* composites */
+    PicturePtr pSrc, pMask, pDst;
+    pixman_image_t *src, *mask, *dst;
+    int src_xoff, src_yoff;
+    int msk_xoff, msk_yoff;
+    int dst_xoff, dst_yoff;
+
+    int nops;
+    FbBatchOpRec ops[FB_BATCH_OPS];
+} fbBatch;
+
+static DevPrivateKeyRec fbBatchScreenKeyRec;
+static unsigned long fbBatchGeneration;
+
+static inline FbBatchScreenPtr
+fbBatchGetScreen(ScreenPtr pScreen)
+{
+    return dixLookupPrivate(&pScreen->devPrivates, &fbBatchScreenKeyRec);
+}
+
+static inline Bool
+fbBatchEnabled(ScreenPtr pScreen)
+{
+    return dixPrivateKeyRegistered(&fbBatchScreenKeyRec) &&
+        fbBatchGetScreen(pScreen)->enabled;
+}
+
+/* fbGetDrawablePixmap(), without drawing the recorded operations */
+static PixmapPtr
+fbBatchPixmap(DrawablePtr pDrawable, int *xoff, int *yoff)
+{
+    PixmapPtr pPixmap;
+
+    if (pDrawable->type != DRAWABLE_PIXMAP) {
+        pPixmap = fbGetWindowPixmap(pDrawable);
+        *xoff = __fbPixOffXWin(pPixmap);
+        *yoff = __fbPixOffYWin(pPixmap);
+    }
+    else {
+        pPixmap = (PixmapPtr) pDrawable;
+        *xoff = __fbPixOffXPix(pPixmap);
+        *yoff = __fbPixOffYPix(pPixmap);
+    }
+    return pPixmap;
+}
+
+static Bool
+fbBatchOverlap(PixmapPtr a, PixmapPtr b)
+{
+    return a == b ||
+        fbBitsOverlap(a->devPrivate.ptr, a->devKind, a->drawable.height,
+                      b->devPrivate.ptr, b->devKind, b->drawable.height);
+}
+
+/*
+ * Operations are drawn with the bits the pixmaps had when they were
+ * recorded: a scratch pixmap header loses its bits before it is
+ * destroyed, which is what draws the operations reading from it.
+ */
+static void
+fbBatchSetPixmap(int i, PixmapPtr pPixmap)
+{
+    fbBatch.pixmaps[i] = pPixmap;
+    fbGetPixmapBitsData(pPixmap, fbBatch.bits[i], fbBatch.strides[i],
+                        fbBatch.bpps[i]);
+    fbBatch.heights[i] = pPixmap->drawable.height;
+}
+
+static void
+fbBatchDrawFills(void)
+{
+    FbBits *dst = fbBatch.bits[0];
+    FbStride dstStride = fbBatch.strides[0];
+    int dstBpp = fbBatch.bpps[0];
+    int i;
+
+    for (i = 0; i < fbBatch.nops; i++) {
+        FbBatchOpPtr op = &fbBatch.ops[i];
+
+        if (fbBatch.and || !pixman_fill((uint32_t *) dst, dstStride, dstBpp,
+                                        op->x, op->y, op->width, op->height,
+                                        fbBatch.xor))
+            fbSolid(dst + op->y * dstStride, dstStride,
+                    op->x * dstBpp, dstBpp, op->width * dstBpp, op->height,
+                    fbBatch.and, fbBatch.xor);
+    }
+}
+
+static void
+fbBatchDrawCopies(void)
+{
+    FbBits *dst = fbBatch.bits[0], *src = fbBatch.bits[1];
+    FbStride dstStride = fbBatch.strides[0], srcStride = fbBatch.strides[1];
+    int dstBpp = fbBatch.bpps[0], srcBpp = fbBatch.bpps[1];
+    int i;
+
+    for (i = 0; i < fbBatch.nops; i++) {
+        FbBatchOpPtr op = &fbBatch.ops[i];
+
+        if (fbBatch.pm == FB_ALLONES && fbBatch.alu == GXcopy &&
+            pixman_blt((uint32_t *) src, (uint32_t *) dst,
+                       srcStride, dstStride, srcBpp, dstBpp,
+                       op->sx, op->sy, op->x, op->y, op->width, op->height))
+            continue;
+        fbBlt(src + op->sy * srcStride, srcStride, op->sx * srcBpp,
+              dst + op->y * dstStride, dstStride, op->x * dstBpp,
+              op->width * dstBpp, op->height,
+              fbBatch.alu, fbBatch.pm, dstBpp, FALSE, FALSE);
+    }
+}
+
+static void
+fbBatchDrawComposites(void)
+{
+    int i;
+
+    for (i = 0; i < fbBatch.nops; i++) {
+        FbBatchOpPtr op = &fbBatch.ops[i];
+
+        pixman_image_composite(fbBatch.op, fbBatch.src, fbBatch.mask,
+                               fbBatch.dst, op->sx, op->sy, op->mx, op->my,
+                               op->x, op->y, op->width, op->height);
+    }
+
+    free_pixman_pict(fbBatch.pSrc, fbBatch.src);
+    free_pixman_pict(fbBatch.pMask, fbBatch.mask);
+    free_pixman_pict(fbBatch.pDst, fbBatch.dst);
+    fbBatch.src = fbBatch.mask = fbBatch.dst = NULL;
+    fbBatch.pSrc = fbBatch.pMask = fbBatch.pDst = NULL;
+}
+
+void
+fbBatchFlush(void)
+{
+    if (!fbBatchPending)
+        return;
+    fbBatchPending = FALSE;
+
+    switch (fbBatch.kind) {
+    case FB_BATCH_FILL:
+        fbBatchDrawFills();
+        break;
+    case FB_BATCH_COPY:
+        fbBatchDrawCopies();
+        break;
+    case FB_BATCH_COMPOSITE:
+        fbBatchDrawComposites();
+        break;
+    case FB_BATCH_NONE:
+        break;
+    }
+
+    fbBatch.kind = FB_BATCH_NONE;
+    fbBatch.npixmaps = 0;
+    fbBatch.nops = 0;
+}
+
+void
+fbBatchAccess(DrawablePtr pDrawable)
+{
+    PixmapPtr pPixmap;
+    int xoff, yoff;
+    int i;
+
+    if (!fbBatchPending)
+        return;
+    pPixmap = fbBatchPixmap(pDrawable, &xoff, &yoff);
+    for (i = 0; i < fbBatch.npixmaps; i++) {
+        if (pPixmap == fbBatch.pixmaps[i] ||
+            fbBitsOverlap(pPixmap->devPrivate.ptr, pPixmap->devKind,
+                          pPixmap->drawable.height,
+                          fbBatch.bits[i],
+                          fbBatch.strides[i] * (int) sizeof(FbBits),
+                          fbBatch.heights[i])) {
+            fbBatchFlush();
+            return;
+        }
+    }
+}
+
+/* Room for nops more operations like the recorded ones, or start over */
+static Bool
+fbBatchContinue(Bool same, int nops)
+{
+    if (fbBatchPending && same && fbBatch.nops + nops <= FB_BATCH_OPS)
+        return TRUE;
+    fbBatchFlush();
+    return FALSE;
+}
+
+static FbBatchOpPtr
+fbBatchAdd(void)
+{
+    fbBatchPending = TRUE;
+    return &fbBatch.ops[fbBatch.nops++];
+}
+
+Bool
+fbBatchFill(DrawablePtr pDrawable, GCPtr pGC,
+            int x, int y, int width, int height)
+{
+    FbGCPrivPtr pPriv = fbGetGCPrivate(pGC);
+    PixmapPtr pPixmap;
+    int xoff, yoff;
+    FbBatchOpPtr op;
+
+    if (!fbBatchEnabled(pDrawable->pScreen) ||
+        width * height > FB_BATCH_MAX_PIXELS)
+        return FALSE;
+
+    pPixmap = fbBatchPixmap(pDrawable, &xoff, &yoff);
+    if (!fbBatchContinue(fbBatch.kind == FB_BATCH_FILL &&
+                         fbBatch.pixmaps[0] == pPixmap &&
+                         fbBatch.and == pPriv->and &&
+                         fbBatch.xor == pPriv->xor, 1)) {
+        fbBatch.kind = FB_BATCH_FILL;
+        fbBatchSetPixmap(0, pPixmap);
+        fbBatch.npixmaps = 1;
+        fbBatch.and = pPriv->and;
+        fbBatch.xor = pPriv->xor;
+    }
+
+    op = fbBatchAdd();
+    op->x = x + xoff;
+    op->y = y + yoff;
+    op->width = width;
+    op->height = height;
+    return TRUE;
+}
+
+Bool
+fbBatchCopy(DrawablePtr pSrcDrawable, DrawablePtr pDstDrawable, GCPtr pGC,
+            BoxPtr pbox, int nbox, int dx, int dy)
+{
+    int alu = pGC ? pGC->alu : GXcopy;
+    FbBits pm = pGC ? fbGetGCPrivate(pGC)->pm : FB_ALLONES;
+    PixmapPtr pSrcPixmap, pDstPixmap;
+    int srcXoff, srcYoff, dstXoff, dstYoff;
+    int pixels = 0;
+    int i;
+
+    if (!fbBatchEnabled(pDstDrawable->pScreen) || nbox > FB_BATCH_OPS)
+        return FALSE;
+    for (i = 0; i < nbox; i++) {
+        pixels += (pbox[i].x2 - pbox[i].x1) * (pbox[i].y2 - pbox[i].y1);
+        if (pixels > FB_BATCH_MAX_PIXELS)
+            return FALSE;
+    }
+
+    /* copies within a pixmap depend on the order of the boxes */
+    pSrcPixmap = fbBatchPixmap(pSrcDrawable, &srcXoff, &srcYoff);
+    pDstPixmap = fbBatchPixmap(pDstDrawable, &dstXoff, &dstYoff);
+    if (fbBatchOverlap(pSrcPixmap, pDstPixmap))
+        return FALSE;
+
+    if (!fbBatchContinue(fbBatch.kind == FB_BATCH_COPY &&
+                         fbBatch.pixmaps[0] == pDstPixmap &&
+                         fbBatch.pixmaps[1] == pSrcPixmap &&
+                         fbBatch.alu == alu && fbBatch.pm == pm, nbox)) {
+        fbBatch.kind = FB_BATCH_COPY;
+        fbBatchSetPixmap(0, pDstPixmap);
+        fbBatchSetPixmap(1, pSrcPixmap);
+        fbBatch.npixmaps = 2;
+        fbBatch.alu = alu;
+        fbBatch.pm = pm;
+    }
+
+    for (i = 0; i < nbox; i++) {
+        FbBatchOpPtr op = fbBatchAdd();
+
+        op->x = pbox[i].x1 + dstXoff;
+        op->y = pbox[i].y1 + dstYoff;
+        op->width = pbox[i].x2 - pbox[i].x1;
+        op->height = pbox[i].y2 - pbox[i].y1;
+        op->sx = pbox[i].x1 + dx + srcXoff;
+        op->sy = pbox[i].y1 + dy + srcYoff;
+    }
+    return TRUE;
+}
+
+Bool
+fbBatchComposite(CARD8 op, PicturePtr pSrc, PicturePtr pMask, PicturePtr pDst,
+                 INT16 xSrc, INT16 ySrc, INT16 xMask, INT16 yMask,
+                 INT16 xDst, INT16 yDst, CARD16 width, CARD16 height)
+{
+    FbBatchOpPtr bop;
+    int xoff, yoff;
+
+    if (!fbBatchEnabled(pDst->pDrawable->pScreen) ||
+        (int64_t) width * height > FB_BATCH_MAX_PIXELS)
+        return FALSE;
+
+    /* source pictures change without telling the screen */
+    if (!pSrc->pDrawable || (pMask && !pMask->pDrawable))
+        return FALSE;
+    if (pSrc->alphaMap || (pMask && pMask->alphaMap) || pDst->alphaMap)
+        return FALSE;
+
+    if (!fbBatchContinue(fbBatch.kind == FB_BATCH_COMPOSITE &&
+                         fbBatch.op == op && fbBatch.pSrc == pSrc &&
+                         fbBatch.pMask == pMask && fbBatch.pDst == pDst, 1)) {
+        fbBatch.src = fbPictureImage(pSrc, FALSE,
+                                     &fbBatch.src_xoff, &fbBatch.src_yoff);
+        fbBatch.mask = fbPictureImage(pMask, FALSE,
+                                      &fbBatch.msk_xoff, &fbBatch.msk_yoff);
+        fbBatch.dst = fbPictureImage(pDst, TRUE,
+                                     &fbBatch.dst_xoff, &fbBatch.dst_yoff);
+        if (!fbBatch.src || !fbBatch.dst || (pMask && !fbBatch.mask)) {
+            free_pixman_pict(pSrc, fbBatch.src);
+            free_pixman_pict(pMask, fbBatch.mask);
+            free_pixman_pict(pDst, fbBatch.dst);
+            fbBatch.src = fbBatch.mask = fbBatch.dst = NULL;
+            return FALSE;
+        }
+
+        fbBatch.kind = FB_BATCH_COMPOSITE;
+        fbBatch.op = op;
+        fbBatch.pSrc = pSrc;
+        fbBatch.pMask = pMask;
+        fbBatch.pDst = pDst;
+        fbBatch.npixmaps = 0;
+        fbBatchSetPixmap(fbBatch.npixmaps++,
+                         fbBatchPixmap(pDst->pDrawable, &xoff, &yoff));
+        fbBatchSetPixmap(fbBatch.npixmaps++,
+                         fbBatchPixmap(pSrc->pDrawable, &xoff, &yoff));
+        if (pMask)
+            fbBatchSetPixmap(fbBatch.npixmaps++,
+                             fbBatchPixmap(pMask->pDrawable, &xoff, &yoff));
+    }
+
+    bop = fbBatchAdd();
+    bop->sx = xSrc + fbBatch.src_xoff;
+    bop->sy = ySrc + fbBatch.src_yoff;
+    bop->mx = xMask + fbBatch.msk_xoff;
+    bop->my = yMask + fbBatch.msk_yoff;
+    bop->x = xDst + fbBatch.dst_xoff;
+    bop->y = yDst + fbBatch.dst_yoff;
+    bop->width = width;
+    bop->height = height;
+    return TRUE;
+}
+
+/* The images of a run are made from the pictures as they were */
+static void
+fbBatchPicture(PicturePtr pPicture)
+{
+    if (fbBatch.kind == FB_BATCH_COMPOSITE &&
+        (pPicture == fbBatch.pSrc || pPicture == fbBatch.pMask ||
+         pPicture == fbBatch.pDst))
+        fbBatchFlush();
+}
+
+static void
+fbBatchValidatePicture(PicturePtr pPicture, Mask mask)
+{
+    ScreenPtr pScreen = pPicture->pDrawable->pScreen;
+    PictureScreenPtr ps = GetPictureScreen(pScreen);
+    FbBatchScreenPtr bs = fbBatchGetScreen(pScreen);
+
+    fbBatchPicture(pPicture);
+    ps->ValidatePicture = bs->ValidatePicture;
+    (*ps->ValidatePicture) (pPicture, mask);
+    ps->ValidatePicture = fbBatchValidatePicture;
+}
+
+static void
+fbBatchDestroyPicture(PicturePtr pPicture)
+{
+    ScreenPtr pScreen = pPicture->pDrawable->pScreen;
+    PictureScreenPtr ps = GetPictureScreen(pScreen);
+    FbBatchScreenPtr bs = fbBatchGetScreen(pScreen);
+
+    fbBatchPicture(pPicture);
+    ps->DestroyPicture = bs->DestroyPicture;
+    (*ps->DestroyPicture) (pPicture);
+    ps->DestroyPicture = fbBatchDestroyPicture;
+}
+
+static int
+fbBatchChangePictureFilter(PicturePtr pPicture,
+                           int filter, xFixed * params, int nparams)
+{
+    ScreenPtr pScreen = pPicture->pDrawable->pScreen;
+    PictureScreenPtr ps = GetPictureScreen(pScreen);
+    FbBatchScreenPtr bs = fbBatchGetScreen(pScreen);
+    int ret;
+
+    fbBatchPicture(pPicture);
+    ps->ChangePictureFilter = bs->ChangePictureFilter;
+    ret = (*ps->ChangePictureFilter) (pPicture, filter, params, nparams);
+    ps->ChangePictureFilter = fbBatchChangePictureFilter;
+    return ret;
+}
+
+/* New bits, or a scratch header about to be reused */
+static Bool
+fbBatchModifyPixmapHeader(PixmapPtr pPixmap, int width, int height,
+                          int depth, int bitsPerPixel, int devKind,
+                          void *pPixData)
+{
+    ScreenPtr pScreen = pPixmap->drawable.pScreen;
+    FbBatchScreenPtr bs = fbBatchGetScreen(pScreen);
+    Bool ret;
+
+    fbBatchAccess(&pPixmap->drawable);
+    pScreen->ModifyPixmapHeader = bs->ModifyPixmapHeader;
+    ret = (*pScreen->ModifyPixmapHeader) (pPixmap, width, height, depth,
+                                          bitsPerPixel, devKind, pPixData);
+    pScreen->ModifyPixmapHeader = fbBatchModifyPixmapHeader;
+    return ret;
+}
+
+static Bool
+fbBatchCloseScreen(ScreenPtr pScreen)
+{
+    PictureScreenPtr ps = GetPictureScreenIfSet(pScreen);
+    FbBatchScreenPtr bs = fbBatchGetScreen(pScreen);
+
+    fbBatchFlush();
+    if (ps) {
+        ps->ValidatePicture = bs->ValidatePicture;
+        ps->DestroyPicture = bs->DestroyPicture;
+        ps->ChangePictureFilter = bs->ChangePictureFilter;
+    }
+    bs->enabled = FALSE;
+
+    pScreen->ModifyPixmapHeader = bs->ModifyPixmapHeader;
+    pScreen->CloseScreen = bs->CloseScreen;
+    return (*pScreen->CloseScreen) (pScreen);
+}
+
+static void
+fbBatchBlockHandler(void *data, void *timeout)
+{
+    fbBatchFlush();
+}
+
+static void
+fbBatchFlushCallback(CallbackListPtr *pcbl, void *closure, void *data)
+{
+    fbBatchFlush();
+}
+
+Bool
+fbBatchInit(ScreenPtr pScreen)
+{
+    PictureScreenPtr ps = GetPictureScreenIfSet(pScreen);
+    FbBatchScreenPtr bs;
+
+    if (!dixRegisterPrivateKey(&fbBatchScreenKeyRec, PRIVATE_SCREEN,
+                               sizeof(FbBatchScreenRec)))
+        return FALSE;
+    bs = fbBatchGetScreen(pScreen);
+
+    if (fbBatchGeneration != serverGeneration) {
+        if (!RegisterBlockAndWakeupHandlers(fbBatchBlockHandler,
+                                            (ServerWakeupHandlerProcPtr) NoopDDA,
+                                            NULL))
+            return FALSE;
+        if (!AddCallback(&FlushCallback, fbBatchFlushCallback, NULL))
+            return FALSE;
+        fbBatchGeneration = serverGeneration;
+    }
+
+    if (ps) {
+        bs->ValidatePicture = ps->ValidatePicture;
+        ps->ValidatePicture = fbBatchValidatePicture;
+        bs->DestroyPicture = ps->DestroyPicture;
+        ps->DestroyPicture = fbBatchDestroyPicture;
+        bs->ChangePictureFilter = ps->ChangePictureFilter;
+        ps->ChangePictureFilter = fbBatchChangePictureFilter;
+    }
+    bs->ModifyPixmapHeader = pScreen->ModifyPixmapHeader;
+    pScreen->ModifyPixmapHeader = fbBatchModifyPixmapHeader;
+    bs->CloseScreen = pScreen->CloseScreen;
+    pScreen->CloseScreen = fbBatchCloseScreen;
+    bs->enabled = TRUE;
+    return TRUE;
+}
+
+#else                           /* FB_ACCESS_WRAPPER */
+
+/* Wrapped pixmaps are only good between the driver's setup and finish */
+
+void
+fbBatchFlush(void)
+{
+}
+
+Bool
+fbBatchFill(DrawablePtr pDrawable, GCPtr pGC,
+            int x, int y, int width, int height)
+{
+    return FALSE;
+}
+
+Bool
+fbBatchCopy(DrawablePtr pSrcDrawable, DrawablePtr pDstDrawable, GCPtr pGC,
+            BoxPtr pbox, int nbox, int dx, int dy)
+{
+    return FALSE;
+}
+
+Bool
+fbBatchComposite(CARD8 op, PicturePtr pSrc, PicturePtr pMask, PicturePtr pDst,
+                 INT16 xSrc, INT16 ySrc, INT16 xMask, INT16 yMask,
+                 INT16 xDst, INT16 yDst, CARD16 width, CARD16 height)
+{
+    return FALSE;
+}
+
+Bool
+fbBatchInit(ScreenPtr pScreen)
+{
+    return FALSE;
+}
+
+#endif                          /* FB_ACCESS_WRAPPER */
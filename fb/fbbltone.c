@@ -22,6 +22,8 @@
 
 #include <dix-config.h>
 
+#include <string.h>
+
 #include "fb.h"
 
 /*
@@ -367,9 +369,113 @@ fbBltOne(FbStip * src, FbStride srcStride,      /* FbStip units per scanline */
     }
 }
 
+/* Bit of a stipple word that pixel x goes to */
+#if BITMAP_BIT_ORDER == LSBFirst
+#define FbStipBitShift(x)	(x)
+#else
+#define FbStipBitShift(x)	(FB_STIP_MASK - (x))
+#endif
+
+/* Byte of eight that fbGatherBits() puts in bit b */
+#if X_BYTE_ORDER == X_LITTLE_ENDIAN
+#define FbGatherByte(b)		(b)
+#else
+#define FbGatherByte(b)		((b) ^ 7)
+#endif
+
+/* The low bits of eight bytes, each 0 or 1, as one: the multiplication
+ * moves them all into the top byte without any carries */
+static inline CARD8
+fbGatherBits(const CARD8 *bytes)
+{
+    uint64_t v;
+
+    memcpy(&v, bytes, sizeof(v));
+    return (v * 0x0102040810204080ULL) >> 56;
+}
+
+/*
+ * The plane bits of n pixels of bpp 8, 16 or 32 as a stipple word,
+ * starting at pixel x of the word.  Each pixel becomes a byte first, in
+ * a loop compilers turn into vector code, then eight bytes at a time
+ * become bits.
+ */
+static inline FbStip
+fbPlaneStip(const void *src, int bpp, int x, int n, FbBits pm)
+{
+    CARD8 on[FB_STIP_UNIT];
+    FbStip bits = 0;
+    int i;
+
+    if (n < FB_STIP_UNIT)
+        memset(on, 0, sizeof(on));
+
+#define FbPlaneBytes(type) {						\
+    const type *s = src;						\
+    for (i = 0; i < n; i++)						\
+	on[FbGatherByte(FbStipBitShift(x + i))] = (READ(s + i) & pm) != 0; \
+}
+    switch (bpp) {
+    case 8:
+        FbPlaneBytes(CARD8);
+        break;
+    case 16:
+        FbPlaneBytes(CARD16);
+        break;
+    case 32:
+        FbPlaneBytes(CARD32);
+        break;
+    }
+#undef FbPlaneBytes
+
+    for (i = 0; i < FB_STIP_UNIT; i += 8)
+        bits |= (FbStip) fbGatherBits(on + i) << i;
+    return bits;
+}
+
+/*
+ * fbBltPlane() for pixels of whole bytes: a destination word at a time
+ * rather than walking masks through source and destination bit by bit.
+ */
+static void
+fbBltPlaneBytes(FbBits * src, FbStride srcStride, int srcX, int srcBpp,
+                FbStip * dst, FbStride dstStride, int dstX,
+                int w, int height,
+                FbStip fgand, FbStip fgxor, FbStip bgand, FbStip bgxor,
+                FbBits pm)
+{
+    while (height--) {
+        CARD8 *s = (CARD8 *) src + (srcX >> 3);
+        FbStip *d = dst;
+        int x = dstX;
+        int wt = w;
+
+        while (wt) {
+            int n = min(wt, FB_STIP_UNIT - x);
+            FbStip bits;
+
+            /* constants for the compiler to unroll the whole words with */
+            if (n == FB_STIP_UNIT)
+                bits = fbPlaneStip(s, srcBpp, 0, FB_STIP_UNIT, pm);
+            else
+                bits = fbPlaneStip(s, srcBpp, x, n, pm);
+
+            WRITE(d, FbStippleRRopMask(READ(d), bits,
+                                       fgand, fgxor, bgand, bgxor,
+                                       FbStipMask(x, n)));
+            d++;
+            s += n * (srcBpp >> 3);
+            wt -= n;
+            x = 0;
+        }
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
 /*
- * Not very efficient, but simple -- copy a single plane
- * from an N bit image to a 1 bit image
+ * Copy a single plane from an N bit image to a 1 bit image.  Not very
+ * efficient, but simple, for pixels that aren't whole bytes.
  */
 
 void
@@ -412,6 +518,12 @@ fbBltPlane(FbBits * src,
     w = width / srcBpp;
 
     pm = fbReplicatePixel(planeMask, srcBpp);
+    if (srcBpp == 8 || srcBpp == 16 || srcBpp == 32) {
+        fbBltPlaneBytes(src, srcStride, srcX, srcBpp, dst, dstStride, dstX,
+                        w, height, fgand, fgxor, bgand, bgxor, pm);
+        return;
+    }
+
     srcMaskFirst = pm & FbBitsMask(srcX, srcBpp);
     srcMask0 = pm & FbBitsMask(0, srcBpp);
 
@@ -459,3 +571,71 @@ fbBltPlane(FbBits * src,
                                        fgand, fgxor, bgand, bgxor, dstUnion));
     }
 }
+
+#define FB_XY_PIXELS 256       /* pixels put together at a time */
+
+/*
+ * The reverse of fbBltPlane() for all planes of an XYPixmap image at
+ * once: put the planes set in planeMask of each row together into pixels
+ * of 8, 16 or 32 bits and draw those with alu.  Raster ops work bit by
+ * bit, so this draws the same as putting each plane in turn, but goes
+ * over the destination once instead of once per plane.  The planes are
+ * planeStride apart in src, the most significant first.
+ */
+void
+fbBltXYPlanes(FbStip * src,
+              FbStride srcStride,
+              FbStride planeStride,
+              int srcX,
+              int depth,
+              FbBits * dst,
+              FbStride dstStride,
+              int dstX,
+              int dstBpp,
+              int width, int height, int alu, Pixel planeMask)
+{
+    CARD32 pixels[FB_XY_PIXELS];
+    int w = width / dstBpp;
+    FbBits pm;
+    int plane, x0, n, i;
+
+    planeMask &= FbFullMask(depth);
+    pm = fbReplicatePixel(planeMask, dstBpp);
+
+    while (height--) {
+        for (x0 = 0; x0 < w; x0 += n) {
+            n = min(w - x0, FB_XY_PIXELS);
+            memset(pixels, 0, n * sizeof(CARD32));
+            for (plane = 0; plane < depth; plane++) {
+                FbStip *s = src + (depth - 1 - plane) * planeStride;
+
+                if (!(planeMask & ((Pixel) 1 << plane)))
+                    continue;
+                for (i = 0; i < n; i++) {
+                    int x = srcX + x0 + i;
+
+                    pixels[i] |= ((s[x >> FB_STIP_SHIFT] >>
+                                   FbStipBitShift(x & FB_STIP_MASK)) & 1) <<
+                        plane;
+                }
+            }
+
+            /* pack for dstBpp in place; each pixel is read before any
+             * write reaches it */
+            if (dstBpp == 8) {
+                for (i = 0; i < n; i++)
+                    ((CARD8 *) pixels)[i] = pixels[i];
+            }
+            else if (dstBpp == 16) {
+                for (i = 0; i < n; i++)
+                    ((CARD16 *) pixels)[i] = pixels[i];
+            }
+
+            fbBlt((FbBits *) pixels, 0, 0, dst, dstStride,
+                  dstX + x0 * dstBpp, n * dstBpp, 1, alu, pm, dstBpp,
+                  FALSE, FALSE);
+        }
+        src += srcStride;
+        dst += dstStride;
+    }
+}
@@ -25,18 +25,9 @@
 #include <stdlib.h>
 
 #include "fb.h"
+#include "fbpriv.h"
 
-void
-fbCopyNtoN(DrawablePtr pSrcDrawable,
-           DrawablePtr pDstDrawable,
-           GCPtr pGC,
-           BoxPtr pbox,
-           int nbox,
-           int dx,
-           int dy, Bool reverse, Bool upsidedown, Pixel bitplane, void *closure)
-{
-    CARD8 alu = pGC ? pGC->alu : GXcopy;
-    FbBits pm = pGC ? fbGetGCPrivate(pGC)->pm : FB_ALLONES;
+typedef struct _FbCopyBands {
     FbBits *src;
     FbStride srcStride;
     int srcBpp;
@@ -45,38 +36,109 @@ fbCopyNtoN(DrawablePtr pSrcDrawable,
     FbStride dstStride;
     int dstBpp;
     int dstXoff, dstYoff;
+    BoxPtr pbox;
+    int nbox;
+    int dx, dy;
+    Bool reverse, upsidedown;
+    CARD8 alu;
+    FbBits pm;
+} FbCopyBandsRec, *FbCopyBandsPtr;
 
-    fbGetDrawable(pSrcDrawable, src, srcStride, srcBpp, srcXoff, srcYoff);
-    fbGetDrawable(pDstDrawable, dst, dstStride, dstBpp, dstXoff, dstYoff);
+/* Copy the part of the boxes within rows y1 to y2. */
+static void
+fbCopyNtoNRows(FbCopyBandsPtr copy, int y1, int y2)
+{
+    BoxPtr pbox = copy->pbox;
+    int nbox = copy->nbox;
 
-    while (nbox--) {
+    for (; nbox--; pbox++) {
+        int by1 = max(pbox->y1, y1);
+        int by2 = min(pbox->y2, y2);
+
+        if (by1 >= by2)
+            continue;
 #ifndef FB_ACCESS_WRAPPER       /* pixman_blt() doesn't support accessors yet */
-        if (pm == FB_ALLONES && alu == GXcopy && !reverse && !upsidedown) {
-            if (!pixman_blt
-                ((uint32_t *) src, (uint32_t *) dst, srcStride, dstStride,
-                 srcBpp, dstBpp, (pbox->x1 + dx + srcXoff),
-                 (pbox->y1 + dy + srcYoff), (pbox->x1 + dstXoff),
-                 (pbox->y1 + dstYoff), (pbox->x2 - pbox->x1),
-                 (pbox->y2 - pbox->y1)))
-                goto fallback;
-            else
-                goto next;
-        }
- fallback:
+        if (copy->pm == FB_ALLONES && copy->alu == GXcopy &&
+            !copy->reverse && !copy->upsidedown &&
+            pixman_blt((uint32_t *) copy->src, (uint32_t *) copy->dst,
+                       copy->srcStride, copy->dstStride,
+                       copy->srcBpp, copy->dstBpp,
+                       (pbox->x1 + copy->dx + copy->srcXoff),
+                       (by1 + copy->dy + copy->srcYoff),
+                       (pbox->x1 + copy->dstXoff), (by1 + copy->dstYoff),
+                       (pbox->x2 - pbox->x1), (by2 - by1)))
+            continue;
 #endif
-        fbBlt(src + (pbox->y1 + dy + srcYoff) * srcStride,
-              srcStride,
-              (pbox->x1 + dx + srcXoff) * srcBpp,
-              dst + (pbox->y1 + dstYoff) * dstStride,
-              dstStride,
-              (pbox->x1 + dstXoff) * dstBpp,
-              (pbox->x2 - pbox->x1) * dstBpp,
-              (pbox->y2 - pbox->y1), alu, pm, dstBpp, reverse, upsidedown);
-#ifndef FB_ACCESS_WRAPPER
- next:
-#endif
-        pbox++;
+        fbBlt(copy->src + (by1 + copy->dy + copy->srcYoff) * copy->srcStride,
+              copy->srcStride,
+              (pbox->x1 + copy->dx + copy->srcXoff) * copy->srcBpp,
+              copy->dst + (by1 + copy->dstYoff) * copy->dstStride,
+              copy->dstStride,
+              (pbox->x1 + copy->dstXoff) * copy->dstBpp,
+              (pbox->x2 - pbox->x1) * copy->dstBpp,
+              (by2 - by1), copy->alu, copy->pm, copy->dstBpp,
+              copy->reverse, copy->upsidedown);
     }
+}
+
+static void
+fbCopyNtoNBand(void *closure, int band, int y1, int y2)
+{
+    fbCopyNtoNRows(closure, y1, y2);
+}
+
+void
+fbCopyNtoN(DrawablePtr pSrcDrawable,
+           DrawablePtr pDstDrawable,
+           GCPtr pGC,
+           BoxPtr pbox,
+           int nbox,
+           int dx,
+           int dy, Bool reverse, Bool upsidedown, Pixel bitplane, void *closure)
+{
+    PixmapPtr pSrcPixmap, pDstPixmap;
+    FbCopyBandsRec copy = {
+        .pbox = pbox,
+        .nbox = nbox,
+        .dx = dx,
+        .dy = dy,
+        .reverse = reverse,
+        .upsidedown = upsidedown,
+        .alu = pGC ? pGC->alu : GXcopy,
+        .pm = pGC ? fbGetGCPrivate(pGC)->pm : FB_ALLONES,
+    };
+    int64_t pixels = 0;
+    int y1 = MAXSHORT, y2 = MINSHORT;
+    int nbands = 1;
+    int i;
+
+    if (fbBatchCopy(pSrcDrawable, pDstDrawable, pGC, pbox, nbox, dx, dy))
+        return;
+
+    fbGetDrawablePixmap(pSrcDrawable, pSrcPixmap, copy.srcXoff, copy.srcYoff);
+    fbGetPixmapBitsData(pSrcPixmap, copy.src, copy.srcStride, copy.srcBpp);
+    fbGetDrawablePixmap(pDstDrawable, pDstPixmap, copy.dstXoff, copy.dstYoff);
+    fbGetPixmapBitsData(pDstPixmap, copy.dst, copy.dstStride, copy.dstBpp);
+
+    for (i = 0; i < nbox; i++) {
+        pixels += (int64_t) (pbox[i].x2 - pbox[i].x1) * (pbox[i].y2 - pbox[i].y1);
+        y1 = min(y1, pbox[i].y1);
+        y2 = max(y2, pbox[i].y2);
+    }
+
+    /* Bands may only run in any order if no band reads what another writes */
+    if (y1 < y2 &&
+        !fbBitsOverlap(pSrcPixmap->devPrivate.ptr, pSrcPixmap->devKind,
+                       pSrcPixmap->drawable.height,
+                       pDstPixmap->devPrivate.ptr, pDstPixmap->devKind,
+                       pDstPixmap->drawable.height))
+        nbands = fbBandCount(pixels, y2 - y1);
+
+    if (nbands > 1)
+        fbRunBands(nbands, y1, y2, fbCopyNtoNBand, &copy);
+    else
+        fbCopyNtoNRows(&copy, MINSHORT, MAXSHORT);
+
     fbFinishAccess(pDstDrawable);
     fbFinishAccess(pSrcDrawable);
 }
@@ -23,6 +23,7 @@
 #include <dix-config.h>
 
 #include "fb.h"
+#include "fbpriv.h"
 
 static void
 fbStipple(FbBits * dst, FbStride dstStride,
@@ -68,16 +69,22 @@ fbStipple(FbBits * dst, FbStride dstStride,
     }
 }
 
-void
-fbFill(DrawablePtr pDrawable, GCPtr pGC, int x, int y, int width, int height)
-{
+typedef struct _FbFillBands {
+    DrawablePtr pDrawable;
+    GCPtr pGC;
     FbBits *dst;
     FbStride dstStride;
     int dstBpp;
     int dstXoff, dstYoff;
-    FbGCPrivPtr pPriv = fbGetGCPrivate(pGC);
+    int x, width;
+} FbFillBandsRec, *FbFillBandsPtr;
 
-    fbGetDrawable(pDrawable, dst, dstStride, dstBpp, dstXoff, dstYoff);
+static void
+fbFillRows(DrawablePtr pDrawable, GCPtr pGC,
+           FbBits * dst, FbStride dstStride, int dstBpp,
+           int dstXoff, int dstYoff, int x, int y, int width, int height)
+{
+    FbGCPrivPtr pPriv = fbGetGCPrivate(pGC);
 
     switch (pGC->fillStyle) {
     case FillSolid:
@@ -176,6 +183,84 @@ fbFill(DrawablePtr pDrawable, GCPtr pGC, int x, int y, int width, int height)
         break;
     }
     }
+}
+
+static void
+fbFillBand(void *closure, int band, int y1, int y2)
+{
+    FbFillBandsPtr fill = closure;
+
+    fbFillRows(fill->pDrawable, fill->pGC, fill->dst, fill->dstStride,
+               fill->dstBpp, fill->dstXoff, fill->dstYoff,
+               fill->x, y1, fill->width, y2 - y1);
+}
+
+/* Whether the tile or stipple is (part of) what is being filled, which
+ * rules out filling in bands. */
+static Bool
+fbFillReadsDest(DrawablePtr pDrawable, GCPtr pGC)
+{
+    PixmapPtr pPattern, pDst;
+    _X_UNUSED int xoff, yoff;
+
+    switch (pGC->fillStyle) {
+    case FillTiled:
+        pPattern = pGC->tile.pixmap;
+        break;
+    case FillStippled:
+    case FillOpaqueStippled:
+        pPattern = pGC->stipple;
+        break;
+    default:
+        return FALSE;
+    }
+    if (!pPattern)
+        return FALSE;
+
+    fbGetDrawablePixmap(pDrawable, pDst, xoff, yoff);
+    return fbBitsOverlap(pPattern->devPrivate.ptr, pPattern->devKind,
+                         pPattern->drawable.height,
+                         pDst->devPrivate.ptr, pDst->devKind,
+                         pDst->drawable.height);
+}
+
+void
+fbFill(DrawablePtr pDrawable, GCPtr pGC, int x, int y, int width, int height)
+{
+    FbBits *dst;
+    FbStride dstStride;
+    int dstBpp;
+    int dstXoff, dstYoff;
+    int nbands;
+
+    if (pGC->fillStyle == FillSolid &&
+        fbBatchFill(pDrawable, pGC, x, y, width, height))
+        return;
+
+    fbGetDrawable(pDrawable, dst, dstStride, dstBpp, dstXoff, dstYoff);
+
+    nbands = 1;
+    if (!fbFillReadsDest(pDrawable, pGC))
+        nbands = fbBandCount((int64_t) width * height, height);
+    if (nbands > 1) {
+        FbFillBandsRec fill = {
+            .pDrawable = pDrawable,
+            .pGC = pGC,
+            .dst = dst,
+            .dstStride = dstStride,
+            .dstBpp = dstBpp,
+            .dstXoff = dstXoff,
+            .dstYoff = dstYoff,
+            .x = x,
+            .width = width,
+        };
+
+        fbRunBands(nbands, y, y + height, fbFillBand, &fill);
+    }
+    else
+        fbFillRows(pDrawable, pGC, dst, dstStride, dstBpp, dstXoff, dstYoff,
+                   x, y, width, height);
+
     fbValidateDrawable(pDrawable);
     fbFinishAccess(pDrawable);
 }
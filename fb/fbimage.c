@@ -25,6 +25,50 @@
 #include <string.h>
 
 #include "fb.h"
+#include "fbpriv.h"
+
+/* Put all planes of an XYPixmap image in one go, see fbBltXYPlanes() */
+static void
+fbPutXYPixmapImage(DrawablePtr pDrawable,
+                   RegionPtr pClip,
+                   int alu,
+                   Pixel planeMask,
+                   int x,
+                   int y,
+                   int width, int height, FbStip * src, FbStride srcStride,
+                   int srcX)
+{
+    FbBits *dst;
+    FbStride dstStride;
+    int dstBpp;
+    int dstXoff, dstYoff;
+    int nbox;
+    BoxPtr pbox;
+    int x1, y1, x2, y2;
+
+    fbGetDrawable(pDrawable, dst, dstStride, dstBpp, dstXoff, dstYoff);
+
+    for (nbox = RegionNumRects(pClip),
+         pbox = RegionRects(pClip); nbox--; pbox++) {
+        x1 = max(x, pbox->x1);
+        y1 = max(y, pbox->y1);
+        x2 = min(x + width, pbox->x2);
+        y2 = min(y + height, pbox->y2);
+        if (x1 >= x2 || y1 >= y2)
+            continue;
+        fbBltXYPlanes(src + (y1 - y) * srcStride,
+                      srcStride,
+                      srcStride * height,
+                      (x1 - x) + srcX,
+                      pDrawable->depth,
+                      dst + (y1 + dstYoff) * dstStride,
+                      dstStride,
+                      (x1 + dstXoff) * dstBpp,
+                      dstBpp, (x2 - x1) * dstBpp, (y2 - y1), alu, planeMask);
+    }
+
+    fbFinishAccess(pDrawable);
+}
 
 void
 fbPutImage(DrawablePtr pDrawable,
@@ -52,6 +96,13 @@ fbPutImage(DrawablePtr pDrawable,
         break;
     case XYPixmap:
         srcStride = BitmapBytePad(w + leftPad) / sizeof(FbStip);
+        if (pDrawable->bitsPerPixel == 8 || pDrawable->bitsPerPixel == 16 ||
+            pDrawable->bitsPerPixel == 32) {
+            fbPutXYPixmapImage(pDrawable, fbGetCompositeClip(pGC),
+                               pGC->alu, pGC->planemask,
+                               x, y, w, h, src, srcStride, leftPad);
+            break;
+        }
         for (i = (unsigned long) 1 << (pDrawable->depth - 1); i; i >>= 1) {
             if (i & pGC->planemask) {
                 fbPutXYImage(pDrawable,
@@ -72,6 +123,60 @@ fbPutImage(DrawablePtr pDrawable,
     }
 }
 
+typedef struct _FbPutZImageBands {
+    RegionPtr pClip;
+    int alu;
+    FbBits pm;
+    int x, y, width, height;
+    FbStip *src;
+    FbStride srcStride;
+    FbStip *dst;
+    FbStride dstStride;
+    int dstBpp;
+    int dstXoff, dstYoff;
+} FbPutZImageBandsRec, *FbPutZImageBandsPtr;
+
+/* Put the part of the image within rows y1 to y2. */
+static void
+fbPutZImageRows(FbPutZImageBandsPtr put, int y1, int y2)
+{
+    int nbox;
+    BoxPtr pbox;
+    int bx1, by1, bx2, by2;
+
+    for (nbox = RegionNumRects(put->pClip),
+         pbox = RegionRects(put->pClip); nbox--; pbox++) {
+        bx1 = put->x;
+        by1 = max(put->y, y1);
+        bx2 = put->x + put->width;
+        by2 = min(put->y + put->height, y2);
+        if (bx1 < pbox->x1)
+            bx1 = pbox->x1;
+        if (by1 < pbox->y1)
+            by1 = pbox->y1;
+        if (bx2 > pbox->x2)
+            bx2 = pbox->x2;
+        if (by2 > pbox->y2)
+            by2 = pbox->y2;
+        if (bx1 >= bx2 || by1 >= by2)
+            continue;
+        fbBltStip(put->src + (by1 - put->y) * put->srcStride,
+                  put->srcStride,
+                  (bx1 - put->x) * put->dstBpp,
+                  put->dst + (by1 + put->dstYoff) * put->dstStride,
+                  put->dstStride,
+                  (bx1 + put->dstXoff) * put->dstBpp,
+                  (bx2 - bx1) * put->dstBpp, (by2 - by1),
+                  put->alu, put->pm, put->dstBpp);
+    }
+}
+
+static void
+fbPutZImageBand(void *closure, int band, int y1, int y2)
+{
+    fbPutZImageRows(closure, y1, y2);
+}
+
 void
 fbPutZImage(DrawablePtr pDrawable,
             RegionPtr pClip,
@@ -80,40 +185,32 @@ fbPutZImage(DrawablePtr pDrawable,
             int x,
             int y, int width, int height, FbStip * src, FbStride srcStride)
 {
-    FbStip *dst;
-    FbStride dstStride;
-    int dstBpp;
-    int dstXoff, dstYoff;
-    int nbox;
-    BoxPtr pbox;
-    int x1, y1, x2, y2;
+    FbPutZImageBandsRec put = {
+        .pClip = pClip,
+        .alu = alu,
+        .pm = pm,
+        .x = x,
+        .y = y,
+        .width = width,
+        .height = height,
+        .src = src,
+        .srcStride = srcStride,
+    };
+    PixmapPtr pPixmap;
+    int nbands = 1;
 
-    fbGetStipDrawable(pDrawable, dst, dstStride, dstBpp, dstXoff, dstYoff);
+    fbGetDrawablePixmap(pDrawable, pPixmap, put.dstXoff, put.dstYoff);
+    fbGetPixmapStipData(pPixmap, put.dst, put.dstStride, put.dstBpp);
 
-    for (nbox = RegionNumRects(pClip),
-         pbox = RegionRects(pClip); nbox--; pbox++) {
-        x1 = x;
-        y1 = y;
-        x2 = x + width;
-        y2 = y + height;
-        if (x1 < pbox->x1)
-            x1 = pbox->x1;
-        if (y1 < pbox->y1)
-            y1 = pbox->y1;
-        if (x2 > pbox->x2)
-            x2 = pbox->x2;
-        if (y2 > pbox->y2)
-            y2 = pbox->y2;
-        if (x1 >= x2 || y1 >= y2)
-            continue;
-        fbBltStip(src + (y1 - y) * srcStride,
-                  srcStride,
-                  (x1 - x) * dstBpp,
-                  dst + (y1 + dstYoff) * dstStride,
-                  dstStride,
-                  (x1 + dstXoff) * dstBpp,
-                  (x2 - x1) * dstBpp, (y2 - y1), alu, pm, dstBpp);
-    }
+    /* unless it's a shared memory pixmap put into itself */
+    if (!fbBitsOverlap(src, srcStride * sizeof(FbStip), height,
+                       pPixmap->devPrivate.ptr, pPixmap->devKind,
+                       pPixmap->drawable.height))
+        nbands = fbBandCount((int64_t) width * height, height);
+    if (nbands > 1)
+        fbRunBands(nbands, y, y + height, fbPutZImageBand, &put);
+    else
+        fbPutZImageRows(&put, y, y + height);
 
     fbFinishAccess(pDrawable);
 }
@@ -232,14 +329,28 @@ fbGetImage(DrawablePtr pDrawable,
         pm = fbReplicatePixel(planeMask, srcBpp);
         dstStride = PixmapBytePad(w, pDrawable->depth);
         dstStride /= sizeof(FbStip);
-        fbBltStip((FbStip *) (src + (y + srcYoff) * srcStride),
-                  FbBitsStrideToStipStride(srcStride),
-                  (x + srcXoff) * srcBpp,
-                  dst, dstStride, 0, w * srcBpp, h, GXcopy, FB_ALLONES, srcBpp);
-
-        if (pm != FB_ALLONES) {
-            for (int i = 0; i < dstStride * h; i++)
-                dst[i] &= pm;
+        if (srcBpp == 32 && pm != FB_ALLONES) {
+            /* mask while copying rather than going over the image twice */
+            FbBits *s = src + (y + srcYoff) * srcStride + x + srcXoff;
+
+            for (int j = 0; j < h; j++) {
+                for (int i = 0; i < w; i++)
+                    dst[i] = READ(s + i) & pm;
+                s += srcStride;
+                dst += dstStride;
+            }
+        }
+        else {
+            fbBltStip((FbStip *) (src + (y + srcYoff) * srcStride),
+                      FbBitsStrideToStipStride(srcStride),
+                      (x + srcXoff) * srcBpp,
+                      dst, dstStride, 0, w * srcBpp, h, GXcopy, FB_ALLONES,
+                      srcBpp);
+
+            if (pm != FB_ALLONES) {
+                for (int i = 0; i < dstStride * h; i++)
+                    dst[i] &= pm;
+            }
         }
     }
     else {
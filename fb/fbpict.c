@@ -28,11 +28,289 @@
 #include <string.h>
 
 #include "fb.h"
+#include "fbpriv.h"
 #include "glyphstr_priv.h"
-#include "picturestr.h"
+#include "picturestr_priv.h"
 #include "mipict.h"
 #include "fbpict.h"
 
+#ifndef FB_ACCESS_WRAPPER
+
+/*
+ * Setting up a pixman image for a picture costs about as much as drawing
+ * a few pixels, which is most of the work of the small composites some
+ * clients send by the thousand.  So the image of a picture with a drawable
+ * is kept in a private of the picture and used again as long as neither
+ * the picture nor the pixels it points at change.  Changes to the picture
+ * come through the hooks below: everything but a new filter makes the
+ * picture validate again before it is next drawn with.  Changes to the
+ * drawable show in its serial number or its pixmap.
+ *
+ * Source pictures and pictures with an alpha map are set up every time,
+ * as nothing tells the screen when they change.  The wrapped fb build
+ * doesn't keep images either, as it must finish access to the pixels
+ * after each operation.
+ */
+
+typedef struct {
+    pixman_image_t *image;
+    unsigned long serial;       /* of the drawable */
+    PixmapPtr pixmap;
+    void *bits;
+    int stride;
+    int width, height;
+    int pix_xoff, pix_yoff;     /* of the drawable in the pixmap */
+    int xoff, yoff;             /* image_from_pict() returned */
+} FbPictImageRec, *FbPictImagePtr;
+
+/* The image of a picture as a source or mask, and as a destination */
+typedef struct {
+    FbPictImageRec image[2];
+} FbPictPrivRec, *FbPictPrivPtr;
+
+typedef struct {
+    ValidatePictureProcPtr ValidatePicture;
+    DestroyPictureProcPtr DestroyPicture;
+    ChangePictureFilterProcPtr ChangePictureFilter;
+} FbPictScreenRec, *FbPictScreenPtr;
+
+static DevPrivateKeyRec fbPictPrivateKeyRec;
+static DevPrivateKeyRec fbPictScreenKeyRec;
+
+static FbPictPrivPtr
+fbGetPictPrivate(PicturePtr pict)
+{
+    return dixLookupPrivate(&pict->devPrivates, &fbPictPrivateKeyRec);
+}
+
+static FbPictScreenPtr
+fbGetPictScreen(ScreenPtr pScreen)
+{
+    return dixLookupPrivate(&pScreen->devPrivates, &fbPictScreenKeyRec);
+}
+
+static void
+fbDropPictureImages(PicturePtr pict)
+{
+    FbPictPrivPtr priv = fbGetPictPrivate(pict);
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(priv->image); i++) {
+        if (priv->image[i].image)
+            pixman_image_unref(priv->image[i].image);
+        priv->image[i].image = NULL;
+    }
+}
+
+pixman_image_t *
+fbPictureImage(PicturePtr pict, Bool has_clip, int *xoff, int *yoff)
+{
+    FbPictImagePtr cache;
+    PixmapPtr pixmap;
+    pixman_image_t *image;
+    int pix_xoff, pix_yoff;
+
+    if (!pict || !pict->pDrawable || pict->alphaMap ||
+        !dixPrivateKeyRegistered(&fbPictPrivateKeyRec))
+        return image_from_pict(pict, has_clip, xoff, yoff);
+
+    cache = &fbGetPictPrivate(pict)->image[has_clip != FALSE];
+    fbGetDrawablePixmap(pict->pDrawable, pixmap, pix_xoff, pix_yoff);
+
+    if (cache->image &&
+        cache->serial == pict->pDrawable->serialNumber &&
+        cache->pixmap == pixmap &&
+        cache->bits == pixmap->devPrivate.ptr &&
+        cache->stride == pixmap->devKind &&
+        cache->width == pixmap->drawable.width &&
+        cache->height == pixmap->drawable.height &&
+        cache->pix_xoff == pix_xoff && cache->pix_yoff == pix_yoff) {
+        PictureImageStats.reused++;
+        *xoff = cache->xoff;
+        *yoff = cache->yoff;
+        return pixman_image_ref(cache->image);
+    }
+    PictureImageStats.setUp++;
+
+    if (cache->image)
+        pixman_image_unref(cache->image);
+    cache->image = NULL;
+
+    image = image_from_pict(pict, has_clip, xoff, yoff);
+    if (image) {
+        cache->image = pixman_image_ref(image);
+        cache->serial = pict->pDrawable->serialNumber;
+        cache->pixmap = pixmap;
+        cache->bits = pixmap->devPrivate.ptr;
+        cache->stride = pixmap->devKind;
+        cache->width = pixmap->drawable.width;
+        cache->height = pixmap->drawable.height;
+        cache->pix_xoff = pix_xoff;
+        cache->pix_yoff = pix_yoff;
+        cache->xoff = *xoff;
+        cache->yoff = *yoff;
+    }
+    return image;
+}
+
+void
+fbLogPictureImageStats(void)
+{
+    if (!PictureImageStats.reused && !PictureImageStats.setUp)
+        return;
+    LogMessageVerb(X_INFO, 3, "fb: picture images: %llu reused, %llu set up\n",
+                   (unsigned long long) PictureImageStats.reused,
+                   (unsigned long long) PictureImageStats.setUp);
+    PictureImageStats.reused = PictureImageStats.setUp = 0;
+}
+
+static void
+fbValidatePicture(PicturePtr pPicture, Mask mask)
+{
+    ScreenPtr pScreen = pPicture->pDrawable->pScreen;
+    PictureScreenPtr ps = GetPictureScreen(pScreen);
+    FbPictScreenPtr fps = fbGetPictScreen(pScreen);
+
+    fbDropPictureImages(pPicture);
+    ps->ValidatePicture = fps->ValidatePicture;
+    (*ps->ValidatePicture) (pPicture, mask);
+    ps->ValidatePicture = fbValidatePicture;
+}
+
+static void
+fbDestroyPicture(PicturePtr pPicture)
+{
+    ScreenPtr pScreen = pPicture->pDrawable->pScreen;
+    PictureScreenPtr ps = GetPictureScreen(pScreen);
+    FbPictScreenPtr fps = fbGetPictScreen(pScreen);
+
+    fbDropPictureImages(pPicture);
+    ps->DestroyPicture = fps->DestroyPicture;
+    (*ps->DestroyPicture) (pPicture);
+    ps->DestroyPicture = fbDestroyPicture;
+}
+
+static int
+fbChangePictureFilter(PicturePtr pPicture,
+                      int filter, xFixed * params, int nparams)
+{
+    ScreenPtr pScreen = pPicture->pDrawable->pScreen;
+    PictureScreenPtr ps = GetPictureScreen(pScreen);
+    FbPictScreenPtr fps = fbGetPictScreen(pScreen);
+    int ret;
+
+    fbDropPictureImages(pPicture);
+    ps->ChangePictureFilter = fps->ChangePictureFilter;
+    ret = (*ps->ChangePictureFilter) (pPicture, filter, params, nparams);
+    ps->ChangePictureFilter = fbChangePictureFilter;
+    return ret;
+}
+
+static Bool
+fbPictureImageInit(ScreenPtr pScreen)
+{
+    PictureScreenPtr ps = GetPictureScreen(pScreen);
+    FbPictScreenPtr fps;
+
+    if (!dixRegisterPrivateKey(&fbPictPrivateKeyRec, PRIVATE_PICTURE,
+                               sizeof(FbPictPrivRec)))
+        return FALSE;
+    if (!dixRegisterPrivateKey(&fbPictScreenKeyRec, PRIVATE_SCREEN,
+                               sizeof(FbPictScreenRec)))
+        return FALSE;
+    fps = fbGetPictScreen(pScreen);
+
+    fps->ValidatePicture = ps->ValidatePicture;
+    ps->ValidatePicture = fbValidatePicture;
+    fps->DestroyPicture = ps->DestroyPicture;
+    ps->DestroyPicture = fbDestroyPicture;
+    fps->ChangePictureFilter = ps->ChangePictureFilter;
+    ps->ChangePictureFilter = fbChangePictureFilter;
+    return TRUE;
+}
+
+#else                           /* FB_ACCESS_WRAPPER */
+
+pixman_image_t *
+fbPictureImage(PicturePtr pict, Bool has_clip, int *xoff, int *yoff)
+{
+    return image_from_pict(pict, has_clip, xoff, yoff);
+}
+
+void
+fbLogPictureImageStats(void)
+{
+}
+
+static Bool
+fbPictureImageInit(ScreenPtr pScreen)
+{
+    return TRUE;
+}
+
+#endif                          /* FB_ACCESS_WRAPPER */
+
+typedef struct _FbCompositeBands {
+    CARD8 op;
+    pixman_image_t *src[FB_BAND_MAX];
+    pixman_image_t *mask[FB_BAND_MAX];
+    pixman_image_t *dest[FB_BAND_MAX];
+    int xSrc, ySrc;
+    int xMask, yMask;
+    int xDst, yDst;
+    int width;
+} FbCompositeBandsRec, *FbCompositeBandsPtr;
+
+static void
+fbCompositeBand(void *closure, int band, int y1, int y2)
+{
+    FbCompositeBandsPtr c = closure;
+    int dy = y1 - c->yDst;
+
+    pixman_image_composite(c->op, c->src[band], c->mask[band], c->dest[band],
+                           c->xSrc, c->ySrc + dy, c->xMask, c->yMask + dy,
+                           c->xDst, y1, c->width, y2 - y1);
+}
+
+static PixmapPtr
+fbPicturePixmap(PicturePtr pict)
+{
+    if (!pict || !pict->pDrawable)
+        return NULL;
+    if (pict->pDrawable->type != DRAWABLE_PIXMAP)
+        return fbGetWindowPixmap(pict->pDrawable);
+    return (PixmapPtr) pict->pDrawable;
+}
+
+static Bool
+fbPicturesOverlap(PicturePtr a, PicturePtr b)
+{
+    PixmapPtr pa = fbPicturePixmap(a);
+    PixmapPtr pb = fbPicturePixmap(b);
+
+    return pa && pb &&
+        fbBitsOverlap(pa->devPrivate.ptr, pa->devKind, pa->drawable.height,
+                      pb->devPrivate.ptr, pb->devKind, pb->drawable.height);
+}
+
+/* Whether the operation reads any of the bits it draws to, which rules out
+ * drawing it in bands. */
+static Bool
+fbCompositeReadsDest(PicturePtr pSrc, PicturePtr pMask, PicturePtr pDst)
+{
+    PicturePtr reads[] = {
+        pSrc, pSrc->alphaMap, pMask, pMask ? pMask->alphaMap : NULL,
+    };
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(reads); i++) {
+        if (fbPicturesOverlap(reads[i], pDst) ||
+            fbPicturesOverlap(reads[i], pDst->alphaMap))
+            return TRUE;
+    }
+    return FALSE;
+}
+
 void
 fbComposite(CARD8 op,
             PicturePtr pSrc,
@@ -43,29 +321,66 @@ fbComposite(CARD8 op,
             INT16 xMask,
             INT16 yMask, INT16 xDst, INT16 yDst, CARD16 width, CARD16 height)
 {
-    pixman_image_t *src, *mask, *dest;
+    FbCompositeBandsRec c;
     int src_xoff, src_yoff;
     int msk_xoff, msk_yoff;
     int dst_xoff, dst_yoff;
+    Bool reads_dest;
+    int nbands = 1;
+    int i;
 
     miCompositeSourceValidate(pSrc);
     if (pMask)
         miCompositeSourceValidate(pMask);
 
-    src = image_from_pict(pSrc, FALSE, &src_xoff, &src_yoff);
-    mask = image_from_pict(pMask, FALSE, &msk_xoff, &msk_yoff);
-    dest = image_from_pict(pDst, TRUE, &dst_xoff, &dst_yoff);
+    reads_dest = fbCompositeReadsDest(pSrc, pMask, pDst);
+    if (!reads_dest &&
+        fbBatchComposite(op, pSrc, pMask, pDst, xSrc, ySrc, xMask, yMask,
+                         xDst, yDst, width, height))
+        return;
+
+    c.src[0] = fbPictureImage(pSrc, FALSE, &src_xoff, &src_yoff);
+    c.mask[0] = fbPictureImage(pMask, FALSE, &msk_xoff, &msk_yoff);
+    c.dest[0] = fbPictureImage(pDst, TRUE, &dst_xoff, &dst_yoff);
+
+    if (c.src[0] && c.dest[0] && !(pMask && !c.mask[0])) {
+        c.op = op;
+        c.xSrc = xSrc + src_xoff;
+        c.ySrc = ySrc + src_yoff;
+        c.xMask = xMask + msk_xoff;
+        c.yMask = yMask + msk_yoff;
+        c.xDst = xDst + dst_xoff;
+        c.yDst = yDst + dst_yoff;
+        c.width = width;
+
+        if (!reads_dest)
+            nbands = fbBandCount((int64_t) width * height, height);
+
+        /* pixman images are set up lazily, so each band gets its own;
+         * only the first band draws with the images the pictures keep */
+        for (i = 1; i < nbands; i++) {
+            int xoff, yoff;
+
+            c.src[i] = image_from_pict(pSrc, FALSE, &xoff, &yoff);
+            c.mask[i] = image_from_pict(pMask, FALSE, &xoff, &yoff);
+            c.dest[i] = image_from_pict(pDst, TRUE, &xoff, &yoff);
+            if (!c.src[i] || !c.dest[i] || (pMask && !c.mask[i])) {
+                free_pixman_pict(pSrc, c.src[i]);
+                free_pixman_pict(pMask, c.mask[i]);
+                free_pixman_pict(pDst, c.dest[i]);
+                nbands = i;
+                break;
+            }
+        }
 
-    if (src && dest && !(pMask && !mask)) {
-        pixman_image_composite(op, src, mask, dest,
-                               xSrc + src_xoff, ySrc + src_yoff,
-                               xMask + msk_xoff, yMask + msk_yoff,
-                               xDst + dst_xoff, yDst + dst_yoff, width, height);
+        fbRunBands(nbands, c.yDst, c.yDst + height, fbCompositeBand, &c);
     }
 
-    free_pixman_pict(pSrc, src);
-    free_pixman_pict(pMask, mask);
-    free_pixman_pict(pDst, dest);
+    for (i = 0; i < nbands; i++) {
+        free_pixman_pict(pSrc, c.src[i]);
+        free_pixman_pict(pMask, c.mask[i]);
+        free_pixman_pict(pDst, c.dest[i]);
+    }
 }
 
 static pixman_glyph_cache_t *glyphCache;
@@ -174,10 +489,10 @@ fbGlyphs(CARD8 op,
 	list++;
     }
 
-    if (!(srcImage = image_from_pict(pSrc, FALSE, &srcXoff, &srcYoff)))
+    if (!(srcImage = fbPictureImage(pSrc, FALSE, &srcXoff, &srcYoff)))
 	goto out;
 
-    if (!(dstImage = image_from_pict(pDst, TRUE, &dstXoff, &dstYoff)))
+    if (!(dstImage = fbPictureImage(pDst, TRUE, &dstXoff, &dstYoff)))
 	goto out_free_src;
 
     if (maskFormat) {
@@ -501,5 +816,5 @@ fbPictureInit(ScreenPtr pScreen, PictFormatPtr formats, int nformats)
     ps->AddTriangles = fbAddTriangles;
     ps->Triangles = fbTriangles;
 
-    return TRUE;
+    return fbPictureImageInit(pScreen);
 }
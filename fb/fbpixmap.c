@@ -89,6 +89,7 @@ fbDestroyPixmap(PixmapPtr pPixmap)
 {
     if (--pPixmap->refcnt)
         return TRUE;
+    fbBatchAccess(&pPixmap->drawable);
     FreePixmap(pPixmap);
     return TRUE;
 }
@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Copyright © 2026 X.Org Foundation
+ */
+#ifndef _FBPRIV_H_
+#define _FBPRIV_H_
+
+/* fb internals, not installed for drivers */
+
+#include "fb.h"
+
+/*
+ * fbbatch.c
+ */
+
+/* Record the operation to draw later; FALSE if it has to be drawn now. */
+Bool fbBatchFill(DrawablePtr pDrawable, GCPtr pGC,
+                 int x, int y, int width, int height);
+
+Bool fbBatchCopy(DrawablePtr pSrcDrawable, DrawablePtr pDstDrawable,
+                 GCPtr pGC, BoxPtr pbox, int nbox, int dx, int dy);
+
+Bool fbBatchComposite(CARD8 op, PicturePtr pSrc, PicturePtr pMask,
+                      PicturePtr pDst, INT16 xSrc, INT16 ySrc,
+                      INT16 xMask, INT16 yMask, INT16 xDst, INT16 yDst,
+                      CARD16 width, CARD16 height);
+
+/*
+ * fbpict.c
+ */
+
+/* The pixman image of a picture, kept with it where fb can use it again. */
+pixman_image_t *fbPictureImage(PicturePtr pict, Bool has_clip,
+                               int *xoff, int *yoff);
+
+/* Log how often picture images were reused or set up, and start over. */
+void fbLogPictureImageStats(void);
+
+/*
+ * fbthread.c
+ */
+
+#define FB_BAND_MAX 16
+
+/* Draw rows y1 to y2 of the operation; band counts from 0. */
+typedef void (*FbBandProcPtr) (void *closure, int band, int y1, int y2);
+
+/* How many bands to cut an operation of pixels pixels over height rows
+ * into, at most FB_BAND_MAX; 1 to draw it on the calling thread. */
+int fbBandCount(int64_t pixels, int height);
+
+/* Call proc for each of nbands bands of rows y1 to y2, in parallel, and
+ * return once all are done. */
+void fbRunBands(int nbands, int y1, int y2, FbBandProcPtr proc,
+                void *closure);
+
+/* Whether two runs of rows share memory; strides are in bytes. */
+Bool fbBitsOverlap(const void *a, int aStride, int aHeight,
+                   const void *b, int bStride, int bHeight);
+
+#endif /* _FBPRIV_H_ */
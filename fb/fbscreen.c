@@ -25,6 +25,7 @@
 #include "os/osdep.h"
 
 #include "fb.h"
+#include "fbpriv.h"
 
 Bool
 fbCloseScreen(ScreenPtr pScreen)
@@ -33,6 +34,7 @@ fbCloseScreen(ScreenPtr pScreen)
     DepthPtr depths = pScreen->allowedDepths;
 
     fbDestroyGlyphCache();
+    fbLogPictureImageStats();
     for (d = 0; d < pScreen->numDepths; d++)
         free(depths[d].vids);
     free(depths);
@@ -0,0 +1,222 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * With -fbthreads n, operations touching more than FB_BAND_MIN_PIXELS
+ * pixels are cut into horizontal bands of destination rows, which n
+ * worker threads and the main thread draw at the same time.  The main
+ * thread waits for all bands before it returns, so to the rest of the
+ * server nothing changed but the time it took.  Callers only band what
+ * draws every destination row from data no other band writes, which
+ * keeps the result the same to the bit as drawing it in one go.
+ *
+ * The workers are started the first time they're needed and stay around
+ * across server generations.  The wrapped fb build always draws on the
+ * main thread, as the accessors of its drivers need not be thread safe.
+ */
+
+#include <dix-config.h>
+
+#include "dix/dix_priv.h"
+
+#include "fb.h"
+#include "fbpriv.h"
+
+#define FB_BAND_MIN_PIXELS 65536        /* not worth waking anyone below */
+#define FB_BAND_MIN_ROWS 8
+
+Bool
+fbBitsOverlap(const void *a, int aStride, int aHeight,
+              const void *b, int bStride, int bHeight)
+{
+    const char *a1 = a, *a2 = a1 + (intptr_t) aStride * aHeight;
+    const char *b1 = b, *b2 = b1 + (intptr_t) bStride * bHeight;
+
+    if (a1 > a2) {
+        const char *t = a1;
+
+        a1 = a2;
+        a2 = t;
+    }
+    if (b1 > b2) {
+        const char *t = b1;
+
+        b1 = b2;
+        b2 = t;
+    }
+    return a1 < b2 && b1 < a2;
+}
+
+#if INPUTTHREAD && !defined(FB_ACCESS_WRAPPER)
+
+#include <pthread.h>
+#include <signal.h>
+
+typedef struct _FbBandJob {
+    FbBandProcPtr proc;
+    void *closure;
+    int nbands;
+    int y1, y2;
+    int next;                   /* next band to hand out */
+    int pending;                /* bands not done yet */
+} FbBandJobRec, *FbBandJobPtr;
+
+static pthread_mutex_t fbBandLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t fbBandWork = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t fbBandDone = PTHREAD_COND_INITIALIZER;
+static FbBandJobPtr fbBandJob;
+static int fbBandThreads;
+static Bool fbBandFailed;
+
+/* Take the next band of the job and draw it; called with fbBandLock held. */
+static void
+fbBandRunOne(FbBandJobPtr job)
+{
+    int band = job->next++;
+    int height = job->y2 - job->y1;
+    int y1 = job->y1 + (int) ((int64_t) height * band / job->nbands);
+    int y2 = job->y1 + (int) ((int64_t) height * (band + 1) / job->nbands);
+
+    pthread_mutex_unlock(&fbBandLock);
+    (*job->proc) (job->closure, band, y1, y2);
+    pthread_mutex_lock(&fbBandLock);
+
+    if (--job->pending == 0)
+        pthread_cond_signal(&fbBandDone);
+}
+
+static void *
+fbBandThread(void *arg)
+{
+    sigset_t set;
+
+    /* Don't handle any signals on this thread */
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+#if defined(HAVE_PTHREAD_SETNAME_NP_WITH_TID)
+    pthread_setname_np (pthread_self(), "FbThread");
+#elif defined(HAVE_PTHREAD_SETNAME_NP_WITHOUT_TID)
+    pthread_setname_np ("FbThread");
+#endif
+
+    pthread_mutex_lock(&fbBandLock);
+    for (;;) {
+        while (!fbBandJob || fbBandJob->next == fbBandJob->nbands)
+            pthread_cond_wait(&fbBandWork, &fbBandLock);
+        fbBandRunOne(fbBandJob);
+    }
+
+    return NULL;
+}
+
+static Bool
+fbBandStart(void)
+{
+    pthread_attr_t attr;
+    int count = min(fbThreadCount, FB_BAND_MAX - 1);
+
+    if (fbBandThreads >= count)
+        return TRUE;
+    if (fbBandFailed)
+        return fbBandThreads > 0;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    while (fbBandThreads < count) {
+        pthread_t thread;
+
+        if (pthread_create(&thread, &attr, fbBandThread, NULL) != 0) {
+            LogMessage(X_WARNING, "fb: could only start %d of %d threads\n",
+                       fbBandThreads, count);
+            fbBandFailed = TRUE;
+            break;
+        }
+        fbBandThreads++;
+    }
+    pthread_attr_destroy(&attr);
+
+    if (!fbBandFailed)
+        LogMessageVerb(X_INFO, 3, "fb: drawing large operations in %d threads\n",
+                       fbBandThreads + 1);
+    return fbBandThreads > 0;
+}
+
+int
+fbBandCount(int64_t pixels, int height)
+{
+    int nbands;
+
+    if (fbThreadCount <= 0 || pixels < FB_BAND_MIN_PIXELS)
+        return 1;
+    if (!fbBandStart())
+        return 1;
+
+    nbands = min(fbBandThreads + 1, height / FB_BAND_MIN_ROWS);
+    return max(nbands, 1);
+}
+
+void
+fbRunBands(int nbands, int y1, int y2, FbBandProcPtr proc, void *closure)
+{
+    FbBandJobRec job = {
+        .proc = proc,
+        .closure = closure,
+        .nbands = nbands,
+        .y1 = y1,
+        .y2 = y2,
+        .next = 0,
+        .pending = nbands,
+    };
+
+    if (nbands <= 1) {
+        (*proc) (closure, 0, y1, y2);
+        return;
+    }
+
+    pthread_mutex_lock(&fbBandLock);
+    fbBandJob = &job;
+    pthread_cond_broadcast(&fbBandWork);
+    while (job.next < job.nbands)
+        fbBandRunOne(&job);
+    while (job.pending)
+        pthread_cond_wait(&fbBandDone, &fbBandLock);
+    fbBandJob = NULL;
+    pthread_mutex_unlock(&fbBandLock);
+}
+
+#else                           /* INPUTTHREAD && !FB_ACCESS_WRAPPER */
+
+int
+fbBandCount(int64_t pixels, int height)
+{
+    return 1;
+}
+
+void
+fbRunBands(int nbands, int y1, int y2, FbBandProcPtr proc, void *closure)
+{
+    (*proc) (closure, 0, y1, y2);
+}
+
+#endif                          /* INPUTTHREAD && !FB_ACCESS_WRAPPER */
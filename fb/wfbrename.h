@@ -4,10 +4,18 @@
 #define fbArc16 wfbArc16
 #define fbArc32 wfbArc32
 #define fbArc8 wfbArc8
+#define fbBandCount wfbBandCount
+#define fbBatchComposite wfbBatchComposite
+#define fbBatchCopy wfbBatchCopy
+#define fbBatchFill wfbBatchFill
+#define fbBatchFlush wfbBatchFlush
+#define fbBatchInit wfbBatchInit
+#define fbBitsOverlap wfbBitsOverlap
 #define fbBlt wfbBlt
 #define fbBltOne wfbBltOne
 #define fbBltPlane wfbBltPlane
 #define fbBltStip wfbBltStip
+#define fbBltXYPlanes wfbBltXYPlanes
 #define fbBres wfbBres
 #define fbBresDash wfbBresDash
 #define fbBresDash16 wfbBresDash16
@@ -65,6 +73,7 @@
 #define fbInitializeColormap wfbInitializeColormap
 #define fbInitVisuals wfbInitVisuals
 #define fbListInstalledColormaps wfbListInstalledColormaps
+#define fbLogPictureImageStats wfbLogPictureImageStats
 #define FbMergeRopBits wFbMergeRopBits
 #define fbOddTile wfbOddTile
 #define fbOver wfbOver
@@ -81,6 +90,7 @@
 #define fbOverlayWindowExposures wfbOverlayWindowExposures
 #define fbOverlayWindowLayer wfbOverlayWindowLayer
 #define fbPadPixmap wfbPadPixmap
+#define fbPictureImage wfbPictureImage
 #define fbPictureInit wfbPictureInit
 #define fbPixmapToRegion wfbPixmapToRegion
 #define fbPolyArc wfbPolyArc
@@ -108,6 +118,7 @@
 #define fbRealizeFont wfbRealizeFont
 #define fbReplicatePixel wfbReplicatePixel
 #define fbResolveColor wfbResolveColor
+#define fbRunBands wfbRunBands
 #define fbScreenPrivateKeyRec wfbScreenPrivateKeyRec
 #define fbSegment wfbSegment
 #define fbSelectBres wfbSelectBres
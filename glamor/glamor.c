@@ -633,8 +633,10 @@ glamor_init(ScreenPtr screen, unsigned int flags)
 
     glamor_set_screen_private(screen, glamor_priv);
 
-    if (!dixRegisterPrivateKey(&glamor_pixmap_private_key, PRIVATE_PIXMAP,
-                               sizeof(struct glamor_pixmap_private))) {
+    if (!dixRegisterPrivateKeyHotness(&glamor_pixmap_private_key,
+                                      PRIVATE_PIXMAP,
+                                      sizeof(struct glamor_pixmap_private),
+                                      PRIVATE_KEY_HOT)) {
         LogMessage(X_WARNING,
                    "glamor%d: Failed to allocate pixmap private\n",
                    screen->myNum);
@@ -130,6 +130,7 @@ typedef enum { NORMAL_MEMORY_FB, SHARED_MEMORY_FB, MMAPPED_FILE_FB } fbMemType;
 static fbMemType fbmemtype = NORMAL_MEMORY_FB;
 static char needswap = 0;
 static Bool Render = TRUE;
+static Bool vfbBatch = FALSE;
 
 #define swapcopy16(_dst, _src) \
     if (needswap) { CARD16 _s = _src; cpswaps(_s, _dst); } \
@@ -249,6 +250,7 @@ ddxUseMsg(void)
     ErrorF("-pixdepths list-of-int support given pixmap depths\n");
     ErrorF("+/-render		   turn on/off RENDER extension support"
            "(default on)\n");
+    ErrorF("-fbbatch               draw runs of small operations together\n");
     ErrorF("-linebias n            adjust thin line pixelization\n");
     ErrorF("-blackpixel n          pixel value for black\n");
     ErrorF("-whitepixel n          pixel value for white\n");
@@ -359,6 +361,11 @@ ddxProcessArgument(int argc, char *argv[], int i)
         return 2;
     }
 
+    if (strcmp(argv[i], "-fbbatch") == 0) {     /* -fbbatch */
+        vfbBatch = TRUE;
+        return 1;
+    }
+
     if (strcmp(argv[i], "-linebias") == 0) {    /* -linebias n */
         CHECK_FOR_REQUIRED_ARGUMENTS(1);
         currentScreen->lineBias = atoi(argv[++i]);
@@ -939,6 +946,9 @@ vfbScreenInit(ScreenPtr pScreen, int argc, char **argv)
     if (ret && Render)
         fbPictureInit(pScreen, 0, 0);
 
+    if (ret && vfbBatch)
+        ret = fbBatchInit(pScreen);
+
     if (!ret)
         return FALSE;
 
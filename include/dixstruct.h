@@ -86,6 +86,7 @@ typedef struct _Client {
     unsigned int swapped:1;
     unsigned int local:1;
     unsigned int big_requests:1; /* supports large requests */
+    unsigned int req_preswapped:1; /* current request already swapped */
     unsigned int clientGone:1;
     unsigned int closeDownMode:2;
     unsigned int clientState:2;
@@ -276,6 +276,13 @@ version_compare(uint32_t a_major, uint32_t a_minor,
 #define SwapRestL(stuff) \
     SwapLongs((CARD32 *)(stuff + 1), LengthRestL(stuff))
 
+/* the same for request swappers, which go by req_len instead of a client */
+#define SwapReqRestS(stuff, req_len) \
+    SwapShorts((short *)(stuff + 1), ((req_len) << 1) - (sizeof(*stuff) >> 1))
+
+#define SwapReqRestL(stuff, req_len) \
+    SwapLongs((CARD32 *)(stuff + 1), (req_len) - (sizeof(*stuff) >> 2))
+
 #if defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 3))
 void __attribute__ ((error("wrong sized variable passed to swap")))
 wrong_size(void);
@@ -105,6 +105,12 @@ extern _X_EXPORT void SetCriticalOutputPending(void);
 extern _X_EXPORT int WriteToClient(ClientPtr /*who */ , int /*count */ ,
                                    const void * /*buf */ );
 
+typedef void (*ClientOutputReleaseProcPtr) (void *data);
+
+extern _X_EXPORT int WriteToClientNoCopy(ClientPtr /*who */ , int /*count */ ,
+                                         void * /*buf */ ,
+                                         ClientOutputReleaseProcPtr /*release */ );
+
 extern _X_EXPORT void ResetOsBuffers(void);
 
 extern _X_EXPORT void NotifyParentProcess(void);
@@ -147,6 +153,12 @@ extern _X_EXPORT Bool AddClientOnOpenFD(int /* fd */ );
 
 extern _X_EXPORT CARD32 GetTimeInMillis(void);
 extern _X_EXPORT CARD64 GetTimeInMicros(void);
+extern _X_EXPORT CARD64 GetTimeInNanos(void);
+
+/* The monotonic time as of the first call since the last
+ * InvalidateCachedTime(); main thread only. */
+extern _X_EXPORT CARD32 GetCachedTimeInMillis(void);
+extern _X_EXPORT void InvalidateCachedTime(void);
 
 extern _X_EXPORT void AdjustWaitForDelay(void *waitTime, int newdelay);
 
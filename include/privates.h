@@ -56,6 +56,17 @@ typedef enum {
     PRIVATE_LAST,
 } DevPrivateType;
 
+/*
+ * How often a private gets looked at.  Hot privates are kept together at
+ * the start of the private storage, right after the object itself, so
+ * that the ones used on every drawing operation share its cache lines
+ * instead of being spread out among the rest.
+ */
+typedef enum {
+    PRIVATE_KEY_COLD,
+    PRIVATE_KEY_HOT,
+} DevPrivateHotness;
+
 typedef struct _DevPrivateKeyRec {
     int offset;
     int size;
@@ -101,6 +112,18 @@ typedef struct _DevScreenPrivateKeyRec {
 extern _X_EXPORT Bool
  dixRegisterPrivateKey(DevPrivateKey key, DevPrivateType type, unsigned size);
 
+/*
+ * Like dixRegisterPrivateKey, for privates that are looked at so often
+ * that they are worth keeping next to the object, before all the cold
+ * ones.  This moves the cold privates already registered, so it only
+ * works for types whose objects can't exist before the keys are all
+ * registered; for the others, and for screen-specific keys, which always
+ * come after all the others, hot keys are put at the end like cold ones.
+ */
+extern _X_EXPORT Bool
+ dixRegisterPrivateKeyHotness(DevPrivateKey key, DevPrivateType type,
+                              unsigned size, DevPrivateHotness hotness);
+
 /*
  * Check whether a private key has been registered
  */
@@ -332,7 +355,8 @@ extern _X_EXPORT int
  dixPrivatesSize(DevPrivateType type);
 
 /*
- * Dump out private stats to ErrorF
+ * Dump out private stats to ErrorF: per type, how many objects there are
+ * and what their privates take up, and where each key's private is
  */
 extern void
  dixPrivateUsage(void);
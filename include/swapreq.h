@@ -30,6 +30,27 @@ extern void SwapColorItem(xColorItem * /* pItem */ );
 
 extern void SwapConnClientPrefix(xConnClientPrefix * /* pCCP */ );
 
+typedef Bool (*SwapReqProcPtr) (xReq * /* req */ , CARD32 /* req_len */ );
+
+/* swappers for the core requests that have one, NULL for the others */
+extern SwapReqProcPtr SwapReqVector[EXTENSION_BASE];
+
+Bool SwapChangeGCReq(xReq *req, CARD32 req_len);
+Bool SwapChangePropertyReq(xReq *req, CARD32 req_len);
+Bool SwapChangeWindowAttributesReq(xReq *req, CARD32 req_len);
+Bool SwapClearAreaReq(xReq *req, CARD32 req_len);
+Bool SwapConfigureWindowReq(xReq *req, CARD32 req_len);
+Bool SwapCopyAreaReq(xReq *req, CARD32 req_len);
+Bool SwapCreateGCReq(xReq *req, CARD32 req_len);
+Bool SwapFillPolyReq(xReq *req, CARD32 req_len);
+Bool SwapImageTextReq(xReq *req, CARD32 req_len);
+Bool SwapPolyReq(xReq *req, CARD32 req_len);
+Bool SwapPolyTextReq(xReq *req, CARD32 req_len);
+Bool SwapPutImageReq(xReq *req, CARD32 req_len);
+Bool SwapResourceReq(xReq *req, CARD32 req_len);
+Bool SwapSetClipRectanglesReq(xReq *req, CARD32 req_len);
+Bool SwapSimpleReq(xReq *req, CARD32 req_len);
+
 int SProcAllocColor(ClientPtr client);
 int SProcAllocColorCells(ClientPtr client);
 int SProcAllocColorPlanes(ClientPtr client);
@@ -39,6 +39,7 @@ in this Software without prior written authorization from The Open Group.
 #include   <X11/Xproto.h>
 
 #include   "dix/cursor_priv.h"
+#include   "os/osdep.h"
 #include   "os/screensaver.h"
 
 #include   "misc.h"
@@ -71,10 +72,31 @@ in this Software without prior written authorization from The Open Group.
 #define EnqueueScreen(dev) dev->spriteInfo->sprite->pEnqueueScreen
 #define DequeueScreen(dev) dev->spriteInfo->sprite->pDequeueScreen
 
+/*
+ * The queue is a ring with a single producer and a single consumer.
+ * Events get added at the tail by whoever holds input_lock(), usually the
+ * input thread, and taken off at the head by mieqProcessInputEvents() on
+ * the main thread, which doesn't take the lock for that, so neither side
+ * ever waits for the other to finish handling an event.
+ *
+ * An event still in the queue can have a later motion event merged into
+ * it, so each slot has a state: the consumer claims a READY event before
+ * copying it out, and the producer only merges into an event it managed
+ * to switch from READY to WRITING.  Growing the queue moves everything,
+ * which the consumer must not see halfway, so the two sides briefly wait
+ * for each other then, through the reading and resizing flags.
+ */
+enum EventState {
+    EVENT_FREE,                 /* taken off the queue, or never used */
+    EVENT_READY,
+    EVENT_WRITING,              /* another motion is being merged in */
+};
+
 typedef struct _Event {
     InternalEvent *events;
     ScreenPtr pScreen;
     DeviceIntPtr pDev;          /* device this event _originated_ from */
+    int state;                  /* enum EventState */
 } EventRec, *EventPtr;
 
 typedef struct _EventQueue {
@@ -84,6 +106,8 @@ typedef struct _EventQueue {
     EventRec *events;           /* our queue as an array */
     size_t nevents;             /* the number of buckets in our queue */
     size_t dropped;             /* counter for number of consecutive dropped events */
+    int reading;                /* the consumer is copying an event out */
+    int resizing;               /* the producer is growing the queue */
     mieqHandler handlers[128];  /* custom event handler */
 } EventQueueRec, *EventQueuePtr;
 
@@ -91,14 +115,30 @@ static EventQueueRec miEventQueue;
 
 static CallbackListPtr miCallbacksWhenDrained = NULL;
 
+/* Tell the CPU we're spinning on the other thread */
+static inline void
+mieqRelax(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield" ::: "memory");
+#else
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
 static size_t
 mieqNumEnqueued(EventQueuePtr eventQueue)
 {
     size_t n_enqueued = 0;
 
     if (eventQueue->nevents) {
+        HWEventQueueType head = __atomic_load_n(&eventQueue->head,
+                                                __ATOMIC_ACQUIRE);
+
         /* % is not well-defined with negative numbers... sigh */
-        n_enqueued = eventQueue->tail - eventQueue->head + eventQueue->nevents;
+        n_enqueued = eventQueue->tail - head + eventQueue->nevents;
         if (n_enqueued >= eventQueue->nevents)
             n_enqueued -= eventQueue->nevents;
     }
@@ -126,26 +166,14 @@ mieqGrowQueue(EventQueuePtr eventQueue, size_t new_nevents)
         return FALSE;
     }
 
-    n_enqueued = mieqNumEnqueued(eventQueue);
-
-    /* First copy the existing events */
-    first_hunk = eventQueue->nevents - eventQueue->head;
-    if (eventQueue->events) {
-        memcpy(new_events,
-               &eventQueue->events[eventQueue->head],
-               first_hunk * sizeof(EventRec));
-        memcpy(&new_events[first_hunk],
-               eventQueue->events, eventQueue->head * sizeof(EventRec));
-    }
-
-    /* Initialize the new portion */
+    /* Initialize the new portion before the consumer has to wait */
     for (i = eventQueue->nevents; i < new_nevents; i++) {
         InternalEvent *evlist = InitEventList(1);
 
         if (!evlist) {
             size_t j;
 
-            for (j = 0; j < i; j++)
+            for (j = eventQueue->nevents; j < i; j++)
                 FreeEventList(new_events[j].events, 1);
             free(new_events);
             return FALSE;
@@ -153,12 +181,31 @@ mieqGrowQueue(EventQueuePtr eventQueue, size_t new_nevents)
         new_events[i].events = evlist;
     }
 
+    /* Keep the consumer out while we move its events around; it only
+     * ever reads one event at a time, so this doesn't take long. */
+    __atomic_store_n(&eventQueue->resizing, TRUE, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&eventQueue->reading, __ATOMIC_SEQ_CST))
+        mieqRelax();
+
+    n_enqueued = mieqNumEnqueued(eventQueue);
+
+    /* Then copy the existing events */
+    first_hunk = eventQueue->nevents - eventQueue->head;
+    if (eventQueue->events) {
+        memcpy(new_events,
+               &eventQueue->events[eventQueue->head],
+               first_hunk * sizeof(EventRec));
+        memcpy(&new_events[first_hunk],
+               eventQueue->events, eventQueue->head * sizeof(EventRec));
+    }
+
     /* And update our record */
     eventQueue->tail = n_enqueued;
     eventQueue->head = 0;
     eventQueue->nevents = new_nevents;
     free(eventQueue->events);
     eventQueue->events = new_events;
+    __atomic_store_n(&eventQueue->resizing, FALSE, __ATOMIC_SEQ_CST);
 
     return TRUE;
 }
@@ -206,6 +253,8 @@ mieqEnqueue(DeviceIntPtr pDev, InternalEvent *e)
     int evlen;
     Time time;
     size_t n_enqueued;
+    int ready = EVENT_READY;
+    Bool merge = FALSE;
 
     verify_internal_event(e);
 
@@ -215,17 +264,29 @@ mieqEnqueue(DeviceIntPtr pDev, InternalEvent *e)
     if (e->any.type == ET_Motion)
         isMotion = pDev->id;
 
+    /* the last event can only be replaced as long as the consumer hasn't
+     * started on it */
     if (isMotion && isMotion == miEventQueue.lastMotion &&
-        oldtail != miEventQueue.head) {
-        oldtail = (oldtail - 1) % miEventQueue.nevents;
+        oldtail != __atomic_load_n(&miEventQueue.head, __ATOMIC_ACQUIRE)) {
+        unsigned int last = (oldtail - 1) % miEventQueue.nevents;
+
+        if (__atomic_compare_exchange_n(&miEventQueue.events[last].state,
+                                        &ready, EVENT_WRITING, FALSE,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            oldtail = last;
+            merge = TRUE;
+        }
     }
-    else if (n_enqueued + 1 == miEventQueue.nevents) {
+    if (!merge && n_enqueued + 1 == miEventQueue.nevents) {
         if (!mieqGrowQueue(&miEventQueue, miEventQueue.nevents << 1)) {
             /* Toss events which come in late.  Usually this means your server's
              * stuck in an infinite loop in the main thread.
+             * The consumer resets the count once it has caught up.
              */
-            miEventQueue.dropped++;
-            if (miEventQueue.dropped == 1) {
+            size_t dropped = __atomic_add_fetch(&miEventQueue.dropped, 1,
+                                                __ATOMIC_RELAXED);
+
+            if (dropped == 1) {
                 ErrorFSigSafe("[mi] EQ overflowing.  Additional events will be "
                               "discarded until existing events are processed.\n");
                 xorg_backtrace();
@@ -233,12 +294,12 @@ mieqEnqueue(DeviceIntPtr pDev, InternalEvent *e)
                               "a culprit higher up the stack.\n");
                 ErrorFSigSafe("[mi] mieq is *NOT* the cause.  It is a victim.\n");
             }
-            else if (miEventQueue.dropped % QUEUE_DROP_BACKTRACE_FREQUENCY == 0 &&
-                     miEventQueue.dropped / QUEUE_DROP_BACKTRACE_FREQUENCY <=
+            else if (dropped % QUEUE_DROP_BACKTRACE_FREQUENCY == 0 &&
+                     dropped / QUEUE_DROP_BACKTRACE_FREQUENCY <=
                      QUEUE_DROP_BACKTRACE_MAX) {
                 ErrorFSigSafe("[mi] EQ overflow continuing.  %zu events have been "
-                              "dropped.\n", miEventQueue.dropped);
-                if (miEventQueue.dropped / QUEUE_DROP_BACKTRACE_FREQUENCY ==
+                              "dropped.\n", dropped);
+                if (dropped / QUEUE_DROP_BACKTRACE_FREQUENCY ==
                     QUEUE_DROP_BACKTRACE_MAX) {
                     ErrorFSigSafe("[mi] No further overflow reports will be "
                                   "reported until the clog is cleared.\n");
@@ -266,7 +327,12 @@ mieqEnqueue(DeviceIntPtr pDev, InternalEvent *e)
     miEventQueue.events[oldtail].pDev = pDev;
 
     miEventQueue.lastMotion = isMotion;
-    miEventQueue.tail = (oldtail + 1) % miEventQueue.nevents;
+    __atomic_store_n(&miEventQueue.events[oldtail].state, EVENT_READY,
+                     __ATOMIC_RELEASE);
+    if (!merge)
+        __atomic_store_n(&miEventQueue.tail,
+                         (oldtail + 1) % miEventQueue.nevents,
+                         __ATOMIC_RELEASE);
 }
 
 /**
@@ -511,17 +577,62 @@ mieqProcessDeviceEvent(DeviceIntPtr dev, InternalEvent *event, ScreenPtr screen)
     }
 }
 
+/*
+ * Take the event at the head of the queue off it, without input_lock().
+ * FALSE if the queue is empty.
+ */
+static Bool
+mieqDequeue(EventQueuePtr eventQueue, InternalEvent *event,
+            DeviceIntPtr *dev, ScreenPtr *screen)
+{
+    HWEventQueueType head;
+    EventPtr e;
+    int ready;
+
+    for (;;) {
+        __atomic_store_n(&eventQueue->reading, TRUE, __ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&eventQueue->resizing, __ATOMIC_SEQ_CST))
+            break;
+        __atomic_store_n(&eventQueue->reading, FALSE, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&eventQueue->resizing, __ATOMIC_SEQ_CST))
+            mieqRelax();
+    }
+
+    head = eventQueue->head;
+    if (head == __atomic_load_n(&eventQueue->tail, __ATOMIC_ACQUIRE)) {
+        __atomic_store_n(&eventQueue->reading, FALSE, __ATOMIC_RELEASE);
+        return FALSE;
+    }
+
+    /* a motion event may be getting merged into it just now */
+    e = &eventQueue->events[head];
+    ready = EVENT_READY;
+    while (!__atomic_compare_exchange_n(&e->state, &ready, EVENT_FREE,
+                                        FALSE, __ATOMIC_ACQUIRE,
+                                        __ATOMIC_RELAXED)) {
+        ready = EVENT_READY;
+        mieqRelax();
+    }
+
+    *event = *e->events;
+    *dev = e->pDev;
+    *screen = e->pScreen;
+
+    __atomic_store_n(&eventQueue->head, (head + 1) % eventQueue->nevents,
+                     __ATOMIC_RELEASE);
+    __atomic_store_n(&eventQueue->reading, FALSE, __ATOMIC_RELEASE);
+    return TRUE;
+}
+
 /* Call this from ProcessInputEvents(). */
 void
 mieqProcessInputEvents(void)
 {
-    EventRec *e = NULL;
     ScreenPtr screen;
     InternalEvent event;
     DeviceIntPtr dev = NULL, master = NULL;
     static Bool inProcessInputEvents = FALSE;
-
-    input_lock();
+    size_t dropped;
 
     /*
      * report an error if mieqProcessInputEvents() is called recursively;
@@ -531,25 +642,17 @@ mieqProcessInputEvents(void)
     BUG_WARN_MSG(inProcessInputEvents, "[mi] mieqProcessInputEvents() called recursively.\n");
     inProcessInputEvents = TRUE;
 
-    if (miEventQueue.dropped) {
+    dropped = __atomic_exchange_n(&miEventQueue.dropped, 0, __ATOMIC_RELAXED);
+    if (dropped) {
         ErrorF("[mi] EQ processing has resumed after %lu dropped events.\n",
-               (unsigned long) miEventQueue.dropped);
+               (unsigned long) dropped);
         ErrorF
             ("[mi] This may be caused by a misbehaving driver monopolizing the server's resources.\n");
-        miEventQueue.dropped = 0;
     }
 
-    while (miEventQueue.head != miEventQueue.tail) {
-        e = &miEventQueue.events[miEventQueue.head];
-
-        event = *e->events;
-        dev = e->pDev;
-        screen = e->pScreen;
-
-        miEventQueue.head = (miEventQueue.head + 1) % miEventQueue.nevents;
-
-        input_unlock();
-
+    /* whatever this pass sends a client goes out in one write */
+    BeginOutputBatch();
+    while (mieqDequeue(&miEventQueue, &event, &dev, &screen)) {
         master = (dev) ? GetMaster(dev, MASTER_ATTACHED) : NULL;
 
         if (screenIsSaved == SCREEN_SAVER_ON)
@@ -571,14 +674,14 @@ mieqProcessInputEvents(void)
                event.any.type == ET_TouchUpdate) &&
               event.device_event.flags & TOUCH_POINTER_EMULATED)))
             miPointerUpdateSprite(dev);
-
-        input_lock();
     }
+    EndOutputBatch();
 
     inProcessInputEvents = FALSE;
 
+    /* the callback list is only ever changed with the lock held */
+    input_lock();
     CallCallbacks(&miCallbacksWhenDrained, NULL);
-
     input_unlock();
 }
 
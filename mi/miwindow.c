@@ -51,6 +51,7 @@ SOFTWARE.
 
 #include "dix/cursor_priv.h"
 #include "dix/input_priv.h"
+#include "dix/windowindex_priv.h"
 
 #include "regionstr.h"
 #include "region.h"
@@ -134,6 +135,23 @@ miMarkWindow(WindowPtr pWin)
     pWin->valdata = val;
 }
 
+/*
+ * Whether pChild's clip can change when pWin comes to cover box, having
+ * covered left before: it either loses some of what it shows to box, or
+ * gets some of what pWin leaves behind.  Without left, anything pWin's
+ * extents overlap has to be recomputed.
+ */
+static Bool
+miClipMayChange(WindowPtr pChild, BoxPtr box, RegionPtr left)
+{
+    if (!left || RegionBroken(&pChild->borderClip))
+        return RegionContainsRect(&pChild->borderSize, box) != rgnOUT;
+    if (RegionContainsRect(&pChild->borderClip, box) != rgnOUT)
+        return TRUE;
+    return RegionNotEmpty(left) &&
+        RegionContainsRect(left, RegionExtents(&pChild->borderSize)) != rgnOUT;
+}
+
 Bool
 miMarkOverlappedWindows(WindowPtr pWin, WindowPtr pFirst, WindowPtr *ppLayerWin)
 {
@@ -174,17 +192,49 @@ miMarkOverlappedWindows(WindowPtr pWin, WindowPtr pFirst, WindowPtr *ppLayerWin)
         pFirst = pFirst->nextSib;
     }
     if ((pChild = pFirst)) {
+        WindowPtr pSiblings = pChild->parent;
+        RegionPtr left = NULL;
+        RegionRec below;
+
         box = RegionExtents(&pWin->borderSize);
-        pLast = pChild->parent->lastChild;
+        pLast = pSiblings->lastChild;
+
+        /*
+         * Until validated, pWin's borderClip still is where it was visible,
+         * which is all it can give up to the windows below.  Each sibling
+         * takes what is in its way, so less of it gets further down.  Not
+         * so when pWin is redirected: then its borderClip isn't clipped by
+         * its siblings.
+         */
+#ifdef COMPOSITE
+        if (pWin->redirectDraw == RedirectDrawNone)
+#endif
+            if (!RegionBroken(&pWin->borderClip))
+                left = &pWin->borderClip;
+        if (left) {
+            RegionNull(&below);
+            RegionCopy(&below, left);
+        }
+
         while (1) {
             if (pChild->viewable) {
+                Bool sibling = pChild->parent == pSiblings;
+
                 if (RegionBroken(&pChild->winSize))
                     SetWinSize(pChild);
                 if (RegionBroken(&pChild->borderSize))
                     SetBorderSize(pChild);
-                if (RegionContainsRect(&pChild->borderSize, box)) {
+                if (pChild == pWin ||
+                    miClipMayChange(pChild, box,
+                                    sibling && left ? &below : left)) {
                     (*MarkWindow) (pChild);
                     anyMarked = TRUE;
+                    if (sibling && left && RegionNotEmpty(&below)
+#ifdef COMPOSITE
+                        && pChild->redirectDraw != RedirectDrawManual
+#endif
+                        )
+                        RegionSubtract(&below, &below, &pChild->borderSize);
                     if (pChild->firstChild) {
                         pChild = pChild->firstChild;
                         continue;
@@ -197,6 +247,8 @@ miMarkOverlappedWindows(WindowPtr pWin, WindowPtr pFirst, WindowPtr *ppLayerWin)
                 break;
             pChild = pChild->nextSib;
         }
+        if (left)
+            RegionUninit(&below);
     }
     if (anyMarked)
         (*MarkWindow) (pWin->parent);
@@ -747,46 +799,68 @@ miMarkUnrealizedWindow(WindowPtr pChild, WindowPtr pWin, Bool fromConfigure)
     }
 }
 
+static Bool
+miSpriteHit(WindowPtr pWin, int x, int y)
+{
+    BoxRec box;
+
+    return (pWin->mapped) &&
+        (x >= pWin->drawable.x - wBorderWidth(pWin)) &&
+        (x < pWin->drawable.x + (int) pWin->drawable.width +
+         wBorderWidth(pWin)) &&
+        (y >= pWin->drawable.y - wBorderWidth(pWin)) &&
+        (y < pWin->drawable.y + (int) pWin->drawable.height +
+         wBorderWidth(pWin))
+        /* When a window is shaped, a further check
+         * is made to see if the point is inside
+         * borderSize
+         */
+        && (!wBoundingShape(pWin) || PointInBorderSize(pWin, x, y))
+        && (!wInputShape(pWin) ||
+            RegionContainsPoint(wInputShape(pWin),
+                                x - pWin->drawable.x,
+                                y - pWin->drawable.y, &box))
+        /* In rootless mode windows may be offscreen, even when
+         * they're in X's stack. (E.g. if the native window system
+         * implements some form of virtual desktop system).
+         */
+        && !pWin->unhittable;
+}
+
+/* The topmost child of pParent under x,y */
+static WindowPtr
+miSpriteTraceChild(WindowPtr pParent, int x, int y)
+{
+    WindowPtr pWin;
+    int n = 0;
+
+    if (WindowIndexPick(pParent, x, y, miSpriteHit, &pWin))
+        return pWin;
+
+    for (pWin = pParent->firstChild; pWin; pWin = pWin->nextSib, n++)
+        if (miSpriteHit(pWin, x, y))
+            break;
+    /* next time, skip the walk if it was a long one */
+    if (n >= WINDOW_INDEX_MIN_CHILDREN)
+        WindowIndexCreate(pParent);
+    return pWin;
+}
+
 WindowPtr
 miSpriteTrace(SpritePtr pSprite, int x, int y)
 {
     WindowPtr pWin;
-    BoxRec box;
 
-    pWin = DeepestSpriteWin(pSprite)->firstChild;
+    pWin = miSpriteTraceChild(DeepestSpriteWin(pSprite), x, y);
     while (pWin) {
-        if ((pWin->mapped) &&
-            (x >= pWin->drawable.x - wBorderWidth(pWin)) &&
-            (x < pWin->drawable.x + (int) pWin->drawable.width +
-             wBorderWidth(pWin)) &&
-            (y >= pWin->drawable.y - wBorderWidth(pWin)) &&
-            (y < pWin->drawable.y + (int) pWin->drawable.height +
-             wBorderWidth(pWin))
-            /* When a window is shaped, a further check
-             * is made to see if the point is inside
-             * borderSize
-             */
-            && (!wBoundingShape(pWin) || PointInBorderSize(pWin, x, y))
-            && (!wInputShape(pWin) ||
-                RegionContainsPoint(wInputShape(pWin),
-                                    x - pWin->drawable.x,
-                                    y - pWin->drawable.y, &box))
-            /* In rootless mode windows may be offscreen, even when
-             * they're in X's stack. (E.g. if the native window system
-             * implements some form of virtual desktop system).
-             */
-            && !pWin->unhittable) {
-            if (pSprite->spriteTraceGood >= pSprite->spriteTraceSize) {
-                pSprite->spriteTraceSize += 10;
-                pSprite->spriteTrace = reallocarray(pSprite->spriteTrace,
-                                                    pSprite->spriteTraceSize,
-                                                    sizeof(WindowPtr));
-            }
-            pSprite->spriteTrace[pSprite->spriteTraceGood++] = pWin;
-            pWin = pWin->firstChild;
+        if (pSprite->spriteTraceGood >= pSprite->spriteTraceSize) {
+            pSprite->spriteTraceSize += 10;
+            pSprite->spriteTrace = reallocarray(pSprite->spriteTrace,
+                                                pSprite->spriteTraceSize,
+                                                sizeof(WindowPtr));
         }
-        else
-            pWin = pWin->nextSib;
+        pSprite->spriteTrace[pSprite->spriteTraceGood++] = pWin;
+        pWin = miSpriteTraceChild(pWin, x, y);
     }
     return DeepestSpriteWin(pSprite);
 }
@@ -1677,10 +1677,13 @@ DamageSetup(ScreenPtr pScreen)
         (&damageGCPrivateKeyRec, PRIVATE_GC, sizeof(DamageGCPrivRec)))
         return FALSE;
 
-    if (!dixRegisterPrivateKey(&damagePixPrivateKeyRec, PRIVATE_PIXMAP, 0))
+    /* looked up on every drawing operation */
+    if (!dixRegisterPrivateKeyHotness(&damagePixPrivateKeyRec, PRIVATE_PIXMAP,
+                                      0, PRIVATE_KEY_HOT))
         return FALSE;
 
-    if (!dixRegisterPrivateKey(&damageWinPrivateKeyRec, PRIVATE_WINDOW, 0))
+    if (!dixRegisterPrivateKeyHotness(&damageWinPrivateKeyRec, PRIVATE_WINDOW,
+                                      0, PRIVATE_KEY_HOT))
         return FALSE;
 
     pScrPriv = malloc(sizeof(DamageScrPrivRec));
@@ -51,6 +51,7 @@ typedef struct _SyncCounter {
     SyncObject sync;            /* Common sync object data */
     int64_t value;              /* counter value */
     struct _SysCounterInfo *pSysCounterInfo; /* NULL if not a system counter */
+    struct _SyncCounterIndex *pIndex; /* triggers by test value */
 } SyncCounter;
 
 struct _SyncFence {
@@ -71,6 +72,9 @@ struct _SyncTrigger {
                          int64_t newval);
     void (*TriggerFired)(struct _SyncTrigger *pTrigger);
     void (*CounterDestroyed)(struct _SyncTrigger *pTrigger);
+    int index_list;             /* list in the counter's index, or -1 */
+    int index_pending;          /* slot among the triggers being fired */
+    int64_t index_value;        /* test value it is indexed under */
 };
 
 typedef struct _SyncTriggerList {
@@ -96,9 +96,10 @@ SOFTWARE.
 #endif
 
 struct _OsTimerRec {
-    struct xorg_list list;
+    int index;                  /* in the timer heap, -1 if not pending */
     CARD32 expires;
     CARD32 delta;
+    CARD32 seq;                 /* when it was set, for timers due together */
     OsTimerCallback callback;
     void *arg;
 };
@@ -106,15 +107,99 @@ struct _OsTimerRec {
 static void DoTimer(OsTimerPtr timer, CARD32 now);
 static void DoTimers(CARD32 now);
 static void CheckAllTimers(void);
-static volatile struct xorg_list timers;
+
+/*
+ * Pending timers are kept in a binary heap ordered by expiry, earliest
+ * first, and those due at the same time in the order they were set.
+ * The heap always has room for every timer allocated, so scheduling a
+ * timer can't fail.
+ */
+static OsTimerPtr *timer_heap;
+static int timer_count;         /* pending */
+static int timer_space;         /* room in timer_heap */
+static int timer_allocated;
+static CARD32 timer_seq;
+
+static uint64_t wakeups;        /* returns from poll() */
+
+static inline Bool
+timer_before(OsTimerPtr a, OsTimerPtr b)
+{
+    if (a->expires != b->expires)
+        return (int) (a->expires - b->expires) < 0;
+    return (int) (a->seq - b->seq) < 0;
+}
+
+static inline void
+timer_heap_place(OsTimerPtr timer, int i)
+{
+    timer_heap[i] = timer;
+    timer->index = i;
+}
+
+static void
+timer_heap_up(OsTimerPtr timer, int i)
+{
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+
+        if (!timer_before(timer, timer_heap[parent]))
+            break;
+        timer_heap_place(timer_heap[parent], i);
+        i = parent;
+    }
+    timer_heap_place(timer, i);
+}
+
+static void
+timer_heap_down(OsTimerPtr timer, int i)
+{
+    for (;;) {
+        int child = 2 * i + 1;
+
+        if (child >= timer_count)
+            break;
+        if (child + 1 < timer_count &&
+            timer_before(timer_heap[child + 1], timer_heap[child]))
+            child++;
+        if (!timer_before(timer_heap[child], timer))
+            break;
+        timer_heap_place(timer_heap[child], i);
+        i = child;
+    }
+    timer_heap_place(timer, i);
+}
+
+static void
+timer_heap_insert(OsTimerPtr timer)
+{
+    timer->seq = timer_seq++;
+    timer_heap_up(timer, timer_count++);
+}
+
+static void
+timer_heap_remove(OsTimerPtr timer)
+{
+    int i = timer->index;
+    OsTimerPtr last;
+
+    if (i < 0)
+        return;
+    timer->index = -1;
+    last = timer_heap[--timer_count];
+    if (last == timer)
+        return;
+    /* the last timer fills the hole, and may have to go either way */
+    if (i > 0 && timer_before(last, timer_heap[(i - 1) / 2]))
+        timer_heap_up(last, i);
+    else
+        timer_heap_down(last, i);
+}
 
 static inline OsTimerPtr
 first_timer(void)
 {
-    /* inline xorg_list_is_empty which can't handle volatile */
-    if (timers.next == &timers)
-        return NULL;
-    return xorg_list_first_entry(&timers, struct _OsTimerRec, list);
+    return timer_count ? timer_heap[0] : NULL;
 }
 
 /*
@@ -126,15 +211,20 @@ check_timers(void)
 {
     OsTimerPtr timer;
 
-    if ((timer = first_timer()) != NULL) {
-        CARD32 now = GetTimeInMillis();
+    /* the input thread sets timers too */
+    input_lock();
+    timer = first_timer();
+    if (timer != NULL) {
+        CARD32 now = GetCachedTimeInMillis();
         int timeout = timer->expires - now;
+        CARD32 delta = timer->delta;
 
+        input_unlock();
         if (timeout <= 0) {
             DoTimers(now);
         } else {
             /* Make sure the timeout is sane */
-            if (timeout < timer->delta + 250)
+            if (timeout < delta + 250)
                 return timeout;
 
             /* time has rewound.  reset the timers. */
@@ -143,6 +233,7 @@ check_timers(void)
 
         return 0;
     }
+    input_unlock();
     return -1;
 }
 
@@ -183,6 +274,9 @@ WaitForSomething(Bool are_ready)
 
     busfault_check();
 
+    /* timers need the time as of now, not as of the last request */
+    InvalidateCachedTime();
+
     /* We need a while loop here to handle
        crashed connections and the screen saver timeout */
     while (1) {
@@ -201,9 +295,12 @@ WaitForSomething(Bool are_ready)
         /* keep this check close to select() call to minimize race */
         if (dispatchException)
             i = -1;
-        else
+        else {
             i = ospoll_wait(server_poll, timeout);
+            wakeups++;
+        }
         pollerr = GetErrno();
+        InvalidateCachedTime();
         WakeupHandler(i);
         if (i <= 0) {           /* An error or timeout occurred */
             if (dispatchException)
@@ -229,6 +326,13 @@ WaitForSomething(Bool are_ready)
     }
 }
 
+/* How often WaitForSomething() has come back from poll(), timeouts included. */
+uint64_t
+WaitForSomethingWakeups(void)
+{
+    return wakeups;
+}
+
 void
 AdjustWaitForDelay(void *waitTime, int newdelay)
 {
@@ -240,22 +344,24 @@ AdjustWaitForDelay(void *waitTime, int newdelay)
 }
 
 static inline Bool timer_pending(OsTimerPtr timer) {
-    return !xorg_list_is_empty(&timer->list);
+    return timer->index >= 0;
 }
 
 /* If time has rewound, re-run every affected timer.
- * Timers might drop out of the list, so we have to restart every time. */
+ * Timers might drop out of the heap, so we have to restart every time. */
 static void
 CheckAllTimers(void)
 {
     OsTimerPtr timer;
     CARD32 now;
+    int i;
 
     input_lock();
  start:
     now = GetTimeInMillis();
 
-    xorg_list_for_each_entry(timer, &timers, list) {
+    for (i = 0; i < timer_count; i++) {
+        timer = timer_heap[i];
         if (timer->expires - now > timer->delta + 250) {
             DoTimer(timer, now);
             goto start;
@@ -269,7 +375,7 @@ DoTimer(OsTimerPtr timer, CARD32 now)
 {
     CARD32 newTime;
 
-    xorg_list_del(&timer->list);
+    timer_heap_remove(timer);
     newTime = (*timer->callback) (timer, now, timer->arg);
     if (newTime)
         TimerSet(timer, 0, newTime, timer->callback, timer->arg);
@@ -289,23 +395,50 @@ DoTimers(CARD32 now)
     input_unlock();
 }
 
+static OsTimerPtr
+AllocTimer(void)
+{
+    OsTimerPtr timer;
+
+    timer = calloc(1, sizeof(struct _OsTimerRec));
+    if (!timer)
+        return NULL;
+    timer->index = -1;
+
+    input_lock();
+    if (timer_allocated == timer_space) {
+        int space = timer_space ? timer_space * 2 : 64;
+        OsTimerPtr *heap = reallocarray(timer_heap, space, sizeof(OsTimerPtr));
+
+        if (!heap) {
+            input_unlock();
+            free(timer);
+            return NULL;
+        }
+        timer_heap = heap;
+        timer_space = space;
+    }
+    timer_allocated++;
+    input_unlock();
+
+    return timer;
+}
+
 OsTimerPtr
 TimerSet(OsTimerPtr timer, int flags, CARD32 millis,
          OsTimerCallback func, void *arg)
 {
-    OsTimerPtr existing;
     CARD32 now = GetTimeInMillis();
 
     if (!timer) {
-        timer = calloc(1, sizeof(struct _OsTimerRec));
+        timer = AllocTimer();
         if (!timer)
             return NULL;
-        xorg_list_init(&timer->list);
     }
     else {
         input_lock();
         if (timer_pending(timer)) {
-            xorg_list_del(&timer->list);
+            timer_heap_remove(timer);
             if (flags & TimerForceOld)
                 (void) (*timer->callback) (timer, now, timer->arg);
         }
@@ -325,12 +458,7 @@ TimerSet(OsTimerPtr timer, int flags, CARD32 millis,
     timer->arg = arg;
     input_lock();
 
-    /* Sort into list */
-    xorg_list_for_each_entry(existing, &timers, list)
-        if ((int) (existing->expires - millis) > 0)
-            break;
-    /* This even works at the end of the list -- existing->list will be timers */
-    xorg_list_append(&timer->list, &existing->list);
+    timer_heap_insert(timer);
 
     /* Check to see if the timer is ready to run now */
     if ((int) (millis - now) <= 0)
@@ -359,7 +487,7 @@ TimerCancel(OsTimerPtr timer)
     if (!timer)
         return;
     input_lock();
-    xorg_list_del(&timer->list);
+    timer_heap_remove(timer);
     input_unlock();
 }
 
@@ -369,6 +497,9 @@ TimerFree(OsTimerPtr timer)
     if (!timer)
         return;
     TimerCancel(timer);
+    input_lock();
+    timer_allocated--;
+    input_unlock();
     free(timer);
 }
 
@@ -381,16 +512,10 @@ TimerCheck(void)
 void
 TimerInit(void)
 {
-    static Bool been_here;
-    OsTimerPtr timer, tmp;
-
-    if (!been_here) {
-        been_here = TRUE;
-        xorg_list_init((struct xorg_list*) &timers);
-    }
+    while (timer_count > 0) {
+        OsTimerPtr timer = timer_heap[--timer_count];
 
-    xorg_list_for_each_entry_safe(timer, tmp, &timers, list) {
-        xorg_list_del(&timer->list);
+        timer_allocated--;
         free(timer);
     }
 }
@@ -98,6 +98,7 @@ SOFTWARE.
 #include "os/audit.h"
 #include "os/auth.h"
 #include "os/osdep.h"
+#include "os/readthread.h"
 
 #include "misc.h"               /* for typedef of pointer */
 #include "dixstruct_priv.h"
@@ -599,7 +600,10 @@ ClientReady(int fd, int xevents, void *data)
     if (xevents & X_NOTIFY_READ)
         mark_client_ready(client);
     if (xevents & X_NOTIFY_WRITE) {
+        OsCommPtr oc = client->osPrivate;
+
         ospoll_mute(server_poll, fd, X_NOTIFY_WRITE);
+        oc->flags &= ~OS_COMM_BLOCKED;
         NewOutputPending = TRUE;
     }
 }
@@ -620,6 +624,9 @@ AllocNewConnection(XtransConnInfo trans_conn, int fd, CARD32 conn_time)
     oc->auth_id = None;
     oc->conn_time = conn_time;
     oc->flags = 0;
+    oc->inputHint = 0;
+    oc->outputHint = 0;
+    oc->reader = NULL;
     if (!(client = NextAvailableClient((void *) oc))) {
         free(oc);
         return NullClient;
@@ -754,6 +761,7 @@ CloseDownFileDescriptor(OsCommPtr oc)
 #ifdef XDMCP
         XdmcpCloseDisplay(connection);
 #endif
+        ReadThreadRemoveClient(oc);
         ospoll_remove(server_poll, connection);
         _XSERVTransDisconnect(oc->trans_conn);
         _XSERVTransClose(oc->trans_conn);
@@ -1098,7 +1106,12 @@ set_poll_client(ClientPtr client)
 {
     OsCommPtr oc = (OsCommPtr) client->osPrivate;
 
-    if (oc->trans_conn) {
+    if (oc->reader) {
+        /* the reader thread does the polling */
+        if (listen_to_client(client) && ReadThreadPending(client))
+            mark_client_ready(client);
+    }
+    else if (oc->trans_conn) {
         if (listen_to_client(client))
             ospoll_listen(server_poll, oc->trans_conn->fd, X_NOTIFY_READ);
         else
@@ -74,6 +74,7 @@ SOFTWARE.
 #include <X11/Xproto.h>
 
 #include "dix/dix_priv.h"
+#include "os/readthread.h"
 
 #include "os.h"
 #include "osdep.h"
@@ -94,17 +95,38 @@ typedef struct _connectionInput {
     unsigned int ignoreBytes;   /* bytes to ignore before the next request */
 } ConnectionInput;
 
+/*
+ * Large payloads handed over by WriteToClientNoCopy() are not copied into
+ * the output buffer but referenced from it: the data of a reference goes
+ * out after the first "at" bytes of the buffer and before the rest.
+ */
+typedef struct _outputRef {
+    struct _outputRef *next;
+    int at;
+    const char *data;           /* next byte to write */
+    int count;                  /* bytes left to write */
+    void *base;
+    ClientOutputReleaseProcPtr release;
+} OutputRef, *OutputRefPtr;
+
 typedef struct _connectionOutput {
     struct _connectionOutput *next;
     unsigned char *buf;
     int size;
     int count;
+    int tail;                   /* start of the last write if still whole, or -1 */
+    OutputRefPtr refs;          /* in stream order */
 } ConnectionOutput;
 
-static ConnectionInputPtr AllocateInputBuffer(void);
-static ConnectionOutputPtr AllocateOutputBuffer(void);
+static ConnectionInputPtr AllocateInputBuffer(int size);
+static ConnectionOutputPtr AllocateOutputBuffer(int size);
+static void ReleaseInputBuffer(ConnectionInputPtr oci);
+static void ReleaseOutputBuffer(ConnectionOutputPtr oco);
+
+OsBufferStatsRec OsBufferStats;
 
 static Bool CriticalOutputPending;
+static int OutputBatchDepth;
 static int timesThisConnection = 0;
 static ConnectionInputPtr FreeInputs = (ConnectionInputPtr) NULL;
 static ConnectionOutputPtr FreeOutputs = (ConnectionOutputPtr) NULL;
@@ -120,7 +142,94 @@ static OsCommPtr AvailableInput = (OsCommPtr) NULL;
 				  ((xBigReq *)(req))->length)
 
 #define BUFSIZE 16384
-#define BUFWATERMARK 32768
+#define OUTPUT_IOV_MAX 64
+
+/*
+ * Data buffers come in power of two size classes starting at BUFSIZE and
+ * go back to a pool when released, so that clients coming and going or
+ * the odd big request don't keep hitting malloc.  Larger classes keep
+ * fewer buffers around, sizes beyond the largest class aren't pooled.
+ */
+#define POOL_CLASSES 7          /* BUFSIZE up to 1MB */
+#define POOL_MAX_FREE 32        /* buffers kept in the smallest class */
+#define POOL_MAX_SIZE ((long) BUFSIZE << (POOL_CLASSES - 1))
+
+typedef struct _poolBuffer {
+    struct _poolBuffer *next;
+} PoolBuffer;
+
+static struct {
+    PoolBuffer *free;
+    int count;
+} BufferPool[POOL_CLASSES];
+
+/* the smallest class holding size bytes, POOL_CLASSES if there is none */
+static int
+PoolClass(long size)
+{
+    int cls = 0;
+
+    while (cls < POOL_CLASSES && ((long) BUFSIZE << cls) < size)
+        cls++;
+    return cls;
+}
+
+/* the size of the buffer GetPoolBuffer() hands out for size bytes */
+static long
+PoolSize(long size)
+{
+    int cls = PoolClass(size);
+
+    return cls < POOL_CLASSES ? (long) BUFSIZE << cls : size;
+}
+
+/* size must come from PoolSize() */
+static void *
+GetPoolBuffer(long size)
+{
+    int cls = PoolClass(size);
+    PoolBuffer *buf;
+
+    if (cls < POOL_CLASSES && (buf = BufferPool[cls].free)) {
+        BufferPool[cls].free = buf->next;
+        BufferPool[cls].count--;
+        OsBufferStats.poolHits++;
+        return buf;
+    }
+    OsBufferStats.poolMisses++;
+    return malloc(size);
+}
+
+static void
+PutPoolBuffer(void *data, long size)
+{
+    int cls = PoolClass(size);
+    PoolBuffer *buf = data;
+
+    if (cls < POOL_CLASSES && size == (long) BUFSIZE << cls &&
+        BufferPool[cls].count < max(POOL_MAX_FREE >> cls, 2)) {
+        buf->next = BufferPool[cls].free;
+        BufferPool[cls].free = buf;
+        BufferPool[cls].count++;
+    }
+    else
+        free(data);
+}
+
+/*
+ * Clients get buffers sized after what they recently needed: the hints
+ * follow the largest recent request and output backlog and decay back
+ * with every update, so a single big request doesn't stick.
+ */
+static void
+UpdateSizeHint(int *hint, long size)
+{
+    *hint -= *hint >> 4;
+    if (size > POOL_MAX_SIZE)
+        size = POOL_MAX_SIZE;
+    if (size > *hint)
+        *hint = size;
+}
 
 /*
  *   A lot of the code in this file manipulates a ConnectionInputPtr:
@@ -200,32 +309,37 @@ YieldControlDeath(void)
     timesThisConnection = 0;
 }
 
-/* If an input buffer was empty, either free it if it is too big or link it
- * into our list of free input buffers.  This means that different clients can
- * share the same input buffer (at different times).  This was done to save
- * memory.
+/* If an input buffer was empty, give it back to the pool.  This means that
+ * different clients can share the same input buffer (at different times).
+ * This was done to save memory.
  */
 static void
 NextAvailableInput(OsCommPtr oc)
 {
     if (AvailableInput) {
         if (AvailableInput != oc) {
-            ConnectionInputPtr aci = AvailableInput->input;
-
-            if (aci->size > BUFWATERMARK) {
-                free(aci->buffer);
-                free(aci);
-            }
-            else {
-                aci->next = FreeInputs;
-                FreeInputs = aci;
-            }
+            ReleaseInputBuffer(AvailableInput->input);
             AvailableInput->input = NULL;
         }
         AvailableInput = NULL;
     }
 }
 
+/* ReadRequestFromClient() for a client with a reader thread */
+static int
+ReadRequestFromThread(ClientPtr client)
+{
+    int result = ReadThreadNextRequest(client);
+
+    if (result < 0)
+        YieldControlDeath();
+    else if (result == 0) {
+        mark_client_not_ready(client);
+        YieldControlNoInput(client);
+    }
+    return result;
+}
+
 int
 ReadRequestFromClient(ClientPtr client)
 {
@@ -239,13 +353,13 @@ ReadRequestFromClient(ClientPtr client)
 
     NextAvailableInput(oc);
 
+    if (oc->reader)
+        return ReadRequestFromThread(client);
+
     /* make sure we have an input buffer */
 
     if (!oci) {
-        if ((oci = FreeInputs)) {
-            FreeInputs = oci->next;
-        }
-        else if (!(oci = AllocateInputBuffer())) {
+        if (!(oci = AllocateInputBuffer(oc->inputHint))) {
             YieldControlDeath();
             return -1;
         }
@@ -268,6 +382,21 @@ ReadRequestFromClient(ClientPtr client)
     move_header = FALSE;
     gotnow = oci->bufcnt + oci->buffer - oci->bufptr;
 
+    /* once the client is set up, a reader thread may take over */
+    if (ReadThreadCount && !gotnow && !oci->ignoreBytes &&
+        client->clientState == ClientStateRunning &&
+        !(oc->flags & OS_COMM_NO_READ_THREAD)) {
+        if (ReadThreadAddClient(client)) {
+            ospoll_mute(server_poll, oc->fd, X_NOTIFY_READ);
+            if (AvailableInput == oc)
+                AvailableInput = (OsCommPtr) NULL;
+            ReleaseInputBuffer(oci);
+            oc->input = (ConnectionInputPtr) NULL;
+            return ReadRequestFromThread(client);
+        }
+        oc->flags |= OS_COMM_NO_READ_THREAD;
+    }
+
     if (oci->ignoreBytes > 0) {
         if (oci->ignoreBytes > oci->size)
             needed = oci->size;
@@ -300,6 +429,8 @@ ReadRequestFromClient(ClientPtr client)
         }
         client->req_len = needed;
         needed <<= 2;           /* needed is in bytes now */
+        if (!need_header)
+            UpdateSizeHint(&oc->inputHint, needed);
     }
     if (gotnow < needed) {
         /* Need to read more data, either so that we can get a
@@ -322,21 +453,24 @@ ReadRequestFromClient(ClientPtr client)
         if ((gotnow == 0) || ((oci->bufptr - oci->buffer + needed) > oci->size)) {
             /* no data, or the request is too big to fit in the buffer */
 
-            if ((gotnow > 0) && (oci->bufptr != oci->buffer))
-                /* save the data we've already read */
-                memmove(oci->buffer, oci->bufptr, gotnow);
             if (needed > oci->size) {
-                /* make buffer bigger to accommodate request */
-                char *ibuf;
+                /* move to a buffer big enough for the request */
+                long size = PoolSize(needed);
+                char *ibuf = GetPoolBuffer(size);
 
-                ibuf = (char *) realloc(oci->buffer, needed);
                 if (!ibuf) {
                     YieldControlDeath();
                     return -1;
                 }
-                oci->size = needed;
+                if (gotnow > 0)
+                    memcpy(ibuf, oci->bufptr, gotnow);
+                PutPoolBuffer(oci->buffer, oci->size);
+                oci->size = size;
                 oci->buffer = ibuf;
             }
+            else if ((gotnow > 0) && (oci->bufptr != oci->buffer))
+                /* save the data we've already read */
+                memmove(oci->buffer, oci->bufptr, gotnow);
             oci->bufptr = oci->buffer;
             oci->bufcnt = gotnow;
         }
@@ -365,14 +499,16 @@ ReadRequestFromClient(ClientPtr client)
         }
         oci->bufcnt += result;
         gotnow += result;
-        /* free up some space after huge requests */
-        if ((oci->size > BUFWATERMARK) &&
-            (oci->bufcnt < BUFSIZE) && (needed < BUFSIZE)) {
+        /* free up some space once huge requests stop coming */
+        if (oci->size > PoolSize(oc->inputHint)) {
+            long size = PoolSize(oc->inputHint);
             char *ibuf;
 
-            ibuf = (char *) realloc(oci->buffer, BUFSIZE);
-            if (ibuf) {
-                oci->size = BUFSIZE;
+            if (oci->bufcnt <= size && needed <= size &&
+                (ibuf = GetPoolBuffer(size))) {
+                memcpy(ibuf, oci->buffer, oci->bufcnt);
+                PutPoolBuffer(oci->buffer, oci->size);
+                oci->size = size;
                 oci->buffer = ibuf;
                 oci->bufptr = ibuf + oci->bufcnt - gotnow;
             }
@@ -390,6 +526,7 @@ ReadRequestFromClient(ClientPtr client)
             }
             client->req_len = needed;
             needed <<= 2;
+            UpdateSizeHint(&oc->inputHint, needed);
         }
         if (gotnow < needed) {
             /* Still don't have enough; punt. */
@@ -505,12 +642,13 @@ InsertFakeRequest(ClientPtr client, char *data, int count)
     ConnectionInputPtr oci = oc->input;
     int gotnow, moveup;
 
+    /* only used for the connection setup, before a reader thread */
+    BUG_RETURN_VAL(oc->reader, FALSE);
+
     NextAvailableInput(oc);
 
     if (!oci) {
-        if ((oci = FreeInputs))
-            FreeInputs = oci->next;
-        else if (!(oci = AllocateInputBuffer()))
+        if (!(oci = AllocateInputBuffer(oc->inputHint)))
             return FALSE;
         oc->input = oci;
     }
@@ -518,12 +656,14 @@ InsertFakeRequest(ClientPtr client, char *data, int count)
     oci->lenLastReq = 0;
     gotnow = oci->bufcnt + oci->buffer - oci->bufptr;
     if ((gotnow + count) > oci->size) {
-        char *ibuf;
+        long size = PoolSize(gotnow + count);
+        char *ibuf = GetPoolBuffer(size);
 
-        ibuf = (char *) realloc(oci->buffer, gotnow + count);
         if (!ibuf)
             return FALSE;
-        oci->size = gotnow + count;
+        memcpy(ibuf, oci->buffer, oci->bufcnt);
+        PutPoolBuffer(oci->buffer, oci->size);
+        oci->size = size;
         oci->buffer = ibuf;
         oci->bufptr = ibuf + oci->bufcnt - gotnow;
     }
@@ -564,6 +704,14 @@ ResetCurrentRequest(ClientPtr client)
     register xReq *request;
     int gotnow, needed;
 
+    if (oc->reader) {
+        ReadThreadResetRequest(client);
+        if (listen_to_client(client))
+            mark_client_ready(client);
+        YieldControl();
+        return;
+    }
+
     if (AvailableInput == oc)
         AvailableInput = (OsCommPtr) NULL;
     oci->lenLastReq = 0;
@@ -631,6 +779,78 @@ FlushAllOutput(void)
     }
 }
 
+/*****************
+ * BeginOutputBatch, EndOutputBatch:
+ *    Local clients normally get their output written right away when
+ *    nothing of theirs is buffered.  Between these, it is buffered like
+ *    anyone else's, and EndOutputBatch writes it out, so that all that
+ *    was sent to a client in between goes out in one write.  Batches nest.
+ *****************/
+
+void
+BeginOutputBatch(void)
+{
+    OutputBatchDepth++;
+}
+
+void
+EndOutputBatch(void)
+{
+    ClientPtr client, tmp;
+
+    if (--OutputBatchDepth)
+        return;
+
+    xorg_list_for_each_entry_safe(client, tmp, &output_pending_clients, output_pending) {
+        OsCommPtr oc = (OsCommPtr) client->osPrivate;
+
+        if (!(oc->flags & OS_COMM_BATCHED))
+            continue;
+        oc->flags &= ~OS_COMM_BATCHED;
+        if (!client->clientGone)
+            (void) FlushClient(client, oc, (char *) NULL, 0);
+    }
+    if (!any_output_pending()) {
+        CriticalOutputPending = FALSE;
+        NewOutputPending = FALSE;
+    }
+}
+
+/*****************
+ * ClientOutputTail:
+ *    The last count bytes buffered for the client, if they were written
+ *    with a single WriteToClient() and are still waiting to go out, so the
+ *    caller may replace them with something newer; NULL otherwise.
+ *****************/
+
+void *
+ClientOutputTail(ClientPtr who, int count)
+{
+    ConnectionOutputPtr oco;
+
+    if (!who || who == serverClient || who->clientGone)
+        return NULL;
+    oco = ((OsCommPtr) who->osPrivate)->output;
+    if (!oco || oco->tail < 0 || oco->count - oco->tail != count)
+        return NULL;
+    return oco->buf + oco->tail;
+}
+
+/*****************
+ * ClientOutputBlocked:
+ *    Whether the client's connection stopped taking output and some of it
+ *    is still buffered, until the connection can take more again.  Output
+ *    merely buffered for the next flush doesn't count.
+ *****************/
+
+Bool
+ClientOutputBlocked(ClientPtr who)
+{
+    if (!who || who == serverClient || who->clientGone)
+        return FALSE;
+    return (((OsCommPtr) who->osPrivate)->flags & OS_COMM_BLOCKED) != 0;
+}
+
 void
 FlushIfCriticalOutputPending(void)
 {
@@ -664,6 +884,67 @@ AbortClient(ClientPtr client)
     }
 }
 
+static ConnectionOutputPtr
+GetOutputBuffer(ClientPtr who)
+{
+    OsCommPtr oc = who->osPrivate;
+    ConnectionOutputPtr oco;
+
+    if (!(oco = AllocateOutputBuffer(oc->outputHint))) {
+        AbortClient(who);
+        MarkClientException(who);
+        return NULL;
+    }
+    oc->output = oco;
+    return oco;
+}
+
+static void
+CallReplyCallback(ClientPtr who, const char *buf, int count, int padBytes)
+{
+    ReplyInfoRec replyinfo;
+
+    replyinfo.client = who;
+    replyinfo.replyData = buf;
+    replyinfo.dataLenBytes = count + padBytes;
+    replyinfo.padBytes = padBytes;
+    if (who->replyBytesRemaining) { /* still sending data of an earlier reply */
+        who->replyBytesRemaining -= count + padBytes;
+        replyinfo.startOfReply = FALSE;
+        replyinfo.bytesRemaining = who->replyBytesRemaining;
+        CallCallbacks((&ReplyCallback), (void *) &replyinfo);
+    }
+    else if (who->clientState == ClientStateRunning && buf[0] == X_Reply) { /* start of new reply */
+        CARD32 replylen;
+        unsigned long bytesleft;
+
+        replylen = ((const xGenericReply *) buf)->length;
+        if (who->swapped)
+            swapl(&replylen);
+        bytesleft = (replylen * 4) + SIZEOF(xReply) - count - padBytes;
+        replyinfo.startOfReply = TRUE;
+        replyinfo.bytesRemaining = who->replyBytesRemaining = bytesleft;
+        CallCallbacks((&ReplyCallback), (void *) &replyinfo);
+    }
+}
+
+static Bool
+GrowOutputBuffer(ConnectionOutputPtr oco, long size)
+{
+    unsigned char *obuf;
+
+    if (size > INT_MAX)
+        return FALSE;
+    size = PoolSize(size);
+    if (!(obuf = GetPoolBuffer(size)))
+        return FALSE;
+    memcpy(obuf, oco->buf, oco->count);
+    PutPoolBuffer(oco->buf, oco->size);
+    oco->buf = obuf;
+    oco->size = size;
+    return TRUE;
+}
+
 /*****************
  * WriteToClient
  *    Copies buf into ClientPtr.buf if it fits (with padding), else
@@ -734,46 +1015,13 @@ WriteToClient(ClientPtr who, int count, const void *__buf)
     }
 #endif
 
-    if (!oco) {
-        if ((oco = FreeOutputs)) {
-            FreeOutputs = oco->next;
-        }
-        else if (!(oco = AllocateOutputBuffer())) {
-            AbortClient(who);
-            MarkClientException(who);
-            return -1;
-        }
-        oc->output = oco;
-    }
+    if (!oco && !(oco = GetOutputBuffer(who)))
+        return -1;
 
     padBytes = padding_for_int32(count);
 
-    if (ReplyCallback) {
-        ReplyInfoRec replyinfo;
-
-        replyinfo.client = who;
-        replyinfo.replyData = buf;
-        replyinfo.dataLenBytes = count + padBytes;
-        replyinfo.padBytes = padBytes;
-        if (who->replyBytesRemaining) { /* still sending data of an earlier reply */
-            who->replyBytesRemaining -= count + padBytes;
-            replyinfo.startOfReply = FALSE;
-            replyinfo.bytesRemaining = who->replyBytesRemaining;
-            CallCallbacks((&ReplyCallback), (void *) &replyinfo);
-        }
-        else if (who->clientState == ClientStateRunning && buf[0] == X_Reply) { /* start of new reply */
-            CARD32 replylen;
-            unsigned long bytesleft;
-
-            replylen = ((const xGenericReply *) buf)->length;
-            if (who->swapped)
-                swapl(&replylen);
-            bytesleft = (replylen * 4) + SIZEOF(xReply) - count - padBytes;
-            replyinfo.startOfReply = TRUE;
-            replyinfo.bytesRemaining = who->replyBytesRemaining = bytesleft;
-            CallCallbacks((&ReplyCallback), (void *) &replyinfo);
-        }
-    }
+    if (ReplyCallback)
+        CallReplyCallback(who, buf, count, padBytes);
 #ifdef DEBUG_COMMUNICATION
     else if (multicount) {
         if (who->replyBytesRemaining) {
@@ -788,7 +1036,8 @@ WriteToClient(ClientPtr who, int count, const void *__buf)
         }
     }
 #endif
-    if ((oco->count == 0 && who->local) || oco->count + count + padBytes > oco->size) {
+    if ((oco->count == 0 && who->local && !OutputBatchDepth) ||
+        oco->count + count + padBytes > oco->size) {
         output_pending_clear(who);
         if (!any_output_pending()) {
             CriticalOutputPending = FALSE;
@@ -800,12 +1049,111 @@ WriteToClient(ClientPtr who, int count, const void *__buf)
 
     NewOutputPending = TRUE;
     output_pending_mark(who);
+    if (OutputBatchDepth && who->local)
+        oc->flags |= OS_COMM_BATCHED;
+    oco->tail = oco->count;
     memmove((char *) oco->buf + oco->count, buf, count);
     oco->count += count;
     if (padBytes) {
         memset(oco->buf + oco->count, '\0', padBytes);
         oco->count += padBytes;
     }
+    OsBufferStats.outputBytesCopied += count + padBytes;
+    return count;
+}
+
+/*****************
+ * WriteToClientNoCopy
+ *    Like WriteToClient, but takes ownership of buf instead of copying
+ *    it.  Whatever can't be written right away stays queued by reference
+ *    and release(buf) is called once all of it went out or the client is
+ *    gone, possibly before this returns.  Small payloads are copied anyway.
+ *****************/
+
+int
+WriteToClientNoCopy(ClientPtr who, int count, void *buf,
+                    ClientOutputReleaseProcPtr release)
+{
+    OsCommPtr oc;
+    ConnectionOutputPtr oco;
+    OutputRefPtr ref, *prev;
+    int padBytes, ret;
+
+    BUG_RETURN_VAL_MSG(in_input_thread(), 0,
+                       "******** %s called from input thread *********\n", __func__);
+
+    if (count < OUTPUT_REF_MIN || !who || who == serverClient ||
+        who->clientGone || !(ref = malloc(sizeof(OutputRef)))) {
+        ret = WriteToClient(who, count, buf);
+        release(buf);
+        return ret;
+    }
+
+    oc = who->osPrivate;
+    oco = oc->output;
+    if (!oco && !(oco = GetOutputBuffer(who))) {
+        free(ref);
+        release(buf);
+        return -1;
+    }
+
+    padBytes = padding_for_int32(count);
+    if (oco->count + padBytes > oco->size &&
+        !GrowOutputBuffer(oco, oco->count + padBytes)) {
+        free(ref);
+        ret = WriteToClient(who, count, buf);
+        release(buf);
+        return ret;
+    }
+
+    if (ReplyCallback)
+        CallReplyCallback(who, buf, count, padBytes);
+
+    oco->tail = -1;
+    ref->next = NULL;
+    ref->at = oco->count;
+    ref->data = buf;
+    ref->count = count;
+    ref->base = buf;
+    ref->release = release;
+    for (prev = &oco->refs; *prev; prev = &(*prev)->next);
+    *prev = ref;
+
+    if (padBytes) {
+        memset(oco->buf + oco->count, '\0', padBytes);
+        oco->count += padBytes;
+    }
+
+    output_pending_clear(who);
+    if (!any_output_pending()) {
+        CriticalOutputPending = FALSE;
+        NewOutputPending = FALSE;
+    }
+    if (FlushClient(who, oc, NULL, 0) < 0)
+        return -1;
+    return count;
+}
+
+static void
+ReleaseOutputRefs(ConnectionOutputPtr oco)
+{
+    OutputRefPtr ref;
+
+    while ((ref = oco->refs)) {
+        oco->refs = ref->next;
+        ref->release(ref->base);
+        free(ref);
+    }
+}
+
+static long
+OutputRefBytes(ConnectionOutputPtr oco)
+{
+    OutputRefPtr ref;
+    long count = 0;
+
+    for (ref = oco->refs; ref; ref = ref->next)
+        count += ref->count;
     return count;
 }
 
@@ -817,6 +1165,10 @@ WriteToClient(ClientPtr who, int count, const void *__buf)
  *    a permanent error, or we can't allocate any more space, we then
  *    close the connection.
  *
+ *    Output goes out in stream order: the buffer interleaved with any
+ *    queued references, then extraBuf and its padding.  Only the part of
+ *    extraBuf that couldn't be written is copied into the buffer.
+ *
  **********************/
 
 int
@@ -824,68 +1176,101 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
 {
     ConnectionOutputPtr oco = oc->output;
     XtransConnInfo trans_conn = oc->trans_conn;
-    struct iovec iov[3];
+    struct iovec iov[OUTPUT_IOV_MAX];
     static char padBuffer[3];
     const char *extraBuf = __extraBuf;
-    long written;
+    long bufDone = 0;           /* bytes of oco->buf written */
+    long extraDone = 0;         /* bytes of extraBuf and padding written */
     long padsize;
     long notWritten;
     long todo;
+    long len;
 
     if (!oco)
 	return 0;
-    written = 0;
     padsize = padding_for_int32(extraCount);
-    notWritten = oco->count + extraCount + padsize;
+    notWritten = oco->count + OutputRefBytes(oco) + extraCount + padsize;
     if (!notWritten)
         return 0;
 
     if (FlushCallback)
         CallCallbacks(&FlushCallback, who);
 
+    oco->tail = -1;
     todo = notWritten;
     while (notWritten) {
-        long before = written;  /* amount of whole thing written */
+        OutputRefPtr ref;
         long remain = todo;     /* amount to try this time, <= notWritten */
+        long pos = bufDone;
         int i = 0;
-        long len;
-
-        /* You could be very general here and have "in" and "out" iovecs
-         * and write a loop without using a macro, but what the heck.  This
-         * translates to:
-         *
-         *     how much of this piece is new?
-         *     if more new then we are trying this time, clamp
-         *     if nothing new
-         *         then bump down amount already written, for next piece
-         *         else put new stuff in iovec, will need all of next piece
-         *
-         * Note that todo had better be at least 1 or else we'll end up
-         * writing 0 iovecs.
-         */
+
+        /* Put up to "remain" bytes of the next piece in the iovec.  Note
+         * that todo had better be at least 1 or else we'll end up writing
+         * 0 iovecs. */
 #define InsertIOV(pointer, length) \
-	len = (length) - before; \
+	len = (length); \
 	if (len > remain) \
 	    len = remain; \
-	if (len <= 0) { \
-	    before = (-len); \
-	} else { \
+	if (len > 0) { \
 	    iov[i].iov_len = len; \
-	    iov[i].iov_base = (pointer) + before;	\
+	    iov[i].iov_base = (pointer); \
 	    i++; \
 	    remain -= len; \
-	    before = 0; \
 	}
 
-        InsertIOV((char *) oco->buf, oco->count)
-            InsertIOV((char *) extraBuf, extraCount)
-            InsertIOV(padBuffer, padsize)
+        for (ref = oco->refs; ref && remain && i < OUTPUT_IOV_MAX - 3;
+             ref = ref->next) {
+            InsertIOV((char *) oco->buf + pos, ref->at - pos)
+            pos = ref->at;
+            InsertIOV((char *) ref->data, ref->count)
+        }
+        if (!ref) {
+            InsertIOV((char *) oco->buf + pos, oco->count - pos)
+            if (extraDone < extraCount) {
+                InsertIOV((char *) extraBuf + extraDone, extraCount - extraDone)
+                InsertIOV(padBuffer, padsize)
+            }
+            else {
+                InsertIOV(padBuffer, extraCount + padsize - extraDone)
+            }
+        }
+#undef InsertIOV
 
-            errno = 0;
+        errno = 0;
         if (trans_conn && (len = _XSERVTransWritev(trans_conn, iov, i)) >= 0) {
-            written += len;
             notWritten -= len;
             todo = notWritten;
+
+            /* account for what went out, in the same order */
+            while (len > 0) {
+                long n;
+
+                ref = oco->refs;
+                n = (ref ? ref->at : oco->count) - bufDone;
+                if (n > 0) {
+                    n = min(n, len);
+                    bufDone += n;
+                }
+                else if (ref) {
+                    n = min(ref->count, len);
+                    ref->data += n;
+                    ref->count -= n;
+                    OsBufferStats.outputBytesReferenced += n;
+                    if (!ref->count) {
+                        oco->refs = ref->next;
+                        ref->release(ref->base);
+                        free(ref);
+                    }
+                }
+                else {
+                    n = len;
+                    if (extraDone < extraCount)
+                        OsBufferStats.outputBytesReferenced +=
+                            min(n, extraCount - extraDone);
+                    extraDone += n;
+                }
+                len -= n;
+            }
         }
         else if (ETEST(errno)
 #ifdef EMSGSIZE                 /* check for another brain-damaged OS bug */
@@ -895,44 +1280,41 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
             /* If we've arrived here, then the client is stuffed to the gills
                and not ready to accept more.  Make a note of it and buffer
                the rest. */
-            output_pending_mark(who);
+            long extraLeft = extraCount + padsize - extraDone;
 
-            if (written < oco->count) {
-                if (written > 0) {
-                    oco->count -= written;
-                    memmove((char *) oco->buf,
-                            (char *) oco->buf + written, oco->count);
-                    written = 0;
-                }
-            }
-            else {
-                written -= oco->count;
-                oco->count = 0;
+            output_pending_mark(who);
+            oc->flags |= OS_COMM_BLOCKED;
+
+            if (bufDone > 0) {
+                oco->count -= bufDone;
+                memmove((char *) oco->buf,
+                        (char *) oco->buf + bufDone, oco->count);
+                for (ref = oco->refs; ref; ref = ref->next)
+                    ref->at -= bufDone;
             }
 
-            if (notWritten > oco->size) {
-                unsigned char *obuf = NULL;
-
-                if (notWritten + BUFSIZE <= INT_MAX) {
-                    obuf = realloc(oco->buf, notWritten + BUFSIZE);
-                }
-                if (!obuf) {
-                    AbortClient(who);
-                    MarkClientException(who);
-                    oco->count = 0;
-                    return -1;
-                }
-                oco->size = notWritten + BUFSIZE;
-                oco->buf = obuf;
+            if (oco->count + extraLeft > oco->size &&
+                !GrowOutputBuffer(oco, oco->count + extraLeft + BUFSIZE)) {
+                AbortClient(who);
+                MarkClientException(who);
+                oco->count = 0;
+                ReleaseOutputRefs(oco);
+                return -1;
             }
 
             /* If the amount written extended into the padBuffer, then the
-               difference "extraCount - written" may be less than 0 */
-            if ((len = extraCount - written) > 0)
+               difference "extraCount - extraDone" may be less than 0 */
+            if ((len = extraCount - extraDone) > 0) {
                 memmove((char *) oco->buf + oco->count,
-                        extraBuf + written, len);
+                        extraBuf + extraDone, len);
+                OsBufferStats.outputBytesCopied += len;
+            }
+            else
+                len = 0;
+            memset((char *) oco->buf + oco->count + len, '\0', extraLeft - len);
 
-            oco->count = notWritten;    /* this will include the pad */
+            oco->count += extraLeft;    /* this will include the pad */
+            UpdateSizeHint(&oc->outputHint, oco->count);
             ospoll_listen(server_poll, oc->fd, X_NOTIFY_WRITE);
 
             /* return only the amount explicitly requested */
@@ -947,6 +1329,7 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
             AbortClient(who);
             MarkClientException(who);
             oco->count = 0;
+            ReleaseOutputRefs(oco);
             return -1;
         }
     }
@@ -954,33 +1337,29 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
     /* everything was flushed out */
     oco->count = 0;
     output_pending_clear(who);
+    oc->flags &= ~OS_COMM_BLOCKED;
 
-    if (oco->size > BUFWATERMARK) {
-        free(oco->buf);
-        free(oco);
-    }
-    else {
-        oco->next = FreeOutputs;
-        FreeOutputs = oco;
-    }
+    UpdateSizeHint(&oc->outputHint, 0);
+    ReleaseOutputBuffer(oco);
     oc->output = (ConnectionOutputPtr) NULL;
     return extraCount;          /* return only the amount explicitly requested */
 }
 
 static ConnectionInputPtr
-AllocateInputBuffer(void)
+AllocateInputBuffer(int size)
 {
     ConnectionInputPtr oci;
 
-    oci = malloc(sizeof(ConnectionInput));
-    if (!oci)
+    if ((oci = FreeInputs))
+        FreeInputs = oci->next;
+    else if (!(oci = malloc(sizeof(ConnectionInput))))
         return NULL;
-    oci->buffer = malloc(BUFSIZE);
+    oci->size = PoolSize(max(size, BUFSIZE));
+    oci->buffer = GetPoolBuffer(oci->size);
     if (!oci->buffer) {
         free(oci);
         return NULL;
     }
-    oci->size = BUFSIZE;
     oci->bufptr = oci->buffer;
     oci->bufcnt = 0;
     oci->lenLastReq = 0;
@@ -989,23 +1368,43 @@ AllocateInputBuffer(void)
 }
 
 static ConnectionOutputPtr
-AllocateOutputBuffer(void)
+AllocateOutputBuffer(int size)
 {
     ConnectionOutputPtr oco;
 
-    oco = malloc(sizeof(ConnectionOutput));
-    if (!oco)
+    if ((oco = FreeOutputs))
+        FreeOutputs = oco->next;
+    else if (!(oco = malloc(sizeof(ConnectionOutput))))
         return NULL;
-    oco->buf = calloc(1, BUFSIZE);
+    oco->size = PoolSize(max(size, BUFSIZE));
+    oco->buf = GetPoolBuffer(oco->size);
     if (!oco->buf) {
         free(oco);
         return NULL;
     }
-    oco->size = BUFSIZE;
     oco->count = 0;
+    oco->tail = -1;
+    oco->refs = NULL;
     return oco;
 }
 
+/* the buffer goes back to the pool, the record is kept for reuse */
+static void
+ReleaseInputBuffer(ConnectionInputPtr oci)
+{
+    PutPoolBuffer(oci->buffer, oci->size);
+    oci->next = FreeInputs;
+    FreeInputs = oci;
+}
+
+static void
+ReleaseOutputBuffer(ConnectionOutputPtr oco)
+{
+    PutPoolBuffer(oco->buf, oco->size);
+    oco->next = FreeOutputs;
+    FreeOutputs = oco;
+}
+
 void
 FreeOsBuffers(OsCommPtr oc)
 {
@@ -1014,47 +1413,47 @@ FreeOsBuffers(OsCommPtr oc)
 
     if (AvailableInput == oc)
         AvailableInput = (OsCommPtr) NULL;
-    if ((oci = oc->input)) {
-        if (FreeInputs) {
-            free(oci->buffer);
-            free(oci);
-        }
-        else {
-            FreeInputs = oci;
-            oci->next = (ConnectionInputPtr) NULL;
-            oci->bufptr = oci->buffer;
-            oci->bufcnt = 0;
-            oci->lenLastReq = 0;
-            oci->ignoreBytes = 0;
-        }
-    }
+    if ((oci = oc->input))
+        ReleaseInputBuffer(oci);
     if ((oco = oc->output)) {
-        if (FreeOutputs) {
-            free(oco->buf);
-            free(oco);
-        }
-        else {
-            FreeOutputs = oco;
-            oco->next = (ConnectionOutputPtr) NULL;
-            oco->count = 0;
-        }
+        ReleaseOutputRefs(oco);
+        ReleaseOutputBuffer(oco);
     }
 }
 
+void
+LogOsBufferStats(void)
+{
+    LogMessageVerb(X_INFO, 3, "Client output: %llu bytes copied, "
+                   "%llu bytes written by reference\n",
+                   (unsigned long long) OsBufferStats.outputBytesCopied,
+                   (unsigned long long) OsBufferStats.outputBytesReferenced);
+    LogMessageVerb(X_INFO, 3, "Client buffer pool: %llu hits, %llu misses\n",
+                   (unsigned long long) OsBufferStats.poolHits,
+                   (unsigned long long) OsBufferStats.poolMisses);
+}
+
 void
 ResetOsBuffers(void)
 {
     ConnectionInputPtr oci;
     ConnectionOutputPtr oco;
+    PoolBuffer *buf;
+    int i;
 
     while ((oci = FreeInputs)) {
         FreeInputs = oci->next;
-        free(oci->buffer);
         free(oci);
     }
     while ((oco = FreeOutputs)) {
         FreeOutputs = oco->next;
-        free(oco->buf);
         free(oco);
     }
+    for (i = 0; i < POOL_CLASSES; i++) {
+        while ((buf = BufferPool[i].free)) {
+            BufferPool[i].free = buf->next;
+            free(buf);
+        }
+        BufferPool[i].count = 0;
+    }
 }
@@ -58,6 +58,7 @@ SOFTWARE.
 #endif
 
 #include <limits.h>
+#include <stdint.h>
 #include <stddef.h>
 #include <X11/Xos.h>
 #include <X11/Xmd.h>
@@ -104,10 +105,16 @@ typedef struct _osComm {
     CARD32 conn_time;           /* timestamp if not established, else 0  */
     struct _XtransConnInfo *trans_conn; /* transport connection object */
     int flags;
+    int inputHint;              /* recent request sizes */
+    int outputHint;             /* recent output backlog */
+    struct _ReadClient *reader; /* reader thread state, see readthread.c */
 } OsCommRec, *OsCommPtr;
 
 #define OS_COMM_GRAB_IMPERVIOUS 1
 #define OS_COMM_IGNORED         2
+#define OS_COMM_NO_READ_THREAD  4
+#define OS_COMM_BATCHED         8
+#define OS_COMM_BLOCKED         16      /* waiting for the socket to take more */
 
 extern int FlushClient(ClientPtr /*who */ ,
                        OsCommPtr /*oc */ ,
@@ -118,6 +125,30 @@ extern int FlushClient(ClientPtr /*who */ ,
 extern void FreeOsBuffers(OsCommPtr     /*oc */
     );
 
+/* WriteToClientNoCopy() copies payloads smaller than this anyway */
+#define OUTPUT_REF_MIN 4096
+
+typedef struct _OsBufferStats {
+    uint64_t outputBytesCopied;         /* copied into output buffers */
+    uint64_t outputBytesReferenced;     /* written straight from the caller */
+    uint64_t poolHits;                  /* buffers taken from the pool */
+    uint64_t poolMisses;                /* buffers that had to be allocated */
+} OsBufferStatsRec;
+
+extern OsBufferStatsRec OsBufferStats;
+
+void LogOsBufferStats(void);
+
+/* Hold back local clients' output until the batch ends; see io.c. */
+void BeginOutputBatch(void);
+void EndOutputBatch(void);
+
+/* The client's last write, if it is count bytes and still buffered. */
+void *ClientOutputTail(ClientPtr who, int count);
+
+/* Whether output for the client waits for its connection to take more. */
+Bool ClientOutputBlocked(ClientPtr who);
+
 void
 CloseDownFileDescriptor(OsCommPtr oc);
 
@@ -141,6 +172,8 @@ extern void GenerateRandomData(int len, char *buf);
 void TimerInit(void);
 Bool TimerForce(OsTimerPtr timer);
 
+uint64_t WaitForSomethingWakeups(void);
+
 #ifdef WIN32
 #include <X11/Xwinsock.h>
 struct utsname {
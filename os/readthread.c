@@ -0,0 +1,825 @@
+/* readthread.c -- Reading and decoding client requests in threads.
+ *
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDER(S) OR AUTHOR(S) BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * With -readthreads n, clients on network transports are handed over to
+ * one of n reader threads once they're past connection setup.  The reader
+ * thread reads the client's socket, cuts the data into requests the way
+ * ReadRequestFromClient() would, byte-swaps the core requests of swapped
+ * clients (SwapReqVector) and queues the requests in batches.  The main
+ * thread takes them off the queue in ReadRequestFromClient() instead of
+ * reading the socket itself; everything from there on, dispatch included,
+ * stays on the main thread.  A client sticks to one reader thread, so its
+ * requests keep their order.
+ *
+ * Clients on local transports stay with the main thread: they can pass
+ * file descriptors along with their requests, and reading them is cheap.
+ */
+
+#include <dix-config.h>
+
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#define XSERV_t
+#define TRANS_SERVER
+#include <X11/Xtrans/Xtrans.h>
+#include <X11/Xproto.h>
+#include <X11/extensions/bigreqsproto.h>
+
+#include "dix/dix_priv.h"
+#include "os/readthread.h"
+
+#include "misc.h"
+#include "dixstruct_priv.h"
+#include "swapreq.h"
+#include "opaque.h"
+#include "osdep.h"
+
+int ReadThreadCount = 0;
+
+#if INPUTTHREAD
+
+#include <pthread.h>
+
+#define READ_BUFFER_SIZE 16384          /* socket reads go here */
+#define READ_BATCH_SIZE 16384           /* initial size of a batch */
+#define READ_QUEUE_MAX (1 << 20)        /* stop reading a client past this */
+
+/* the request was byte-swapped by the reader thread */
+#define READ_REQ_PRESWAPPED 1
+
+/**
+ * A request as queued by a reader thread.  The request data follows,
+ * with the header of big requests already moved up as
+ * ReadRequestFromClient() does it.
+ */
+typedef struct _ReadReq {
+    int size;                   /* bytes of request data */
+    int len;                    /* what ReadThreadNextRequest() returns */
+    CARD32 req_len;             /* for client->req_len */
+    int flags;
+} ReadReqRec, *ReadReqPtr;
+
+typedef struct _ReadBatch {
+    struct _ReadBatch *next;
+    int size;
+    int used;
+    int pos;                    /* main thread: the current request */
+    char data[];
+} ReadBatchRec, *ReadBatchPtr;
+
+typedef enum _ReadClientState {
+    read_client_added,
+    read_client_running,
+    read_client_removed
+} ReadClientState;
+
+typedef struct _ReadThread ReadThreadRec, *ReadThreadPtr;
+
+/**
+ * A client as seen by its reader thread.
+ */
+typedef struct _ReadClient {
+    struct xorg_list node;      /* in thread->clients */
+    struct xorg_list ready;     /* in thread->ready while there's news */
+    ReadThreadPtr thread;
+    ClientPtr client;
+    XtransConnInfo trans_conn;
+    int fd;
+    Bool swapped;
+
+    /* under thread->lock */
+    ReadClientState state;
+    Bool bigRequests;
+    Bool throttled;             /* too much queued, stopped reading */
+    Bool eof;                   /* nothing queued after the last batch */
+    long queued;
+    ReadBatchPtr head, tail;
+
+    /* held by the reader thread while it reads the client */
+    pthread_mutex_t readLock;
+
+    /* reader thread only */
+    char *buf;                  /* data not cut into requests yet */
+    int size;
+    int count;
+    uint64_t ignoreBytes;
+    Bool muted;
+
+    /* main thread only */
+    ReadReqPtr current;
+    Bool replay;
+} ReadClientRec, *ReadClientPtr;
+
+struct _ReadThread {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    struct xorg_list clients;
+    struct xorg_list ready;
+    struct ospoll *fds;
+    int controlRead;
+    int controlWrite;
+    int nclients;
+    Bool changed;               /* under lock */
+    Bool running;
+    Bool notify;
+};
+
+static ReadThreadPtr readThreads;
+static int numReadThreads;
+
+static int notifyPipeRead = -1;
+static int notifyPipeWrite = -1;
+
+static void
+ReadThreadFillPipe(int writeHead)
+{
+    int ret;
+    char byte = 0;
+
+    do {
+        ret = write(writeHead, &byte, 1);
+    } while (ret < 0 && ETEST(errno));
+}
+
+static int
+ReadThreadReadPipe(int readHead)
+{
+    int ret, array[10];
+
+    ret = read(readHead, &array, sizeof(array));
+    if (ret >= 0)
+        return ret;
+
+    if (errno != EAGAIN)
+        FatalError("read-thread: draining pipe (%d)", errno);
+
+    return 1;
+}
+
+static Bool
+ReadThreadPipe(int *readHead, int *writeHead)
+{
+    int fds[2];
+    int flags;
+
+    if (pipe(fds) < 0)
+        return FALSE;
+
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    flags = fcntl(fds[0], F_GETFD);
+    if (flags != -1)
+        (void)fcntl(fds[0], F_SETFD, flags | FD_CLOEXEC);
+    flags = fcntl(fds[1], F_GETFD);
+    if (flags != -1)
+        (void)fcntl(fds[1], F_SETFD, flags | FD_CLOEXEC);
+
+    *readHead = fds[0];
+    *writeHead = fds[1];
+    return TRUE;
+}
+
+static void
+FreeReadClient(ReadClientPtr rc)
+{
+    ReadBatchPtr batch;
+
+    while ((batch = rc->head)) {
+        rc->head = batch->next;
+        free(batch);
+    }
+    pthread_mutex_destroy(&rc->readLock);
+    free(rc->buf);
+    free(rc);
+}
+
+/* Make room for a request of size bytes at the end of the batch. */
+static ReadReqPtr
+BatchAppend(ReadBatchPtr *pbatch, int size)
+{
+    ReadBatchPtr batch = *pbatch;
+    int used = batch ? batch->used : 0;
+    int need = used + sizeof(ReadReqRec) + size;
+    ReadReqPtr req;
+
+    if (!batch || need > batch->size) {
+        int newsize = batch ? batch->size : READ_BATCH_SIZE;
+
+        while (newsize < need)
+            newsize <<= 1;
+        batch = realloc(batch, sizeof(ReadBatchRec) + newsize);
+        if (!batch)
+            return NULL;
+        if (!*pbatch) {
+            batch->next = NULL;
+            batch->used = 0;
+            batch->pos = 0;
+        }
+        batch->size = newsize;
+        *pbatch = batch;
+    }
+
+    req = (ReadReqPtr) (batch->data + batch->used);
+    req->size = size;
+    req->flags = 0;
+    batch->used = need;
+    return req;
+}
+
+/**
+ * Cut what has been read from the client into requests and append them to
+ * the batch.  The tail of a partial request stays in the buffer for the
+ * next read.
+ *
+ * @return FALSE if nothing more is to be read from the client.
+ */
+static Bool
+FrameRequests(ReadClientPtr rc, Bool bigRequests, ReadBatchPtr *pbatch)
+{
+    unsigned int pos = 0, need = 0;
+
+    for (;;) {
+        unsigned int avail = rc->count - pos;
+        xReq *request, *data;
+        ReadReqPtr req;
+        uint64_t needed;
+        CARD32 words;
+        Bool big = FALSE;
+
+        if (rc->ignoreBytes > 0) {
+            unsigned int skip = min(rc->ignoreBytes, avail);
+
+            pos += skip;
+            rc->ignoreBytes -= skip;
+            if (rc->ignoreBytes > 0)
+                break;
+            continue;
+        }
+        if (avail < sizeof(xReq)) {
+            need = sizeof(xReq);
+            break;
+        }
+
+        request = (xReq *) (rc->buf + pos);
+        words = rc->swapped ? bswap_16(request->length) : request->length;
+        if (!words && !bigRequests) {
+            /* Let dispatch answer it with BadLength, and go on after
+             * the header, as ReadRequestFromClient() does. */
+            if (!(req = BatchAppend(pbatch, sizeof(xReq))))
+                return FALSE;
+            memcpy(req + 1, request, sizeof(xReq));
+            req->len = sizeof(xReq);
+            req->req_len = 0;
+            pos += sizeof(xReq);
+            continue;
+        }
+        if (!words) {
+            /* nothing sensible can follow a bad length */
+            if (avail < sizeof(xBigReq)) {
+                need = sizeof(xBigReq);
+                break;
+            }
+            words = ((xBigReq *) request)->length;
+            if (rc->swapped)
+                words = bswap_32(words);
+            if (words < bytes_to_int32(sizeof(xBigReq)))
+                return FALSE;
+            big = TRUE;
+        }
+        needed = (uint64_t) words << 2;
+
+        if (needed > (uint64_t) maxBigRequestSize << 2) {
+            /*
+             * Too big for us to handle: queue just the header and skip the
+             * rest.  Dispatch() turns it into a BadLength error.
+             */
+            if (!(req = BatchAppend(pbatch, sizeof(xReq))))
+                return FALSE;
+            memcpy(req + 1, request, sizeof(xReq));
+            req->len = min(needed, INT_MAX);
+            req->req_len = words;
+            rc->ignoreBytes = needed;
+            continue;
+        }
+        if (avail < needed) {
+            need = needed;
+            break;
+        }
+
+        if (big) {
+            int body = needed - sizeof(xBigReq);
+
+            if (!(req = BatchAppend(pbatch, sizeof(xReq) + body)))
+                return FALSE;
+            data = (xReq *) (req + 1);
+            *data = *request;
+            memcpy(data + 1, rc->buf + pos + sizeof(xBigReq), body);
+            req->req_len = words - bytes_to_int32(sizeof(xBigReq) -
+                                                  sizeof(xReq));
+        }
+        else {
+            if (!(req = BatchAppend(pbatch, needed)))
+                return FALSE;
+            data = (xReq *) (req + 1);
+            memcpy(data, request, needed);
+            req->req_len = words;
+        }
+        req->len = needed;
+
+        if (rc->swapped && data->reqType < EXTENSION_BASE &&
+            SwapReqVector[data->reqType] &&
+            SwapReqVector[data->reqType] (data, req->req_len))
+            req->flags |= READ_REQ_PRESWAPPED;
+
+        pos += needed;
+    }
+
+    /* keep the partial request at the start of the buffer */
+    if (pos > 0) {
+        rc->count -= pos;
+        if (rc->count > 0)
+            memmove(rc->buf, rc->buf + pos, rc->count);
+    }
+
+    if (need > rc->size ||
+        (rc->size > READ_BUFFER_SIZE && need <= READ_BUFFER_SIZE &&
+         rc->count <= READ_BUFFER_SIZE)) {
+        int size = max(need, READ_BUFFER_SIZE);
+        char *buf = realloc(rc->buf, size);
+
+        if (!buf)
+            return FALSE;
+        rc->buf = buf;
+        rc->size = size;
+    }
+
+    return TRUE;
+}
+
+/**
+ * Read a client on its reader thread, and queue what came in for the
+ * main thread.
+ */
+static void
+ClientReadable(int fd, int xevents, void *data)
+{
+    ReadClientPtr rc = data;
+    ReadThreadPtr rt = rc->thread;
+    ReadBatchPtr batch = NULL;
+    Bool running, bigRequests, more = TRUE, stop;
+    int result;
+
+    pthread_mutex_lock(&rc->readLock);
+
+    pthread_mutex_lock(&rt->lock);
+    running = rc->state == read_client_running;
+    bigRequests = rc->bigRequests;
+    pthread_mutex_unlock(&rt->lock);
+
+    if (!running) {
+        pthread_mutex_unlock(&rc->readLock);
+        return;
+    }
+
+    result = _XSERVTransRead(rc->trans_conn, rc->buf + rc->count,
+                             rc->size - rc->count);
+    if (result > 0) {
+        rc->count += result;
+        more = FrameRequests(rc, bigRequests, &batch);
+    }
+    else if (result < 0 && ETEST(errno)) {
+        pthread_mutex_unlock(&rc->readLock);
+        return;
+    }
+    else
+        more = FALSE;
+
+    pthread_mutex_lock(&rt->lock);
+    if (batch) {
+        if (rc->tail)
+            rc->tail->next = batch;
+        else
+            rc->head = batch;
+        rc->tail = batch;
+        rc->queued += batch->used;
+    }
+    if (!more)
+        rc->eof = TRUE;
+    if (rc->queued > READ_QUEUE_MAX)
+        rc->throttled = TRUE;
+    stop = rc->eof || rc->throttled;
+    if (xorg_list_is_empty(&rc->ready))
+        xorg_list_append(&rc->ready, &rt->ready);
+    pthread_mutex_unlock(&rt->lock);
+
+    if (stop) {
+        ospoll_mute(rt->fds, fd, X_NOTIFY_READ);
+        rc->muted = TRUE;
+    }
+    rt->notify = TRUE;
+
+    pthread_mutex_unlock(&rc->readLock);
+}
+
+static void
+ReadThreadControlNotify(int fd, int revents, void *data)
+{
+    ReadThreadPtr rt = data;
+
+    /* Empty pending input, shut down if the pipe has been closed */
+    if (ReadThreadReadPipe(rt->controlRead) == 0)
+        rt->running = FALSE;
+}
+
+static void *
+ReadThreadDoWork(void *arg)
+{
+    ReadThreadPtr rt = arg;
+    sigset_t set;
+
+    /* Don't handle any signals on this thread */
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+#if defined(HAVE_PTHREAD_SETNAME_NP_WITH_TID)
+    pthread_setname_np (pthread_self(), "ReadThread");
+#elif defined(HAVE_PTHREAD_SETNAME_NP_WITHOUT_TID)
+    pthread_setname_np ("ReadThread");
+#endif
+
+    ospoll_add(rt->fds, rt->controlRead, ospoll_trigger_level,
+               ReadThreadControlNotify, rt);
+    ospoll_listen(rt->fds, rt->controlRead, X_NOTIFY_READ);
+
+    while (rt->running) {
+        /* Pick up new and departed clients, resume throttled ones */
+        pthread_mutex_lock(&rt->lock);
+        if (rt->changed) {
+            ReadClientPtr rc, tmp;
+
+            rt->changed = FALSE;
+            xorg_list_for_each_entry_safe(rc, tmp, &rt->clients, node) {
+                switch (rc->state) {
+                case read_client_added:
+                    ospoll_add(rt->fds, rc->fd, ospoll_trigger_level,
+                               ClientReadable, rc);
+                    ospoll_listen(rt->fds, rc->fd, X_NOTIFY_READ);
+                    rc->state = read_client_running;
+                    break;
+                case read_client_running:
+                    if (rc->muted && !rc->throttled && !rc->eof) {
+                        ospoll_listen(rt->fds, rc->fd, X_NOTIFY_READ);
+                        rc->muted = FALSE;
+                    }
+                    break;
+                case read_client_removed:
+                    ospoll_remove(rt->fds, rc->fd);
+                    xorg_list_del(&rc->node);
+                    FreeReadClient(rc);
+                    break;
+                }
+            }
+        }
+        pthread_mutex_unlock(&rt->lock);
+
+        if (ospoll_wait(rt->fds, -1) < 0) {
+            if (errno == EINVAL)
+                FatalError("read-thread: %s (%s)", __func__, strerror(errno));
+            else if (errno != EINTR)
+                ErrorF("read-thread: %s (%s)\n", __func__, strerror(errno));
+        }
+
+        /* Kick the main thread to dispatch the queued requests */
+        if (rt->notify) {
+            rt->notify = FALSE;
+            ReadThreadFillPipe(notifyPipeWrite);
+        }
+    }
+
+    ospoll_remove(rt->fds, rt->controlRead);
+
+    return NULL;
+}
+
+/* Schedule the clients the reader threads have queued requests for. */
+static void
+ReadThreadNotifyPipe(int fd, int mask, void *data)
+{
+    int i;
+
+    ReadThreadReadPipe(fd);
+
+    for (i = 0; i < numReadThreads; i++) {
+        ReadThreadPtr rt = &readThreads[i];
+        ReadClientPtr rc, tmp;
+
+        pthread_mutex_lock(&rt->lock);
+        xorg_list_for_each_entry_safe(rc, tmp, &rt->ready, ready) {
+            xorg_list_del(&rc->ready);
+            if (listen_to_client(rc->client))
+                mark_client_ready(rc->client);
+        }
+        pthread_mutex_unlock(&rt->lock);
+    }
+}
+
+Bool
+ReadThreadAddClient(ClientPtr client)
+{
+    OsCommPtr oc = (OsCommPtr) client->osPrivate;
+    ReadThreadPtr rt;
+    ReadClientPtr rc;
+    int i;
+
+    if (!readThreads || !oc->trans_conn ||
+        _XSERVTransIsLocal(oc->trans_conn))
+        return FALSE;
+
+    rc = calloc(1, sizeof(ReadClientRec));
+    if (!rc)
+        return FALSE;
+    rc->buf = malloc(READ_BUFFER_SIZE);
+    if (!rc->buf) {
+        free(rc);
+        return FALSE;
+    }
+    rc->size = READ_BUFFER_SIZE;
+
+    /* the least busy thread gets it */
+    rt = &readThreads[0];
+    for (i = 1; i < numReadThreads; i++)
+        if (readThreads[i].nclients < rt->nclients)
+            rt = &readThreads[i];
+
+    xorg_list_init(&rc->ready);
+    rc->thread = rt;
+    rc->client = client;
+    rc->trans_conn = oc->trans_conn;
+    rc->fd = oc->fd;
+    rc->swapped = client->swapped;
+    rc->bigRequests = client->big_requests;
+    rc->state = read_client_added;
+    pthread_mutex_init(&rc->readLock, NULL);
+
+    pthread_mutex_lock(&rt->lock);
+    /* Do not prepend, so that a removed client with the same fd gets
+     * processed first. */
+    xorg_list_append(&rc->node, &rt->clients);
+    rt->nclients++;
+    rt->changed = TRUE;
+    pthread_mutex_unlock(&rt->lock);
+
+    oc->reader = rc;
+    ReadThreadFillPipe(rt->controlWrite);
+
+    return TRUE;
+}
+
+void
+ReadThreadRemoveClient(OsCommPtr oc)
+{
+    ReadClientPtr rc = oc->reader;
+    ReadThreadPtr rt;
+
+    if (!rc)
+        return;
+    rt = rc->thread;
+
+    /* wait for a read in progress, the fd is about to be closed */
+    pthread_mutex_lock(&rc->readLock);
+    pthread_mutex_lock(&rt->lock);
+    rc->state = read_client_removed;
+    xorg_list_del(&rc->ready);
+    rt->nclients--;
+    rt->changed = TRUE;
+    pthread_mutex_unlock(&rt->lock);
+    pthread_mutex_unlock(&rc->readLock);
+
+    oc->reader = NULL;
+    ReadThreadFillPipe(rt->controlWrite);
+}
+
+int
+ReadThreadNextRequest(ClientPtr client)
+{
+    OsCommPtr oc = (OsCommPtr) client->osPrivate;
+    ReadClientPtr rc = oc->reader;
+    ReadThreadPtr rt = rc->thread;
+    ReadBatchPtr batch, done = NULL;
+    ReadReqPtr req = NULL;
+    xReq *data;
+    Bool eof, resume = FALSE;
+
+    pthread_mutex_lock(&rt->lock);
+    batch = rc->head;
+    if (rc->current && !rc->replay) {
+        /* done with the current request */
+        batch->pos += sizeof(ReadReqRec) + rc->current->size;
+        rc->current = NULL;
+        if (batch->pos == batch->used) {
+            rc->head = batch->next;
+            if (!rc->head)
+                rc->tail = NULL;
+            rc->queued -= batch->used;
+            done = batch;
+            batch = rc->head;
+            if (rc->throttled && rc->queued <= READ_QUEUE_MAX / 2) {
+                rc->throttled = FALSE;
+                rt->changed = TRUE;
+                resume = TRUE;
+            }
+        }
+    }
+    rc->replay = FALSE;
+    if (batch)
+        req = rc->current = (ReadReqPtr) (batch->data + batch->pos);
+    eof = rc->eof;
+    pthread_mutex_unlock(&rt->lock);
+
+    free(done);
+    if (resume)
+        ReadThreadFillPipe(rt->controlWrite);
+
+    if (!req)
+        return eof ? -1 : 0;
+
+    data = (xReq *) (req + 1);
+    if ((req->flags & READ_REQ_PRESWAPPED) &&
+        client->requestVector != SwappedProcVector) {
+        /* somebody wants to see the request as the client sent it */
+        SwapReqVector[data->reqType] (data, req->req_len);
+        req->flags &= ~READ_REQ_PRESWAPPED;
+    }
+
+    client->requestBuffer = data;
+    client->req_len = req->req_len;
+    client->req_preswapped = !!(req->flags & READ_REQ_PRESWAPPED);
+    return req->len;
+}
+
+void
+ReadThreadResetRequest(ClientPtr client)
+{
+    OsCommPtr oc = (OsCommPtr) client->osPrivate;
+    ReadClientPtr rc = oc->reader;
+
+    if (rc->current)
+        rc->replay = TRUE;
+}
+
+Bool
+ReadThreadPending(ClientPtr client)
+{
+    OsCommPtr oc = (OsCommPtr) client->osPrivate;
+    ReadClientPtr rc = oc->reader;
+    ReadThreadPtr rt = rc->thread;
+    Bool pending;
+
+    pthread_mutex_lock(&rt->lock);
+    pending = rc->head != NULL || rc->eof;
+    pthread_mutex_unlock(&rt->lock);
+
+    return pending;
+}
+
+void
+ReadThreadBigRequests(ClientPtr client)
+{
+    OsCommPtr oc = (OsCommPtr) client->osPrivate;
+    ReadClientPtr rc = oc ? oc->reader : NULL;
+
+    if (!rc)
+        return;
+
+    /* The client waits for the reply before it sends a big request, so
+     * the reader thread can't have cut one up the wrong way. */
+    pthread_mutex_lock(&rc->thread->lock);
+    rc->bigRequests = TRUE;
+    pthread_mutex_unlock(&rc->thread->lock);
+}
+
+/**
+ * Start the reader threads, if any were asked for.
+ */
+void
+ReadThreadInit(void)
+{
+    pthread_attr_t attr;
+    int i;
+
+    if (ReadThreadCount <= 0)
+        return;
+
+    if (!ReadThreadPipe(&notifyPipeRead, &notifyPipeWrite))
+        FatalError("read-thread: could not create pipe");
+
+    readThreads = calloc(ReadThreadCount, sizeof(ReadThreadRec));
+    if (!readThreads)
+        FatalError("read-thread: could not allocate memory");
+
+    SetNotifyFd(notifyPipeRead, ReadThreadNotifyPipe, X_NOTIFY_READ, NULL);
+
+    pthread_attr_init(&attr);
+    if (pthread_attr_setscope(&attr, PTHREAD_SCOPE_SYSTEM) != 0)
+        ErrorF("read-thread: error setting thread scope\n");
+
+    for (i = 0; i < ReadThreadCount; i++) {
+        ReadThreadPtr rt = &readThreads[i];
+
+        pthread_mutex_init(&rt->lock, NULL);
+        xorg_list_init(&rt->clients);
+        xorg_list_init(&rt->ready);
+        rt->fds = ospoll_create();
+        if (!rt->fds || !ReadThreadPipe(&rt->controlRead, &rt->controlWrite))
+            FatalError("read-thread: could not create thread %d", i);
+        rt->running = TRUE;
+
+        if (pthread_create(&rt->thread, &attr, ReadThreadDoWork, rt) != 0)
+            FatalError("read-thread: could not create thread %d", i);
+        numReadThreads++;
+    }
+
+    pthread_attr_destroy(&attr);
+
+    LogMessageVerb(X_INFO, 3, "Reading client requests in %d threads\n",
+                   numReadThreads);
+}
+
+/**
+ * Stop the reader threads.  Clients are all gone by now.
+ */
+void
+ReadThreadFini(void)
+{
+    int i;
+
+    if (!readThreads)
+        return;
+
+    for (i = 0; i < numReadThreads; i++) {
+        ReadThreadPtr rt = &readThreads[i];
+        ReadClientPtr rc, tmp;
+
+        /* Close the pipe to get the thread to shut down */
+        close(rt->controlWrite);
+        pthread_join(rt->thread, NULL);
+
+        xorg_list_for_each_entry_safe(rc, tmp, &rt->clients, node) {
+            ospoll_remove(rt->fds, rc->fd);
+            xorg_list_del(&rc->node);
+            FreeReadClient(rc);
+        }
+        ospoll_destroy(rt->fds);
+        close(rt->controlRead);
+        pthread_mutex_destroy(&rt->lock);
+    }
+
+    RemoveNotifyFd(notifyPipeRead);
+    close(notifyPipeRead);
+    close(notifyPipeWrite);
+    notifyPipeRead = -1;
+    notifyPipeWrite = -1;
+
+    free(readThreads);
+    readThreads = NULL;
+    numReadThreads = 0;
+}
+
+#else /* INPUTTHREAD */
+
+void ReadThreadInit(void) {}
+void ReadThreadFini(void) {}
+Bool ReadThreadAddClient(ClientPtr client) { return FALSE; }
+void ReadThreadRemoveClient(OsCommPtr oc) {}
+int ReadThreadNextRequest(ClientPtr client) { return -1; }
+void ReadThreadResetRequest(ClientPtr client) {}
+Bool ReadThreadPending(ClientPtr client) { return FALSE; }
+void ReadThreadBigRequests(ClientPtr client) {}
+
+#endif
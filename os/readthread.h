@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Copyright © 2026 X.Org Foundation
+ */
+#ifndef _XSERVER_OS_READTHREAD_H
+#define _XSERVER_OS_READTHREAD_H
+
+#include "dixstruct.h"
+#include "osdep.h"
+
+/* Number of threads reading client requests (-readthreads), 0 to read
+ * them all on the main thread. */
+extern int ReadThreadCount;
+
+void ReadThreadInit(void);
+void ReadThreadFini(void);
+
+/* Hand a client over to a reader thread.  FALSE if it has to stay on
+ * the main thread. */
+Bool ReadThreadAddClient(ClientPtr client);
+
+/* Take a client back from its reader thread, before its connection
+ * gets closed. */
+void ReadThreadRemoveClient(OsCommPtr oc);
+
+/* ReadRequestFromClient() for clients with a reader thread: the length
+ * of the next request, 0 if there's none yet, -1 if the client is gone. */
+int ReadThreadNextRequest(ClientPtr client);
+
+/* Have ReadThreadNextRequest() return the current request again. */
+void ReadThreadResetRequest(ClientPtr client);
+
+/* Whether the client has requests (or its end of file) waiting. */
+Bool ReadThreadPending(ClientPtr client);
+
+/* BIG-REQUESTS got enabled for the client. */
+void ReadThreadBigRequests(ClientPtr client);
+
+#endif /* _XSERVER_OS_READTHREAD_H */
@@ -105,10 +105,12 @@ __stdcall unsigned long GetTickCount(void);
 
 #include "dix/dix_priv.h"
 #include "dix/input_priv.h"
+#include "dix/profile_priv.h"
 #include "os/auth.h"
 #include "os/cmdline.h"
 #include "os/ddx_priv.h"
 #include "os/osdep.h"
+#include "os/readthread.h"
 #include "os/serverlock.h"
 
 #include "dixstruct.h"
@@ -273,6 +275,11 @@ GetTimeInMicros(void)
 {
     return (CARD64) GetTickCount() * 1000;
 }
+CARD64
+GetTimeInNanos(void)
+{
+    return (CARD64) GetTickCount() * 1000000;
+}
 #else
 CARD32
 GetTimeInMillis(void)
@@ -305,12 +312,20 @@ GetTimeInMillis(void)
 
 CARD64
 GetTimeInMicros(void)
+{
+    return GetTimeInNanos() / 1000;
+}
+
+CARD64
+GetTimeInNanos(void)
 {
     struct timeval tv;
 #ifdef MONOTONIC_CLOCK
     struct timespec tp;
     static clockid_t uclockid;
 
+    /* not the coarse clock, whose ticks are too long for anything finer
+     * than milliseconds */
     if (!uclockid) {
         if (clock_gettime(CLOCK_MONOTONIC, &tp) == 0)
             uclockid = CLOCK_MONOTONIC;
@@ -318,14 +333,41 @@ GetTimeInMicros(void)
             uclockid = ~0L;
     }
     if (uclockid != ~0L && clock_gettime(uclockid, &tp) == 0)
-        return (CARD64) tp.tv_sec * (CARD64)1000000 + tp.tv_nsec / 1000;
+        return (CARD64) tp.tv_sec * (CARD64)1000000000 + tp.tv_nsec;
 #endif
 
     X_GETTIMEOFDAY(&tv);
-    return (CARD64) tv.tv_sec * (CARD64)1000000 + (CARD64) tv.tv_usec;
+    return (CARD64) tv.tv_sec * (CARD64)1000000000 +
+        (CARD64) tv.tv_usec * 1000;
 }
 #endif
 
+/*
+ * The main thread asks for the time many times over while it handles a
+ * single request, and once more per timer check; it gets to share a
+ * single clock read between them, until Dispatch() or WaitForSomething()
+ * moves on and calls InvalidateCachedTime().  The input thread keeps
+ * reading the clock itself.
+ */
+static CARD32 cachedTimeInMillis;
+static Bool cachedTimeValid;
+
+CARD32
+GetCachedTimeInMillis(void)
+{
+    if (!cachedTimeValid) {
+        cachedTimeInMillis = GetTimeInMillis();
+        cachedTimeValid = TRUE;
+    }
+    return cachedTimeInMillis;
+}
+
+void
+InvalidateCachedTime(void)
+{
+    cachedTimeValid = FALSE;
+}
+
 void
 UseMsg(void)
 {
@@ -342,6 +384,7 @@ UseMsg(void)
     ErrorF("-c                     turns off key-click\n");
     ErrorF("c #                    key-click volume (0-100)\n");
     ErrorF("-cc int                default color visual class\n");
+    ErrorF("-coalescemotion        send clients only the latest of queued motion events\n");
     ErrorF("-nocursor              disable the cursor\n");
     ErrorF("-core                  generate core dump on fatal error\n");
     ErrorF("-displayfd fd          file descriptor to write display number to when ready to connect\n");
@@ -353,6 +396,7 @@ UseMsg(void)
         ("-deferglyphs [none|all|16] defer loading of [no|all|16-bit] glyphs\n");
     ErrorF("-f #                   bell base (0-100)\n");
     ErrorF("-fakescreenfps #       fake screen default fps (1-600)\n");
+    ErrorF("-fbthreads n           draw large operations in n more threads\n");
     ErrorF("-fp string             default font path\n");
     ErrorF("-help                  prints message with these options\n");
     ErrorF("+iglx                  Allow creating indirect GLX contexts\n");
@@ -377,8 +421,10 @@ UseMsg(void)
     ErrorF("-p #                   screen-saver pattern duration (minutes)\n");
     ErrorF("-pn                    accept failure to listen on all ports\n");
     ErrorF("-nopn                  reject failure to listen on all ports\n");
+    ErrorF("-profile               profile request dispatch (toggle with SIGUSR2)\n");
     ErrorF("-r                     turns off auto-repeat\n");
     ErrorF("r                      turns on auto-repeat \n");
+    ErrorF("-readthreads n         read network clients in n threads\n");
     ErrorF("-render [default|mono|gray|color] set render color alloc policy\n");
     ErrorF("-retro                 start with classic stipple and cursor\n");
     ErrorF("-s #                   screen-saver timeout (minutes)\n");
@@ -397,6 +443,7 @@ UseMsg(void)
 #endif
     ErrorF("-dumbSched             Disable smart scheduling and threaded input, enable old behavior\n");
     ErrorF("-schedInterval int     Set scheduler interval in msec\n");
+    ErrorF("-schedPolicy policy    Pick clients to run by smart, fair or focus\n");
     ErrorF("-sigstop               Enable SIGSTOP based startup\n");
     ErrorF("+extension name        Enable extension\n");
     ErrorF("-extension name        Disable extension\n");
@@ -552,6 +599,8 @@ ProcessCommandLine(int argc, char *argv[])
         else if (strcmp(argv[i], "-c") == 0) {
             defaultKeyboardControl.click = 0;
         }
+        else if (strcmp(argv[i], "-coalescemotion") == 0)
+            coalesceMotionEvents = TRUE;
         else if (strcmp(argv[i], "-cc") == 0) {
             if (++i < argc)
                 defaultColorVisualClass = atoi(argv[i]);
@@ -610,6 +659,12 @@ ProcessCommandLine(int argc, char *argv[])
             else
                 UseMsg();
         }
+        else if (strcmp(argv[i], "-fbthreads") == 0) {
+            if (++i < argc)
+                fbThreadCount = atoi(argv[i]);
+            else
+                UseMsg();
+        }
         else if (strcmp(argv[i], "-fp") == 0) {
             if (++i < argc) {
                 defaultFontPath = argv[i];
@@ -705,6 +760,12 @@ ProcessCommandLine(int argc, char *argv[])
             else
                 UseMsg();
         }
+        else if (strcmp(argv[i], "-readthreads") == 0) {
+            if (++i < argc)
+                ReadThreadCount = atoi(argv[i]);
+            else
+                UseMsg();
+        }
         else if (strcmp(argv[i], "-noreset") == 0) {
             dispatchExceptionAtReset = 0;
         }
@@ -721,6 +782,8 @@ ProcessCommandLine(int argc, char *argv[])
         else if (strcmp(argv[i], "-pogo") == 0) {
             dispatchException = DE_TERMINATE;
         }
+        else if (strcmp(argv[i], "-profile") == 0)
+            DispatchProfileEnabled = TRUE;
         else if (strcmp(argv[i], "-pn") == 0)
             PartialNetwork = TRUE;
         else if (strcmp(argv[i], "-nopn") == 0)
@@ -827,6 +890,10 @@ ProcessCommandLine(int argc, char *argv[])
             else
                 UseMsg();
         }
+        else if (strcmp(argv[i], "-schedPolicy") == 0) {
+            if (++i >= argc || !ScheduleSetPolicy(argv[i]))
+                UseMsg();
+        }
         else if (strcmp(argv[i], "-schedMax") == 0) {
             if (++i < argc) {
                 SmartScheduleMaxSlice = atoi(argv[i]);
@@ -53,6 +53,7 @@ static int PictureGeneration;
 RESTYPE PictureType;
 RESTYPE PictFormatType;
 RESTYPE GlyphSetType;
+PictureImageStatsRec PictureImageStats;
 int PictureCmapPolicy = PictureCmapPolicyDefault;
 
 PictFormatPtr
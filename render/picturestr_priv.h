@@ -18,6 +18,16 @@ extern RESTYPE PictureType;
 extern RESTYPE PictFormatType;
 extern RESTYPE GlyphSetType;
 
+/* How often the screen's drawing code kept the pixman image of a picture
+ * and used it again, and how often it set one up; fb counts and logs
+ * them. */
+typedef struct _PictureImageStats {
+    uint64_t reused;
+    uint64_t setUp;
+} PictureImageStatsRec;
+
+extern PictureImageStatsRec PictureImageStats;
+
 #define VERIFY_PICTURE(pPicture, pid, client, mode) {\
     int tmprc = dixLookupResourceByType((void *)&(pPicture), pid,\
 	                                PictureType, client, mode);\
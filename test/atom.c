@@ -0,0 +1,144 @@
+/**
+ * Copyright © 2026 X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <dix-config.h>
+
+#include <X11/Xatom.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "misc.h"
+#include "dix.h"
+#include "tests-common.h"
+
+#define NUM_BENCH_ATOMS 100000
+
+static void
+atom_predefined(void)
+{
+    InitAtoms();
+
+    assert(MakeAtom("PRIMARY", 7, FALSE) == XA_PRIMARY);
+    assert(MakeAtom("WM_TRANSIENT_FOR", 16, FALSE) == XA_LAST_PREDEFINED);
+    assert(strcmp(NameForAtom(XA_STRING), "STRING") == 0);
+    assert(NameForAtom(None) == NULL);
+    assert(NameForAtom(XA_LAST_PREDEFINED + 1) == NULL);
+    assert(!ValidAtom(None));
+    assert(ValidAtom(XA_LAST_PREDEFINED));
+    assert(!ValidAtom(XA_LAST_PREDEFINED + 1));
+
+    FreeAllAtoms();
+}
+
+static void
+atom_make_lookup(void)
+{
+    Atom a, b;
+
+    InitAtoms();
+
+    assert(MakeAtom("_NET_WM_NAME", 12, FALSE) == None);
+    a = MakeAtom("_NET_WM_NAME", 12, TRUE);
+    assert(a == XA_LAST_PREDEFINED + 1);
+    assert(MakeAtom("_NET_WM_NAME", 12, TRUE) == a);
+    assert(MakeAtom("_NET_WM_NAME", 12, FALSE) == a);
+    assert(strcmp(NameForAtom(a), "_NET_WM_NAME") == 0);
+
+    /* only the first len bytes of the string make up the name */
+    assert(MakeAtom("_NET_WM_NAME_X", 12, FALSE) == a);
+
+    /* a prefix of an existing name is a distinct atom */
+    b = MakeAtom("_NET_WM_NAM", 11, TRUE);
+    assert(b != a && b != None);
+    assert(strcmp(NameForAtom(b), "_NET_WM_NAM") == 0);
+
+    /* names stop at the first NUL, as they always have */
+    assert(MakeAtom("_NET_WM_NAME\0junk", 17, FALSE) == a);
+
+    /* the empty name is a valid atom */
+    b = MakeAtom("", 0, TRUE);
+    assert(b != None && b != BAD_RESOURCE);
+    assert(strcmp(NameForAtom(b), "") == 0);
+
+    FreeAllAtoms();
+}
+
+static void
+atom_many(void)
+{
+    static char names[NUM_BENCH_ATOMS][16];
+    double start, made, forward, reverse;
+    int i;
+
+    InitAtoms();
+
+    for (i = 0; i < NUM_BENCH_ATOMS; i++)
+        snprintf(names[i], sizeof(names[i]), "_ATOM_%08x", i * 2654435761u);
+
+    start = now_ms();
+    for (i = 0; i < NUM_BENCH_ATOMS; i++)
+        assert(MakeAtom(names[i], strlen(names[i]), TRUE) ==
+               XA_LAST_PREDEFINED + 1 + i);
+    made = now_ms();
+
+    for (i = 0; i < NUM_BENCH_ATOMS; i++)
+        assert(MakeAtom(names[i], strlen(names[i]), FALSE) ==
+               XA_LAST_PREDEFINED + 1 + i);
+    forward = now_ms();
+
+    for (i = NUM_BENCH_ATOMS - 1; i >= 0; i--) {
+        Atom a = XA_LAST_PREDEFINED + 1 + i;
+
+        assert(strcmp(NameForAtom(a), names[i]) == 0);
+        assert(MakeAtom(names[i], strlen(names[i]), FALSE) == a);
+    }
+    reverse = now_ms();
+
+    dbg("%d atoms: intern %.2fms, lookup %.2fms, reverse lookup %.2fms\n",
+        NUM_BENCH_ATOMS, made - start, forward - made, reverse - forward);
+
+    /* predefined atoms survive the table growing underneath them */
+    assert(MakeAtom("WM_CLASS", 8, FALSE) == XA_WM_CLASS);
+    assert(strcmp(NameForAtom(XA_WM_CLASS), "WM_CLASS") == 0);
+
+    FreeAllAtoms();
+    InitAtoms();
+    assert(MakeAtom(names[0], strlen(names[0]), FALSE) == None);
+    FreeAllAtoms();
+}
+
+const testfunc_t*
+atom_test(void)
+{
+    static const testfunc_t testfuncs[] = {
+        atom_predefined,
+        atom_make_lookup,
+        atom_many,
+        NULL,
+    };
+
+    return testfuncs;
+}
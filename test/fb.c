@@ -0,0 +1,669 @@
+/**
+ * Copyright © 2026 X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <dix-config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dix/dix_priv.h"
+#include "render/picturestr_priv.h"
+
+#include "fb.h"
+#include "mi.h"
+#include "privates.h"
+#include "scrnintstr.h"
+#include "windowstr.h"
+#include "tests-common.h"
+
+#define WIDTH 200
+#define HEIGHT 16
+#define BENCH_WIDTH 1024
+#define BENCH_HEIGHT 768
+#define FILL_SIZE 512
+#define PICT_SIZE 64
+
+static void
+fill_random(void *p, size_t size)
+{
+    unsigned char *c = p;
+
+    while (size--)
+        *c++ = rand();
+}
+
+/* fbBltPlane() as it was before it handled pixels of whole bytes apart */
+static void
+scalar_blt_plane(FbBits * src, FbStride srcStride, int srcX, int srcBpp,
+                 FbStip * dst, FbStride dstStride, int dstX,
+                 int width, int height,
+                 FbStip fgand, FbStip fgxor, FbStip bgand, FbStip bgxor,
+                 Pixel planeMask)
+{
+    FbBits *s;
+    FbBits pm;
+    FbBits srcMask, srcMaskFirst, srcMask0;
+    FbBits srcBits;
+    FbStip dstBits;
+    FbStip *d;
+    FbStip dstMask, dstMaskFirst;
+    FbStip dstUnion;
+    int w, wt;
+
+    src += srcX >> FB_SHIFT;
+    srcX &= FB_MASK;
+    dst += dstX >> FB_STIP_SHIFT;
+    dstX &= FB_STIP_MASK;
+    w = width / srcBpp;
+
+    pm = fbReplicatePixel(planeMask, srcBpp);
+    srcMaskFirst = pm & FbBitsMask(srcX, srcBpp);
+    srcMask0 = pm & FbBitsMask(0, srcBpp);
+    dstMaskFirst = FbStipMask(dstX, 1);
+    while (height--) {
+        d = dst;
+        dst += dstStride;
+        s = src;
+        src += srcStride;
+
+        srcMask = srcMaskFirst;
+        srcBits = *s++;
+        dstMask = dstMaskFirst;
+        dstUnion = 0;
+        dstBits = 0;
+        for (wt = w; wt--;) {
+            if (!srcMask) {
+                srcBits = *s++;
+                srcMask = srcMask0;
+            }
+            if (!dstMask) {
+                *d = FbStippleRRopMask(*d, dstBits, fgand, fgxor,
+                                       bgand, bgxor, dstUnion);
+                d++;
+                dstMask = FbStipMask(0, 1);
+                dstUnion = 0;
+                dstBits = 0;
+            }
+            if (srcBits & srcMask)
+                dstBits |= dstMask;
+            dstUnion |= dstMask;
+            if (srcBpp == FB_UNIT)
+                srcMask = 0;
+            else
+                srcMask = FbScrRight(srcMask, srcBpp);
+            dstMask = FbStipRight(dstMask, 1);
+        }
+        if (dstUnion)
+            *d = FbStippleRRopMask(*d, dstBits, fgand, fgxor,
+                                   bgand, bgxor, dstUnion);
+    }
+}
+
+/* fbPutImage() of an XYPixmap as it was: a pass of fbBltOne() per plane */
+static void
+scalar_blt_xy_planes(FbStip * src, FbStride srcStride, FbStride planeStride,
+                     int srcX, int depth, FbBits * dst, FbStride dstStride,
+                     int dstX, int dstBpp, int width, int height,
+                     int alu, Pixel planeMask)
+{
+    Pixel i;
+
+    for (i = (Pixel) 1 << (depth - 1); i; i >>= 1) {
+        if (i & planeMask) {
+            FbBits pm = fbReplicatePixel(i, dstBpp);
+
+            fbBltOne(src, srcStride, srcX, dst, dstStride, dstX, dstBpp,
+                     width, height,
+                     fbAnd(alu, FB_ALLONES, pm), fbXor(alu, FB_ALLONES, pm),
+                     fbAnd(alu, 0, pm), fbXor(alu, 0, pm));
+        }
+        src += planeStride;
+    }
+}
+
+static void
+fb_plane_extract(void)
+{
+    static const int bpps[] = { 8, 16, 32 };
+    FbBits src[HEIGHT * WIDTH];
+    FbStip dst[HEIGHT * 16], ref[HEIGHT * 16];
+    FbStride srcStride = WIDTH;
+    FbStride dstStride = 16;
+    int n, b, alu;
+
+    srand(3);
+    fill_random(src, sizeof(src));
+
+    for (n = 0; n < 500; n++) {
+        int bpp = bpps[n % ARRAY_SIZE(bpps)];
+        int maxw = WIDTH * FB_UNIT / bpp;
+        int srcX = rand() % (maxw / 2);
+        int dstX = rand() % 64;
+        int width = rand() % (min(maxw - srcX, dstStride * FB_STIP_UNIT -
+                                  dstX) + 1);
+        Pixel planeMask = (Pixel) 1 << (rand() % bpp);
+
+        if (n % 7 == 0)
+            planeMask |= rand();        /* more than one plane */
+        alu = rand() % 16;
+        fill_random(dst, sizeof(dst));
+        memcpy(ref, dst, sizeof(dst));
+
+        fbBltPlane(src, srcStride, srcX * bpp, bpp, dst, dstStride, dstX,
+                   width * bpp, HEIGHT,
+                   fbAndStip(alu, FB_STIP_ALLONES, FB_STIP_ALLONES),
+                   fbXorStip(alu, FB_STIP_ALLONES, FB_STIP_ALLONES),
+                   fbAndStip(alu, 0, FB_STIP_ALLONES),
+                   fbXorStip(alu, 0, FB_STIP_ALLONES), planeMask);
+        scalar_blt_plane(src, srcStride, srcX * bpp, bpp, ref, dstStride,
+                         dstX, width * bpp, HEIGHT,
+                         fbAndStip(alu, FB_STIP_ALLONES, FB_STIP_ALLONES),
+                         fbXorStip(alu, FB_STIP_ALLONES, FB_STIP_ALLONES),
+                         fbAndStip(alu, 0, FB_STIP_ALLONES),
+                         fbXorStip(alu, 0, FB_STIP_ALLONES), planeMask);
+        for (b = 0; b < ARRAY_SIZE(dst); b++)
+            assert(dst[b] == ref[b]);
+    }
+}
+
+static void
+fb_plane_insert(void)
+{
+    static const struct {
+        int depth, bpp;
+    } formats[] = {
+        { 8, 8 }, { 15, 16 }, { 16, 16 }, { 24, 32 }, { 30, 32 }, { 32, 32 },
+    };
+    FbStip src[32 * HEIGHT * 8];
+    FbBits dst[HEIGHT * WIDTH], ref[HEIGHT * WIDTH];
+    FbStride srcStride = 8;
+    FbStride planeStride = HEIGHT * srcStride;
+    FbStride dstStride = WIDTH;
+    int n, b;
+
+    srand(4);
+    fill_random(src, sizeof(src));
+
+    for (n = 0; n < 500; n++) {
+        int depth = formats[n % ARRAY_SIZE(formats)].depth;
+        int bpp = formats[n % ARRAY_SIZE(formats)].bpp;
+        int srcX = rand() % 64;
+        int dstX = rand() % 64;
+        int width = 1 + rand() % min(srcStride * FB_STIP_UNIT - srcX,
+                                     WIDTH * FB_UNIT / bpp - dstX);
+        int alu = rand() % 16;
+        Pixel planeMask = rand();
+
+        if (n % 5 == 0)
+            planeMask = ~(Pixel) 0;
+        fill_random(dst, sizeof(dst));
+        memcpy(ref, dst, sizeof(dst));
+
+        fbBltXYPlanes(src, srcStride, planeStride, srcX, depth,
+                      dst, dstStride, dstX * bpp, bpp, width * bpp, HEIGHT,
+                      alu, planeMask);
+        scalar_blt_xy_planes(src, srcStride, planeStride, srcX, depth,
+                             ref, dstStride, dstX * bpp, bpp, width * bpp,
+                             HEIGHT, alu, planeMask);
+        for (b = 0; b < ARRAY_SIZE(dst); b++)
+            assert(dst[b] == ref[b]);
+    }
+}
+
+static void
+fb_plane_bench(void)
+{
+    FbStride pixStride = BENCH_WIDTH;
+    FbStride bitStride = BENCH_WIDTH / FB_STIP_UNIT;
+    FbStride planeStride = bitStride * BENCH_HEIGHT;
+    FbBits *pix = calloc(pixStride * BENCH_HEIGHT, sizeof(FbBits));
+    FbStip *bits = calloc(planeStride * 24, sizeof(FbStip));
+    double start, mid, end;
+    Pixel plane;
+
+    assert(pix && bits);
+    srand(5);
+    fill_random(pix, pixStride * BENCH_HEIGHT * sizeof(FbBits));
+
+    /* GetImage of an XYPixmap comes a plane at a time */
+    start = now_ms();
+    for (plane = 0; plane < 24; plane++)
+        scalar_blt_plane(pix, pixStride, 0, 32,
+                         bits + (23 - plane) * planeStride, bitStride, 0,
+                         BENCH_WIDTH * 32, BENCH_HEIGHT,
+                         fbAndStip(GXcopy, FB_STIP_ALLONES, FB_STIP_ALLONES),
+                         fbXorStip(GXcopy, FB_STIP_ALLONES, FB_STIP_ALLONES),
+                         fbAndStip(GXcopy, 0, FB_STIP_ALLONES),
+                         fbXorStip(GXcopy, 0, FB_STIP_ALLONES),
+                         (Pixel) 1 << plane);
+    mid = now_ms();
+    for (plane = 0; plane < 24; plane++)
+        fbBltPlane(pix, pixStride, 0, 32,
+                   bits + (23 - plane) * planeStride, bitStride, 0,
+                   BENCH_WIDTH * 32, BENCH_HEIGHT,
+                   fbAndStip(GXcopy, FB_STIP_ALLONES, FB_STIP_ALLONES),
+                   fbXorStip(GXcopy, FB_STIP_ALLONES, FB_STIP_ALLONES),
+                   fbAndStip(GXcopy, 0, FB_STIP_ALLONES),
+                   fbXorStip(GXcopy, 0, FB_STIP_ALLONES), (Pixel) 1 << plane);
+    end = now_ms();
+    dbg("%dx%d XYPixmap get, 24 planes: %.2fms a bit at a time, %.2fms now\n",
+        BENCH_WIDTH, BENCH_HEIGHT, mid - start, end - mid);
+
+    start = now_ms();
+    scalar_blt_xy_planes(bits, bitStride, planeStride, 0, 24, pix, pixStride,
+                         0, 32, BENCH_WIDTH * 32, BENCH_HEIGHT, GXcopy,
+                         0xffffff);
+    mid = now_ms();
+    fbBltXYPlanes(bits, bitStride, planeStride, 0, 24, pix, pixStride,
+                  0, 32, BENCH_WIDTH * 32, BENCH_HEIGHT, GXcopy, 0xffffff);
+    end = now_ms();
+    dbg("%dx%d XYPixmap put, 24 planes: %.2fms a plane at a time, %.2fms now\n",
+        BENCH_WIDTH, BENCH_HEIGHT, mid - start, end - mid);
+
+    free(bits);
+    free(pix);
+}
+
+static ScreenRec fillScreen;
+
+/* Just enough of a screen for fbFill() to find its GC private */
+static GCPtr
+fill_gc(void)
+{
+    GCPtr pGC;
+
+    dixResetPrivates();
+    screenInfo.numScreens = 1;
+    screenInfo.screens[0] = &fillScreen;
+    dixInitScreenSpecificPrivates(&fillScreen);
+    assert(dixAllocatePrivates(&fillScreen.devPrivates, PRIVATE_SCREEN));
+    assert(fbAllocatePrivates(&fillScreen));
+
+    pGC = dixAllocateScreenObjectWithPrivates(&fillScreen, GC, PRIVATE_GC);
+    assert(pGC);
+    pGC->pScreen = &fillScreen;
+    pGC->alu = GXcopy;
+    pGC->planemask = ~0;
+    pGC->fgPixel = 0x123456;
+    pGC->bgPixel = 0xabcdef;
+    pGC->patOrg.x = 5;
+    pGC->patOrg.y = 3;
+    fbGetGCPrivate(pGC)->pm = FB_ALLONES;
+    fbGetGCPrivate(pGC)->and = fbAnd(GXcopy, pGC->fgPixel, FB_ALLONES);
+    fbGetGCPrivate(pGC)->xor = fbXor(GXcopy, pGC->fgPixel, FB_ALLONES);
+    fbGetGCPrivate(pGC)->bgand = fbAnd(GXcopy, pGC->bgPixel, FB_ALLONES);
+    fbGetGCPrivate(pGC)->bgxor = fbXor(GXcopy, pGC->bgPixel, FB_ALLONES);
+    return pGC;
+}
+
+static void
+fill_pixmap(PixmapPtr pPixmap, void *bits, int width, int height, int bpp,
+            int stride)
+{
+    memset(pPixmap, 0, sizeof(*pPixmap));
+    pPixmap->drawable.type = DRAWABLE_PIXMAP;
+    pPixmap->drawable.pScreen = &fillScreen;
+    pPixmap->drawable.depth = bpp == 1 ? 1 : 24;
+    pPixmap->drawable.bitsPerPixel = bpp;
+    pPixmap->drawable.width = width;
+    pPixmap->drawable.height = height;
+    pPixmap->devKind = stride;
+    pPixmap->devPrivate.ptr = bits;
+}
+
+/*
+ * Tiled and stippled fills drawn in bands must come out as drawn in one,
+ * including when the tile is part of the pixmap being filled.
+ */
+static void
+fb_fill_bands(void)
+{
+    static FbBits tileBits[16 * 32];
+    static FbStip stipBits[16];
+    static const int threads[] = { 3, 0 };
+    size_t size = FILL_SIZE * FILL_SIZE * sizeof(FbBits);
+    FbBits *init = malloc(size);
+    FbBits *out[2] = { malloc(size), malloc(size) };
+    PixmapRec dst, tile, stipple;
+    GCPtr pGC = fill_gc();
+    int n, i;
+
+    assert(init && out[0] && out[1]);
+    srand(6);
+    fill_random(init, size);
+    fill_random(tileBits, sizeof(tileBits));
+    fill_random(stipBits, sizeof(stipBits));
+    fill_pixmap(&stipple, stipBits, 32, 16, 1, sizeof(FbStip));
+    pGC->stipple = &stipple;
+    pGC->tile.pixmap = &tile;
+    pGC->tileIsPixel = FALSE;
+
+    /* a tile, a stipple, and a tile in the destination */
+    for (n = 0; n < 3; n++) {
+        pGC->fillStyle = n == 1 ? FillOpaqueStippled : FillTiled;
+        for (i = 0; i < ARRAY_SIZE(threads); i++) {
+            memcpy(out[i], init, size);
+            fill_pixmap(&dst, out[i], FILL_SIZE, FILL_SIZE, 32,
+                        FILL_SIZE * sizeof(FbBits));
+            if (n == 2)
+                fill_pixmap(&tile, out[i] + 300 * FILL_SIZE + 40, 32, 16, 32,
+                            FILL_SIZE * sizeof(FbBits));
+            else
+                fill_pixmap(&tile, tileBits, 32, 16, 32, 32 * sizeof(FbBits));
+
+            fbThreadCount = threads[i];
+            fbFill(&dst.drawable, pGC, 7, 0, FILL_SIZE - 9, FILL_SIZE);
+        }
+        assert(memcmp(out[0], out[1], size) == 0);
+    }
+
+    fbThreadCount = 0;
+    free(out[1]);
+    free(out[0]);
+    free(init);
+}
+
+/*
+ * A screen with RENDER on fb, and one format, a8r8g8b8.  The pixmaps and
+ * windows drawn to are made up by the tests, which free their bits.
+ */
+static ScreenRec pictScreen;
+static ClientRec pictServerClient;
+static PictFormatPtr pictFormat;
+
+static Bool
+pict_destroy_pixmap(PixmapPtr pPixmap)
+{
+    pPixmap->refcnt--;
+    return TRUE;
+}
+
+static void
+pict_screen(void)
+{
+    PictFormatPtr format = calloc(1, sizeof(PictFormatRec));
+
+    assert(format);
+    dixResetPrivates();
+    serverClient = &pictServerClient;
+    InitClient(serverClient, 0, NULL);
+    assert(InitClientResources(serverClient));
+
+    screenInfo.numScreens = 1;
+    screenInfo.screens[0] = &pictScreen;
+    dixInitScreenSpecificPrivates(&pictScreen);
+    assert(dixAllocatePrivates(&pictScreen.devPrivates, PRIVATE_SCREEN));
+    assert(fbAllocatePrivates(&pictScreen));
+    pictScreen.DestroyPixmap = pict_destroy_pixmap;
+    pictScreen.ModifyPixmapHeader = miModifyPixmapHeader;
+
+    format->id = FakeClientID(0);
+    format->type = PictTypeDirect;
+    format->depth = 32;
+    format->direct.alpha = 24;
+    format->direct.alphaMask = 0xff;
+    format->direct.red = 16;
+    format->direct.redMask = 0xff;
+    format->direct.green = 8;
+    format->direct.greenMask = 0xff;
+    format->direct.blueMask = 0xff;
+    assert(fbPictureInit(&pictScreen, format, 1));
+    pictFormat = format;
+}
+
+static void
+pict_pixmap(PixmapPtr pPixmap, void *bits, int width, int height)
+{
+    memset(pPixmap, 0, sizeof(*pPixmap));
+    pPixmap->drawable.type = DRAWABLE_PIXMAP;
+    pPixmap->drawable.pScreen = &pictScreen;
+    pPixmap->drawable.depth = 32;
+    pPixmap->drawable.bitsPerPixel = 32;
+    pPixmap->drawable.width = width;
+    pPixmap->drawable.height = height;
+    pPixmap->drawable.serialNumber = NEXT_SERIAL_NUMBER;
+    pPixmap->devKind = width * 4;
+    pPixmap->devPrivate.ptr = bits;
+    pPixmap->refcnt = 1;
+}
+
+/* A window showing in all of its area of pScreenPixmap */
+static WindowPtr
+pict_window(PixmapPtr pScreenPixmap, int x, int y, int width, int height)
+{
+    WindowPtr pWin = dixAllocateScreenObjectWithPrivates(&pictScreen,
+                                                         WindowRec,
+                                                         PRIVATE_WINDOW);
+    BoxRec box = { x, y, x + width, y + height };
+
+    assert(pWin);
+    pWin->drawable.type = DRAWABLE_WINDOW;
+    pWin->drawable.pScreen = &pictScreen;
+    pWin->drawable.depth = 32;
+    pWin->drawable.bitsPerPixel = 32;
+    pWin->drawable.x = x;
+    pWin->drawable.y = y;
+    pWin->drawable.width = width;
+    pWin->drawable.height = height;
+    pWin->drawable.serialNumber = NEXT_SERIAL_NUMBER;
+    RegionInit(&pWin->clipList, &box, 1);
+    _fbSetWindowPixmap(pWin, pScreenPixmap);
+    return pWin;
+}
+
+static PicturePtr
+pict_picture(DrawablePtr pDrawable)
+{
+    PicturePtr pPicture;
+    int error;
+
+    pPicture = CreatePicture(FakeClientID(0), pDrawable, pictFormat, 0, NULL,
+                             serverClient, &error);
+    assert(pPicture && error == Success);
+    return pPicture;
+}
+
+enum {
+    PICT_CLIP,                  /* of the destination */
+    PICT_REPEAT,                /* of the source */
+    PICT_TRANSFORM,
+    PICT_FILTER,
+    PICT_MOVE_WINDOW,           /* the destination */
+    PICT_MODIFY_PIXMAP,         /* the destination's header */
+    PICT_CHANGES
+};
+
+/* What a picture starts with, before the change */
+static void
+pict_setup(int change, PicturePtr pSrc)
+{
+    PictTransform scale = { {
+        { pixman_double_to_fixed(0.75), 0, 0 },
+        { 0, pixman_double_to_fixed(0.75), 0 },
+        { 0, 0, pixman_fixed_1 },
+    } };
+
+    if (change == PICT_FILTER)
+        assert(SetPictureTransform(pSrc, &scale) == Success);
+}
+
+/* The change to the pictures, as opposed to their drawables */
+static void
+pict_change(int change, PicturePtr pSrc, PicturePtr pDst)
+{
+    xRectangle clip = { 5, 7, 30, 20 };
+    XID repeat = RepeatNormal;
+    PictTransform scale = { {
+        { pixman_int_to_fixed(2), 0, 0 },
+        { 0, pixman_int_to_fixed(2), 0 },
+        { 0, 0, pixman_fixed_1 },
+    } };
+
+    switch (change) {
+    case PICT_CLIP:
+        assert(SetPictureClipRects(pDst, 3, 1, 1, &clip) == Success);
+        break;
+    case PICT_REPEAT:
+        assert(ChangePicture(pSrc, CPRepeat, &repeat, NULL,
+                             serverClient) == Success);
+        break;
+    case PICT_TRANSFORM:
+        assert(SetPictureTransform(pSrc, &scale) == Success);
+        break;
+    case PICT_FILTER:
+        assert(SetPictureFilter(pSrc, FilterBilinear, strlen(FilterBilinear),
+                                NULL, 0) == Success);
+        break;
+    }
+}
+
+static void
+pict_composite(PicturePtr pSrc, PicturePtr pDst)
+{
+    CompositePicture(PictOpOver, pSrc, NULL, pDst, 16, 8, 0, 0, 4, 2,
+                     PICT_SIZE - 8, PICT_SIZE - 4);
+}
+
+/*
+ * Composite, change something, and composite again, into out; with the
+ * same pictures all along if cached, with new ones each time if not.
+ */
+static void
+pict_run(int change, Bool cached, const uint32_t *srcBits, uint32_t *out)
+{
+    PixmapRec src, dst;
+    WindowPtr pWin = NULL;
+    PicturePtr pSrc, pDst;
+    DrawablePtr pDstDrawable = &dst.drawable;
+    PictureImageStatsRec before;
+
+    pict_pixmap(&src, (void *) srcBits, PICT_SIZE, PICT_SIZE);
+    pict_pixmap(&dst, out, PICT_SIZE, PICT_SIZE);
+    if (change == PICT_MOVE_WINDOW) {
+        pWin = pict_window(&dst, 10, 6, 40, 30);
+        pDstDrawable = &pWin->drawable;
+    }
+
+    pSrc = pict_picture(&src.drawable);
+    pDst = pict_picture(pDstDrawable);
+    pict_setup(change, pSrc);
+    pict_composite(pSrc, pDst);
+
+    /* the images are kept */
+    before = PictureImageStats;
+    pict_composite(pSrc, pDst);
+    if (cached)
+        assert(PictureImageStats.reused == before.reused + 2 &&
+               PictureImageStats.setUp == before.setUp);
+
+    switch (change) {
+    case PICT_MOVE_WINDOW:
+        /* as miValidateTree() leaves it */
+        pWin->drawable.x += 13;
+        pWin->drawable.y += 5;
+        RegionTranslate(&pWin->clipList, 13, 5);
+        pWin->drawable.serialNumber = NEXT_SERIAL_NUMBER;
+        break;
+    case PICT_MODIFY_PIXMAP:
+        /* the second half of out */
+        assert(miModifyPixmapHeader(&dst, PICT_SIZE, PICT_SIZE, 32, 32,
+                                    PICT_SIZE * 4, out + PICT_SIZE * PICT_SIZE));
+        break;
+    }
+
+    if (!cached) {
+        FreePicture(pSrc, 0);
+        FreePicture(pDst, 0);
+        pSrc = pict_picture(&src.drawable);
+        pDst = pict_picture(pDstDrawable);
+        pict_setup(change, pSrc);
+    }
+    pict_change(change, pSrc, pDst);
+
+    /* and dropped after the change */
+    before = PictureImageStats;
+    pict_composite(pSrc, pDst);
+    assert(PictureImageStats.setUp > before.setUp);
+
+    FreePicture(pSrc, 0);
+    FreePicture(pDst, 0);
+    if (pWin) {
+        RegionUninit(&pWin->clipList);
+        dixFreeObjectWithPrivates(pWin, PRIVATE_WINDOW);
+    }
+}
+
+/*
+ * fb keeps the pixman image of a picture between operations.  Compositing
+ * after a change to the picture or its drawable must come out as it does
+ * with new pictures.
+ */
+static void
+fb_picture_images(void)
+{
+    size_t size = PICT_SIZE * PICT_SIZE * sizeof(uint32_t);
+    uint32_t *srcBits = malloc(size);
+    uint32_t *init = malloc(2 * size);
+    uint32_t *out[2] = { malloc(2 * size), malloc(2 * size) };
+    int change, i;
+
+    assert(srcBits && init && out[0] && out[1]);
+    pict_screen();
+    srand(7);
+    fill_random(srcBits, size);
+    fill_random(init, 2 * size);
+
+    for (change = 0; change < PICT_CHANGES; change++) {
+        for (i = 0; i < 2; i++) {
+            memcpy(out[i], init, 2 * size);
+            pict_run(change, i == 0, srcBits, out[i]);
+        }
+        assert(memcmp(out[0], out[1], 2 * size) == 0);
+        /* and something was drawn */
+        assert(memcmp(out[0], init, 2 * size) != 0);
+    }
+
+    free(out[1]);
+    free(out[0]);
+    free(init);
+    free(srcBits);
+}
+
+const testfunc_t*
+fb_test(void)
+{
+    static const testfunc_t testfuncs[] = {
+        fb_plane_extract,
+        fb_plane_insert,
+        fb_plane_bench,
+        fb_fill_bands,
+        fb_picture_images,
+        NULL,
+    };
+
+    return testfuncs;
+}
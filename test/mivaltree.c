@@ -0,0 +1,321 @@
+/**
+ * Copyright © 2026 X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <dix-config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "misc.h"
+#include "dix.h"
+#include "dixstruct.h"
+#include "mi.h"
+#include "regionstr.h"
+#include "scrnintstr.h"
+#include "windowstr.h"
+#include "tests-common.h"
+
+#define NUM_TOPLEVELS 60
+#define NUM_CHILDREN 2
+#define NUM_STEPS 400
+#define NUM_STACKED 100
+#define NUM_WINDOWS 200
+#define ROOT_WIDTH 640
+#define ROOT_HEIGHT 480
+
+static ScreenRec screen;
+static WindowOptRec optional;
+static WindowRec root;
+static WindowRec windows[NUM_WINDOWS];
+static int numWindows;
+static int marked;
+
+static void
+clip_mark_window(WindowPtr pWin)
+{
+    if (!pWin->valdata)
+        marked++;
+    miMarkWindow(pWin);
+}
+
+static Bool
+clip_position_window(WindowPtr pWin, int x, int y)
+{
+    return TRUE;
+}
+
+static Bool
+clip_realize_window(WindowPtr pWin)
+{
+    return TRUE;
+}
+
+static void
+clip_copy_window(WindowPtr pWin, DDXPointRec oldOrigin, RegionPtr oldRegion)
+{
+}
+
+static void
+clip_window_exposures(WindowPtr pWin, RegionPtr prgn)
+{
+}
+
+static void
+clip_paint_window(WindowPtr pWin, RegionPtr prgn, int what)
+{
+}
+
+static void
+clip_setup(void)
+{
+    BoxRec box = { 0, 0, ROOT_WIDTH, ROOT_HEIGHT };
+
+    InitRegions();
+    memset(&screen, 0, sizeof(screen));
+    screen.width = ROOT_WIDTH;
+    screen.height = ROOT_HEIGHT;
+    screen.root = &root;
+    screen.MarkWindow = clip_mark_window;
+    screen.MarkOverlappedWindows = miMarkOverlappedWindows;
+    screen.MarkUnrealizedWindow = miMarkUnrealizedWindow;
+    screen.ValidateTree = miValidateTree;
+    screen.HandleExposures = miHandleValidateExposures;
+    screen.GetLayerWindow = miGetLayerWindow;
+    screen.MoveWindow = miMoveWindow;
+    screen.ResizeWindow = miResizeWindow;
+    screen.PositionWindow = clip_position_window;
+    screen.RealizeWindow = clip_realize_window;
+    screen.UnrealizeWindow = clip_realize_window;
+    screen.CopyWindow = clip_copy_window;
+    screen.WindowExposures = clip_window_exposures;
+    screen.PaintWindow = clip_paint_window;
+
+    memset(&root, 0, sizeof(root));
+    memset(&optional, 0, sizeof(optional));
+    root.drawable.pScreen = &screen;
+    root.drawable.class = InputOutput;
+    root.drawable.width = ROOT_WIDTH;
+    root.drawable.height = ROOT_HEIGHT;
+    root.optional = &optional;
+    root.borderIsPixel = TRUE;
+    root.mapped = root.realized = root.viewable = TRUE;
+    root.visibility = VisibilityUnobscured;
+    RegionInit(&root.winSize, &box, 1);
+    RegionInit(&root.borderSize, &box, 1);
+    RegionInit(&root.clipList, &box, 1);
+    RegionInit(&root.borderClip, &box, 1);
+    numWindows = 0;
+}
+
+static WindowPtr
+clip_create(WindowPtr pParent, int x, int y, int w, int h, int bw)
+{
+    WindowPtr pWin = &windows[numWindows++];
+
+    memset(pWin, 0, sizeof(*pWin));
+    pWin->drawable.pScreen = &screen;
+    pWin->drawable.class = InputOutput;
+    pWin->drawable.id = FakeClientID(0);
+    pWin->drawable.width = w;
+    pWin->drawable.height = h;
+    pWin->drawable.x = pParent->drawable.x + x + bw;
+    pWin->drawable.y = pParent->drawable.y + y + bw;
+    pWin->origin.x = x + bw;
+    pWin->origin.y = y + bw;
+    pWin->borderWidth = bw;
+    pWin->borderIsPixel = TRUE;
+    pWin->visibility = VisibilityNotViewable;
+    pWin->parent = pParent;
+    pWin->nextSib = pParent->firstChild;
+    if (pParent->firstChild)
+        pParent->firstChild->prevSib = pWin;
+    else
+        pParent->lastChild = pWin;
+    pParent->firstChild = pWin;
+    RegionNull(&pWin->winSize);
+    RegionNull(&pWin->borderSize);
+    RegionNull(&pWin->clipList);
+    RegionNull(&pWin->borderClip);
+    SetWinSize(pWin);
+    SetBorderSize(pWin);
+    MapWindow(pWin, serverClient);
+    return pWin;
+}
+
+static void
+clip_teardown(void)
+{
+    int i;
+
+    for (i = 0; i < numWindows; i++) {
+        RegionUninit(&windows[i].winSize);
+        RegionUninit(&windows[i].borderSize);
+        RegionUninit(&windows[i].clipList);
+        RegionUninit(&windows[i].borderClip);
+    }
+    RegionUninit(&root.winSize);
+    RegionUninit(&root.borderSize);
+    RegionUninit(&root.clipList);
+    RegionUninit(&root.borderClip);
+}
+
+static void
+clip_mark_all(WindowPtr pWin)
+{
+    WindowPtr pChild;
+
+    miMarkWindow(pWin);
+    for (pChild = pWin->firstChild; pChild; pChild = pChild->nextSib)
+        if (pChild->viewable)
+            clip_mark_all(pChild);
+}
+
+/* recompute every clip from scratch and compare with what's there */
+static void
+clip_check(void)
+{
+    RegionRec clip[NUM_WINDOWS + 1], border[NUM_WINDOWS + 1];
+    WindowPtr pWin;
+    int i;
+
+    for (i = 0; i <= numWindows; i++) {
+        pWin = i < numWindows ? &windows[i] : &root;
+        RegionNull(&clip[i]);
+        RegionNull(&border[i]);
+        RegionCopy(&clip[i], &pWin->clipList);
+        RegionCopy(&border[i], &pWin->borderClip);
+    }
+
+    /* what the full algorithm does when it trusts nothing */
+    RegionBreak(&root.clipList);
+    clip_mark_all(&root);
+    miValidateTree(&root, NullWindow, VTOther);
+    miHandleValidateExposures(&root);
+
+    for (i = 0; i <= numWindows; i++) {
+        pWin = i < numWindows ? &windows[i] : &root;
+        assert(RegionEqual(&clip[i], &pWin->clipList));
+        assert(RegionEqual(&border[i], &pWin->borderClip));
+        RegionUninit(&clip[i]);
+        RegionUninit(&border[i]);
+    }
+}
+
+static void
+mivaltree_incremental(void)
+{
+    int i, j;
+
+    clip_setup();
+    srand(3);
+    for (i = 0; i < NUM_TOPLEVELS; i++) {
+        WindowPtr pWin = clip_create(&root, rand() % ROOT_WIDTH - 50,
+                                     rand() % ROOT_HEIGHT - 50,
+                                     20 + rand() % 200, 20 + rand() % 150,
+                                     rand() % 3);
+
+        for (j = 0; j < NUM_CHILDREN; j++)
+            clip_create(pWin, rand() % pWin->drawable.width - 10,
+                        rand() % pWin->drawable.height - 10,
+                        5 + rand() % 60, 5 + rand() % 40, rand() % 2);
+    }
+    clip_check();
+
+    for (i = 0; i < NUM_STEPS; i++) {
+        WindowPtr pWin = &windows[rand() % numWindows];
+        WindowPtr pTop = pWin->parent->firstChild;
+        int bw = wBorderWidth(pWin);
+        int x = pWin->origin.x - bw, y = pWin->origin.y - bw;
+
+        marked = 0;
+        switch (rand() % 6) {
+        case 0:                /* drag */
+            miMoveWindow(pWin, x + rand() % 41 - 20, y + rand() % 41 - 20,
+                         pWin->nextSib, VTMove);
+            break;
+        case 1:                /* raise */
+            miMoveWindow(pWin, x, y, pTop == pWin ? pWin->nextSib : pTop,
+                         VTOther);
+            break;
+        case 2:                /* lower */
+            miMoveWindow(pWin, x, y, NullWindow, VTOther);
+            break;
+        case 3:                /* resize */
+            miResizeWindow(pWin, x, y, 10 + rand() % 200, 10 + rand() % 150,
+                           pWin->nextSib);
+            break;
+        case 4:                /* move and raise in one go */
+            miMoveWindow(pWin, rand() % ROOT_WIDTH, rand() % ROOT_HEIGHT,
+                         pTop == pWin ? pWin->nextSib : pTop, VTMove);
+            break;
+        case 5:
+            if (pWin->mapped)
+                UnmapWindow(pWin, FALSE);
+            else
+                MapWindow(pWin, serverClient);
+            break;
+        }
+        clip_check();
+    }
+
+    clip_teardown();
+}
+
+static void
+mivaltree_stacked(void)
+{
+    WindowPtr pTop = NULL;
+    int i;
+
+    /* windows on top of each other, like tabs, with one on top dragged */
+    clip_setup();
+    for (i = 0; i < NUM_STACKED; i++)
+        pTop = clip_create(&root, 100, 100, 300, 200, 1);
+    clip_create(&root, 500, 300, 100, 100, 1);
+
+    for (i = 0; i < 20; i++) {
+        marked = 0;
+        miMoveWindow(pTop, 100 + i, 100 + i / 2, pTop->nextSib, VTMove);
+        /* pTop, the one below it and the root, not the whole stack */
+        assert(marked <= 4);
+        clip_check();
+    }
+
+    clip_teardown();
+}
+
+const testfunc_t*
+mivaltree_test(void)
+{
+    static const testfunc_t testfuncs[] = {
+        mivaltree_incremental,
+        mivaltree_stacked,
+        NULL,
+    };
+
+    return testfuncs;
+}
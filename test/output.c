@@ -0,0 +1,323 @@
+/**
+ * Copyright © 2026 X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <dix-config.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define XSERV_t
+#define TRANS_SERVER
+#define TRANS_REOPEN
+#include <X11/Xtrans/Xtrans.h>
+#include <X11/Xproto.h>
+#include <X11/extensions/XI2.h>
+#include <X11/extensions/XI2proto.h>
+
+#include "dix/dix_priv.h"
+#include "os/osdep.h"
+
+#include "callback.h"
+#include "dixstruct_priv.h"
+#include "exglobals.h"
+#include "misc.h"
+#include "tests-common.h"
+
+#define XI_VALUATORS 2
+#define XI_EVENT_SIZE (sizeof(xXIDeviceEvent) + 8 + 8 * XI_VALUATORS)
+
+static ClientRec client;
+static OsCommRec oc;
+static int peer;
+
+/* A local client at the other end of a socket pair. */
+static void
+output_client(Bool swapped)
+{
+    int fds[2];
+
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    peer = fds[1];
+
+    memset(&oc, 0, sizeof(oc));
+    oc.fd = fds[0];
+    oc.trans_conn = _XSERVTransReopenCOTSServer(5, fds[0], ":0");
+    assert(oc.trans_conn);
+
+    /* Dispatch() would have set this up */
+    xorg_list_init(&output_pending_clients);
+
+    memset(&client, 0, sizeof(client));
+    InitClient(&client, 1, &oc);
+    client.local = TRUE;
+    client.swapped = swapped;
+
+    IReqCode = 131;
+    coalesceMotionEvents = TRUE;
+}
+
+/* What the client got so far, which must be count bytes. */
+static void
+expect_output(void *buf, int count)
+{
+    char extra;
+
+    if (count)
+        assert(recv(peer, buf, count, MSG_DONTWAIT) == count);
+    assert(recv(peer, &extra, 1, MSG_DONTWAIT) == -1 && errno == EAGAIN);
+}
+
+/* As WriteEventsToClient() sends a single event. */
+static void
+send_event(void *ev, int length)
+{
+    if (!CoalesceMotionEvent(&client, ev, length))
+        WriteToClient(&client, length, ev);
+}
+
+static xEvent
+core_motion(int x, int y)
+{
+    xEvent ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.u.u.type = MotionNotify;
+    ev.u.u.sequenceNumber = 1;
+    ev.u.keyButtonPointer.time = x;
+    ev.u.keyButtonPointer.root = 0x100;
+    ev.u.keyButtonPointer.event = 0x200;
+    ev.u.keyButtonPointer.rootX = x;
+    ev.u.keyButtonPointer.rootY = y;
+    ev.u.keyButtonPointer.eventX = x;
+    ev.u.keyButtonPointer.eventY = y;
+    ev.u.keyButtonPointer.sameScreen = xTrue;
+    return ev;
+}
+
+static void
+output_batch(void)
+{
+    xEvent ev[3], got[3];
+
+    output_client(FALSE);
+
+    /* a local client gets its output right away */
+    ev[0] = core_motion(1, 1);
+    WriteToClient(&client, sizeof(xEvent), &ev[0]);
+    expect_output(got, sizeof(xEvent));
+    assert(memcmp(got, ev, sizeof(xEvent)) == 0);
+
+    /* but not during a batch, nested or not */
+    ev[1] = ev[0];
+    ev[0].u.u.type = ButtonPress;
+    ev[1].u.u.type = ButtonRelease;
+    BeginOutputBatch();
+    WriteToClient(&client, sizeof(xEvent), &ev[0]);
+    BeginOutputBatch();
+    WriteToClient(&client, sizeof(xEvent), &ev[1]);
+    EndOutputBatch();
+    expect_output(NULL, 0);
+    EndOutputBatch();
+    expect_output(got, 2 * sizeof(xEvent));
+    assert(memcmp(&got[0], &ev[0], sizeof(xEvent)) == 0);
+    assert(memcmp(&got[1], &ev[1], sizeof(xEvent)) == 0);
+
+    close(peer);
+}
+
+/* Stands in for RECORD, which watches delivered events. */
+static void
+watch_events(CallbackListPtr *pcbl, void *data, void *call_data)
+{
+}
+
+static void
+output_coalesce_core(void)
+{
+    xEvent ev[3], got[3];
+
+    output_client(FALSE);
+
+    /* two motions waiting become the last one */
+    ev[0] = core_motion(1, 1);
+    ev[1] = core_motion(2, 3);
+    BeginOutputBatch();
+    send_event(&ev[0], sizeof(xEvent));
+    send_event(&ev[1], sizeof(xEvent));
+    EndOutputBatch();
+    expect_output(got, sizeof(xEvent));
+    assert(memcmp(got, &ev[1], sizeof(xEvent)) == 0);
+
+    /* a motion after another event stays */
+    ev[1].u.u.type = ButtonPress;
+    ev[2] = core_motion(4, 5);
+    BeginOutputBatch();
+    send_event(&ev[0], sizeof(xEvent));
+    send_event(&ev[1], sizeof(xEvent));
+    send_event(&ev[2], sizeof(xEvent));
+    EndOutputBatch();
+    expect_output(got, 3 * sizeof(xEvent));
+    assert(memcmp(got, ev, 3 * sizeof(xEvent)) == 0);
+
+    /* as does one with another button state */
+    ev[1] = core_motion(2, 3);
+    ev[1].u.keyButtonPointer.state = Button1Mask;
+    BeginOutputBatch();
+    send_event(&ev[0], sizeof(xEvent));
+    send_event(&ev[1], sizeof(xEvent));
+    EndOutputBatch();
+    expect_output(got, 2 * sizeof(xEvent));
+    assert(memcmp(got, ev, 2 * sizeof(xEvent)) == 0);
+
+    /* or while someone watches the events delivered */
+    ev[1] = core_motion(2, 3);
+    assert(AddCallback(&EventCallback, watch_events, NULL));
+    BeginOutputBatch();
+    send_event(&ev[0], sizeof(xEvent));
+    send_event(&ev[1], sizeof(xEvent));
+    EndOutputBatch();
+    DeleteCallback(&EventCallback, watch_events, NULL);
+    expect_output(got, 2 * sizeof(xEvent));
+    assert(memcmp(got, ev, 2 * sizeof(xEvent)) == 0);
+
+    /* and nothing is merged without -coalescemotion */
+    coalesceMotionEvents = FALSE;
+    BeginOutputBatch();
+    send_event(&ev[0], sizeof(xEvent));
+    send_event(&ev[1], sizeof(xEvent));
+    EndOutputBatch();
+    expect_output(got, 2 * sizeof(xEvent));
+    assert(memcmp(got, ev, 2 * sizeof(xEvent)) == 0);
+
+    close(peer);
+}
+
+/* An XI2 event with one button mask unit and one valuator mask unit. */
+static void
+xi_motion(void *buf, int evtype, int x, Bool swapped)
+{
+    xXIDeviceEvent *ev = buf;
+    uint32_t *masks = (uint32_t *) (ev + 1);
+    int32_t *values = (int32_t *) (masks + 2);
+
+    memset(buf, 0, XI_EVENT_SIZE);
+    ev->type = GenericEvent;
+    ev->extension = IReqCode;
+    ev->sequenceNumber = 1;
+    ev->length = bytes_to_int32(XI_EVENT_SIZE - sizeof(xEvent));
+    ev->evtype = evtype;
+    ev->deviceid = 2;
+    ev->sourceid = 4;
+    ev->time = x;
+    ev->root = 0x100;
+    ev->event = 0x200;
+    ev->root_x = ev->event_x = x << 16;
+    ev->root_y = ev->event_y = x << 16;
+    ev->buttons_len = 1;
+    ev->valuators_len = 1;
+    masks[1] = (1 << XI_VALUATORS) - 1;
+    for (int i = 0; i < XI_VALUATORS; i++)
+        values[2 * i] = x;
+
+    if (swapped) {
+        swapl(&ev->length);
+        swaps(&ev->evtype);
+        swaps(&ev->deviceid);
+        swaps(&ev->sourceid);
+        swaps(&ev->buttons_len);
+        swaps(&ev->valuators_len);
+    }
+}
+
+static void
+output_coalesce_xi2(void)
+{
+    char ev[3][XI_EVENT_SIZE], got[3][XI_EVENT_SIZE];
+    xEvent core = core_motion(3, 3);
+
+    for (int swapped = 0; swapped < 2; swapped++) {
+        output_client(swapped);
+
+        /* XI_Motion is merged like MotionNotify */
+        xi_motion(ev[0], XI_Motion, 1, swapped);
+        xi_motion(ev[1], XI_Motion, 2, swapped);
+        BeginOutputBatch();
+        send_event(ev[0], XI_EVENT_SIZE);
+        send_event(ev[1], XI_EVENT_SIZE);
+        EndOutputBatch();
+        expect_output(got, XI_EVENT_SIZE);
+        assert(memcmp(got, ev[1], XI_EVENT_SIZE) == 0);
+
+        /* but not after another event */
+        xi_motion(ev[2], XI_Motion, 4, swapped);
+        BeginOutputBatch();
+        send_event(ev[0], XI_EVENT_SIZE);
+        send_event(&core, sizeof(xEvent));
+        send_event(ev[2], XI_EVENT_SIZE);
+        EndOutputBatch();
+        expect_output(got, 2 * XI_EVENT_SIZE + sizeof(xEvent));
+        assert(memcmp(got[0], ev[0], XI_EVENT_SIZE) == 0);
+        assert(memcmp(got[1], &core, sizeof(xEvent)) == 0);
+        assert(memcmp(got[1] + sizeof(xEvent), ev[2], XI_EVENT_SIZE) == 0);
+
+        /* nor for another button held */
+        ((uint32_t *) ((xXIDeviceEvent *) ev[1] + 1))[0] = 1 << 1;
+        BeginOutputBatch();
+        send_event(ev[0], XI_EVENT_SIZE);
+        send_event(ev[1], XI_EVENT_SIZE);
+        EndOutputBatch();
+        expect_output(got, 2 * XI_EVENT_SIZE);
+        assert(memcmp(got, ev, 2 * XI_EVENT_SIZE) == 0);
+
+        /* and raw motion never is */
+        xi_motion(ev[0], XI_RawMotion, 1, swapped);
+        xi_motion(ev[1], XI_RawMotion, 2, swapped);
+        BeginOutputBatch();
+        send_event(ev[0], XI_EVENT_SIZE);
+        send_event(ev[1], XI_EVENT_SIZE);
+        EndOutputBatch();
+        expect_output(got, 2 * XI_EVENT_SIZE);
+        assert(memcmp(got, ev, 2 * XI_EVENT_SIZE) == 0);
+
+        close(peer);
+    }
+}
+
+const testfunc_t*
+output_test(void)
+{
+    static const testfunc_t testfuncs[] = {
+        output_batch,
+        output_coalesce_core,
+        output_coalesce_xi2,
+        NULL,
+    };
+
+    return testfuncs;
+}
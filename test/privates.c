@@ -0,0 +1,146 @@
+/**
+ * Copyright © 2026 X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <dix-config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "misc.h"
+#include "dix.h"
+#include "pixmapstr.h"
+#include "privates.h"
+#include "scrnintstr.h"
+#include "tests-common.h"
+
+#define NUM_PIXMAPS 100000
+
+static DevPrivateKeyRec coldStructKey, hotPtrKey, coldPtrKey, hotStructKey,
+    coldSmallKey;
+
+static DevPrivateKeyRec pixColdKey, pixHotKey;
+
+/* whether the privates of two keys overlap */
+static Bool
+privates_overlap(DevPrivateKey a, DevPrivateKey b)
+{
+    int asize = a->size ? a->size : sizeof(void *);
+    int bsize = b->size ? b->size : sizeof(void *);
+
+    return a->offset < b->offset + bsize && b->offset < a->offset + asize;
+}
+
+static void
+privates_hot_first(void)
+{
+    DevPrivateKey keys[] = {
+        &coldStructKey, &hotPtrKey, &coldPtrKey, &hotStructKey, &coldSmallKey,
+    };
+    int i, j;
+
+    /* registered in a mix, hot ones end up in front, in order */
+    assert(dixRegisterPrivateKey(&coldStructKey, PRIVATE_GLYPHSET, 24));
+    assert(dixRegisterPrivateKeyHotness(&hotPtrKey, PRIVATE_GLYPHSET, 0,
+                                        PRIVATE_KEY_HOT));
+    assert(dixRegisterPrivateKey(&coldPtrKey, PRIVATE_GLYPHSET, 0));
+    assert(dixRegisterPrivateKeyHotness(&hotStructKey, PRIVATE_GLYPHSET, 12,
+                                        PRIVATE_KEY_HOT));
+    assert(dixRegisterPrivateKey(&coldSmallKey, PRIVATE_GLYPHSET, 1));
+
+    assert(hotPtrKey.offset < coldStructKey.offset);
+    assert(hotStructKey.offset == hotPtrKey.offset + sizeof(void *));
+    assert(coldStructKey.offset >= hotStructKey.offset + 12);
+    assert(coldPtrKey.offset > coldStructKey.offset);
+    assert(coldSmallKey.offset > coldPtrKey.offset);
+
+    for (i = 0; i < ARRAY_SIZE(keys); i++) {
+        assert(keys[i]->offset % sizeof(void *) == 0);
+        assert(keys[i]->offset + keys[i]->size <= dixPrivatesSize(PRIVATE_GLYPHSET));
+        for (j = i + 1; j < ARRAY_SIZE(keys); j++)
+            assert(!privates_overlap(keys[i], keys[j]));
+    }
+
+    /* registering again changes nothing */
+    i = hotPtrKey.offset;
+    assert(dixRegisterPrivateKeyHotness(&hotPtrKey, PRIVATE_GLYPHSET, 0,
+                                        PRIVATE_KEY_HOT));
+    assert(hotPtrKey.offset == i);
+}
+
+static void
+privates_pixmaps(void)
+{
+    PixmapPtr *pixmaps = calloc(NUM_PIXMAPS, sizeof(PixmapPtr));
+    int i;
+
+    assert(pixmaps);
+    assert(dixRegisterPrivateKey(&pixColdKey, PRIVATE_PIXMAP, 64));
+    assert(dixRegisterPrivateKeyHotness(&pixHotKey, PRIVATE_PIXMAP, 0,
+                                        PRIVATE_KEY_HOT));
+    assert(pixHotKey.offset < pixColdKey.offset);
+
+    for (i = 0; i < NUM_PIXMAPS; i++) {
+        PixmapPtr pPixmap = dixAllocateScreenObjectWithPrivates(NULL, PixmapRec,
+                                                                PRIVATE_PIXMAP);
+
+        assert(pPixmap);
+        /* the hot private comes before the cold one, right after the pixmap */
+        assert((char *) dixLookupPrivateAddr(&pPixmap->devPrivates, &pixHotKey) <
+               (char *) dixLookupPrivate(&pPixmap->devPrivates, &pixColdKey));
+        dixSetPrivate(&pPixmap->devPrivates, &pixHotKey, pPixmap);
+        memset(dixLookupPrivate(&pPixmap->devPrivates, &pixColdKey), i & 0xff, 64);
+        pixmaps[i] = pPixmap;
+    }
+
+    for (i = 0; i < NUM_PIXMAPS; i++) {
+        PixmapPtr pPixmap = pixmaps[i];
+        unsigned char *cold = dixLookupPrivate(&pPixmap->devPrivates,
+                                               &pixColdKey);
+
+        assert(dixLookupPrivate(&pPixmap->devPrivates, &pixHotKey) == pPixmap);
+        assert(cold[0] == (i & 0xff) && cold[63] == (i & 0xff));
+    }
+
+    if (verbose)
+        dixPrivateUsage();
+
+    for (i = 0; i < NUM_PIXMAPS; i++)
+        dixFreeObjectWithPrivates(pixmaps[i], PRIVATE_PIXMAP);
+    free(pixmaps);
+}
+
+const testfunc_t*
+privates_test(void)
+{
+    static const testfunc_t testfuncs[] = {
+        privates_hot_first,
+        privates_pixmaps,
+        NULL,
+    };
+
+    return testfuncs;
+}
@@ -0,0 +1,207 @@
+/**
+ * Copyright © 2026 X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <dix-config.h>
+
+#include <X11/Xatom.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "dix/property_priv.h"
+
+#include "misc.h"
+#include "dix.h"
+#include "dixstruct.h"
+#include "privates.h"
+#include "scrnintstr.h"
+#include "windowstr.h"
+#include "propertyst.h"
+#include "tests-common.h"
+
+#define NUM_PROPERTIES 1000
+#define NUM_LOOKUP_ROUNDS 1000
+
+static ScreenRec screen;
+static WindowOptRec optional;
+static WindowPtr root;
+static ClientRec client;
+
+static void
+property_setup(void)
+{
+    /* the index lives in a window private */
+    dixResetPrivates();
+    screenInfo.numScreens = 1;
+    screenInfo.screens[0] = &screen;
+    dixInitScreenSpecificPrivates(&screen);
+    assert(PropertyIndexInit());
+    root = dixAllocateScreenObjectWithPrivates(&screen, WindowRec,
+                                               PRIVATE_WINDOW);
+    assert(root);
+
+    memset(&optional, 0, sizeof(optional));
+    root->drawable.pScreen = &screen;
+    root->optional = &optional;
+    client.index = 1;
+}
+
+static Atom
+property_atom(int i)
+{
+    /* atoms don't need to be interned for the property code */
+    return XA_LAST_PREDEFINED + 1 + i * 7;
+}
+
+static void
+property_add(int i)
+{
+    CARD32 value = i;
+
+    assert(dixChangeWindowProperty(&client, root, property_atom(i),
+                                   XA_CARDINAL, 32, PropModeReplace, 1,
+                                   &value, FALSE) == Success);
+}
+
+static void
+property_check(int i, Bool present)
+{
+    PropertyPtr pProp;
+    int rc;
+
+    rc = dixLookupProperty(&pProp, root, property_atom(i), &client,
+                           DixReadAccess);
+    if (!present) {
+        assert(rc == BadMatch);
+        assert(pProp == NULL);
+        return;
+    }
+    assert(rc == Success);
+    assert(pProp->propertyName == property_atom(i));
+    assert(*(CARD32 *) pProp->data == (CARD32) i);
+}
+
+static void
+property_list_order(int first, int last)
+{
+    PropertyPtr pProp = wUserProps(root);
+    int i;
+
+    /* new properties go to the front, ListProperties reports them so */
+    for (i = last; i >= first; i--) {
+        assert(pProp);
+        assert(pProp->propertyName == property_atom(i));
+        pProp = pProp->next;
+    }
+    assert(pProp == NULL);
+}
+
+static void
+property_index(void)
+{
+    CARD32 value = 42;
+    PropertyPtr pProp;
+    int i;
+
+    property_setup();
+
+    for (i = 0; i < NUM_PROPERTIES; i++) {
+        property_add(i);
+        property_check(i, TRUE);
+        property_check(i + 1, FALSE);
+    }
+    property_list_order(0, NUM_PROPERTIES - 1);
+    assert(dixLookupPrivate(&root->devPrivates, &PropertyIndexKeyRec));
+
+    for (i = 0; i < NUM_PROPERTIES; i++)
+        property_check(i, TRUE);
+
+    /* replacing and appending keep the property in place */
+    assert(dixChangeWindowProperty(&client, root, property_atom(10),
+                                   XA_CARDINAL, 32, PropModeAppend, 1,
+                                   &value, FALSE) == Success);
+    assert(dixLookupProperty(&pProp, root, property_atom(10), &client,
+                             DixReadAccess) == Success);
+    assert(pProp->size == 2);
+    assert(((CARD32 *) pProp->data)[1] == value);
+    property_list_order(0, NUM_PROPERTIES - 1);
+
+    /* delete every other property, lookups must still find the rest */
+    for (i = 0; i < NUM_PROPERTIES; i += 2)
+        assert(DeleteProperty(&client, root, property_atom(i)) == Success);
+    for (i = 0; i < NUM_PROPERTIES; i++)
+        property_check(i, i & 1);
+
+    /* deleting again is not an error */
+    assert(DeleteProperty(&client, root, property_atom(0)) == Success);
+
+    /* shrink below the threshold, the index goes away */
+    for (i = 1; i < NUM_PROPERTIES - 2; i += 2)
+        assert(DeleteProperty(&client, root, property_atom(i)) == Success);
+    assert(!dixLookupPrivate(&root->devPrivates, &PropertyIndexKeyRec));
+    property_check(NUM_PROPERTIES - 1, TRUE);
+    property_check(NUM_PROPERTIES - 3, FALSE);
+
+    DeleteAllWindowProperties(root);
+    assert(wUserProps(root) == NULL);
+    assert(!dixLookupPrivate(&root->devPrivates, &PropertyIndexKeyRec));
+}
+
+static void
+property_lookup_bench(void)
+{
+    PropertyPtr pProp;
+    double start, end;
+    int i, j;
+
+    property_setup();
+
+    for (i = 0; i < NUM_PROPERTIES; i++)
+        property_add(i);
+
+    start = now_ms();
+    for (j = 0; j < NUM_LOOKUP_ROUNDS; j++)
+        for (i = 0; i < NUM_PROPERTIES; i++)
+            assert(dixLookupProperty(&pProp, root, property_atom(i), &client,
+                                     DixReadAccess) == Success);
+    end = now_ms();
+
+    dbg("%d lookups on a window with %d properties: %.2fms\n",
+        NUM_LOOKUP_ROUNDS * NUM_PROPERTIES, NUM_PROPERTIES, end - start);
+
+    DeleteAllWindowProperties(root);
+}
+
+const testfunc_t*
+property_test(void)
+{
+    static const testfunc_t testfuncs[] = {
+        property_index,
+        property_lookup_bench,
+        NULL,
+    };
+
+    return testfuncs;
+}
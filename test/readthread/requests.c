@@ -0,0 +1,221 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Feeds requests to a server reading TCP clients in a reader thread
+ * (-readthreads): several requests in one write, a request split over
+ * two writes, and a request with a length of zero, which must get
+ * BadLength without losing the connection.  Done in both byte orders,
+ * since the reader thread swaps the core requests of swapped clients.
+ *
+ * The requests are written by hand, which libxcb won't do for the
+ * broken ones.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define X_TCP_PORT 6000
+#define X_GET_INPUT_FOCUS 43
+#define X_ERROR 0
+#define X_REPLY 1
+#define BAD_LENGTH 16
+
+static char order;
+static unsigned int sequence;
+
+static void
+put16(uint8_t *p, uint16_t v)
+{
+    if (order == 'l') {
+        p[0] = v;
+        p[1] = v >> 8;
+    }
+    else {
+        p[0] = v >> 8;
+        p[1] = v;
+    }
+}
+
+static uint16_t
+get16(const uint8_t *p)
+{
+    return order == 'l' ? p[0] | p[1] << 8 : p[0] << 8 | p[1];
+}
+
+static void
+write_all(int fd, const void *data, size_t len)
+{
+    if (write(fd, data, len) != (ssize_t) len) {
+        perror("write");
+        exit(1);
+    }
+}
+
+static void
+read_all(int fd, void *data, size_t len)
+{
+    uint8_t *p = data;
+
+    while (len) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        ssize_t r;
+
+        if (poll(&pfd, 1, 10000) != 1) {
+            fprintf(stderr, "Timed out waiting for the server\n");
+            exit(1);
+        }
+        r = read(fd, p, len);
+        if (r <= 0) {
+            fprintf(stderr, "Lost the connection\n");
+            exit(1);
+        }
+        p += r;
+        len -= r;
+    }
+}
+
+static int
+connect_tcp(int display)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(X_TCP_PORT + display),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    uint8_t prefix[12] = { 0 }, setup[8];
+    int fd, one = 1;
+    uint8_t *rest;
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        printf("Can't connect to the server over TCP\n");
+        exit(77);
+    }
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    prefix[0] = order;
+    put16(prefix + 2, 11);
+    put16(prefix + 4, 0);
+    write_all(fd, prefix, sizeof(prefix));
+
+    read_all(fd, setup, sizeof(setup));
+    if (setup[0] != 1) {
+        fprintf(stderr, "Connection refused\n");
+        exit(1);
+    }
+    rest = malloc(get16(setup + 6) * 4);
+    read_all(fd, rest, get16(setup + 6) * 4);
+    free(rest);
+
+    sequence = 0;
+    return fd;
+}
+
+/* Returns the sequence number of the request */
+static unsigned int
+get_input_focus(uint8_t *req, uint16_t length)
+{
+    req[0] = X_GET_INPUT_FOCUS;
+    req[1] = 0;
+    put16(req + 2, length);
+    return ++sequence;
+}
+
+static void
+expect(int fd, uint8_t type, unsigned int seq, const char *what)
+{
+    uint8_t ev[32];
+
+    /* GetInputFocus replies and errors are 32 bytes */
+    read_all(fd, ev, sizeof(ev));
+    if (ev[0] != type || get16(ev + 2) != (seq & 0xffff)) {
+        fprintf(stderr, "%c: %s: got type %d code %d for sequence %d, "
+                "expected type %d for %d\n", order, what, ev[0], ev[1],
+                get16(ev + 2), type, seq & 0xffff);
+        exit(1);
+    }
+    if (type == X_ERROR &&
+        (ev[1] != BAD_LENGTH || ev[10] != X_GET_INPUT_FOCUS)) {
+        fprintf(stderr, "%c: %s: got error %d for opcode %d\n", order, what,
+                ev[1], ev[10]);
+        exit(1);
+    }
+}
+
+static void
+run(int display)
+{
+    uint8_t reqs[3][4];
+    unsigned int seq[3];
+    int fd = connect_tcp(display);
+
+    /* several requests in one write */
+    for (int i = 0; i < 3; i++)
+        seq[i] = get_input_focus(reqs[i], 1);
+    write_all(fd, reqs, sizeof(reqs));
+    for (int i = 0; i < 3; i++)
+        expect(fd, X_REPLY, seq[i], "batched request");
+
+    /* one request in two writes */
+    seq[0] = get_input_focus(reqs[0], 1);
+    write_all(fd, reqs[0], 2);
+    usleep(100000);
+    write_all(fd, reqs[0] + 2, 2);
+    expect(fd, X_REPLY, seq[0], "split request");
+
+    /* a zero length, and a good request right behind it */
+    seq[0] = get_input_focus(reqs[0], 0);
+    seq[1] = get_input_focus(reqs[1], 1);
+    write_all(fd, reqs, 8);
+    expect(fd, X_ERROR, seq[0], "zero-length request");
+    expect(fd, X_REPLY, seq[1], "request after a zero-length one");
+
+    close(fd);
+}
+
+int main(int argc, char **argv)
+{
+    const char *display = getenv("DISPLAY");
+    const char *colon = display ? strrchr(display, ':') : NULL;
+
+    if (!colon) {
+        fprintf(stderr, "No DISPLAY\n");
+        exit(1);
+    }
+
+    order = 'l';
+    run(atoi(colon + 1));
+    order = 'B';
+    run(atoi(colon + 1));
+
+    return 0;
+}
@@ -0,0 +1,335 @@
+/**
+ * Copyright © 2026 X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <dix-config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "misc.h"
+#include "dix.h"
+#include "dixstruct.h"
+#include "resource.h"
+#include "tests-common.h"
+
+#define NUM_RESOURCES 50000
+#define NUM_CHURN_RESOURCES 100000
+#define NUM_CHURN_ROUNDS 10
+
+static ClientRec server_client;
+static ClientRec client;
+static RESTYPE type_a, type_b;
+
+static int num_deleted;
+static XID deleted[8];
+static RESTYPE deleted_type[8];
+
+static int
+delete_a(void *value, XID id)
+{
+    if (num_deleted < 8) {
+        deleted[num_deleted] = id;
+        deleted_type[num_deleted] = type_a;
+    }
+    num_deleted++;
+    return Success;
+}
+
+static int
+delete_b(void *value, XID id)
+{
+    if (num_deleted < 8) {
+        deleted[num_deleted] = id;
+        deleted_type[num_deleted] = type_b;
+    }
+    num_deleted++;
+    return Success;
+}
+
+static void
+resource_setup(void)
+{
+    if (!serverClient) {
+        server_client.index = 0;
+        serverClient = &server_client;
+    }
+    if (!lastResourceType)
+        assert(InitClientResources(serverClient));
+    if (!type_a) {
+        type_a = CreateNewResourceType(delete_a, "TEST A");
+        type_b = CreateNewResourceType(delete_b, "TEST B");
+        assert(type_a && type_b);
+    }
+
+    memset(&client, 0, sizeof(client));
+    client.index = 1;
+    client.clientAsMask = (Mask) 1 << CLIENTOFFSET;
+    assert(InitClientResources(&client));
+    num_deleted = 0;
+}
+
+static XID
+resource_id(int i)
+{
+    return client.clientAsMask | (i + 1);
+}
+
+static void
+resource_check(int i, Bool present)
+{
+    void *value;
+    int rc;
+
+    rc = dixLookupResourceByType(&value, resource_id(i), type_a, NULL,
+                                 DixReadAccess);
+    if (!present) {
+        assert(rc == BadValue);
+        assert(value == NULL);
+        return;
+    }
+    assert(rc == Success);
+    assert(value == (void *) (intptr_t) (i + 1));
+}
+
+static void
+resource_count(void *value, XID id, void *cdata)
+{
+    (*(int *) cdata)++;
+}
+
+static void
+resource_table(void)
+{
+    int i, n = 0;
+
+    resource_setup();
+
+    /* enough to grow the table many times over */
+    for (i = 0; i < NUM_RESOURCES; i++) {
+        assert(AddResource(resource_id(i), type_a, (void *) (intptr_t) (i + 1)));
+        if (i % 1000 == 0)
+            resource_check(i / 2, TRUE);
+    }
+    for (i = 0; i < NUM_RESOURCES; i++)
+        resource_check(i, TRUE);
+    resource_check(NUM_RESOURCES, FALSE);
+
+    FindClientResourcesByType(&client, type_a, resource_count, &n);
+    assert(n == NUM_RESOURCES);
+
+    for (i = 0; i < NUM_RESOURCES; i += 2)
+        FreeResource(resource_id(i), X11_RESTYPE_NONE);
+    assert(num_deleted == NUM_RESOURCES / 2);
+    for (i = 0; i < NUM_RESOURCES; i++)
+        resource_check(i, i & 1);
+
+    assert(ChangeResourceValue(resource_id(1), type_a, (void *) 42));
+    assert(!ChangeResourceValue(resource_id(0), type_a, (void *) 42));
+    assert(!ChangeResourceValue(resource_id(1), type_b, (void *) 42));
+    assert(ChangeResourceValue(resource_id(1), type_a, (void *) 2));
+
+    /* deleted slots get reused */
+    for (i = 0; i < NUM_RESOURCES; i += 2)
+        assert(AddResource(resource_id(i), type_a, (void *) (intptr_t) (i + 1)));
+    for (i = 0; i < NUM_RESOURCES; i++)
+        resource_check(i, TRUE);
+
+    FreeClientResources(&client);
+    assert(num_deleted == NUM_RESOURCES * 3 / 2);
+}
+
+static void
+resource_shared_id(void)
+{
+    XID id = resource_id(7);
+    void *value;
+
+    resource_setup();
+
+    assert(AddResource(id, type_a, (void *) 1));
+    assert(AddResource(resource_id(8), type_a, (void *) 8));
+    assert(AddResource(id, type_b, (void *) 2));
+    assert(AddResource(id, type_a, (void *) 3));
+
+    /* the newest one of a type is found */
+    assert(dixLookupResourceByType(&value, id, type_a, NULL,
+                                   DixReadAccess) == Success);
+    assert(value == (void *) 3);
+    assert(dixLookupResourceByType(&value, id, type_b, NULL,
+                                   DixReadAccess) == Success);
+    assert(value == (void *) 2);
+    assert(dixLookupResourceByClass(&value, id, RC_ANY, NULL,
+                                    DixReadAccess) == Success);
+    assert(value == (void *) 3);
+
+    FreeResourceByType(id, type_a, FALSE);
+    assert(num_deleted == 1);
+    assert(dixLookupResourceByType(&value, id, type_a, NULL,
+                                   DixReadAccess) == Success);
+    assert(value == (void *) 1);
+
+    /* and they are freed in the opposite order they were added */
+    assert(AddResource(id, type_a, (void *) 4));
+    num_deleted = 0;
+    FreeResource(id, X11_RESTYPE_NONE);
+    assert(num_deleted == 3);
+    assert(deleted_type[0] == type_a);
+    assert(deleted_type[1] == type_b);
+    assert(deleted_type[2] == type_a);
+    assert(dixLookupResourceByClass(&value, id, RC_ANY, NULL,
+                                    DixReadAccess) == BadValue);
+    assert(dixLookupResourceByType(&value, resource_id(8), type_a, NULL,
+                                   DixReadAccess) == Success);
+
+    /* same for all of a client's resources */
+    assert(AddResource(id, type_b, (void *) 5));
+    assert(AddResource(id, type_a, (void *) 6));
+    num_deleted = 0;
+    FreeClientResources(&client);
+    assert(num_deleted == 3);
+    if (deleted[0] == id) {
+        assert(deleted_type[0] == type_a && deleted_type[1] == type_b);
+    }
+    else {
+        assert(deleted_type[1] == type_a && deleted_type[2] == type_b);
+    }
+}
+
+static void
+resource_lookup_cache(void)
+{
+    XID id = resource_id(3);
+    void *value;
+
+    resource_setup();
+
+    assert(AddResource(id, type_a, (void *) 1));
+    assert(dixLookupResourceByType(&value, id, type_a, NULL,
+                                   DixReadAccess) == Success);
+    assert(value == (void *) 1);
+    assert(dixLookupResourceByClass(&value, id, RC_ANY, NULL,
+                                    DixReadAccess) == Success);
+    assert(value == (void *) 1);
+
+    /* what the cache has must not outlive changes */
+    assert(ChangeResourceValue(id, type_a, (void *) 2));
+    assert(dixLookupResourceByType(&value, id, type_a, NULL,
+                                   DixReadAccess) == Success);
+    assert(value == (void *) 2);
+
+    assert(AddResource(id, type_b, (void *) 3));
+    assert(dixLookupResourceByClass(&value, id, RC_ANY, NULL,
+                                    DixReadAccess) == Success);
+    assert(value == (void *) 3);
+    assert(dixLookupResourceByType(&value, id, type_b, NULL,
+                                   DixReadAccess) == Success);
+    assert(value == (void *) 3);
+
+    /* an id that shares the cache slot */
+    assert(AddResource(resource_id(3 + 16), type_a, (void *) 4));
+    assert(dixLookupResourceByType(&value, resource_id(3 + 16), type_a, NULL,
+                                   DixReadAccess) == Success);
+    assert(value == (void *) 4);
+    assert(dixLookupResourceByType(&value, id, type_a, NULL,
+                                   DixReadAccess) == Success);
+    assert(value == (void *) 2);
+
+    FreeResourceByType(id, type_b, FALSE);
+    assert(dixLookupResourceByType(&value, id, type_b, NULL,
+                                   DixReadAccess) == BadValue);
+    assert(dixLookupResourceByClass(&value, id, RC_ANY, NULL,
+                                    DixReadAccess) == Success);
+    assert(value == (void *) 2);
+
+    FreeResource(id, X11_RESTYPE_NONE);
+    assert(dixLookupResourceByType(&value, id, type_a, NULL,
+                                   DixReadAccess) == BadValue);
+    assert(dixLookupResourceByClass(&value, id, RC_ANY, NULL,
+                                    DixReadAccess) == BadValue);
+
+    FreeClientResources(&client);
+}
+
+static void
+resource_churn_bench(void)
+{
+    void *value;
+    double start, add, lookup, churn, t, slowest = 0;
+    int i, j;
+
+    resource_setup();
+
+    /* growing the table shouldn't stall any one AddResource() */
+    start = now_ms();
+    for (i = 0; i < NUM_CHURN_RESOURCES; i++) {
+        t = now_ms();
+        assert(AddResource(resource_id(i), type_a, (void *) (intptr_t) (i + 1)));
+        t = now_ms() - t;
+        if (t > slowest)
+            slowest = t;
+    }
+    add = now_ms();
+
+    srand(1);
+    for (i = 0; i < NUM_CHURN_RESOURCES * NUM_CHURN_ROUNDS; i++)
+        assert(dixLookupResourceByType(&value,
+                                       resource_id(rand() % NUM_CHURN_RESOURCES),
+                                       type_a, NULL, DixReadAccess) == Success);
+    lookup = now_ms();
+
+    /* the way pictures and glyphsets come and go */
+    for (j = 0; j < NUM_CHURN_ROUNDS; j++) {
+        for (i = j % 2; i < NUM_CHURN_RESOURCES; i += 2)
+            FreeResource(resource_id(i), X11_RESTYPE_NONE);
+        for (i = j % 2; i < NUM_CHURN_RESOURCES; i += 2)
+            assert(AddResource(resource_id(i), type_a,
+                               (void *) (intptr_t) (i + 1)));
+    }
+    churn = now_ms();
+
+    dbg("%d resources added in %.2fms (slowest %.3fms), %d lookups in %.2fms, "
+        "%d frees and adds in %.2fms\n",
+        NUM_CHURN_RESOURCES, add - start, slowest,
+        NUM_CHURN_RESOURCES * NUM_CHURN_ROUNDS, lookup - add,
+        NUM_CHURN_RESOURCES * NUM_CHURN_ROUNDS, churn - lookup);
+
+    FreeClientResources(&client);
+}
+
+const testfunc_t*
+resource_test(void)
+{
+    static const testfunc_t testfuncs[] = {
+        resource_table,
+        resource_shared_id,
+        resource_lookup_cache,
+        resource_churn_bench,
+        NULL,
+    };
+
+    return testfuncs;
+}
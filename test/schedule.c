@@ -0,0 +1,215 @@
+/**
+ * Copyright © 2026 X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <dix-config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dix/dix_priv.h"
+
+#include "dixstruct_priv.h"
+#include "inputstr.h"
+#include "misc.h"
+#include "windowstr.h"
+#include "tests-common.h"
+
+#define NUM_CLIENTS 3
+#define SLICE_NS 1000000
+
+static ClientRec client[NUM_CLIENTS];
+
+/* Clients 1, 2 and 3, all ready, under the named policy. */
+static void
+schedule_setup(const char *policy)
+{
+    int i;
+
+    assert(ScheduleSetPolicy(policy));
+    assert(!ScheduleSetPolicy("none"));
+    init_client_ready();
+
+    for (i = 0; i < NUM_CLIENTS; i++) {
+        memset(&client[i], 0, sizeof(client[i]));
+        InitClient(&client[i], i + 1, NULL);
+        clients[i + 1] = &client[i];
+        mark_client_ready(&client[i]);
+    }
+    currentMaxClients = NUM_CLIENTS + 1;
+}
+
+/* Runs count slices, charging each the same; how often each client ran. */
+static void
+schedule_run(int count, int *runs)
+{
+    memset(runs, 0, NUM_CLIENTS * sizeof(int));
+    while (count--) {
+        ClientPtr best = SmartScheduleClient();
+
+        runs[best->index - 1]++;
+        ScheduleCharge(best, SLICE_NS);
+    }
+}
+
+static void
+schedule_charge(void)
+{
+    static const struct {
+        int priority;
+        CARD64 vtime;
+    } weights[] = {
+        { 0, 1000 },
+        { 1, 500 },
+        { 2, 250 },
+        { -1, 2000 },
+        { 4, 62 },
+        { 10, 62 },             /* no more than four steps either way */
+        { -4, 16000 },
+        { -10, 16000 },
+    };
+    int i;
+
+    schedule_setup("fair");
+
+    for (i = 0; i < ARRAY_SIZE(weights); i++) {
+        ClientPtr c = &client[0];
+        ScheduleClientRec *sched = &ScheduleClients[c->index];
+        CARD64 cpu = sched->cpu_ns, vtime = sched->vtime;
+
+        c->priority = weights[i].priority;
+        ScheduleCharge(c, 1000);
+        /* the CPU time is the same whatever the priority */
+        assert(sched->cpu_ns == cpu + 1000);
+        assert(sched->vtime == vtime + weights[i].vtime);
+    }
+}
+
+static void
+schedule_smart(void)
+{
+    int runs[NUM_CLIENTS];
+
+    schedule_setup("smart");
+
+    /* equals go round robin */
+    schedule_run(3 * NUM_CLIENTS, runs);
+    assert(runs[0] == 3 && runs[1] == 3 && runs[2] == 3);
+
+    /* X priority first, whatever the CPU time */
+    client[0].priority = 1;
+    schedule_run(NUM_CLIENTS, runs);
+    assert(runs[0] == NUM_CLIENTS);
+
+    /* then the client that used up fewer of its slices */
+    client[0].priority = 0;
+    client[0].smart_priority = -1;
+    client[2].smart_priority = -1;
+    schedule_run(NUM_CLIENTS, runs);
+    assert(runs[1] == NUM_CLIENTS);
+}
+
+static void
+schedule_fair(void)
+{
+    int runs[NUM_CLIENTS], i;
+
+    schedule_setup("fair");
+
+    /* least CPU time first, X priority halving the charge */
+    client[0].priority = 1;
+    mark_client_not_ready(&client[2]);
+    schedule_run(300, runs);
+    assert(runs[0] == 200 && runs[1] == 100 && runs[2] == 0);
+
+    /*
+     * Back from idle, a client gets its share from now on, rather than
+     * what it missed while it was away.
+     */
+    mark_client_ready(&client[2]);
+    schedule_run(8, runs);
+    assert(runs[0] && runs[1] && runs[2] <= 4);
+
+    /* smart priority doesn't count; they start a slice or two apart */
+    client[0].priority = 0;
+    client[1].smart_priority = SMART_MIN_PRIORITY;
+    schedule_run(300, runs);
+    for (i = 0; i < NUM_CLIENTS; i++)
+        assert(runs[i] >= 98 && runs[i] <= 102);
+}
+
+static void
+schedule_focus(void)
+{
+    static DeviceIntRec keyboard;
+    static FocusClassRec focus;
+    static WindowRec window;
+    int runs[NUM_CLIENTS];
+
+    schedule_setup("focus");
+
+    /* client 1 owns the window the master keyboard is focused on */
+    window.drawable.id = client[0].clientAsMask | 1;
+    focus.win = &window;
+    keyboard.type = MASTER_KEYBOARD;
+    keyboard.focus = &focus;
+    inputInfo.devices = &keyboard;
+
+    schedule_run(NUM_CLIENTS, runs);
+    assert(runs[0] == NUM_CLIENTS);
+
+    /* but not ahead of higher X priority */
+    client[1].priority = 1;
+    schedule_run(NUM_CLIENTS, runs);
+    assert(runs[1] == NUM_CLIENTS);
+    client[1].priority = 0;
+
+    /* and no longer once it has been using up its slices */
+    client[0].smart_priority = SMART_MIN_PRIORITY;
+    schedule_run(2 * NUM_CLIENTS, runs);
+    assert(runs[0] == 0 && runs[1] == NUM_CLIENTS && runs[2] == NUM_CLIENTS);
+
+    /* without the focus, it goes along with the others */
+    client[0].smart_priority = 0;
+    keyboard.type = SLAVE;
+    schedule_run(3 * NUM_CLIENTS, runs);
+    assert(runs[0] == 3 && runs[1] == 3 && runs[2] == 3);
+
+    inputInfo.devices = NULL;
+}
+
+const testfunc_t*
+schedule_test(void)
+{
+    static const testfunc_t testfuncs[] = {
+        schedule_charge,
+        schedule_smart,
+        schedule_fair,
+        schedule_focus,
+        NULL,
+    };
+    return testfuncs;
+}
@@ -0,0 +1,12 @@
+#!/bin/sh
+
+# Runs x11perf tests made of many small operations against Xvfb, once
+# drawing each operation right away and once with -fbbatch, to see what
+# setting up an operation costs.
+#
+#   X11PERF     x11perf tests to run (default: small fills and copies)
+
+X11PERF=${X11PERF:-"-rect1 -rect10 -copypixwin10 -copypixpix10"}
+
+exec $XSERVER_DIR/test/scripts/xvfb-x11perf-compare.sh fbbatch "$X11PERF" \
+    "" "-fbbatch"
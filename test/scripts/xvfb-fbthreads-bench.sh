@@ -0,0 +1,20 @@
+#!/bin/sh
+
+# Runs the x11perf tests whose operations fb can draw in bands against
+# Xvfb, once drawing on the main thread only and once with -fbthreads.
+#
+#   FBTHREADS   threads to compare against (default: cores - 1)
+#   X11PERF     x11perf tests to run (default: large fills, copies and puts)
+
+if test -z "$FBTHREADS"; then
+    FBTHREADS=$(($(getconf _NPROCESSORS_ONLN) - 1))
+fi
+if test "$FBTHREADS" -lt 1; then
+    echo "only one core, nothing to compare"
+    exit 77
+fi
+
+X11PERF=${X11PERF:-"-rect500 -tilerect500 -oddtilerect500 -copypixwin500 -copypixpix500 -putimage500 -shmput500"}
+
+exec $XSERVER_DIR/test/scripts/xvfb-x11perf-compare.sh fbthreads "$X11PERF" \
+    "-fbthreads 0" "-fbthreads $FBTHREADS"
@@ -0,0 +1,18 @@
+#!/bin/sh
+
+# Gets images large enough to be sent in steps from Xvfb, with GetImage
+# and ShmGetImage, while another client makes events for the one getting
+# them, and checks the images and where the events come.
+
+CLIENT=$XSERVER_BUILDDIR/test/shm/shm-getimage
+if ! test -x "$CLIENT"; then
+    echo "$CLIENT not built, skipping"
+    exit 77
+fi
+
+exec $XSERVER_BUILDDIR/test/simple-xinit \
+    "$CLIENT" \
+    -- \
+    $XSERVER_BUILDDIR/hw/vfb/Xvfb \
+    -noreset \
+    -screen scrn 1280x1024x24
@@ -0,0 +1,41 @@
+#!/bin/sh
+
+# Runs x11perf tests against Xvfb once with each of two sets of server
+# options and lines the results up next to each other:
+#
+#   xvfb-x11perf-compare.sh name "x11perf tests" "options" "other options"
+#
+# The x11perf output is kept in $XSERVER_BUILDDIR/test/x11perf-name.
+
+X11PERF_BIN=${X11PERF_BIN:-x11perf}
+if ! command -v "$X11PERF_BIN" > /dev/null; then
+    echo "x11perf not found, skipping"
+    exit 77
+fi
+
+NAME=$1
+TESTS=$2
+OUT=$XSERVER_BUILDDIR/test/x11perf-$NAME
+mkdir -p "$OUT"
+
+run() {
+    $XSERVER_BUILDDIR/test/simple-xinit \
+        "$X11PERF_BIN" -repeat 3 -time 2 $TESTS \
+        -- \
+        $XSERVER_BUILDDIR/hw/vfb/Xvfb \
+        -noreset \
+        -screen scrn 1280x1024x24 \
+        $2 \
+        > "$OUT/$1.txt"
+}
+
+run a "$3" || exit 1
+run b "$4" || exit 1
+
+echo "a: $3"
+echo "b: $4"
+if command -v x11perfcomp > /dev/null; then
+    x11perfcomp "$OUT/a.txt" "$OUT/b.txt"
+else
+    grep -h reps "$OUT/a.txt" "$OUT/b.txt"
+fi
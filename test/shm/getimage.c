@@ -0,0 +1,417 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Gets an image large enough for the server to send in steps, with
+ * GetImage and with ShmGetImage, while another client makes events for
+ * the one getting it.  The image must match the one got in bands small
+ * enough to go in one go, and the events must all come after the reply.
+ *
+ * The client getting the image talks to the server by hand, so that it
+ * can leave the reply unread while the other client goes on, and see
+ * exactly where the events land in what comes back.
+ */
+
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <xcb/xcb.h>
+
+#define WIDTH 1024
+#define HEIGHT 1024
+#define BAND 32                 /* lines, well below the size sent in steps */
+#define EVENTS 16
+
+#define X_CHANGE_WINDOW_ATTRIBUTES 2
+#define X_GET_INPUT_FOCUS 43
+#define X_GET_IMAGE 73
+#define X_QUERY_EXTENSION 98
+#define X_SHM_ATTACH 1
+#define X_SHM_GET_IMAGE 4
+#define X_ERROR 0
+#define X_REPLY 1
+#define X_PROPERTY_NOTIFY 28
+
+#define CW_EVENT_MASK (1 << 11)
+#define PROPERTY_CHANGE_MASK (1 << 22)
+#define Z_PIXMAP 2
+
+static xcb_connection_t *c;
+static xcb_window_t window;
+static xcb_pixmap_t pixmap;
+static xcb_atom_t property;
+static uint32_t *banded;
+static size_t image_size;
+
+static int fd;
+static uint32_t id_base;
+static unsigned int sequence;
+
+static void
+write_all(const void *data, size_t len)
+{
+    if (write(fd, data, len) != (ssize_t) len) {
+        perror("write");
+        exit(1);
+    }
+}
+
+static void
+read_all(void *data, size_t len)
+{
+    uint8_t *p = data;
+
+    while (len) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        ssize_t r;
+
+        if (poll(&pfd, 1, 10000) != 1) {
+            fprintf(stderr, "Timed out waiting for the server\n");
+            exit(1);
+        }
+        r = read(fd, p, len);
+        if (r <= 0) {
+            fprintf(stderr, "Lost the connection\n");
+            exit(1);
+        }
+        p += r;
+        len -= r;
+    }
+}
+
+/*
+ * Requests and replies go in the byte order of this machine; these put
+ * the bytes and halves of a request's words where they belong.
+ */
+static uint32_t
+pack(uint8_t a, uint8_t b, uint16_t c)
+{
+    uint8_t bytes[4] = { a, b };
+    uint32_t word;
+
+    memcpy(bytes + 2, &c, 2);
+    memcpy(&word, bytes, 4);
+    return word;
+}
+
+static uint32_t
+pair(uint16_t a, uint16_t b)
+{
+    uint16_t halves[2] = { a, b };
+    uint32_t word;
+
+    memcpy(&word, halves, 4);
+    return word;
+}
+
+static void
+connect_unix(int display)
+{
+    const uint16_t one = 1;
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    uint8_t prefix[12] = { 0 }, setup[8];
+    uint8_t *rest;
+    size_t len;
+
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "/tmp/.X11-unix/X%d",
+             display);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        printf("Can't connect to the server's unix socket\n");
+        exit(77);
+    }
+
+    prefix[0] = *(const uint8_t *) &one ? 'l' : 'B';
+    *(uint16_t *) (prefix + 2) = 11;
+    write_all(prefix, sizeof(prefix));
+
+    read_all(setup, sizeof(setup));
+    if (setup[0] != 1) {
+        fprintf(stderr, "Connection refused\n");
+        exit(1);
+    }
+    len = *(uint16_t *) (setup + 6) * 4;
+    rest = malloc(len);
+    read_all(rest, len);
+    id_base = *(uint32_t *) (rest + 4);
+    free(rest);
+}
+
+/* Reads 32 bytes, which must be a reply or error to request seq. */
+static void
+expect(uint8_t *ev, uint8_t type, unsigned int seq, const char *what)
+{
+    read_all(ev, 32);
+    if ((ev[0] & 0x7f) != type || *(uint16_t *) (ev + 2) != (seq & 0xffff)) {
+        fprintf(stderr, "%s: got type %d code %d for sequence %d, "
+                "expected type %d for %d\n", what, ev[0], ev[1],
+                *(uint16_t *) (ev + 2), type, seq & 0xffff);
+        exit(1);
+    }
+}
+
+/* A round trip, which must not find any events on the way. */
+static void
+sync_raw(const char *what)
+{
+    uint32_t req = pack(X_GET_INPUT_FOCUS, 0, 1);
+    uint8_t rep[32];
+
+    write_all(&req, sizeof(req));
+    expect(rep, X_REPLY, ++sequence, what);
+}
+
+static void
+select_property_events(void)
+{
+    uint32_t req[4] = {
+        pack(X_CHANGE_WINDOW_ATTRIBUTES, 0, 4), window, CW_EVENT_MASK,
+        PROPERTY_CHANGE_MASK
+    };
+
+    write_all(req, sizeof(req));
+    sequence++;
+    sync_raw("selecting events");
+}
+
+/* Returns the major opcode of MIT-SHM, or 0 if there isn't one. */
+static uint8_t
+query_shm(void)
+{
+    uint32_t req[4] = { pack(X_QUERY_EXTENSION, 0, 4), pair(7, 0) };
+    uint8_t rep[32];
+
+    memcpy(req + 2, "MIT-SHM", 7);
+    write_all(req, sizeof(req));
+    expect(rep, X_REPLY, ++sequence, "QueryExtension");
+    return rep[8] ? rep[9] : 0;
+}
+
+/* The other client's part: events for this one, while it isn't reading. */
+static void
+make_events(void)
+{
+    for (int i = 0; i < EVENTS; i++) {
+        uint32_t value = i;
+
+        xcb_change_property(c, XCB_PROP_MODE_REPLACE, window, property,
+                            XCB_ATOM_INTEGER, 32, 1, &value);
+        free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+    }
+}
+
+/* After the reply to request seq, exactly the events made for it. */
+static void
+expect_events(unsigned int seq, const char *what)
+{
+    uint8_t ev[32];
+
+    for (int i = 0; i < EVENTS; i++)
+        expect(ev, X_PROPERTY_NOTIFY, seq, what);
+    sync_raw(what);
+}
+
+static void
+compare(const uint32_t *image, const char *what)
+{
+    if (memcmp(image, banded, image_size) != 0) {
+        fprintf(stderr, "%s doesn't match the image got in bands\n", what);
+        exit(1);
+    }
+}
+
+static void
+get_image(void)
+{
+    uint32_t req[5] = {
+        pack(X_GET_IMAGE, Z_PIXMAP, 5), pixmap, 0, pair(WIDTH, HEIGHT), ~0
+    };
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    uint8_t rep[32];
+    uint32_t *image;
+
+    write_all(req, sizeof(req));
+    /* the reply has started, and won't fit in the socket */
+    if (poll(&pfd, 1, 10000) != 1) {
+        fprintf(stderr, "Timed out waiting for GetImage\n");
+        exit(1);
+    }
+    make_events();
+
+    expect(rep, X_REPLY, ++sequence, "GetImage");
+    if (*(uint32_t *) (rep + 4) * 4 != image_size) {
+        fprintf(stderr, "GetImage replied %u bytes, expected %zu\n",
+                *(uint32_t *) (rep + 4) * 4, image_size);
+        exit(1);
+    }
+    image = malloc(image_size);
+    read_all(image, image_size);
+    compare(image, "GetImage");
+    free(image);
+    expect_events(sequence, "events after GetImage");
+}
+
+static void
+shm_get_image(uint8_t shm_opcode)
+{
+    uint32_t attach[4] = { pack(shm_opcode, X_SHM_ATTACH, 4), id_base };
+    uint32_t req[8] = {
+        pack(shm_opcode, X_SHM_GET_IMAGE, 8), pixmap, 0, pair(WIDTH, HEIGHT),
+        ~0, pack(Z_PIXMAP, 0, 0), id_base, 0
+    };
+    uint32_t sync = pack(X_GET_INPUT_FOCUS, 0, 1);
+    uint8_t rep[32];
+    uint32_t *image;
+    int shmid;
+
+    shmid = shmget(IPC_PRIVATE, image_size, IPC_CREAT | 0600);
+    if (shmid < 0) {
+        printf("No shared memory, skipping ShmGetImage\n");
+        return;
+    }
+    image = shmat(shmid, NULL, 0);
+    memset(image, 0, image_size);
+    attach[2] = shmid;
+    write_all(attach, sizeof(attach));
+    sequence++;
+    write_all(&sync, sizeof(sync));
+    read_all(rep, sizeof(rep));
+    shmctl(shmid, IPC_RMID, NULL);
+    if (rep[0] == X_ERROR) {
+        printf("Can't attach the segment, skipping ShmGetImage\n");
+        shmdt(image);
+        return;
+    }
+    sequence++;
+
+    write_all(req, sizeof(req));
+    make_events();
+
+    expect(rep, X_REPLY, ++sequence, "ShmGetImage");
+    if (*(uint32_t *) (rep + 12) != image_size) {
+        fprintf(stderr, "ShmGetImage replied %u bytes, expected %zu\n",
+                *(uint32_t *) (rep + 12), image_size);
+        exit(1);
+    }
+    compare(image, "ShmGetImage");
+    expect_events(sequence, "events after ShmGetImage");
+    shmdt(image);
+}
+
+int main(int argc, char **argv)
+{
+    const char *display = getenv("DISPLAY");
+    const char *colon = display ? strrchr(display, ':') : NULL;
+    xcb_screen_t *screen;
+    xcb_gcontext_t gc;
+    xcb_intern_atom_reply_t *atom;
+    uint32_t *pattern;
+    uint8_t shm_opcode;
+
+    if (!colon) {
+        fprintf(stderr, "No DISPLAY\n");
+        exit(1);
+    }
+
+    c = xcb_connect(NULL, NULL);
+    if (xcb_connection_has_error(c)) {
+        fprintf(stderr, "Can't connect to the server\n");
+        exit(1);
+    }
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    if (screen->root_depth != 24) {
+        printf("Root depth %d, not 24\n", screen->root_depth);
+        exit(77);
+    }
+    image_size = (size_t) WIDTH * HEIGHT * 4;
+
+    atom = xcb_intern_atom_reply(c, xcb_intern_atom(c, 0, 15,
+                                                    "GETIMAGE_EVENTS"),
+                                 NULL);
+    property = atom->atom;
+    free(atom);
+
+    window = xcb_generate_id(c);
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, window, screen->root, 0, 0,
+                      1, 1, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                      XCB_COPY_FROM_PARENT, 0, NULL);
+    pixmap = xcb_generate_id(c);
+    xcb_create_pixmap(c, 24, pixmap, screen->root, WIDTH, HEIGHT);
+    gc = xcb_generate_id(c);
+    xcb_create_gc(c, gc, pixmap, 0, NULL);
+
+    pattern = malloc(image_size);
+    for (int i = 0; i < WIDTH * HEIGHT; i++)
+        pattern[i] = (i * 2654435761u) & 0xffffff;
+    for (int y = 0; y < HEIGHT; y += BAND)
+        xcb_put_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP, pixmap, gc, WIDTH, BAND,
+                      0, y, 0, 24, WIDTH * BAND * 4,
+                      (uint8_t *) (pattern + y * WIDTH));
+
+    /* the same image, in requests that are each done in one go */
+    banded = malloc(image_size);
+    for (int y = 0; y < HEIGHT; y += BAND) {
+        xcb_get_image_reply_t *band =
+            xcb_get_image_reply(c, xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                                 pixmap, 0, y, WIDTH, BAND,
+                                                 ~0), NULL);
+
+        if (!band || xcb_get_image_data_length(band) != WIDTH * BAND * 4) {
+            fprintf(stderr, "GetImage of lines %d to %d failed\n", y,
+                    y + BAND);
+            exit(1);
+        }
+        memcpy(banded + y * WIDTH, xcb_get_image_data(band),
+               WIDTH * BAND * 4);
+        free(band);
+    }
+    if (memcmp(banded, pattern, image_size) != 0) {
+        fprintf(stderr, "GetImage in bands doesn't match what was put\n");
+        exit(1);
+    }
+    free(pattern);
+
+    connect_unix(atoi(colon + 1));
+    select_property_events();
+    shm_opcode = query_shm();
+
+    get_image();
+    if (shm_opcode)
+        shm_get_image(shm_opcode);
+    else
+        printf("No MIT-SHM, skipping ShmGetImage\n");
+
+    close(fd);
+    xcb_free_gc(c, gc);
+    xcb_free_pixmap(c, pixmap);
+    xcb_destroy_window(c, window);
+    xcb_disconnect(c);
+    exit(0);
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Puts small parts of a shared memory image, which the server draws by
+ * wrapping the segment in a scratch pixmap and copying from it, and
+ * checks what lands in the pixmap.  Run against Xvfb -fbbatch, where the
+ * copies are recorded and drawn after the scratch pixmap is gone.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <xcb/xcb.h>
+#include <xcb/shm.h>
+
+#define SIZE 64
+#define NPUTS 40
+
+static uint32_t
+pattern(int x, int y)
+{
+    return ((x * 7 + y * 13) * 0x010203) & 0xffffff;
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    const xcb_query_extension_reply_t *ext = xcb_get_extension_data(c, &xcb_shm_id);
+    xcb_screen_t *screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    uint32_t expected[SIZE * SIZE] = { 0 };
+    xcb_pixmap_t pixmap;
+    xcb_gcontext_t gc;
+    xcb_shm_seg_t seg;
+    xcb_get_image_reply_t *image;
+    xcb_generic_error_t *error;
+    uint32_t *data, *got;
+    int shmid;
+
+    if (!ext->present) {
+        printf("No MIT-SHM present\n");
+        exit(77);
+    }
+    if (screen->root_depth != 24) {
+        printf("Needs a depth 24 screen\n");
+        exit(77);
+    }
+
+    shmid = shmget(IPC_PRIVATE, SIZE * SIZE * 4, IPC_CREAT | 0600);
+    if (shmid < 0) {
+        printf("No shared memory\n");
+        exit(77);
+    }
+    data = shmat(shmid, NULL, 0);
+    shmctl(shmid, IPC_RMID, NULL);
+    for (int y = 0; y < SIZE; y++)
+        for (int x = 0; x < SIZE; x++)
+            data[y * SIZE + x] = pattern(x, y);
+
+    seg = xcb_generate_id(c);
+    error = xcb_request_check(c, xcb_shm_attach_checked(c, seg, shmid, 1));
+    if (error) {
+        printf("Can't attach the segment\n");
+        exit(77);
+    }
+
+    pixmap = xcb_generate_id(c);
+    xcb_create_pixmap(c, 24, pixmap, screen->root, SIZE, SIZE);
+    gc = xcb_generate_id(c);
+    xcb_create_gc(c, gc, pixmap, XCB_GC_FOREGROUND, (uint32_t[]) { 0 });
+    xcb_poly_fill_rectangle(c, pixmap, gc, 1,
+                            (xcb_rectangle_t[]) { { 0, 0, SIZE, SIZE } });
+
+    /* Small puts from all over the image, none of them all of it */
+    for (int i = 0; i < NPUTS; i++) {
+        int sx = (i * 11) % (SIZE - 8), sy = (i * 5) % (SIZE - 8);
+        int dx = (i * 17) % (SIZE - 8), dy = (i * 3) % (SIZE - 8);
+        int w = 1 + i % 8, h = 1 + (i / 3) % 8;
+
+        xcb_shm_put_image(c, pixmap, gc, SIZE, SIZE, sx, sy, w, h, dx, dy,
+                          24, XCB_IMAGE_FORMAT_Z_PIXMAP, 0, seg, 0);
+        for (int y = 0; y < h; y++)
+            for (int x = 0; x < w; x++)
+                expected[(dy + y) * SIZE + dx + x] = pattern(sx + x, sy + y);
+    }
+
+    image = xcb_get_image_reply(c, xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                                 pixmap, 0, 0, SIZE, SIZE,
+                                                 ~0),
+                                NULL);
+    if (!image) {
+        fprintf(stderr, "GetImage failed\n");
+        exit(1);
+    }
+    if (xcb_get_image_data_length(image) != SIZE * SIZE * 4) {
+        fprintf(stderr, "GetImage returned %d bytes\n",
+                xcb_get_image_data_length(image));
+        exit(1);
+    }
+    got = (uint32_t *) xcb_get_image_data(image);
+    for (int i = 0; i < SIZE * SIZE; i++) {
+        if ((got[i] & 0xffffff) != expected[i]) {
+            fprintf(stderr, "Pixel %d,%d is 0x%06x, expected 0x%06x\n",
+                    i % SIZE, i / SIZE, got[i] & 0xffffff, expected[i]);
+            exit(1);
+        }
+    }
+    free(image);
+
+    xcb_shm_detach(c, seg);
+    xcb_disconnect(c);
+    shmdt(data);
+    exit(0);
+}
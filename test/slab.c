@@ -0,0 +1,175 @@
+/**
+ * Copyright © 2026 X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <dix-config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dix/slab_priv.h"
+
+#include "misc.h"
+#include "regionstr.h"
+#include "tests-common.h"
+
+#define NUM_OBJECTS 10000
+#define NUM_STEPS 100000
+
+static void
+slab_churn(void)
+{
+    unsigned char **objects = calloc(NUM_OBJECTS, sizeof(unsigned char *));
+    DixSlabStatsRec stats;
+    int i, live = 0;
+
+    assert(objects);
+    srand(17);
+    for (i = 0; i < NUM_STEPS; i++) {
+        int n = rand() % NUM_OBJECTS;
+
+        if (objects[n]) {
+            /* nobody else wrote over it */
+            assert(objects[n][0] == (n & 0xff));
+            assert(objects[n][199] == (n & 0xff));
+            dixSlabFree(objects[n]);
+            objects[n] = NULL;
+            live--;
+        }
+        else {
+            objects[n] = dixSlabAlloc(SLAB_WINDOW, 200);
+            assert(objects[n]);
+            /* aligned for anything, as from malloc() */
+            assert(((uintptr_t) objects[n] & (2 * sizeof(void *) - 1)) == 0);
+            memset(objects[n], n & 0xff, 200);
+            live++;
+        }
+    }
+
+    dixSlabStats(SLAB_WINDOW, &stats);
+    dbg("%lu live, %lu cached, %lu bytes\n",
+        stats.live, stats.cached, stats.bytes);
+    assert(stats.live == live);
+    assert(stats.bytes >= (stats.live + stats.cached) * 200);
+
+    for (i = 0; i < NUM_OBJECTS; i++)
+        dixSlabFree(objects[i]);
+    free(objects);
+
+    /* one empty slab is kept around, the rest is gone */
+    dixSlabStats(SLAB_WINDOW, &stats);
+    assert(stats.live == 0);
+    assert(stats.cached > 0 && stats.bytes < 20000);
+
+    dixSlabReset();
+    dixSlabStats(SLAB_WINDOW, &stats);
+    assert(stats.cached == 0 && stats.bytes == 0);
+}
+
+static void
+slab_sizes(void)
+{
+    void *small, *other, *big;
+    DixSlabStatsRec stats;
+    int i;
+
+    small = dixSlabAlloc(SLAB_PIXMAP, 100);
+    other = dixSlabAlloc(SLAB_PIXMAP, 300);
+    big = dixSlabAlloc(SLAB_PIXMAP, 1 << 20);
+    assert(small && other && big);
+    assert(((uintptr_t) other & (2 * sizeof(void *) - 1)) == 0);
+    assert(((uintptr_t) big & (2 * sizeof(void *) - 1)) == 0);
+    memset(big, 0, 1 << 20);
+
+    dixSlabStats(SLAB_PIXMAP, &stats);
+    assert(stats.live == 3);
+    /* big ones don't go in a slab */
+    assert(stats.bytes < (1 << 20));
+
+    /* other types are counted on their own */
+    dixSlabStats(SLAB_GC, &stats);
+    assert(stats.live == 0 && stats.bytes == 0);
+
+    dixSlabFree(big);
+    dixSlabFree(other);
+    dixSlabFree(small);
+    dixSlabStats(SLAB_PIXMAP, &stats);
+    assert(stats.live == 0);
+
+    /* cleared ones are, whether from a slab or not */
+    other = dixSlabAlloc(SLAB_PIXMAP, 300);
+    assert(other);
+    memset(other, 0xff, 300);
+    dixSlabFree(other);
+    other = dixSlabCalloc(SLAB_PIXMAP, 300);
+    big = dixSlabCalloc(SLAB_PIXMAP, 1 << 20);
+    assert(other && big);
+    for (i = 0; i < 300; i++)
+        assert(((char *) other)[i] == 0);
+    for (i = 0; i < 1 << 20; i++)
+        assert(((char *) big)[i] == 0);
+    dixSlabFree(big);
+    dixSlabFree(other);
+}
+
+static void
+slab_regions(void)
+{
+    BoxRec box = { 0, 0, 10, 10 };
+    RegionPtr regions[100];
+    DixSlabStatsRec stats;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(regions); i++) {
+        regions[i] = RegionCreate(&box, 1);
+        assert(regions[i] && !RegionNar(regions[i]));
+        box.x2++;
+    }
+
+    dixSlabStats(SLAB_REGION, &stats);
+    assert(stats.live == ARRAY_SIZE(regions));
+
+    for (i = 0; i < ARRAY_SIZE(regions); i++) {
+        assert(regions[i]->extents.x2 == 10 + i);
+        RegionDestroy(regions[i]);
+    }
+
+    dixSlabStats(SLAB_REGION, &stats);
+    assert(stats.live == 0);
+}
+
+const testfunc_t*
+slab_test(void)
+{
+    static const testfunc_t testfuncs[] = {
+        slab_churn,
+        slab_sizes,
+        slab_regions,
+        NULL,
+    };
+
+    return testfuncs;
+}
@@ -25,6 +25,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include <xcb/sync.h>
 
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
@@ -281,6 +284,139 @@ test_change_alarm_delta(xcb_connection_t *c)
     }
 }
 
+/* Puts 10000 alarms on one counter and steps the counter through all of
+ * them, so each change sets off exactly one.  Also a benchmark: the time
+ * this takes shouldn't depend much on how many alarms there are.
+ */
+static void
+test_many_alarms(xcb_connection_t *c, uint8_t first_event)
+{
+    const int num_alarms = 10000;
+    xcb_sync_counter_t counter = xcb_generate_id(c);
+    xcb_generic_event_t *ev;
+    struct timespec start, end;
+    int events = 0;
+
+    xcb_sync_create_counter(c, counter, sync_value(0));
+
+    for (int i = 0; i < num_alarms; i++) {
+        uint32_t values[] = {
+            counter,
+            XCB_SYNC_VALUETYPE_ABSOLUTE,
+            0, i + 1,
+            XCB_SYNC_TESTTYPE_POSITIVE_TRANSITION,
+            0, 0,
+        };
+
+        xcb_sync_create_alarm(c, xcb_generate_id(c),
+                              XCB_SYNC_CA_COUNTER | XCB_SYNC_CA_VALUE_TYPE |
+                              XCB_SYNC_CA_VALUE | XCB_SYNC_CA_TEST_TYPE |
+                              XCB_SYNC_CA_DELTA, values);
+    }
+    counter_value(c, xcb_sync_query_counter(c, counter));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < num_alarms; i++)
+        xcb_sync_change_counter(c, counter, sync_value(1));
+    counter_value(c, xcb_sync_query_counter(c, counter));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    while ((ev = xcb_poll_for_queued_event(c))) {
+        if ((ev->response_type & 0x7f) == first_event + XCB_SYNC_ALARM_NOTIFY)
+            events++;
+        free(ev);
+    }
+
+    printf("%d counter changes with %d alarms: %.1f ms\n", num_alarms,
+           num_alarms, (end.tv_sec - start.tv_sec) * 1e3 +
+           (end.tv_nsec - start.tv_nsec) / 1e6);
+
+    if (events != num_alarms) {
+        fprintf(stderr, "%d alarms went off, expected %d\n",
+                events, num_alarms);
+        exit(1);
+    }
+}
+
+static xcb_sync_counter_t
+system_counter(xcb_connection_t *c, const char *name)
+{
+    xcb_sync_list_system_counters_reply_t *reply =
+        xcb_sync_list_system_counters_reply(c,
+            xcb_sync_list_system_counters(c), NULL);
+    xcb_sync_systemcounter_iterator_t iter =
+        xcb_sync_list_system_counters_counters_iterator(reply);
+    xcb_sync_counter_t counter = XCB_NONE;
+
+    for (; iter.rem; xcb_sync_systemcounter_next(&iter)) {
+        if (iter.data->name_len == strlen(name) &&
+            !memcmp(xcb_sync_systemcounter_name(iter.data), name,
+                    iter.data->name_len))
+            counter = iter.data->counter;
+    }
+    free(reply);
+    return counter;
+}
+
+/* With an alarm on SERVERTIME a minute away and one waiting for input on
+ * IDLETIME, the server has no reason to wake up until the next request.
+ * An alarm on SERVERTIME a little later has to go off in time though.
+ */
+static void
+test_idle_wakeups(xcb_connection_t *c, uint8_t first_event)
+{
+    xcb_sync_counter_t servertime = system_counter(c, "SERVERTIME");
+    xcb_sync_counter_t idletime = system_counter(c, "IDLETIME");
+    xcb_sync_counter_t wakeups = system_counter(c, "SERVERWAKEUPS");
+    int64_t before, after;
+    xcb_generic_event_t *ev;
+    uint8_t type;
+    uint32_t later[] = {
+        servertime,
+        XCB_SYNC_VALUETYPE_RELATIVE,
+        0, 60000,
+        XCB_SYNC_TESTTYPE_POSITIVE_COMPARISON,
+    };
+    uint32_t input[] = {
+        idletime,
+        XCB_SYNC_VALUETYPE_ABSOLUTE,
+        0, 100,
+        XCB_SYNC_TESTTYPE_NEGATIVE_TRANSITION,
+    };
+    uint32_t soon[] = {
+        servertime,
+        XCB_SYNC_VALUETYPE_RELATIVE,
+        0, 200,
+        XCB_SYNC_TESTTYPE_POSITIVE_COMPARISON,
+    };
+    uint32_t mask = XCB_SYNC_CA_COUNTER | XCB_SYNC_CA_VALUE_TYPE |
+        XCB_SYNC_CA_VALUE | XCB_SYNC_CA_TEST_TYPE;
+
+    assert(servertime && idletime && wakeups);
+
+    xcb_sync_create_alarm(c, xcb_generate_id(c), mask, later);
+    xcb_sync_create_alarm(c, xcb_generate_id(c), mask, input);
+    before = counter_value(c, xcb_sync_query_counter(c, wakeups));
+    usleep(500 * 1000);
+    after = counter_value(c, xcb_sync_query_counter(c, wakeups));
+
+    printf("%d server wakeups in 500 ms\n", (int) (after - before));
+    if (after - before > 10) {
+        fprintf(stderr, "server woke up %d times while idle\n",
+                (int) (after - before));
+        exit(1);
+    }
+
+    xcb_sync_create_alarm(c, xcb_generate_id(c), mask, soon);
+    xcb_flush(c);
+    do {
+        ev = xcb_wait_for_event(c);
+        assert(ev);
+        type = ev->response_type & 0x7f;
+        free(ev);
+    } while (type != first_event + XCB_SYNC_ALARM_NOTIFY);
+}
+
 int main(int argc, char **argv)
 {
     int screen;
@@ -298,6 +434,8 @@ int main(int argc, char **argv)
     test_change_counter_overflow(c);
     test_change_alarm_value(c);
     test_change_alarm_delta(c);
+    test_many_alarms(c, ext->first_event);
+    test_idle_wakeups(c, ext->first_event);
 
     xcb_disconnect(c);
     exit(0);
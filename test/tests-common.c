@@ -2,6 +2,7 @@
 #include <sys/wait.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "tests-common.h"
@@ -38,3 +39,12 @@ run_test_in_child(const testfunc_t* (*suite)(void), const char *funcname)
     }
     printf(" Pass\n");
 }
+
+double
+now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
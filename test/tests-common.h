@@ -10,4 +10,7 @@
 
 void run_test_in_child(const testfunc_t* (*func)(void), const char *funcname);
 
+/* Monotonic time in milliseconds, for timing benchmarks */
+double now_ms(void);
+
 #endif /* TESTS_COMMON_H */
@@ -0,0 +1,183 @@
+/**
+ * Copyright © 2026 X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+/* Test relies on assert() */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <dix-config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "os/osdep.h"
+
+#include "misc.h"
+#include "os.h"
+#include "tests-common.h"
+
+#define NUM_ORDER_TIMERS 1000
+#define NUM_BENCH_TIMERS 100000
+
+static CARD32 expires[NUM_ORDER_TIMERS];
+static int set_order[NUM_ORDER_TIMERS];
+static int num_set;
+static int fired[NUM_ORDER_TIMERS];
+static int num_fired;
+static CARD32 last_expiry;
+static int last_set;
+
+static CARD32
+order_callback(OsTimerPtr timer, CARD32 now, void *arg)
+{
+    int i = (intptr_t) arg;
+
+    /* never early, in order of expiry, and in the order set when due together */
+    assert((int) (now - expires[i]) >= 0);
+    assert(num_fired == 0 || (int) (expires[i] - last_expiry) >= 0);
+    assert(num_fired == 0 || expires[i] != last_expiry ||
+           set_order[i] > last_set);
+    last_expiry = expires[i];
+    last_set = set_order[i];
+    fired[i]++;
+    num_fired++;
+    return 0;
+}
+
+static void
+timer_order(void)
+{
+    static OsTimerPtr timers[NUM_ORDER_TIMERS];
+    CARD32 start = GetTimeInMillis();
+    int i, expected = 0;
+
+    srand(1);
+    for (i = 0; i < NUM_ORDER_TIMERS; i++) {
+        expires[i] = start + 5 + rand() % 30;
+        set_order[i] = num_set++;
+        timers[i] = TimerSet(NULL, TimerAbsolute, expires[i],
+                             order_callback, (void *) (intptr_t) i);
+        assert(timers[i]);
+    }
+
+    /* cancel some, move some */
+    for (i = 0; i < NUM_ORDER_TIMERS; i += 3)
+        TimerCancel(timers[i]);
+    for (i = 1; i < NUM_ORDER_TIMERS; i += 3) {
+        expires[i] = start + 5 + rand() % 30;
+        set_order[i] = num_set++;
+        TimerSet(timers[i], TimerAbsolute, expires[i],
+                 order_callback, (void *) (intptr_t) i);
+    }
+
+    while ((int) (GetTimeInMillis() - (start + 40)) < 0)
+        TimerCheck();
+
+    for (i = 0; i < NUM_ORDER_TIMERS; i++) {
+        assert(fired[i] == (i % 3 ? 1 : 0));
+        expected += fired[i];
+        TimerFree(timers[i]);
+    }
+    assert(num_fired == expected);
+}
+
+static int repeats;
+
+static CARD32
+repeat_callback(OsTimerPtr timer, CARD32 now, void *arg)
+{
+    return ++repeats < 3 ? 1 : 0;
+}
+
+static void
+timer_repeat(void)
+{
+    OsTimerPtr timer = TimerSet(NULL, 0, 1, repeat_callback, NULL);
+    CARD32 start = GetTimeInMillis();
+
+    while (repeats < 3 && GetTimeInMillis() - start < 1000)
+        TimerCheck();
+    assert(repeats == 3);
+
+    /* forcing a timer that isn't pending does nothing */
+    assert(!TimerForce(timer));
+    TimerSet(timer, 0, 10000, repeat_callback, NULL);
+    assert(TimerForce(timer));
+    assert(repeats == 4);
+
+    TimerFree(timer);
+}
+
+static CARD32
+bench_callback(OsTimerPtr timer, CARD32 now, void *arg)
+{
+    assert(!"bench timers must not fire");
+    return 0;
+}
+
+static void
+timer_bench(void)
+{
+    static OsTimerPtr timers[NUM_BENCH_TIMERS];
+    double start, set, reset, cancel;
+    int i;
+
+    srand(2);
+    start = now_ms();
+    for (i = 0; i < NUM_BENCH_TIMERS; i++) {
+        timers[i] = TimerSet(NULL, 0, 3600000 + rand() % 3600000,
+                             bench_callback, NULL);
+        assert(timers[i]);
+    }
+    set = now_ms();
+
+    for (i = 0; i < NUM_BENCH_TIMERS; i++)
+        TimerSet(timers[i], 0, 3600000 + rand() % 3600000,
+                 bench_callback, NULL);
+    reset = now_ms();
+
+    for (i = 0; i < NUM_BENCH_TIMERS; i += 2)
+        TimerCancel(timers[i]);
+    TimerCheck();
+    cancel = now_ms();
+
+    dbg("%d timers: set %.2fms, reset %.2fms, cancel half %.2fms\n",
+        NUM_BENCH_TIMERS, set - start, reset - set, cancel - reset);
+
+    for (i = 0; i < NUM_BENCH_TIMERS; i++)
+        TimerFree(timers[i]);
+}
+
+const testfunc_t*
+timer_test(void)
+{
+    static const testfunc_t testfuncs[] = {
+        timer_order,
+        timer_repeat,
+        timer_bench,
+        NULL,
+    };
+
+    return testfuncs;
+}
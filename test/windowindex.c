@@ -0,0 +1,327 @@
+/**
+ * Copyright © 2026 X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <dix-config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dix/windowindex_priv.h"
+
+#include "misc.h"
+#include "dix.h"
+#include "inputstr.h"
+#include "mi.h"
+#include "privates.h"
+#include "scrnintstr.h"
+#include "windowstr.h"
+#include "tests-common.h"
+
+#define NUM_WINDOWS 10000
+#define NUM_TOPLEVELS 100
+#define NUM_PICKS 100000
+#define ROOT_WIDTH 1920
+#define ROOT_HEIGHT 1080
+
+static ScreenRec screen;
+static WindowRec root;
+static WindowRec windows[NUM_WINDOWS];
+static char *window_privates;  /* the root's, then each window's */
+static int window_privates_size;
+static SpriteRec sprite;
+
+/* link an unlinked window in on top of its siblings */
+static void
+window_raise(WindowPtr pWin)
+{
+    WindowPtr pParent = pWin->parent;
+
+    pWin->prevSib = NullWindow;
+    pWin->nextSib = pParent->firstChild;
+    if (pParent->firstChild)
+        pParent->firstChild->prevSib = pWin;
+    else
+        pParent->lastChild = pWin;
+    pParent->firstChild = pWin;
+    WindowIndexInvalidate(pParent);
+}
+
+/* window i, at the top of its parent's stack */
+static void
+window_add(int i, WindowPtr pParent, int x, int y, int w, int h)
+{
+    WindowPtr pWin = &windows[i];
+
+    memset(pWin, 0, sizeof(*pWin));
+    dixInitScreenPrivates(&screen, pWin,
+                          window_privates + (i + 1) * window_privates_size,
+                          PRIVATE_WINDOW);
+    pWin->drawable.pScreen = &screen;
+    pWin->drawable.x = pParent->drawable.x + x;
+    pWin->drawable.y = pParent->drawable.y + y;
+    pWin->drawable.width = w;
+    pWin->drawable.height = h;
+    pWin->origin.x = x;
+    pWin->origin.y = y;
+    pWin->borderWidth = i % 3;
+    pWin->mapped = TRUE;
+    pWin->parent = pParent;
+    window_raise(pWin);
+}
+
+static void
+window_unlink(WindowPtr pWin)
+{
+    WindowPtr pParent = pWin->parent;
+
+    if (pParent->firstChild == pWin)
+        pParent->firstChild = pWin->nextSib;
+    if (pParent->lastChild == pWin)
+        pParent->lastChild = pWin->prevSib;
+    if (pWin->nextSib)
+        pWin->nextSib->prevSib = pWin->prevSib;
+    if (pWin->prevSib)
+        pWin->prevSib->nextSib = pWin->nextSib;
+    pWin->nextSib = pWin->prevSib = NullWindow;
+    WindowIndexInvalidate(pParent);
+}
+
+static void
+window_move(WindowPtr pWin, int dx, int dy)
+{
+    pWin->drawable.x += dx;
+    pWin->drawable.y += dy;
+    pWin->origin.x += dx;
+    pWin->origin.y += dy;
+    WindowIndexUpdate(pWin);
+}
+
+static void
+tree_setup(void)
+{
+    int i;
+
+    /* the index lives in a window private */
+    dixResetPrivates();
+    screenInfo.numScreens = 1;
+    screenInfo.screens[0] = &screen;
+    dixInitScreenSpecificPrivates(&screen);
+    assert(WindowIndexInit());
+    window_privates_size = dixScreenSpecificPrivatesSize(&screen,
+                                                         PRIVATE_WINDOW);
+    window_privates = calloc(NUM_WINDOWS + 1, window_privates_size);
+    assert(window_privates);
+
+    memset(&root, 0, sizeof(root));
+    dixInitScreenPrivates(&screen, &root, window_privates, PRIVATE_WINDOW);
+    root.drawable.pScreen = &screen;
+    root.drawable.width = ROOT_WIDTH;
+    root.drawable.height = ROOT_HEIGHT;
+    root.mapped = TRUE;
+
+    /* a few big toplevels with children, then lots of small popups */
+    srand(1);
+    for (i = 0; i < NUM_TOPLEVELS; i++)
+        window_add(i, &root, rand() % ROOT_WIDTH - 200,
+                   rand() % ROOT_HEIGHT - 200, 400, 300);
+    for (; i < NUM_WINDOWS; i++) {
+        if (i % 4 == 0)
+            window_add(i, &windows[rand() % NUM_TOPLEVELS],
+                       rand() % 400, rand() % 300, 30, 20);
+        else
+            window_add(i, &root, rand() % ROOT_WIDTH, rand() % ROOT_HEIGHT,
+                       1 + rand() % 120, 1 + rand() % 40);
+        if (i % 7 == 0)
+            windows[i].mapped = FALSE;
+    }
+
+    sprite.spriteTraceSize = 1;
+    sprite.spriteTrace = calloc(1, sizeof(WindowPtr));
+    sprite.spriteTrace[0] = &root;
+}
+
+static void
+tree_teardown(void)
+{
+    int i;
+
+    for (i = 0; i < NUM_TOPLEVELS; i++)
+        WindowIndexDestroy(&windows[i]);
+    WindowIndexDestroy(&root);
+    free(window_privates);
+    free(sprite.spriteTrace);
+    memset(&sprite, 0, sizeof(sprite));
+}
+
+static Bool
+hit_any(WindowPtr pWin, int x, int y)
+{
+    return TRUE;
+}
+
+/* WindowIndexPick() only answers for windows with an index */
+static Bool
+has_index(WindowPtr pWin)
+{
+    WindowPtr pFound;
+
+    return WindowIndexPick(pWin, 0, 0, hit_any, &pFound);
+}
+
+/* what miSpriteTrace() did before it had an index */
+static WindowPtr
+pick_walk(int x, int y)
+{
+    WindowPtr pWin = root.firstChild, pFound = &root;
+
+    while (pWin) {
+        int bw = wBorderWidth(pWin);
+
+        if (pWin->mapped &&
+            x >= pWin->drawable.x - bw &&
+            x < pWin->drawable.x + (int) pWin->drawable.width + bw &&
+            y >= pWin->drawable.y - bw &&
+            y < pWin->drawable.y + (int) pWin->drawable.height + bw) {
+            pFound = pWin;
+            pWin = pWin->firstChild;
+        }
+        else
+            pWin = pWin->nextSib;
+    }
+    return pFound;
+}
+
+static void
+pick_check(int npicks)
+{
+    int i;
+
+    for (i = 0; i < npicks; i++) {
+        int x = rand() % (ROOT_WIDTH + 40) - 20;
+        int y = rand() % (ROOT_HEIGHT + 40) - 20;
+
+        assert(miXYToWindow(&screen, &sprite, x, y) == pick_walk(x, y));
+    }
+}
+
+static void
+windowindex_pick(void)
+{
+    int i;
+
+    tree_setup();
+
+    /* a walk past all of them creates the index, later picks use it */
+    assert(miXYToWindow(&screen, &sprite, -10000, -10000) == &root);
+    assert(has_index(&root));
+    pick_check(10000);
+
+    /* every point of a window on top finds it */
+    window_unlink(&windows[500]);
+    window_add(500, &root, 100, 100, 50, 50);
+    for (i = 0; i < 50 * 50; i++)
+        assert(miXYToWindow(&screen, &sprite, 100 + i % 50, 100 + i / 50) ==
+               &windows[500]);
+
+    /* moves, including off the grid, maps and unmaps */
+    for (i = NUM_TOPLEVELS; i < NUM_WINDOWS; i += 13) {
+        window_move(&windows[i], rand() % 201 - 100, rand() % 201 - 100);
+        if (i % 2)
+            window_move(&windows[i], 3000, -2000);
+        windows[i].mapped = !windows[i].mapped;
+        WindowIndexUpdate(&windows[i]);
+    }
+    pick_check(10000);
+
+    /* raising and destroying */
+    for (i = NUM_TOPLEVELS; i < NUM_WINDOWS; i += 11) {
+        window_unlink(&windows[i]);
+        if (i % 2)
+            window_raise(&windows[i]);
+    }
+    pick_check(10000);
+
+    /* moving a toplevel takes its children along */
+    for (i = 0; i < NUM_TOPLEVELS; i++) {
+        WindowPtr pChild;
+
+        window_move(&windows[i], 37, -21);
+        for (pChild = windows[i].firstChild; pChild; pChild = pChild->nextSib) {
+            pChild->drawable.x += 37;
+            pChild->drawable.y -= 21;
+            WindowIndexUpdate(pChild);
+        }
+    }
+    pick_check(10000);
+
+    /* down to a handful of children the index goes away */
+    while (root.firstChild)
+        window_unlink(root.firstChild);
+    assert(miXYToWindow(&screen, &sprite, 10, 10) == &root);
+    assert(!has_index(&root));
+
+    tree_teardown();
+}
+
+static void
+windowindex_pick_bench(void)
+{
+    double start, mid, end;
+    int i, found = 0;
+
+    tree_setup();
+    assert(miXYToWindow(&screen, &sprite, -10000, -10000) == &root);
+
+    srand(2);
+    start = now_ms();
+    for (i = 0; i < NUM_PICKS; i++)
+        found += pick_walk(rand() % ROOT_WIDTH, rand() % ROOT_HEIGHT) != &root;
+    mid = now_ms();
+    srand(2);
+    for (i = 0; i < NUM_PICKS; i++)
+        found -= miXYToWindow(&screen, &sprite, rand() % ROOT_WIDTH,
+                              rand() % ROOT_HEIGHT) != &root;
+    end = now_ms();
+    assert(found == 0);
+
+    dbg("%d picks among %d windows: %.2fms walking, %.2fms indexed\n",
+        NUM_PICKS, NUM_WINDOWS, mid - start, end - mid);
+
+    tree_teardown();
+}
+
+const testfunc_t*
+windowindex_test(void)
+{
+    static const testfunc_t testfuncs[] = {
+        windowindex_pick,
+        windowindex_pick_bench,
+        NULL,
+    };
+
+    return testfuncs;
+}